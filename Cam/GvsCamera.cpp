@@ -23,6 +23,8 @@
 GvsCamera::GvsCamera() : GvsBase(),
     aspectRatio(1.0),
     camFilter(gvsCamFilterRGB),
+    mProgressiveBlock(0), mProgressiveError(0.001),
+    mBgTableStep(0), mBgTableError(0.001),
     mRedShift(false), mTimeShift(false), mPolarisation(false), mAllData(false), mMask(false),
     mIsStereoCam(false) {
     viewResolution = m4d::ivec2(720,576);
@@ -31,6 +33,8 @@ GvsCamera::GvsCamera() : GvsBase(),
 GvsCamera::GvsCamera( const GvsCamFilter filter ) :
     aspectRatio(1.0),
     camFilter(filter),
+    mProgressiveBlock(0), mProgressiveError(0.001),
+    mBgTableStep(0), mBgTableError(0.001),
     mRedShift(false), mTimeShift(false), mPolarisation(false), mAllData(false), mMask(false),
     mIsStereoCam(false) {
     viewResolution = m4d::ivec2(720,576);
@@ -93,6 +97,32 @@ GvsCamFilter GvsCamera::getCamFilter ( ) const {
     return camFilter;
 }
 
+void GvsCamera::setProgressive ( int blockSize, double maxError ) {
+    mProgressiveBlock = blockSize;
+    mProgressiveError = maxError;
+}
+
+int GvsCamera::getProgressiveBlock ( ) const {
+    return mProgressiveBlock;
+}
+
+double GvsCamera::getProgressiveError ( ) const {
+    return mProgressiveError;
+}
+
+void GvsCamera::setBackgroundTable ( int step, double maxError ) {
+    mBgTableStep = step;
+    mBgTableError = maxError;
+}
+
+int GvsCamera::getBackgroundTableStep ( ) const {
+    return mBgTableStep;
+}
+
+double GvsCamera::getBackgroundTableError ( ) const {
+    return mBgTableError;
+}
+
 bool GvsCamera::isRedshift() {
     return mRedShift;
 }
@@ -126,5 +156,11 @@ void GvsCamera::Print( FILE* fptr ) {
     fprintf(fptr,"Camera {\n");
     fprintf(fptr,"\tres  %4d x %4d\n",viewResolution.x(0),viewResolution.x(1));
     fprintf(fptr,"\tfilt %s\n",GvsCamFilterNames[camFilter].c_str());
+    if (mProgressiveBlock > 1) {
+        fprintf(fptr,"\tprog %d  err %g\n",mProgressiveBlock,mProgressiveError);
+    }
+    if (mBgTableStep > 1) {
+        fprintf(fptr,"\tbgtable %d  err %g\n",mBgTableStep,mBgTableError);
+    }
     fprintf(fptr,"}\n");
 }
@@ -45,6 +45,31 @@ public:
     void         setCamFilter ( GvsCamFilter filter );
     GvsCamFilter getCamFilter ( ) const;
 
+    /**
+     * Progressive rendering.
+     *   The image is traced on a grid of blocks. The pixels of a block whose
+     *   corner and center rays hit the same object, and whose texture
+     *   coordinates deviate at most 'maxError' from the bilinear interpolation,
+     *   are interpolated instead of traced. Otherwise, the block is split.
+     * @param blockSize  edge length of the coarse blocks; less than 2 disables it
+     * @param maxError   maximum interpolation error of the texture coordinates
+     */
+    void   setProgressive      ( int blockSize, double maxError );
+    int    getProgressiveBlock ( ) const;
+    double getProgressiveError ( ) const;
+
+    /**
+     * Table of the background, see GvsBackgroundTable.
+     *   Samples in cells of 'step' pixels whose corner and center rays all
+     *   hit the background object, or all miss every object, are taken from
+     *   the table instead of being traced.
+     * @param step      edge length of the cells; less than 2 disables the table
+     * @param maxError  maximum interpolation error of the texture coordinates
+     */
+    void   setBackgroundTable      ( int step, double maxError );
+    int    getBackgroundTableStep  ( ) const;
+    double getBackgroundTableError ( ) const;
+
     void   setAspectRatio     ( double a );
     double getAspectRatio     ( ) const;
 
@@ -74,6 +99,12 @@ protected:
 
     GvsCamFilter camFilter;      //!< Camera filter: RGB, RGBpdz, RGBjac
 
+    int    mProgressiveBlock;    //!< Block size of progressive rendering, 0: off
+    double mProgressiveError;    //!< Maximum error of interpolated texture coordinates
+
+    int    mBgTableStep;         //!< Cell size of the background table, 0: off
+    double mBgTableError;        //!< Maximum error of texture coordinates from the table
+
     bool mRedShift;
     bool mTimeShift;
     bool mPolarisation;
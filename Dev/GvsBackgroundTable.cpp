@@ -0,0 +1,184 @@
+/**
+ * @file    GvsBackgroundTable.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Dev/GvsBackgroundTable.h"
+#include "Dev/GvsBlockSample.h"
+#include "Dev/GvsDevice.h"
+#include "Obj/SolidObj/GvsSolBackground.h"
+
+#include <cmath>
+#include <thread>
+
+GvsBackgroundTable::GvsBackgroundTable( int step, double maxError )
+    : mStep(GVS_MAX(step, 2)),
+      mMaxError(maxError),
+      mNumX(0),
+      mNumY(0),
+      mNumResolved(0)
+{
+}
+
+
+void GvsBackgroundTable::build( std::vector<GvsDevice*> &devices ) {
+    mNodes.clear();
+    mResolved.clear();
+    mNumX = mNumY = mNumResolved = 0;
+    if (devices.empty()) {
+        return;
+    }
+
+    m4d::ivec2 res = devices[0]->camera->GetResolution();
+    mNumX = (res.x(0) + mStep - 1) / mStep;
+    mNumY = (res.x(1) + mStep - 1) / mStep;
+    mNodes.resize((mNumX + 1)*(mNumY + 1) + mNumX*mNumY);
+
+    std::atomic<size_t> next(0);
+    if (devices.size() == 1) {
+        traceNodes(devices[0], &next);
+    } else {
+        std::vector<std::thread> workers;
+        for (unsigned int w = 0; w < devices.size(); w++) {
+            workers.push_back(std::thread(&GvsBackgroundTable::traceNodes, this, devices[w], &next));
+        }
+        for (unsigned int w = 0; w < workers.size(); w++) {
+            workers[w].join();
+        }
+    }
+    classifyCells(devices[0]);
+}
+
+
+void GvsBackgroundTable::traceNodes( GvsDevice* device, std::atomic<size_t>* next ) {
+    int numCorners = (mNumX + 1)*(mNumY + 1);
+
+    size_t n;
+    while ((n = (*next)++) < mNodes.size()) {
+        // The corners lie on the pixel borders, such that the cells cover all subpixel samples.
+        int k = static_cast<int>(n);
+        int width = mNumX + 1;
+        double offset = -0.5;
+        if (k >= numCorners) {
+            k -= numCorners;
+            width = mNumX;
+            offset += 0.5*mStep;
+        }
+        double x = offset + (k % width)*mStep;
+        double y = offset + (k / width)*mStep;
+
+        gvsTraceBlockSample(device, x, y, mNodes[n]);
+    }
+}
+
+
+void GvsBackgroundTable::classifyCells( GvsDevice* device ) {
+    mResolved.assign(mNumX*mNumY, 0);
+    mNumResolved = 0;
+    for (int j = 0; j < mNumY; j++) {
+        for (int i = 0; i < mNumX; i++) {
+            const GvsBlockSample* corner[4] = { &mNodes[cornerNode(i,j)], &mNodes[cornerNode(i+1,j)],
+                                                &mNodes[cornerNode(i,j+1)], &mNodes[cornerNode(i+1,j+1)] };
+            const GvsBlockSample &center = mNodes[centerNode(i,j)];
+            const GvsSurface* object = center.key.object;
+            if (object != nullptr && dynamic_cast<const GvsSolBackground*>(object) == nullptr) {
+                continue;
+            }
+            if (gvsIsSmoothBlock(device, corner, center, 0.5, 0.5, mMaxError)) {
+                mResolved[j*mNumX + i] = 1;
+            }
+        }
+    }
+
+    // An object that fits between the rays of a cell is likely to also reach
+    // into a neighbouring cell; thus, the neighbours of unresolved cells are traced, too.
+    std::vector<char> sampled(mResolved);
+    for (int j = 0; j < mNumY; j++) {
+        for (int i = 0; i < mNumX; i++) {
+            bool isResolved = sampled[j*mNumX + i];
+            for (int nj = GVS_MAX(j - 1, 0); nj <= GVS_MIN(j + 1, mNumY - 1) && isResolved; nj++) {
+                for (int ni = GVS_MAX(i - 1, 0); ni <= GVS_MIN(i + 1, mNumX - 1) && isResolved; ni++) {
+                    isResolved = sampled[nj*mNumX + ni];
+                }
+            }
+            mResolved[j*mNumX + i] = isResolved;
+            if (isResolved) {
+                mNumResolved++;
+            }
+        }
+    }
+}
+
+
+bool GvsBackgroundTable::lookup( double x, double y, gvsSampleKey &key,
+                                 GvsSurfIntersec &surfIntersec, GvsColor &col ) const {
+    double tx, ty;
+    int cell = findCell(x, y, tx, ty);
+    if (cell < 0 || !mResolved[cell]) {
+        return false;
+    }
+
+    int i = cell % mNumX;
+    int j = cell / mNumX;
+    const GvsBlockSample* corner[4] = { &mNodes[cornerNode(i,j)], &mNodes[cornerNode(i+1,j)],
+                                        &mNodes[cornerNode(i,j+1)], &mNodes[cornerNode(i+1,j+1)] };
+    key = corner[0]->key;
+    if (key.object != nullptr) {
+        surfIntersec = gvsInterpolateHit(corner, tx, ty);
+    } else {
+        col = gvsInterpolateColor(corner, tx, ty);
+    }
+    return true;
+}
+
+
+bool GvsBackgroundTable::isResolved( double x, double y ) const {
+    double tx, ty;
+    int cell = findCell(x, y, tx, ty);
+    return (cell >= 0) && mResolved[cell];
+}
+
+
+int GvsBackgroundTable::findCell( double x, double y, double &tx, double &ty ) const {
+    double u = (x + 0.5)/mStep;
+    double v = (y + 0.5)/mStep;
+    int i = static_cast<int>(floor(u));
+    int j = static_cast<int>(floor(v));
+    if (i < 0 || i >= mNumX || j < 0 || j >= mNumY || mResolved.empty()) {
+        return -1;
+    }
+    tx = u - i;
+    ty = v - j;
+    return j*mNumX + i;
+}
+
+
+int GvsBackgroundTable::cornerNode( int i, int j ) const {
+    return j*(mNumX + 1) + i;
+}
+
+int GvsBackgroundTable::centerNode( int i, int j ) const {
+    return (mNumX + 1)*(mNumY + 1) + j*mNumX + i;
+}
+
+
+int GvsBackgroundTable::getStep() const {
+    return mStep;
+}
+
+int GvsBackgroundTable::getNumResolved() const {
+    return mNumResolved;
+}
+
+int GvsBackgroundTable::getNumCells() const {
+    return mNumX*mNumY;
+}
+
+
+void GvsBackgroundTable::Print( FILE* fptr ) const {
+    fprintf(fptr,"BackgroundTable {\n");
+    fprintf(fptr,"\tstep     : %d\n",mStep);
+    fprintf(fptr,"\tmaxError : %g\n",mMaxError);
+    fprintf(fptr,"\tcells    : %d of %d resolved\n",mNumResolved,mNumX*mNumY);
+    fprintf(fptr,"}\n");
+}
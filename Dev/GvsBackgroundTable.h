@@ -0,0 +1,105 @@
+/**
+ * @file    GvsBackgroundTable.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_BACKGROUND_TABLE_H
+#define GVS_BACKGROUND_TABLE_H
+
+#include <atomic>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+#include "Dev/GvsBlockSample.h"
+
+class GvsDevice;
+
+/**
+ * Table of the background seen by the observer.
+ *
+ *   The image is covered by cells of 'step' x 'step' pixels. The rays of
+ *   the cell corners and centers are traced once for the current pose of
+ *   the camera. A cell is resolved by the table if all five rays hit the
+ *   background object (GvsSolBackground), or all miss every object, and the
+ *   cell is smooth, see gvsIsSmoothBlock. The rays of any sample within a
+ *   resolved cell, subpixel samples included, are not traced: the
+ *   intersection with the background is interpolated and shaded, or the
+ *   color of the rays that were captured or escaped is interpolated.
+ *
+ *   All other cells, i.e. those whose rays hit or come close to any other
+ *   object, and their eight neighbours are traced as usual. The neighbours
+ *   catch the parts of an object that fit between the five rays of a cell;
+ *   an object whose image fits completely into one cell can still be missed,
+ *   the step has to be smaller than the image of the smallest object.
+ *
+ *   The table is built by the sample manager before the pixels of a frame
+ *   are rendered and is only read afterwards; thus, it is shared by all
+ *   worker threads.
+ */
+class GvsBackgroundTable
+{
+public:
+    /**
+     * @param step      edge length of a cell in pixels, at least 2
+     * @param maxError  maximum interpolation error of the texture coordinates
+     */
+    GvsBackgroundTable( int step, double maxError );
+
+    /**
+     * Trace the nodes of the image of the camera of the device.
+     *   Each device takes the next node until all are traced; the devices must
+     *   not use this table yet.
+     * @param devices  one device per worker thread
+     */
+    void  build ( std::vector<GvsDevice*> &devices );
+
+    /**
+     * Look up sample (x,y).
+     * @param x             x-coordinate of the sample in pixels
+     * @param y             y-coordinate of the sample in pixels
+     * @param key           object and break condition of the rays of the cell
+     * @param surfIntersec  interpolated intersection with the background, if key.object is not NULL
+     * @param col           interpolated color, if key.object is NULL
+     * @return false if the sample has to be traced
+     */
+    bool  lookup ( double x, double y, gvsSampleKey &key, GvsSurfIntersec &surfIntersec, GvsColor &col ) const;
+
+    //! The cell of sample (x,y) is resolved by the table.
+    bool  isResolved ( double x, double y ) const;
+
+    int   getStep ( ) const;
+    int   getNumResolved ( ) const;
+    int   getNumCells ( ) const;
+
+    void  Print ( FILE* fptr = stderr ) const;
+
+protected:
+    //! Trace the nodes the worker gets from the counter.
+    void  traceNodes ( GvsDevice* device, std::atomic<size_t>* next );
+
+    /**
+     * Decide which cells are resolved by the table; unresolved cells are dilated by one cell.
+     * @param device  device to shade the interpolated centers of the cells
+     */
+    void  classifyCells ( GvsDevice* device );
+
+    //! Index of the cell of sample (x,y) and its position within the cell; -1 outside of the image.
+    int   findCell ( double x, double y, double &tx, double &ty ) const;
+
+    int   cornerNode ( int i, int j ) const;
+    int   centerNode ( int i, int j ) const;
+
+private:
+    int     mStep;
+    double  mMaxError;
+
+    int     mNumX;  //!< number of cells per row
+    int     mNumY;  //!< number of cells per column
+    int     mNumResolved;
+
+    //! Corners of the cells first, then their centers.
+    std::vector<GvsBlockSample>  mNodes;
+    std::vector<char>            mResolved;
+};
+
+#endif // GVS_BACKGROUND_TABLE_H
@@ -0,0 +1,99 @@
+/**
+ * @file    GvsBlockSample.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Dev/GvsBlockSample.h"
+#include "Dev/GvsDevice.h"
+#include "Dev/GvsProjector.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Maximum difference of a color channel between the traced center of a
+// block and the center shaded from the interpolated corners.
+static const double blockColorError = 0.02;
+
+
+void gvsTraceBlockSample( GvsDevice* device, double x, double y, GvsBlockSample &sample ) {
+    if (device->projector->getSampleHit(device, x, y, sample.col, sample.key, sample.surfIntersec)) {
+        sample.point = sample.surfIntersec.point();
+        sample.normal = sample.surfIntersec.normal();
+        sample.localDir = sample.surfIntersec.getLocalDirection();
+        sample.uv = sample.surfIntersec.texUVParam();
+    }
+}
+
+
+double gvsEdgeStrength( const GvsColor& col1, const gvsSampleKey& key1,
+                        const GvsColor& col2, const gvsSampleKey& key2 ) {
+    if (key1.object != key2.object || key1.breakCond != key2.breakCond) {
+        return 2.0;
+    }
+    double diff = 0.0;
+    for (int c = 0; c < 3; c++) {
+        double c1 = std::min(std::max(col1[c], 0.0), 1.0);
+        double c2 = std::min(std::max(col2[c], 0.0), 1.0);
+        diff = std::max(diff, fabs(c1 - c2));
+    }
+    return diff;
+}
+
+
+bool gvsIsSmoothBlock( GvsDevice* device, const GvsBlockSample* const corner[4],
+                       const GvsBlockSample &center, double tx, double ty, double maxError ) {
+    const gvsSampleKey &key = center.key;
+    for (int i = 0; i < 4; i++) {
+        if (corner[i]->key.object != key.object || corner[i]->key.breakCond != key.breakCond) {
+            return false;
+        }
+    }
+    if (key.object == nullptr) {
+        return true;
+    }
+
+    m4d::vec2 uv[4];
+    for (int i = 0; i < 4; i++) {
+        uv[i] = corner[i]->uv;
+        // corners on both sides of a texture seam
+        if (fabs(uv[i][0] - uv[0][0]) > 0.5 || fabs(uv[i][1] - uv[0][1]) > 0.5) {
+            return false;
+        }
+    }
+    m4d::vec2 err = gvsBilinear(uv, tx, ty) - center.uv;
+    if (fabs(err[0]) > maxError || fabs(err[1]) > maxError) {
+        return false;
+    }
+
+    // Shadow boundaries and highlights within the block change the shading.
+    GvsColor col = device->projector->shadeIntersec(device, gvsInterpolateHit(corner, tx, ty));
+    return gvsEdgeStrength(col, key, center.col, key) <= blockColorError;
+}
+
+
+GvsSurfIntersec gvsInterpolateHit( const GvsBlockSample* const corner[4], double tx, double ty ) {
+    m4d::vec4 point[4];
+    m4d::vec3 normal[4], localDir[4];
+    m4d::vec2 uv[4];
+    for (int i = 0; i < 4; i++) {
+        point[i] = corner[i]->point;
+        normal[i] = corner[i]->normal;
+        localDir[i] = corner[i]->localDir;
+        uv[i] = corner[i]->uv;
+    }
+    GvsSurfIntersec surfIntersec = corner[(tx < 0.5 ? 0 : 1) + (ty < 0.5 ? 0 : 2)]->surfIntersec;
+    surfIntersec.setPoint(gvsBilinear(point, tx, ty));
+    surfIntersec.setNormal(gvsBilinear(normal, tx, ty));
+    surfIntersec.setLocalDirection(gvsBilinear(localDir, tx, ty));
+    surfIntersec.setTexUVParam(gvsBilinear(uv, tx, ty));
+    return surfIntersec;
+}
+
+
+GvsColor gvsInterpolateColor( const GvsBlockSample* const corner[4], double tx, double ty ) {
+    GvsColor col[4];
+    for (int i = 0; i < 4; i++) {
+        col[i] = corner[i]->col;
+    }
+    return gvsBilinear(col, tx, ty);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file    GvsBlockSample.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_BLOCK_SAMPLE_H
+#define GVS_BLOCK_SAMPLE_H
+
+#include "GvsGlobalDefs.h"
+#include "Img/GvsColor.h"
+#include "Ray/GvsSurfIntersec.h"
+
+class GvsDevice;
+
+/**
+ * Traced sample at a corner or the center of an image block.
+ *   Progressive rendering and the background table interpolate the samples
+ *   within a block from its corners if the block is smooth. The corners are
+ *   always given in the order lower-left, lower-right, upper-left, upper-right.
+ */
+typedef struct GvsBlockSample_T {
+    gvsSampleKey     key;
+    GvsColor         col;
+    GvsSurfIntersec  surfIntersec;  //!< only set if the ray hit an object
+    m4d::vec4        point;
+    m4d::vec3        normal;
+    m4d::vec3        localDir;
+    m4d::vec2        uv;
+} GvsBlockSample;
+
+
+template <class T>
+inline T gvsBilinear( const T c[4], double tx, double ty ) {
+    return (1.0 - ty) * ((1.0 - tx) * c[0] + tx * c[1]) + ty * ((1.0 - tx) * c[2] + tx * c[3]);
+}
+
+//! Trace sample (x,y) with the projector of the device.
+void  gvsTraceBlockSample ( GvsDevice* device, double x, double y, GvsBlockSample &sample );
+
+/**
+ * Difference of the clamped colors of two samples.
+ * @return maximum difference of a color channel; 2 if the samples hit
+ *         different objects or stopped for different reasons
+ */
+double  gvsEdgeStrength ( const GvsColor& col1, const gvsSampleKey& key1,
+                          const GvsColor& col2, const gvsSampleKey& key2 );
+
+/**
+ * Test whether the samples of a block can be interpolated from its corners.
+ *   The corner and center rays have to hit the same object and stop for the
+ *   same reason. If they hit an object, the corners must not lie on both
+ *   sides of a texture seam, the texture coordinates of the center may deviate
+ *   at most 'maxError' from the bilinear interpolation, and the center shaded
+ *   from the interpolated intersection has to agree with the traced color.
+ * @param device    device to shade the interpolated center
+ * @param corner    corner samples
+ * @param center    traced sample within the block
+ * @param tx        relative x-position of the center sample
+ * @param ty        relative y-position of the center sample
+ * @param maxError  maximum interpolation error of the texture coordinates
+ */
+bool  gvsIsSmoothBlock ( GvsDevice* device, const GvsBlockSample* const corner[4],
+                         const GvsBlockSample &center, double tx, double ty, double maxError );
+
+/**
+ * Intersection at (tx,ty) within a block whose corners hit the same object.
+ *   Point, normal, direction and texture coordinates are interpolated, the
+ *   nearest corner gives all other data.
+ */
+GvsSurfIntersec  gvsInterpolateHit ( const GvsBlockSample* const corner[4], double tx, double ty );
+
+//! Color at (tx,ty) within a block whose corners missed every object.
+GvsColor  gvsInterpolateColor ( const GvsBlockSample* const corner[4], double tx, double ty );
+
+#endif // GVS_BLOCK_SAMPLE_H
@@ -9,6 +9,8 @@
 #include "Dev/GvsDevice.h"
 #include "Obj/GvsSceneObj.h"
 #include "Parser/GvsParser.h"
+#include "Ray/GvsRayGen.h"
+#include "Utils/GvsGeodSolver.h"
 
 #include "metric/m4dMetric.h"
 
@@ -26,11 +28,17 @@ GvsDevice ::GvsDevice()
     mChangeObj.clear();
     isManual = false;
     camEye = gvsCamEyeStandard;
+    bgTable = nullptr;
+    rayCache = nullptr;
+    mIsThreadCopy = false;
 }
 
 GvsDevice::~GvsDevice()
 {
     clearChangeObj();
+    if (mIsThreadCopy) {
+        deleteThreadComponents();
+    }
     // delete metric;
     // TODO: clear metric, camera,...
 }
@@ -128,6 +136,9 @@ bool GvsDevice::makeChange()
 
         adjustTetrad |= (setHint == gvsSetParamAdjustTetrad);
     }
+    if (!mChangeObj.empty()) {
+        GvsSceneObj::countSceneChange();
+    }
 
     // THE FOLLOWING IS NOT ALLOWED WHEN SETTING TETRAD VECTORS MANUALLY !!!!
     // In that case, you have to call
@@ -206,6 +217,70 @@ void GvsDevice ::setManual(bool manual)
     isManual = manual;
 }
 
+GvsDevice* GvsDevice::createThreadCopy() const
+{
+    if (projector == nullptr || projector->getRayGen() == nullptr || projector->getLocalTetrad() == nullptr) {
+        return nullptr;
+    }
+
+    GvsRayGen* rayGen = projector->getRayGen();
+    GvsGeodSolver* solver = rayGen->getActualSolver();
+    if (solver == nullptr) {
+        return nullptr;
+    }
+
+    // The ray generator and the observer have to live in the same metric instance.
+    if (solver->getMetric() != metric) {
+        fprintf(stderr, "GvsDevice::createThreadCopy() ... solver and device metric differ.\n");
+        return nullptr;
+    }
+
+    m4d::Metric* newMetric = Gvsm4dMetricDummy::cloneMetric(metric);
+    if (newMetric == nullptr) {
+        fprintf(stderr, "GvsDevice::createThreadCopy() ... cannot clone metric %s.\n", metric->getMetricName());
+        return nullptr;
+    }
+
+    GvsGeodSolver* newSolver = solver->clone(newMetric);
+    GvsRayGen* newRayGen = rayGen->clone(newSolver);
+
+    GvsDevice* device = new GvsDevice();
+    device->camera = camera;
+    device->projector = projector->clone(newRayGen, newMetric);
+    device->metric = newMetric;
+    device->lightSrcMgr = lightSrcMgr;
+    device->sceneGraph = sceneGraph;
+    device->isManual = isManual;
+    device->camEye = camEye;
+    device->bgTable = bgTable;
+    device->rayCache = rayCache;
+    device->mIsThreadCopy = true;
+    return device;
+}
+
+bool GvsDevice::isThreadCopy() const
+{
+    return mIsThreadCopy;
+}
+
+void GvsDevice::deleteThreadComponents()
+{
+    if (projector != nullptr) {
+        GvsRayGen* rayGen = projector->getRayGen();
+        if (rayGen != nullptr) {
+            delete rayGen->getActualSolver();
+            delete rayGen;
+        }
+        delete projector->getLocalTetrad();
+        delete projector;
+    }
+    delete metric;
+
+    projector = nullptr;
+    metric = nullptr;
+    mIsThreadCopy = false;
+}
+
 void GvsDevice::Print(FILE* fptr)
 {
     LOG.printf("Device consists of the following components:\n");
@@ -20,6 +20,8 @@
 #include "Light/GvsLightSrcMgr.h"
 #include "Obj/GvsBase.h"
 
+class GvsBackgroundTable;
+class GvsRayCache;
 class GvsSceneObj;
 class Metric;
 class GvsLightSrcMgr;
@@ -53,6 +55,19 @@ public:
     void clear();
 
     void setManual(bool manual);
+
+    /**
+     * Create a copy of the device for a worker thread.
+     *   Camera, light sources, scene graph, background table, and ray cache are shared
+     *   with this device. Metric, geodesic solver, ray generator, and projector are
+     *   cloned, such that rays can be traced with the copy concurrently to all other
+     *   copies. The copy owns the cloned components and deletes them in its destructor.
+     * @return pointer to device copy, or nullptr if the components cannot be cloned
+     */
+    GvsDevice* createThreadCopy() const;
+
+    bool isThreadCopy() const;
+
     virtual void Print(FILE* fptr = stderr);
 
 public:
@@ -67,6 +82,18 @@ public:
 
     bool isManual;
     GvsCamEye camEye;
+
+    /// Table of the background of the current frame, set by the sample manager; NULL if off.
+    GvsBackgroundTable* bgTable;
+
+    /// Rays of the pixels kept from frame to frame; NULL if off. The device does not own the cache.
+    GvsRayCache* rayCache;
+
+protected:
+    void deleteThreadComponents();
+
+    /// The device owns its metric, solver, ray generator, and projector.
+    bool mIsThreadCopy;
 };
 
 #endif
@@ -6,13 +6,16 @@
  */
 #include <iostream>
 
+#include "Dev/GvsBackgroundTable.h"
 #include "Dev/GvsDevice.h"
 #include "Dev/GvsProjector.h"
+#include "Dev/GvsRayCache.h"
 #include "Obj/GvsSceneObj.h"
 #include "Ray/GvsRayGen.h"
 #include "Ray/GvsSurfIntersec.h"
 #include "Shader/GvsShader.h"
 #include "Utils/GvsGramSchmidt.h"
+#include "Utils/GvsStatistics.h"
 
 #include <metric/m4dMetric.h>
 
@@ -24,6 +27,12 @@ GvsProjector ::GvsProjector()
     , rayGen(nullptr)
     , locTetrad(nullptr)
     , stMotion(nullptr)
+    , mEyeRay(nullptr)
+    , mSecondaryRay(nullptr)
+    , mPacketNum(0)
+    , mPacketEye(gvsCamEyeStandard)
+    , mRayFamily(nullptr)
+    , mOwnsRayFamily(true)
 {
 
     GvsBase::AddParam("position", gvsDT_VEC4);
@@ -37,6 +46,31 @@ GvsProjector ::GvsProjector(GvsRayGen* gen)
     : rayGen(gen)
     , locTetrad(nullptr)
     , stMotion(nullptr)
+    , mEyeRay(nullptr)
+    , mSecondaryRay(nullptr)
+    , mPacketNum(0)
+    , mPacketEye(gvsCamEyeStandard)
+    , mRayFamily(nullptr)
+    , mOwnsRayFamily(true)
+{
+
+    GvsBase::AddParam("position", gvsDT_VEC4);
+    GvsBase::AddParam("actualpos", gvsDT_INT);
+    errorColor = GvsColor(0.0);
+    constraintColor = GvsColor(0.0);
+    breakDownColor = GvsColor(0.0);
+}
+
+GvsProjector ::GvsProjector(GvsRayGen* gen, GvsLocalTetrad* lT)
+    : rayGen(gen)
+    , locTetrad(lT)
+    , stMotion(nullptr)
+    , mEyeRay(nullptr)
+    , mSecondaryRay(nullptr)
+    , mPacketNum(0)
+    , mPacketEye(gvsCamEyeStandard)
+    , mRayFamily(nullptr)
+    , mOwnsRayFamily(true)
 {
 
     GvsBase::AddParam("position", gvsDT_VEC4);
@@ -48,12 +82,34 @@ GvsProjector ::GvsProjector(GvsRayGen* gen)
 
 GvsProjector::~GvsProjector()
 {
-    // nothing to delete
+    deleteRays();
+    if (mOwnsRayFamily) {
+        delete mRayFamily;
+    }
+}
+
+GvsProjector* GvsProjector::clone(GvsRayGen* gen, m4d::Metric* metric) const
+{
+    assert(locTetrad != NULL);
+    GvsLocalTetrad* lT = new GvsLocalTetrad(locTetrad);
+    lT->setMetric(metric);
+
+    GvsProjector* projector = new GvsProjector(gen, lT);
+    projector->setBackgroundColor(backgroundColor);
+    projector->setErrorColor(errorColor);
+    projector->setConstraintColor(constraintColor);
+    projector->setBreakDownColor(breakDownColor);
+    // The family is integrated once per frame by this projector, the clone only reads it.
+    projector->mRayFamily = mRayFamily;
+    projector->mOwnsRayFamily = false;
+    return projector;
 }
 
 void GvsProjector ::setRayGen(GvsRayGen* gen)
 {
     rayGen = gen;
+    deleteRays();
+    mPacketNum = 0;
 }
 
 GvsRayGen* GvsProjector ::getRayGen() const
@@ -105,6 +161,7 @@ void GvsProjector ::setLocalTetrad(GvsLocalTetrad* lT)
 {
     locTetrad = lT;
     locTetrad->transformTetrad(true);
+    mPacketNum = 0;
 }
 
 GvsLocalTetrad* GvsProjector::getLocalTetrad()
@@ -118,6 +175,7 @@ void GvsProjector ::setPosition(const m4d::vec4& pos)
     locTetrad->setPosition(pos);
     locTetrad->adjustTetrad();
     GvsBase::SetParam("position", pos);
+    mPacketNum = 0;
 }
 
 m4d::vec4 GvsProjector ::getPosition() const
@@ -131,6 +189,7 @@ void GvsProjector ::setMotion(GvsStMotion* motion)
     assert(motion != NULL);
     stMotion = motion;
     locTetrad = stMotion->getLocalTetrad(0);
+    mPacketNum = 0;
 }
 
 GvsStMotion* GvsProjector ::getMotion() const
@@ -138,43 +197,51 @@ GvsStMotion* GvsProjector ::getMotion() const
     return stMotion;
 }
 
-void GvsProjector::getSampleColor(GvsDevice* device, double x, double y, GvsColor& col, gvsData& data) const
+void GvsProjector::getSampleColor(
+    GvsDevice* device, double x, double y, GvsColor& col, gvsData& data, gvsSampleKey* key) const
 {
     assert((rayGen != NULL) && (locTetrad != NULL));
-
-    m4d::vec4 rayOrigin = locTetrad->getPosition();
-    if (device->camEye == gvsCamEyeLeft) {
-        m4d::vec3 leftEyePos = device->camera->GetLeftEyePos();
-        m4d::vec4 e0, e1, e2, e3;
-        locTetrad->getTetrad(e0, e1, e2, e3);
-        rayOrigin += leftEyePos.x(0) * e1 + leftEyePos.x(1) * e2 + leftEyePos.x(2) * e3;
-    }
-    else if (device->camEye == gvsCamEyeRight) {
-        m4d::vec3 rightEyePos = device->camera->GetRightEyePos();
-        m4d::vec4 e0, e1, e2, e3;
-        locTetrad->getTetrad(e0, e1, e2, e3);
-        rayOrigin += rightEyePos.x(0) * e1 + rightEyePos.x(1) * e2 + rightEyePos.x(2) * e3;
+    if (takeTableSample(device, x, y, col, key)) {
+        return;
     }
 
     // rayOrigin and rayDir in coordinates
+    m4d::vec4 rayOrigin = getRayOrigin(device);
     m4d::vec4 rayDir;
     m4d::vec3 localRayDir;
     getRayDir(device, x, y, rayDir, localRayDir);
 
     //    LOG.printf(5,"Pixel: %4d %4d ************************\n",static_cast<int>(x),static_cast<int>(y));
 
-    GvsRayVisual* eyeRay = new GvsRayVisual(rayGen);
+    GvsRayVisual* eyeRay = reuseRay(mEyeRay);
 
     GvsCamFilter camFilter = device->camera->getCamFilter();
     col = errorColor;
 
     if (!rayDir.getAsV3D().isZero()) {
         bool validRay = false;
+        bool intersecTested = false;
         switch (camFilter) {
             case gvsCamFilterRGBpt:
             case gvsCamFilterRGBIntersec:
+            case gvsCamFilterRGBcost:
             case gvsCamFilterRGB: {
-                validRay = eyeRay->recalc(rayOrigin, rayDir);
+                if (rayGen->getChunkSize() > 0) {
+                    validRay = traceRayChunked(eyeRay, rayOrigin, rayDir, device);
+                    intersecTested = true;
+                }
+                else if (camFilter == gvsCamFilterRGBcost) {
+                    validRay = eyeRay->recalc(rayOrigin, rayDir);
+                }
+                else if (!takeCachedRay(device, x, y, eyeRay, validRay)) {
+                    if (!(takePacketRay(device, x, y, eyeRay, validRay)
+                            || takeFamilyRay(rayOrigin, rayDir, eyeRay, validRay))) {
+                        validRay = eyeRay->recalc(rayOrigin, rayDir);
+                    }
+                    if (validRay && device->rayCache != NULL) {
+                        device->rayCache->storeRay(device->camEye, x, y, eyeRay);
+                    }
+                }
                 break;
             }
             case gvsCamFilterRGBpdz: {
@@ -188,24 +255,266 @@ void GvsProjector::getSampleColor(GvsDevice* device, double x, double y, GvsColo
         }
 
         if (camFilter == gvsCamFilterRGB || camFilter == gvsCamFilterRGBpdz || camFilter == gvsCamFilterRGBjac
-            || camFilter == gvsCamFilterRGBpt || camFilter == gvsCamFilterRGBIntersec) {
+            || camFilter == gvsCamFilterRGBpt || camFilter == gvsCamFilterRGBIntersec
+            || camFilter == gvsCamFilterRGBcost) {
             if (validRay) {
-                col = getSampleColor(eyeRay, device);
+                if (intersecTested) {
+                    col = shadeSample(eyeRay, device, eyeRay->intersecFound());
+                }
+                else {
+                    col = getSampleColor(eyeRay, device);
+                }
                 if (camFilter == gvsCamFilterRGBIntersec) {
                     data = getSampleIntersection(eyeRay, device);
                 }
             }
         }
+
+        if (key != nullptr) {
+            GvsSurfIntersec* surfIntersec = eyeRay->getSurfIntersec();
+            bool hit = validRay && eyeRay->intersecFound() && surfIntersec != NULL;
+            key->object = hit ? surfIntersec->surface() : nullptr;
+            key->breakCond = eyeRay->getBreakCond();
+        }
     }
     else {
         col.setValid(false);
     }
-    delete eyeRay;
+}
+
+bool GvsProjector::getSampleHit(GvsDevice* device, double x, double y, GvsColor& col, gvsSampleKey& key,
+    GvsSurfIntersec& surfIntersec) const
+{
+    gvsData data;
+    key = gvsSampleKey();
+    getSampleColor(device, x, y, col, data, &key);
+    if (key.object == nullptr || mEyeRay == nullptr) {
+        return false;
+    }
+    surfIntersec = mEyeRay->surfIntersec();
+    return true;
+}
+
+GvsColor GvsProjector::shadeIntersec(GvsDevice* device, const GvsSurfIntersec& surfIntersec) const
+{
+    GvsRayVisual* eyeRay = reuseRay(mEyeRay);
+    eyeRay->surfIntersec() = surfIntersec;
+    return shadeSample(eyeRay, device, true);
+}
+
+void GvsProjector::tracePacket(GvsDevice* device, int num, const double* x, const double* y) const
+{
+    assert((rayGen != NULL) && (locTetrad != NULL));
+    mPacketNum = 0;
+    num = GVS_MIN(num, getPacketSize());
+    if (num <= 0) {
+        return;
+    }
+
+    m4d::vec4 rayOrigin = getRayOrigin(device);
+    m4d::vec4 orig[GVS_PACKET_MAX_LANES];
+    m4d::vec4 dirs[GVS_PACKET_MAX_LANES];
+    for (int i = 0; i < num; i++) {
+        if (device->bgTable != NULL && device->bgTable->isResolved(x[i], y[i])
+            && device->camera->getCamFilter() == gvsCamFilterRGB) {
+            // getSampleColor takes such a pixel from the table
+            continue;
+        }
+        if (device->rayCache != NULL && device->rayCache->contains(device->camEye, x[i], y[i])) {
+            // getSampleColor takes the ray of such a pixel from the cache
+            continue;
+        }
+        m4d::vec3 localRayDir;
+        getRayDir(device, x[i], y[i], dirs[i], localRayDir);
+        if (dirs[i].getAsV3D().isZero()) {
+            // getSampleColor does not trace such a pixel
+            continue;
+        }
+        orig[mPacketNum] = rayOrigin;
+        dirs[mPacketNum] = dirs[i];
+        mPacketX[mPacketNum] = x[i];
+        mPacketY[mPacketNum] = y[i];
+        mPacketPending[mPacketNum] = true;
+        mPacketNum++;
+    }
+
+    mPacketEye = device->camEye;
+    if (!rayGen->calcPolylinePacket(mPacketNum, orig, dirs, mPacketPoints, mPacketDirs, mPacketBreakCond)) {
+        mPacketNum = 0;
+    }
+}
+
+int GvsProjector::getPacketSize() const
+{
+    // Chunked rays are integrated by getSampleColor itself and never take a packet.
+    if (rayGen == NULL || mRayFamily != NULL || rayGen->getChunkSize() > 0) {
+        return 0;
+    }
+    return rayGen->getPacketSize();
+}
+
+void GvsProjector::setSymmetryRays(int numRays)
+{
+    if (mOwnsRayFamily) {
+        delete mRayFamily;
+    }
+    mRayFamily = (numRays > 0) ? new GvsRayFamily(numRays) : nullptr;
+    mOwnsRayFamily = true;
+}
+
+int GvsProjector::getSymmetryRays() const
+{
+    return (mRayFamily != NULL) ? mRayFamily->getNumRays() : 0;
+}
+
+void GvsProjector::prepareRayFamily(GvsDevice* device)
+{
+    if (mRayFamily == NULL || !mOwnsRayFamily) {
+        return;
+    }
+
+    // All rays start at the observer; the ray of the image center gives their time direction.
+    m4d::ivec2 res = device->camera->GetResolution();
+    m4d::vec4 rayDir;
+    m4d::vec3 localRayDir;
+    getRayDir(device, 0.5 * (res.x(0) - 1), 0.5 * (res.x(1) - 1), rayDir, localRayDir);
+    mRayFamily->prepare(rayGen, getRayOrigin(device), rayDir);
+}
+
+bool GvsProjector::takeFamilyRay(
+    const m4d::vec4& orig, const m4d::vec4& dir, GvsRayVisual* eyeRay, bool& validRay) const
+{
+    m4d::enum_break_condition bc;
+    if (mRayFamily == NULL
+        || !mRayFamily->getRay(rayGen->getActualSolver()->getMetric(), orig, dir, mFamilyPoints, mFamilyDirs, bc)) {
+        return false;
+    }
+    validRay = eyeRay->setPolyline(mFamilyPoints, mFamilyDirs, bc);
+    return true;
+}
+
+bool GvsProjector::takeTableSample(GvsDevice* device, double x, double y, GvsColor& col, gvsSampleKey* key) const
+{
+    if (device->bgTable == NULL || device->camera->getCamFilter() != gvsCamFilterRGB) {
+        return false;
+    }
+
+    gvsSampleKey tableKey;
+    GvsRayVisual* eyeRay = reuseRay(mEyeRay);
+    if (!device->bgTable->lookup(x, y, tableKey, eyeRay->surfIntersec(), col)) {
+        return false;
+    }
+    if (tableKey.object != nullptr) {
+        col = shadeSample(eyeRay, device, true);
+    }
+    if (key != nullptr) {
+        *key = tableKey;
+    }
+    return true;
+}
+
+bool GvsProjector::takeCachedRay(GvsDevice* device, double x, double y, GvsRayVisual* eyeRay, bool& validRay) const
+{
+    m4d::enum_break_condition bc;
+    if (device->rayCache == NULL
+        || !device->rayCache->getRay(device->camEye, x, y, mCachePoints, mCacheDirs, bc)) {
+        return false;
+    }
+    validRay = eyeRay->setPolyline(mCachePoints, mCacheDirs, bc);
+    return true;
+}
+
+bool GvsProjector::takePacketRay(GvsDevice* device, double x, double y, GvsRayVisual* eyeRay, bool& validRay) const
+{
+    if (device->camEye != mPacketEye) {
+        return false;
+    }
+    for (int i = 0; i < mPacketNum; i++) {
+        if (mPacketPending[i] && mPacketX[i] == x && mPacketY[i] == y) {
+            mPacketPending[i] = false;
+            validRay = eyeRay->setPolyline(mPacketPoints[i], mPacketDirs[i], mPacketBreakCond[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+m4d::vec4 GvsProjector::getRayOrigin(GvsDevice* device) const
+{
+    m4d::vec4 rayOrigin = locTetrad->getPosition();
+    if (device->camEye == gvsCamEyeLeft) {
+        m4d::vec3 leftEyePos = device->camera->GetLeftEyePos();
+        m4d::vec4 e0, e1, e2, e3;
+        locTetrad->getTetrad(e0, e1, e2, e3);
+        rayOrigin += leftEyePos.x(0) * e1 + leftEyePos.x(1) * e2 + leftEyePos.x(2) * e3;
+    }
+    else if (device->camEye == gvsCamEyeRight) {
+        m4d::vec3 rightEyePos = device->camera->GetRightEyePos();
+        m4d::vec4 e0, e1, e2, e3;
+        locTetrad->getTetrad(e0, e1, e2, e3);
+        rayOrigin += rightEyePos.x(0) * e1 + rightEyePos.x(1) * e2 + rightEyePos.x(2) * e3;
+    }
+    return rayOrigin;
+}
+
+GvsRayVisual* GvsProjector::getSecondaryRay() const
+{
+    return reuseRay(mSecondaryRay);
+}
+
+GvsRayVisual* GvsProjector::reuseRay(GvsRayVisual*& ray) const
+{
+    assert(rayGen != NULL);
+    if (ray != NULL && ray->getRayGen() != rayGen) {
+        delete ray;
+        ray = NULL;
+    }
+    if (ray == NULL) {
+        ray = new GvsRayVisual(rayGen);
+    }
+    return ray;
+}
+
+void GvsProjector::deleteRays()
+{
+    delete mEyeRay;
+    mEyeRay = nullptr;
+    delete mSecondaryRay;
+    mSecondaryRay = nullptr;
 }
 
 GvsColor GvsProjector::getSampleColor(GvsRayVisual*& eyeRay, GvsDevice* device) const
 {
+    bool hit = (device->sceneGraph != NULL) && (device->sceneGraph->testIntersection(*eyeRay));
+    return shadeSample(eyeRay, device, hit);
+}
 
+bool GvsProjector::traceRayChunked(
+    GvsRayVisual*& eyeRay, const m4d::vec4& orig, const m4d::vec4& dir, GvsDevice* device) const
+{
+    int chunkSize = rayGen->getChunkSize();
+    if (!eyeRay->recalcFirstChunk(orig, dir, chunkSize)) {
+        return false;
+    }
+
+    do {
+        if (device->sceneGraph != NULL) {
+            device->sceneGraph->testIntersection(*eyeRay);
+        }
+
+        // The last segment of the current chunk is tested together with the next chunk.
+        // Hence, only an intersection in front of it is the closest one.
+        GvsSurfIntersec* surfIntersec = eyeRay->getSurfIntersec();
+        if (eyeRay->intersecFound() && surfIntersec != NULL
+            && surfIntersec->dist() < double(eyeRay->getNumPoints() - 2)) {
+            break;
+        }
+    } while (eyeRay->recalcNextChunk(chunkSize));
+    return true;
+}
+
+GvsColor GvsProjector::shadeSample(GvsRayVisual*& eyeRay, GvsDevice* device, bool hit) const
+{
     m4d::vec4 lightDirStart, locLightDirStart, locLightDirEnd, lightDirEnd;
     double i, frak, wObs, wSrc;
     m4d::vec5 jacobi;
@@ -214,10 +523,13 @@ GvsColor GvsProjector::getSampleColor(GvsRayVisual*& eyeRay, GvsDevice* device)
     GvsColor sampleColor = getBackgroundColor();
 
     bool intersecFound = false;
-    if ((device->sceneGraph != NULL) && (device->sceneGraph->testIntersection(*eyeRay))) {
+    if (hit) {
         GvsShader* shader = eyeRay->intersecShader();
         if (shader != NULL) {
-            sampleColor = shader->getIncidentLight(device, *eyeRay);
+            {
+                GvsStatistics::ShadingTimer shadingTimer;
+                sampleColor = shader->getIncidentLight(device, *eyeRay);
+            }
             // sampleColor.Print();
 
             // Direction of the light ray at the intersection points.
@@ -256,8 +568,9 @@ GvsColor GvsProjector::getSampleColor(GvsRayVisual*& eyeRay, GvsDevice* device)
                     delete lt;
                 }
                 else {
+                    // The tetrad of the object is bound to the metric of the scene.
                     lt = surfIntersec->getLocalTetrad();
-                    locLightDirEnd = lt->coordToLocal(lightDirEnd);
+                    locLightDirEnd = lt->coordToLocal(lightDirEnd, device->metric);
                 }
                 wSrc = locLightDirEnd.x(0);
                 // std::cerr << wObs << " " << wSrc << " " << wSrc/wObs << std::endl;
@@ -283,7 +596,7 @@ GvsColor GvsProjector::getSampleColor(GvsRayVisual*& eyeRay, GvsDevice* device)
                     sampleColor.data.objID = static_cast<double>(surfIntersec->surface()->GetID());
                 }
             }
-            sampleColor = sampleColor.trim();
+            // The color is clamped when it is stored in the low dynamic range image.
             intersecFound = true;
         }
     }
@@ -455,6 +768,9 @@ void GvsProjector::Print(FILE* fptr)
         fprintf(fptr, "\tbgColor:  ");
         backgroundColor.Print(fptr);
         rayGen->Print(fptr);
+        if (mRayFamily != NULL) {
+            mRayFamily->Print(fptr);
+        }
         locTetrad->Print(fptr);
     }
     fprintf(fptr, "}\n\n");
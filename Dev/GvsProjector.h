@@ -18,7 +18,9 @@
 #include "Obj/STMotion/GvsLocalTetrad.h"
 #include "Obj/STMotion/GvsStMotion.h"
 #include "Ray/GvsRayAllIS.h"
+#include "Ray/GvsRayFamily.h"
 #include "Ray/GvsRayVisual.h"
+#include "Utils/GvsPacketSolver.h"
 
 /**
  * The projector represents the observer within a scene given
@@ -34,6 +36,16 @@ public:
     GvsProjector(GvsRayGen* gen, GvsLocalTetrad* lT);
     virtual ~GvsProjector();
 
+    /**
+     * Create a new projector with the same colors and a copy of the current local tetrad.
+     *   The copied local tetrad lives in the given metric. The caller owns the new
+     *   projector as well as its local tetrad.
+     * @param gen     pointer to ray generator of the new projector
+     * @param metric  pointer to metric of the copied local tetrad
+     * @return pointer to new projector
+     */
+    GvsProjector* clone(GvsRayGen* gen, m4d::Metric* metric) const;
+
     void setRayGen(GvsRayGen* gen);
     GvsRayGen* getRayGen() const;
 
@@ -54,13 +66,36 @@ public:
     /**
      * Get the sample color for pixel (x,y).
      *   A visual ray for pixel (x,y) is generated depending on the camera of the scene.
-     *   Then, the 'getSampleColor(eyeRay, device)' is called.
+     *   Then, the 'getSampleColor(eyeRay, device)' is called. Samples resolved by
+     *   the background table of the device are not traced, and rays kept by the
+     *   ray cache of the device are not integrated again.
      * @param device   pointer to current scene device
      * @param x   x-coordinate of pixel
      * @param y   y-coordinate of pixel
+     * @param key  if not NULL, the hit object and break condition of the ray are stored
      * @return  rendered color
      */
-    void getSampleColor(GvsDevice* device, double x, double y, GvsColor& col, gvsData& data) const;
+    void getSampleColor(
+        GvsDevice* device, double x, double y, GvsColor& col, gvsData& data, gvsSampleKey* key = nullptr) const;
+
+    /**
+     * Get the sample color for pixel (x,y) and keep the intersection of the ray.
+     *   Used by progressive rendering with the camera filter 'FilterRGB'.
+     * @param surfIntersec  copy of the intersection if the ray hit an object
+     * @return  true if the ray hit an object
+     */
+    bool getSampleHit(GvsDevice* device, double x, double y, GvsColor& col, gvsSampleKey& key,
+        GvsSurfIntersec& surfIntersec) const;
+
+    /**
+     * Shade an intersection which was interpolated instead of traced.
+     *   The eye ray carries the intersection; thus, the color is exact for
+     *   shaders which only depend on the intersection, not on the path of the ray.
+     * @param device        scene device
+     * @param surfIntersec  interpolated intersection
+     * @return rendered color
+     */
+    GvsColor shadeIntersec(GvsDevice* device, const GvsSurfIntersec& surfIntersec) const;
 
     /**
      * Get the sample color from the light ray.
@@ -71,6 +106,60 @@ public:
      */
     GvsColor getSampleColor(GvsRayVisual*& eyeRay, GvsDevice* device) const;
 
+    /**
+     * Integrate the light ray chunk by chunk and test each chunk for intersections.
+     *   Integration stops as soon as the closest intersection lies within the
+     *   segments that have already been tested by all objects.
+     * @param eyeRay  visual ray
+     * @param orig    initial position of the ray in coordinates
+     * @param dir     initial direction of the ray in coordinates
+     * @param device  scene device
+     * @return  false if the ray is not valid
+     */
+    bool traceRayChunked(GvsRayVisual*& eyeRay, const m4d::vec4& orig, const m4d::vec4& dir, GvsDevice* device) const;
+
+    /**
+     * Integrate the light rays of several pixels as one packet.
+     *   The rays are kept until the next packet and taken by getSampleColor
+     *   if it is called for one of these pixels. Only the camera filters
+     *   'FilterRGB', 'FilterRGBpt', and 'FilterRGBIntersec' take them.
+     * @param device  scene device
+     * @param num     number of pixels, at most getPacketSize()
+     * @param x       x-coordinates of the pixels
+     * @param y       y-coordinates of the pixels
+     */
+    void tracePacket(GvsDevice* device, int num, const double* x, const double* y) const;
+
+    //! Number of pixels per packet; zero if the ray generator does not integrate packets, integrates in chunks, or a ray family is used.
+    int getPacketSize() const;
+
+    /**
+     * Take the light rays from a family of rays in a static spherically symmetric spacetime.
+     *   See GvsRayFamily; the family is integrated once for each radius of
+     *   the observer, and each pixel only rotates and interpolates two of its
+     *   members. Only the camera filters 'FilterRGB', 'FilterRGBpt', and
+     *   'FilterRGBIntersec' take these rays; if the metric is not supported,
+     *   each ray is integrated as usual.
+     * @param numRays  number of family members; zero switches the family off
+     */
+    void setSymmetryRays(int numRays);
+    int getSymmetryRays() const;
+
+    /**
+     * Prepare the ray family for the observer of the frame of the device.
+     *   Call before the pixels of the frame are rendered. The clones of this
+     *   projector share its family and only read it; a clone does not prepare it.
+     */
+    void prepareRayFamily(GvsDevice* device);
+
+    /**
+     * Visual ray for secondary rays like shadow rays.
+     *   The ray belongs to the projector and is reused for every call; thus,
+     *   it is only valid until the next call. Each thread has its own projector.
+     * @return  pointer to visual ray
+     */
+    GvsRayVisual* getSecondaryRay() const;
+
     void getSampleIntersection(GvsDevice* device, double x, double y);
     // void getSampleIntersection(GvsRayAllIS*& eyeRay, GvsDevice* device);
     gvsData getSampleIntersection(GvsRayVisual*& eyeRay, GvsDevice* device) const;
@@ -141,6 +230,52 @@ public:
 
     virtual void Print(FILE* fptr = stderr);
 
+protected:
+    /**
+     * Shade the light ray whose intersections have already been tested.
+     * @param eyeRay  visual ray
+     * @param device  scene device
+     * @param hit     an intersection was found
+     * @return rendered color
+     */
+    GvsColor shadeSample(GvsRayVisual*& eyeRay, GvsDevice* device, bool hit) const;
+
+    //! Position of the observer or of the current eye of a stereo camera.
+    m4d::vec4 getRayOrigin(GvsDevice* device) const;
+
+    /**
+     * Take the ray of pixel (x,y) from the last packet.
+     * @param validRay  the ray has at least two points
+     * @return  false if the pixel is not part of the last packet
+     */
+    bool takePacketRay(GvsDevice* device, double x, double y, GvsRayVisual* eyeRay, bool& validRay) const;
+
+    /**
+     * Take the ray from the ray family.
+     * @param validRay  the ray has at least two points
+     * @return  false if there is no ray family or it does not fit the ray
+     */
+    bool takeFamilyRay(
+        const m4d::vec4& orig, const m4d::vec4& dir, GvsRayVisual* eyeRay, bool& validRay) const;
+
+    /**
+     * Take the ray of pixel (x,y) from the ray cache of the device.
+     * @param validRay  the ray has at least two points
+     * @return  false if the ray is not cached
+     */
+    bool takeCachedRay(GvsDevice* device, double x, double y, GvsRayVisual* eyeRay, bool& validRay) const;
+
+    /**
+     * Take sample (x,y) from the background table of the device.
+     *   Only the camera filter 'FilterRGB' takes samples from the table.
+     * @return  false if the sample has to be traced
+     */
+    bool takeTableSample(GvsDevice* device, double x, double y, GvsColor& col, gvsSampleKey* key) const;
+
+    //! Create the ray on first use or if the ray generator has changed.
+    GvsRayVisual* reuseRay(GvsRayVisual*& ray) const;
+    void deleteRays();
+
 protected:
     GvsColor backgroundColor;
     GvsColor errorColor;
@@ -149,6 +284,29 @@ protected:
     GvsRayGen* rayGen;
     GvsLocalTetrad* locTetrad; //!< If the projector is static.
     GvsStMotion* stMotion; //!< If the projector is in motion.
+
+    // The rays keep their buffers from pixel to pixel.
+    mutable GvsRayVisual* mEyeRay;
+    mutable GvsRayVisual* mSecondaryRay;
+
+    // Rays of the last packet that have not been taken yet, see tracePacket.
+    mutable int mPacketNum;
+    mutable GvsCamEye mPacketEye;
+    mutable double mPacketX[GVS_PACKET_MAX_LANES];
+    mutable double mPacketY[GVS_PACKET_MAX_LANES];
+    mutable bool mPacketPending[GVS_PACKET_MAX_LANES];
+    mutable std::vector<m4d::vec4> mPacketPoints[GVS_PACKET_MAX_LANES];
+    mutable std::vector<m4d::vec4> mPacketDirs[GVS_PACKET_MAX_LANES];
+    mutable m4d::enum_break_condition mPacketBreakCond[GVS_PACKET_MAX_LANES];
+
+    GvsRayFamily* mRayFamily; //!< NULL if the rays are integrated pixel by pixel
+    bool mOwnsRayFamily; //!< false for clones, which share the family of their projector
+    mutable std::vector<m4d::vec4> mFamilyPoints;
+    mutable std::vector<m4d::vec4> mFamilyDirs;
+
+    // Copy of a cached ray, see takeCachedRay.
+    mutable std::vector<m4d::vec4> mCachePoints;
+    mutable std::vector<m4d::vec4> mCacheDirs;
 };
 
 #endif
@@ -0,0 +1,407 @@
+/**
+ * @file    GvsRayCache.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Dev/GvsRayCache.h"
+#include "Dev/GvsDevice.h"
+#include "Ray/GvsRay.h"
+#include "Ray/GvsRayGen.h"
+#include "Utils/GvsGeodSolver.h"
+
+#include <cmath>
+#include <cstring>
+
+// Time bounds of the bounding box beyond this value do not restrict the rays.
+#define GVS_RAY_CACHE_OPEN_TIME  1.0e10
+
+static const char gvsRayCacheMagic[8] = {'G','V','S','R','C','0','0','1'};
+
+
+GvsRayCache::GvsRayCache( double maxMBytes )
+    : mMaxBytes(maxMBytes*1024.0*1024.0),
+      mNumBytes(0),
+      mNumRays(0)
+{
+    for (int e = 0; e < 3; e++) {
+        resetEye(mEyes[e], 0, 0);
+    }
+}
+
+
+void GvsRayCache::prepare( GvsDevice* device ) {
+    assert(device != NULL && device->camera != NULL && device->projector != NULL);
+    Eye &eye = mEyes[device->camEye];
+
+    std::string names;
+    std::vector<double> key;
+    bool stationary = false;
+    double time = 0.0;
+    makeKey(device, names, key, stationary, time);
+
+    m4d::ivec2 res = device->camera->GetResolution();
+    if (!eye.valid || names != eye.names || key != eye.key || stationary != eye.stationary
+        || res.x(0) != eye.resX || res.x(1) != eye.resY || (!stationary && time != eye.time)) {
+        resetEye(eye, res.x(0), res.x(1));
+        eye.valid = true;
+        eye.names = names;
+        eye.key.swap(key);
+        eye.stationary = stationary;
+        eye.time = time;
+    }
+    eye.timeShift = time - eye.time;
+}
+
+
+void GvsRayCache::clear() {
+    for (int e = 0; e < 3; e++) {
+        resetEye(mEyes[e], 0, 0);
+    }
+    mNumBytes = 0;
+    mNumRays = 0;
+}
+
+
+bool GvsRayCache::contains( GvsCamEye eye, double x, double y ) const {
+    int n = entryIndex(mEyes[eye], x, y);
+    return (n >= 0) && (mEyes[eye].state[n].load(std::memory_order_acquire) == entryFilled);
+}
+
+
+bool GvsRayCache::getRay( GvsCamEye eye, double x, double y, std::vector<m4d::vec4> &points,
+                          std::vector<m4d::vec4> &dirs, m4d::enum_break_condition &bc ) const {
+    const Eye &e = mEyes[eye];
+    int n = entryIndex(e, x, y);
+    if (n < 0 || e.state[n].load(std::memory_order_acquire) != entryFilled) {
+        return false;
+    }
+
+    const Entry &entry = e.entries[n];
+    points = entry.points;
+    dirs = entry.dirs;
+    bc = entry.breakCond;
+    if (e.timeShift != 0.0) {
+        for (size_t i = 0; i < points.size(); i++) {
+            points[i][0] += e.timeShift;
+        }
+    }
+    return true;
+}
+
+
+void GvsRayCache::storeRay( GvsCamEye eye, double x, double y, GvsRay* ray ) {
+    Eye &e = mEyes[eye];
+    int n = entryIndex(e, x, y);
+    int num = ray->getNumPoints();
+    if (n < 0 || num < 2) {
+        return;
+    }
+
+    // Only the first thread stores the ray of the pixel.
+    char expected = entryEmpty;
+    if (!e.state[n].compare_exchange_strong(expected, entryWriting)) {
+        return;
+    }
+    if (!reserveBytes(num)) {
+        e.state[n] = entryEmpty;
+        return;
+    }
+
+    Entry &entry = e.entries[n];
+    entry.points.assign(ray->points(), ray->points() + num);
+    entry.dirs.assign(ray->tangents(), ray->tangents() + num);
+    entry.breakCond = ray->getBreakCond();
+    if (e.timeShift != 0.0) {
+        for (int i = 0; i < num; i++) {
+            entry.points[i][0] -= e.timeShift;
+        }
+    }
+    mNumRays++;
+    e.state[n].store(entryFilled, std::memory_order_release);
+}
+
+
+/**
+ * The file starts with a magic number. Each eye with rays follows with
+ * its key and its filled entries: pixel index, break condition, number
+ * of points, points, and directions.
+ */
+bool GvsRayCache::write( const char* filename ) const {
+    FILE* fptr = fopen(filename, "wb");
+    if (fptr == NULL) {
+        fprintf(stderr,"GvsRayCache::write() ... cannot open file %s for output!\n",filename);
+        return false;
+    }
+
+    bool isOkay = (fwrite(gvsRayCacheMagic, sizeof(gvsRayCacheMagic), 1, fptr) == 1);
+    for (int eyeNum = 0; eyeNum < 3 && isOkay; eyeNum++) {
+        const Eye &eye = mEyes[eyeNum];
+        if (!eye.valid) {
+            continue;
+        }
+
+        int header[5] = { eyeNum, eye.resX, eye.resY, static_cast<int>(eye.names.size()),
+                          static_cast<int>(eye.key.size()) };
+        int numEntries = 0;
+        for (int n = 0; n < eye.resX*eye.resY; n++) {
+            numEntries += (eye.state[n].load() == entryFilled) ? 1 : 0;
+        }
+        char stationary = eye.stationary ? 1 : 0;
+        isOkay = (fwrite(header, sizeof(int), 5, fptr) == 5)
+              && (fwrite(eye.names.data(), 1, eye.names.size(), fptr) == eye.names.size())
+              && (eye.key.empty() || fwrite(&eye.key[0], sizeof(double), eye.key.size(), fptr) == eye.key.size())
+              && (fwrite(&stationary, 1, 1, fptr) == 1)
+              && (fwrite(&eye.time, sizeof(double), 1, fptr) == 1)
+              && (fwrite(&numEntries, sizeof(int), 1, fptr) == 1);
+
+        for (int n = 0; n < eye.resX*eye.resY && isOkay; n++) {
+            if (eye.state[n].load() != entryFilled) {
+                continue;
+            }
+            const Entry &entry = eye.entries[n];
+            int data[3] = { n, static_cast<int>(entry.breakCond), static_cast<int>(entry.points.size()) };
+            isOkay = (fwrite(data, sizeof(int), 3, fptr) == 3)
+                  && (fwrite(entry.points[0].data(), sizeof(double)*4, data[2], fptr) == size_t(data[2]))
+                  && (fwrite(entry.dirs[0].data(), sizeof(double)*4, data[2], fptr) == size_t(data[2]));
+        }
+    }
+    fclose(fptr);
+
+    if (!isOkay) {
+        fprintf(stderr,"GvsRayCache::write() ... cannot write file %s!\n",filename);
+    }
+    return isOkay;
+}
+
+
+bool GvsRayCache::read( const char* filename ) {
+    FILE* fptr = fopen(filename, "rb");
+    if (fptr == NULL) {
+        return false;
+    }
+
+    clear();
+    char magic[sizeof(gvsRayCacheMagic)];
+    bool isOkay = (fread(magic, sizeof(magic), 1, fptr) == 1)
+               && (memcmp(magic, gvsRayCacheMagic, sizeof(magic)) == 0);
+
+    int header[5];
+    while (isOkay && fread(header, sizeof(int), 5, fptr) == 5) {
+        isOkay = (header[0] >= 0 && header[0] < 3 && header[1] > 0 && header[2] > 0
+                  && header[3] >= 0 && header[4] >= 0);
+        if (!isOkay) {
+            break;
+        }
+
+        Eye &eye = mEyes[header[0]];
+        resetEye(eye, header[1], header[2]);
+        eye.names.resize(header[3]);
+        eye.key.resize(header[4]);
+        char stationary = 0;
+        int numEntries = 0;
+        isOkay = (header[3] == 0 || fread(&eye.names[0], 1, header[3], fptr) == size_t(header[3]))
+              && (header[4] == 0 || fread(&eye.key[0], sizeof(double), header[4], fptr) == size_t(header[4]))
+              && (fread(&stationary, 1, 1, fptr) == 1)
+              && (fread(&eye.time, sizeof(double), 1, fptr) == 1)
+              && (fread(&numEntries, sizeof(int), 1, fptr) == 1);
+        eye.stationary = (stationary != 0);
+        eye.valid = isOkay;
+
+        for (int k = 0; k < numEntries && isOkay; k++) {
+            int data[3];
+            isOkay = (fread(data, sizeof(int), 3, fptr) == 3)
+                  && (data[0] >= 0 && data[0] < eye.resX*eye.resY && data[2] >= 2);
+            if (!isOkay) {
+                break;
+            }
+
+            Entry &entry = eye.entries[data[0]];
+            entry.points.resize(data[2]);
+            entry.dirs.resize(data[2]);
+            entry.breakCond = static_cast<m4d::enum_break_condition>(data[1]);
+            isOkay = (fread(entry.points[0].data(), sizeof(double)*4, data[2], fptr) == size_t(data[2]))
+                  && (fread(entry.dirs[0].data(), sizeof(double)*4, data[2], fptr) == size_t(data[2]));
+            if (isOkay && reserveBytes(data[2])) {
+                eye.state[data[0]] = entryFilled;
+                mNumRays++;
+            } else {
+                std::vector<m4d::vec4>().swap(entry.points);
+                std::vector<m4d::vec4>().swap(entry.dirs);
+            }
+        }
+    }
+    fclose(fptr);
+
+    if (!isOkay) {
+        fprintf(stderr,"GvsRayCache::read() ... file %s is corrupt; the rays are integrated again.\n",filename);
+        clear();
+    }
+    return isOkay;
+}
+
+
+int GvsRayCache::getNumRays() const {
+    return mNumRays;
+}
+
+
+void GvsRayCache::makeKey( GvsDevice* device, std::string &names, std::vector<double> &key,
+                           bool &stationary, double &time ) const {
+    GvsProjector* projector = device->projector;
+    GvsRayGen* rayGen = projector->getRayGen();
+    GvsGeodSolver* solver = rayGen->getActualSolver();
+    m4d::Metric* metric = solver->getMetric();
+
+    names = std::string(metric->getMetricName()) + "|" + std::to_string(static_cast<int>(solver->getSolverType()));
+    key.clear();
+
+    // The observer: position, eye, and the directions of some pixels for the tetrad and the camera.
+    m4d::vec4 pos = projector->getPosition();
+    time = pos.x(0);
+    for (int i = 1; i < 4; i++) {
+        key.push_back(pos.x(i));
+    }
+    m4d::vec3 eyePos = (device->camEye == gvsCamEyeLeft) ? device->camera->GetLeftEyePos()
+                     : ((device->camEye == gvsCamEyeRight) ? device->camera->GetRightEyePos() : m4d::vec3());
+    for (int i = 0; i < 3; i++) {
+        key.push_back(eyePos.x(i));
+    }
+
+    m4d::ivec2 res = device->camera->GetResolution();
+    const double probes[5][2] = { {0.0, 0.0}, {res.x(0) - 1.0, 0.0}, {0.0, res.x(1) - 1.0},
+                                  {res.x(0) - 1.0, res.x(1) - 1.0}, {0.5*res.x(0), 0.5*res.x(1)} };
+    for (int p = 0; p < 5; p++) {
+        m4d::vec4 dir;
+        m4d::vec3 localDir;
+        projector->getRayDir(device, probes[p][0], probes[p][1], dir, localDir);
+        for (int i = 0; i < 4; i++) {
+            key.push_back(dir.x(i));
+        }
+    }
+    key.push_back(projector->getSymmetryRays());
+
+    // The metric and the integration of the rays.
+    std::vector<std::string> paramNames;
+    metric->getParamNames(paramNames);
+    for (size_t i = 0; i < paramNames.size(); i++) {
+        double val = 0.0;
+        metric->getParam(paramNames[i].c_str(), val);
+        key.push_back(val);
+    }
+
+    double epsAbs, epsRel;
+    solver->getEpsilons(epsAbs, epsRel);
+    key.push_back(rayGen->getMaxNumPoints());
+    key.push_back(solver->getGeodType());
+    key.push_back(solver->getTimeDir());
+    key.push_back(epsAbs);
+    key.push_back(epsRel);
+    key.push_back(solver->getStepSizeControl() ? 1.0 : 0.0);
+    key.push_back(solver->getStepsize());
+    key.push_back(solver->getMaxStepsize());
+    key.push_back(solver->getNativeKernel() ? 1.0 : 0.0);
+
+    double boxMin[4], boxMax[4];
+    solver->getBoundingBox(boxMin, boxMax);
+    for (int i = 1; i < 4; i++) {
+        key.push_back(boxMin[i]);
+        key.push_back(boxMax[i]);
+    }
+
+    // A time bound of the box moves with the observer if the rays are shifted in time.
+    stationary = isStationary(metric, pos);
+    double t0 = stationary ? time : 0.0;
+    key.push_back((boxMin[0] > -GVS_RAY_CACHE_OPEN_TIME) ? boxMin[0] - t0 : -GVS_RAY_CACHE_OPEN_TIME);
+    key.push_back((boxMax[0] <  GVS_RAY_CACHE_OPEN_TIME) ? boxMax[0] - t0 :  GVS_RAY_CACHE_OPEN_TIME);
+}
+
+
+bool GvsRayCache::isStationary( m4d::Metric* metric, const m4d::vec4 &pos ) {
+    const double offsets[3][4] = { {0.0, 0.0, 0.0, 0.0}, {0.0, 0.3, 0.1, 0.2}, {0.0, 1.1, -0.2, -0.4} };
+    const double times[2] = { 1.7, -23.9 };
+    for (int k = 0; k < 3; k++) {
+        double p[4];
+        for (int i = 0; i < 4; i++) {
+            p[i] = pos.x(i) + offsets[k][i];
+        }
+        metric->calculateMetric(p);
+        double g[4][4];
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                g[i][j] = metric->getMetricCoeff(i,j);
+            }
+        }
+
+        for (int s = 0; s < 2; s++) {
+            double q[4] = { p[0] + times[s], p[1], p[2], p[3] };
+            metric->calculateMetric(q);
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    double val = metric->getMetricCoeff(i,j);
+                    if (!(fabs(val - g[i][j]) <= 1.0e-12*(fabs(g[i][j]) + 1.0))) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+void GvsRayCache::resetEye( Eye &eye, int resX, int resY ) {
+    // The memory of the dropped rays is free again.
+    for (size_t n = 0; n < eye.entries.size(); n++) {
+        if (eye.state[n].load() == entryFilled) {
+            mNumBytes -= 2*sizeof(m4d::vec4)*eye.entries[n].points.size();
+            mNumRays--;
+        }
+    }
+
+    eye.valid = false;
+    eye.names.clear();
+    eye.key.clear();
+    eye.stationary = false;
+    eye.time = 0.0;
+    eye.timeShift = 0.0;
+    eye.resX = resX;
+    eye.resY = resY;
+
+    int num = resX*resY;
+    std::vector<Entry>(num).swap(eye.entries);
+    eye.state.reset(new std::atomic<char>[num]);
+    for (int n = 0; n < num; n++) {
+        eye.state[n] = entryEmpty;
+    }
+}
+
+
+int GvsRayCache::entryIndex( const Eye &eye, double x, double y ) const {
+    if (!eye.valid) {
+        return -1;
+    }
+    int i = static_cast<int>(x);
+    int j = static_cast<int>(y);
+    if (i != x || j != y || i < 0 || i >= eye.resX || j < 0 || j >= eye.resY) {
+        return -1;
+    }
+    return j*eye.resX + i;
+}
+
+
+bool GvsRayCache::reserveBytes( size_t num ) {
+    size_t bytes = 2*sizeof(m4d::vec4)*num;
+    if (mNumBytes.fetch_add(bytes) + bytes > mMaxBytes) {
+        mNumBytes -= bytes;
+        return false;
+    }
+    return true;
+}
+
+
+void GvsRayCache::Print( FILE* fptr ) const {
+    fprintf(fptr,"RayCache {\n");
+    fprintf(fptr,"\trays   : %d\n",mNumRays.load());
+    fprintf(fptr,"\tMBytes : %.1f of %.1f\n",mNumBytes.load()/(1024.0*1024.0),mMaxBytes/(1024.0*1024.0));
+    fprintf(fptr,"}\n");
+}
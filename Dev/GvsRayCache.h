@@ -0,0 +1,128 @@
+/**
+ * @file    GvsRayCache.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_RAY_CACHE_H
+#define GVS_RAY_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+#include <m4dGlobalDefs.h>
+#include <metric/m4dMetric.h>
+
+class GvsDevice;
+class GvsRay;
+
+/**
+ * Light rays of the pixels, kept from one frame to the next.
+ *
+ *   If only objects move between the frames of an animation, the light
+ *   rays of the pixels do not change. The cache keeps the ray of every
+ *   pixel center that was integrated for the first frame; the following
+ *   frames only test these rays for intersections and shade them.
+ *
+ *   The rays of each camera eye belong to a key: the position of the
+ *   observer, the directions of some probe pixels (tetrad and camera), the
+ *   metric and its parameters, and the parameters of the ray generator and
+ *   its solver. 'prepare' drops the rays of the eye if the key of the device
+ *   differs. If the metric does not depend on the time coordinate, a change
+ *   of the time of the observer shifts the cached rays in time instead.
+ *
+ *   The cache can be written to and read from a binary file; thus, frames
+ *   rendered by separate processes share their rays. Rays are only stored
+ *   as long as the cache holds less than 'maxMBytes' megabytes.
+ */
+class GvsRayCache
+{
+public:
+    explicit GvsRayCache( double maxMBytes = 1024.0 );
+
+    /**
+     * Prepare the cache for the frame of the device.
+     *   Call before any ray of the frame is taken or stored.
+     * @param device  device of the frame; its camera eye selects the rays
+     */
+    void  prepare ( GvsDevice* device );
+
+    //! Drop all rays.
+    void  clear ( );
+
+    //! The ray of sample (x,y) of the eye is cached.
+    bool  contains ( GvsCamEye eye, double x, double y ) const;
+
+    /**
+     * Copy the ray of sample (x,y) of the eye.
+     * @param points  ray points; the buffer is overwritten
+     * @param dirs    ray directions; the buffer is overwritten
+     * @param bc      break condition of the ray
+     * @return false if the ray is not cached
+     */
+    bool  getRay ( GvsCamEye eye, double x, double y, std::vector<m4d::vec4> &points,
+                   std::vector<m4d::vec4> &dirs, m4d::enum_break_condition &bc ) const;
+
+    /**
+     * Store the ray of sample (x,y) of the eye if it is not cached yet.
+     *   Only samples at pixel centers are stored. Several threads may store
+     *   the rays of different pixels concurrently.
+     */
+    void  storeRay ( GvsCamEye eye, double x, double y, GvsRay* ray );
+
+    bool  read  ( const char* filename );
+    bool  write ( const char* filename ) const;
+
+    int   getNumRays  ( ) const;
+    void  Print ( FILE* fptr = stderr ) const;
+
+protected:
+    typedef struct Entry_T {
+        std::vector<m4d::vec4>     points;
+        std::vector<m4d::vec4>     dirs;
+        m4d::enum_break_condition  breakCond;
+    } Entry;
+
+    enum { entryEmpty = 0, entryWriting, entryFilled };
+
+    //! Rays of one camera eye.
+    typedef struct Eye_T {
+        bool                 valid;
+        std::string          names;       //!< metric and solver
+        std::vector<double>  key;
+        bool                 stationary;  //!< the rays may be shifted in time
+        double               time;        //!< time of the observer of the stored rays
+        double               timeShift;   //!< time of the current observer minus 'time'
+        int                  resX;
+        int                  resY;
+        std::vector<Entry>   entries;
+        std::unique_ptr<std::atomic<char>[]>  state;
+    } Eye;
+
+    //! Key of the rays of the device.
+    void  makeKey ( GvsDevice* device, std::string &names, std::vector<double> &key,
+                    bool &stationary, double &time ) const;
+
+    //! The metric does not depend on the time coordinate near the position.
+    static bool  isStationary ( m4d::Metric* metric, const m4d::vec4 &pos );
+
+    void  resetEye ( Eye &eye, int resX, int resY );
+
+    //! Index of the entry of sample (x,y); -1 if (x,y) is not a pixel center.
+    int   entryIndex ( const Eye &eye, double x, double y ) const;
+
+    //! Reserve memory for a ray with num points; false if the cache is full.
+    bool  reserveBytes ( size_t num );
+
+private:
+    double  mMaxBytes;
+    std::atomic<size_t>  mNumBytes;
+    std::atomic<int>     mNumRays;
+
+    Eye  mEyes[3];
+};
+
+#endif // GVS_RAY_CACHE_H
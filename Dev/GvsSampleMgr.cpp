@@ -17,22 +17,223 @@
 //  along with GeoViS.  If not, see <http://www.gnu.org/licenses/>.
 // ---------------------------------------------------------------------
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "Cam/GvsCamera.h"
+#include "Dev/GvsBackgroundTable.h"
+#include "Dev/GvsBlockSample.h"
 #include "Dev/GvsDevice.h"
 #include "Dev/GvsSampleMgr.h"
 #include "Dev/GvsProjector.h"
+#include "Dev/GvsRayCache.h"
+#include "Dev/GvsTileScheduler.h"
 #include "Img/GvsPicIOEnvelope.h"
+#include "Ray/GvsSurfIntersec.h"
+#include "Utils/GvsAllocCounter.h"
+#include "Utils/GvsProgress.h"
+#include "Utils/GvsRenderJournal.h"
+#include "Utils/GvsStatistics.h"
 
 #include "Utils/GvsLog.h"
 extern GvsLog& LOG;
 
 
+// High dynamic range formats get the unclamped radiance.
+static bool writeImage( GvsChannelImg2D& ldrImg, GvsHdrImg2D& hdrImg, const char* filename ) {
+    if (GvsPicIOEnvelope::isHdrExtension(filename)) {
+        return GvsPicIOEnvelope().writeHdrImg( hdrImg, filename );
+    }
+    return GvsPicIOEnvelope().writeChannelImg( ldrImg, filename );
+}
+
+// Jitter within a stratum of a refined pixel. It only depends on the pixel
+// and the ray; thus, the image does not depend on the number of threads.
+static double subpixelJitter( unsigned int x, unsigned int y, unsigned int n ) {
+    unsigned int h = (x * 73856093u) ^ (y * 19349663u) ^ (n * 83492791u);
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return (h & 0xffffff) / 16777216.0;
+}
+
+
+/**
+ * Progressive rendering of one tile.
+ *   The tile is split into blocks whose corner rays are traced first. A block
+ *   is interpolated if it is smooth, see gvsIsSmoothBlock; otherwise, it is
+ *   split into four blocks. The samples of the traced rays are kept until the
+ *   tile is finished.
+ */
+class GvsProgressiveTile
+{
+public:
+    GvsProgressiveTile( GvsDevice* device, int x1, int y1, int x2, int y2 )
+        : mDevice(device), mX1(x1), mY1(y1),
+          mWidth(x2 - x1 + 1), mHeight(y2 - y1 + 1), mMaxError(0.0), mNumInterpolated(0) {
+        int numPixels = mWidth * mHeight;
+        mColors.resize(numPixels);
+        mKeys.resize(numPixels);
+        mState.assign(numPixels, stateEmpty);
+        mSampleIdx.assign(numPixels, -1);
+    }
+
+    void render( int blockSize, double maxError ) {
+        mMaxError = maxError;
+        int x2 = mX1 + mWidth - 1;
+        int y2 = mY1 + mHeight - 1;
+        for (int by = mY1; ; by += blockSize) {
+            int by2 = std::min(by + blockSize, y2);
+            for (int bx = mX1; ; bx += blockSize) {
+                int bx2 = std::min(bx + blockSize, x2);
+                refineBlock(bx, by, bx2, by2);
+                if (bx2 >= x2) {
+                    break;
+                }
+            }
+            if (by2 >= y2) {
+                break;
+            }
+        }
+    }
+
+    const GvsColor&      color ( int x, int y ) const { return mColors[index(x,y)]; }
+    const gvsSampleKey&  key   ( int x, int y ) const { return mKeys[index(x,y)]; }
+    int  numInterpolated () const { return mNumInterpolated; }
+
+private:
+    enum { stateEmpty = 0, stateInterpolated, stateTraced };
+
+    int index( int x, int y ) const {
+        return (y - mY1) * mWidth + (x - mX1);
+    }
+
+    int trace( int x, int y ) {
+        int n = index(x,y);
+        if (mState[n] == stateTraced) {
+            return n;
+        }
+        if (mState[n] == stateInterpolated) {
+            mNumInterpolated--;
+        }
+        GvsBlockSample sample;
+        gvsTraceBlockSample(mDevice, double(x), double(y), sample);
+        mColors[n] = sample.col;
+        mKeys[n] = sample.key;
+        mSampleIdx[n] = static_cast<int>(mSamples.size());
+        mSamples.push_back(sample);
+        mState[n] = stateTraced;
+        return n;
+    }
+
+    const GvsBlockSample* tracedSample( int n ) const {
+        return &mSamples[mSampleIdx[n]];
+    }
+
+    void refineBlock( int x1, int y1, int x2, int y2 ) {
+        int corner[4] = { trace(x1,y1), trace(x2,y1), trace(x1,y2), trace(x2,y2) };
+        if (x2 - x1 < 2 && y2 - y1 < 2) {
+            return;
+        }
+
+        int cx = (x1 + x2) / 2;
+        int cy = (y1 + y2) / 2;
+        int center = trace(cx,cy);
+        double tx = (x2 > x1) ? (cx - x1) / double(x2 - x1) : 0.0;
+        double ty = (y2 > y1) ? (cy - y1) / double(y2 - y1) : 0.0;
+
+        // The samples are not traced any more, the pointers stay valid.
+        const GvsBlockSample* cornerSample[4] = { tracedSample(corner[0]), tracedSample(corner[1]),
+                                                  tracedSample(corner[2]), tracedSample(corner[3]) };
+        if (gvsIsSmoothBlock(mDevice, cornerSample, *tracedSample(center), tx, ty, mMaxError)) {
+            interpolateBlock(x1, y1, x2, y2, cornerSample);
+            return;
+        }
+
+        // Split at the center; a block of width one is only split in the other direction.
+        int xr[2][2], yr[2][2];
+        int nx = splitRange(x1, cx, x2, xr);
+        int ny = splitRange(y1, cy, y2, yr);
+        for (int j = 0; j < ny; j++) {
+            for (int i = 0; i < nx; i++) {
+                refineBlock(xr[i][0], yr[j][0], xr[i][1], yr[j][1]);
+            }
+        }
+    }
+
+    static int splitRange( int a, int c, int b, int range[2][2] ) {
+        if (c == a) {
+            range[0][0] = a;
+            range[0][1] = b;
+            return 1;
+        }
+        range[0][0] = a;
+        range[0][1] = c;
+        range[1][0] = c;
+        range[1][1] = b;
+        return 2;
+    }
+
+    void interpolateBlock( int x1, int y1, int x2, int y2, const GvsBlockSample* const corner[4] ) {
+        bool hit = (corner[0]->key.object != nullptr);
+        for (int y = y1; y <= y2; y++) {
+            for (int x = x1; x <= x2; x++) {
+                int n = index(x,y);
+                if (mState[n] != stateEmpty) {
+                    continue;
+                }
+                double tx = (x2 > x1) ? (x - x1) / double(x2 - x1) : 0.0;
+                double ty = (y2 > y1) ? (y - y1) / double(y2 - y1) : 0.0;
+                mKeys[n] = corner[0]->key;
+                if (hit) {
+                    mColors[n] = mDevice->projector->shadeIntersec(mDevice, gvsInterpolateHit(corner, tx, ty));
+                } else {
+                    mColors[n] = gvsInterpolateColor(corner, tx, ty);
+                }
+                mState[n] = stateInterpolated;
+                mNumInterpolated++;
+            }
+        }
+    }
+
+private:
+    GvsDevice*  mDevice;
+    int         mX1;
+    int         mY1;
+    int         mWidth;
+    int         mHeight;
+    double      mMaxError;
+    int         mNumInterpolated;
+
+    std::vector<GvsColor>      mColors;
+    std::vector<gvsSampleKey>  mKeys;
+    std::vector<char>          mState;
+    std::vector<int>           mSampleIdx;  //!< index into 'mSamples' of traced pixels
+    std::vector<GvsBlockSample>  mSamples;
+};
+
+
 GvsSampleMgr ::  GvsSampleMgr ( GvsDevice* rtDev, bool showProgress )
     : sampleDevice(rtDev),
       aspectRatio(1.0),
-      mShowProgress(showProgress)
+      mShowProgress(showProgress),
+      mAdaptiveGrid(0),
+      mAdaptiveThreshold(0.05),
+      mAdaptiveBudget(1.0),
+      mNumInterpolated(0),
+      mBgTable(NULL),
+      mJournal(NULL),
+      mJournalFile(NULL),
+      mJournalRefined(false),
+      mNumAllocations(0),
+      mNumAllocPixels(0),
+      mNumPixels(0)
 {
     assert(sampleDevice!=NULL);
 
@@ -42,6 +243,8 @@ GvsSampleMgr ::  GvsSampleMgr ( GvsDevice* rtDev, bool showProgress )
     samplePicture = new GvsChannelImg2D( resX, resY, 3 );
     assert(samplePicture!=NULL);
 
+    sampleHdrPicture = new GvsHdrImg2D( resX, resY );
+
     sampleIntersecPicture = new GvsIntersecOutput(0, 0);
     assert(sampleIntersecPicture != NULL);
 
@@ -49,10 +252,23 @@ GvsSampleMgr ::  GvsSampleMgr ( GvsDevice* rtDev, bool showProgress )
 }
 
 GvsSampleMgr :: ~GvsSampleMgr() {
+    if (mBgTable != NULL) {
+        sampleDevice->bgTable = NULL;
+        delete mBgTable;
+        mBgTable = NULL;
+    }
+    if (mJournalFile != NULL) {
+        fclose(mJournalFile);
+        mJournalFile = NULL;
+    }
     if (samplePicture!=NULL) {
         delete samplePicture;
         samplePicture = NULL;
     }
+    if (sampleHdrPicture != NULL) {
+        delete sampleHdrPicture;
+        sampleHdrPicture = NULL;
+    }
     if (sampleIntersecPicture != NULL) {
         delete sampleIntersecPicture;
         sampleIntersecPicture = NULL;
@@ -63,6 +279,9 @@ void GvsSampleMgr :: clear() {
     if (samplePicture != NULL) {
         samplePicture->clear();
     }
+    if (sampleHdrPicture != NULL) {
+        sampleHdrPicture->clear();
+    }
     if (sampleIntersecPicture != NULL) {
         sampleIntersecPicture->clear();
     }
@@ -87,10 +306,12 @@ void GvsSampleMgr::setRegionToImage() {
     bool withData = false;
     if ((filter == gvsCamFilterRGBpdz) ||
             (filter == gvsCamFilterRGBjac) ||
-            (filter == gvsCamFilterRGBpt)) {
+            (filter == gvsCamFilterRGBpt) ||
+            (filter == gvsCamFilterRGBcost)) {
         withData = true;
     }
     samplePicture->resize( resX, resY, withData );
+    sampleHdrPicture->resize( resX, resY );
 }
 
 
@@ -130,6 +351,8 @@ void GvsSampleMgr :: setRegion ( const m4d::ivec2 &corner1, const m4d::ivec2 &co
     }
     samplePicture->resize( sampleDevice->camera->GetResolution().x(0),
                            sampleDevice->camera->GetResolution().x(1) );
+    sampleHdrPicture->resize( sampleDevice->camera->GetResolution().x(0),
+                              sampleDevice->camera->GetResolution().x(1) );
 }
 
 
@@ -160,61 +383,226 @@ int GvsSampleMgr::calcRegionData(int x1, int y1, int x2, int y2) const {
 
 bool GvsSampleMgr::putFirstPixel() {
     samplePixCoord = sampleRegionLL;        
+    mJournalRefined = false;
+    mResumedPixels.clear();
+    resetAllocations();
+    prepareSampleKeys();
+    if (sampleDevice->rayCache != NULL) {
+        sampleDevice->rayCache->prepare(sampleDevice);
+    }
+    sampleDevice->projector->prepareRayFamily(sampleDevice);
+    std::vector<GvsDevice*> devices(1, sampleDevice);
+    prepareBackgroundTable(devices);
+    mProgress.start("Rendering", calcRegionPixels(sampleRegionLL.x(0), sampleRegionLL.x(1),
+                    sampleRegionUR.x(0), sampleRegionUR.x(1)), mShowProgress ? 1.0 : 0.0);
+
+    if (useProgressive()) {
+        // The whole region is rendered here; putNextPixel only finishes it.
+        mNumInterpolated = 0;
+        int tileSize = 4 * sampleDevice->camera->getProgressiveBlock();
+        for (int y = sampleRegionLL.x(1); y <= sampleRegionUR.x(1); y += tileSize) {
+            for (int x = sampleRegionLL.x(0); x <= sampleRegionUR.x(0); x += tileSize) {
+                int x2 = std::min(x + tileSize - 1, sampleRegionUR.x(0));
+                int y2 = std::min(y + tileSize - 1, sampleRegionUR.x(1));
+                renderProgressive(sampleDevice, x, y, x2, y2);
+                mProgress.addPixels(calcRegionPixels(x, y, x2, y2));
+            }
+        }
+        samplePixCoord = sampleRegionUR;
+        return true;
+    }
 
     GvsColor pixcol;
     gvsData data;
-    calcPixelColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol, data );
-    samplePicture->setColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol );
+    unsigned long numAllocs = GvsAllocCounter::numAllocations();
+    tracePacket( sampleDevice, samplePixCoord.x(0), samplePixCoord.x(1), sampleRegionLL.x(0), sampleRegionUR.x(0) );
+    calcPixelColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol, data,
+                    sampleKey(samplePixCoord.x(0), samplePixCoord.x(1)) );
+    countAllocations( GvsAllocCounter::numAllocations() - numAllocs );
+    storeColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol );
 
     if (sampleIntersecPicture != NULL) {
         sampleIntersecPicture->setData(samplePixCoord.x(0), samplePixCoord.x(1), data);
     }
+    mProgress.addPixels(1);
     return true;
 }
 
 
 bool GvsSampleMgr::putNextPixel() {
     if ( ++samplePixCoord[0] > sampleRegionUR[0] ) {
-        if ( ++samplePixCoord[1] > sampleRegionUR[1] ) return false;
+        if ( ++samplePixCoord[1] > sampleRegionUR[1] ) {
+            printProgressive();
+            if (!mSampleKeys.empty()) {
+                std::vector<GvsDevice*> devices(1, sampleDevice);
+                refineAdaptive(devices);
+            }
+            // the whole region is one tile
+            mProgress.addTile(sampleRegionLL.x(0), sampleRegionLL.x(1), sampleRegionUR.x(0), sampleRegionUR.x(1),
+                              mProgress.wallTime());
+            mProgress.stop();
+            return false;
+        }
 
         samplePixCoord[0] = sampleRegionLL[0];
     }
 
     GvsColor pixcol;
     gvsData data;
-    calcPixelColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol, data );
-    samplePicture->setColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol );
+    unsigned long numAllocs = GvsAllocCounter::numAllocations();
+    tracePacket( sampleDevice, samplePixCoord.x(0), samplePixCoord.x(1), sampleRegionLL.x(0), sampleRegionUR.x(0) );
+    calcPixelColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol, data,
+                    sampleKey(samplePixCoord.x(0), samplePixCoord.x(1)) );
+    countAllocations( GvsAllocCounter::numAllocations() - numAllocs );
+    storeColor( samplePixCoord.x(0), samplePixCoord.x(1), pixcol );
 
     if (sampleDevice->camera->getCamFilter() == gvsCamFilterRGBIntersec) {
         if (sampleIntersecPicture != NULL) {
             sampleIntersecPicture->setData(samplePixCoord.x(0), samplePixCoord.x(1), data);
         }
     }
+    mProgress.addPixels(1);
     return true;
 }
 
 
-void GvsSampleMgr::calcPixelColor(int i, int j , GvsColor &col, gvsData &data) const {
-    if (mShowProgress) {
-        fprintf(stderr,"\r%4d %4d / %4d %4d",i+1,j+1,
-                sampleDevice->camera->GetResolution().x(0),
-                sampleDevice->camera->GetResolution().x(1));
+void GvsSampleMgr::storeColor( int x, int y, const GvsColor& col ) {
+    sampleHdrPicture->setColor( x, y, col );
+
+    GvsColor ldrCol = col;
+    samplePicture->setColor( x, y, ldrCol.trim() );
+}
+
+
+bool GvsSampleMgr::isMasked( int i, int j ) const {
+    if (!haveMask) {
+        return false;
+    }
+    int px = static_cast<int>( i*maskResX/static_cast<double>(resX) );
+    int py = static_cast<int>( j*maskResY/static_cast<double>(resY) );
+    return (maskPicture.sampleValue(px,py) < 0.9);
+}
+
+
+void GvsSampleMgr::tracePacket( GvsDevice* device, int x, int y, int xStart, int xEnd ) const {
+    GvsCamFilter filter = device->camera->getCamFilter();
+    if (filter != gvsCamFilterRGB && filter != gvsCamFilterRGBpt && filter != gvsCamFilterRGBIntersec) {
+        return;
+    }
+    int packetSize = device->projector->getPacketSize();
+    if (packetSize <= 0 || (x - xStart) % packetSize != 0) {
+        return;
     }
 
-    bool doSample = true;
-    if (haveMask) {
-        int px = static_cast<int>( i*maskResX/static_cast<double>(resX) );
-        int py = static_cast<int>( j*maskResY/static_cast<double>(resY) );
-        double val = maskPicture.sampleValue(px,py);
-        if (val < 0.9) {
-            doSample = false;
+    double px[GVS_PACKET_MAX_LANES];
+    double py[GVS_PACKET_MAX_LANES];
+    int num = 0;
+    for (int i = x; i <= xEnd && i < x + packetSize; i++) {
+        if (!isMasked(i, y)) {
+            px[num] = double(i);
+            py[num] = double(y);
+            num++;
         }
     }
+    device->projector->tracePacket(device, num, px, py);
+}
 
+
+void GvsSampleMgr::calcPixelColor(int i, int j , GvsColor &col, gvsData &data, gvsSampleKey* key) const {
+    calcPixelColor(sampleDevice, i, j, col, data, key);
+}
+
+
+void GvsSampleMgr::calcPixelColor(GvsDevice* device, int i, int j, GvsColor &col, gvsData &data, gvsSampleKey* key) const {
     col = RgbBlack;
-    if (doSample) {
-        sampleDevice->projector->getSampleColor( sampleDevice, double(i), double (j), col, data );
-    }    
+    if (isMasked(i,j)) {
+        return;
+    }
+    if (device->camera->getCamFilter() != gvsCamFilterRGBcost) {
+        device->projector->getSampleColor( device, double(i), double (j), col, data, key );
+        return;
+    }
+
+    // The cost of the pixel is stored like the data of the other filters.
+    GvsStatistics::setPixelCostEnabled(true);
+    GvsStatistics::resetPixelCost();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    device->projector->getSampleColor( device, double(i), double (j), col, data );
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    GvsStatistics::setPixelCostEnabled(false);
+    col.data.cost[0] = seconds.count();
+    col.data.cost[1] = static_cast<double>(GvsStatistics::pixelCost().numSteps);
+    col.data.cost[2] = static_cast<double>(GvsStatistics::pixelCost().numSegmentTests);
+}
+
+
+void GvsSampleMgr::renderParallel( int numThreads, int tileSize ) {
+    assert(sampleDevice!=NULL);
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+
+    std::vector<GvsDevice*> workerDevices;
+    for (int w = 0; w < numThreads; w++) {
+        GvsDevice* device = sampleDevice->createThreadCopy();
+        if (device == NULL) {
+            break;
+        }
+        workerDevices.push_back(device);
+    }
+
+    if (workerDevices.empty()) {
+        fprintf(stderr,"GvsSampleMgr::renderParallel() ... cannot create worker devices, render serially.\n");
+        putFirstPixel();
+        while (putNextPixel());
+        return;
+    }
+
+    std::vector<GvsTile> finished;
+    mJournalRefined = false;
+    mResumedPixels.clear();
+    if (mJournal != NULL) {
+        resumeJournal(finished);
+    }
+
+    // A tile holds several blocks of progressive rendering.
+    if (useProgressive()) {
+        tileSize = std::max(tileSize, 4 * sampleDevice->camera->getProgressiveBlock());
+        mNumInterpolated = 0;
+    }
+
+    int numWorkers = static_cast<int>(workerDevices.size());
+    GvsTileScheduler scheduler(numWorkers);
+    scheduler.setRegion(sampleRegionLL, sampleRegionUR, tileSize, finished);
+    resetAllocations();
+    prepareSampleKeys();
+    if (sampleDevice->rayCache != NULL) {
+        sampleDevice->rayCache->prepare(sampleDevice);
+    }
+    sampleDevice->projector->prepareRayFamily(sampleDevice);
+    prepareBackgroundTable(workerDevices);
+
+    long numPixels = 0;
+    for (unsigned int i = 0; i < finished.size(); i++) {
+        numPixels += calcRegionPixels(finished[i].x1, finished[i].y1, finished[i].x2, finished[i].y2);
+    }
+    mProgress.start("Rendering", calcRegionPixels(sampleRegionLL.x(0), sampleRegionLL.x(1),
+                    sampleRegionUR.x(0), sampleRegionUR.x(1)) - numPixels, mShowProgress ? 1.0 : 0.0);
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < numWorkers; w++) {
+        workers.push_back(std::thread(&GvsSampleMgr::renderTiles, this, workerDevices[w], &scheduler, w));
+    }
+    for (int w = 0; w < numWorkers; w++) {
+        workers[w].join();
+    }
+    printProgressive();
+    refineAdaptive(workerDevices);
+    mProgress.stop();
+
+    for (int w = 0; w < numWorkers; w++) {
+        delete workerDevices[w];
+    }
 }
 
 
@@ -232,6 +620,402 @@ void GvsSampleMgr::calcPixelColor(int i, int j , GvsColor &col, gvsData &data) c
 //}
 
 
+void GvsSampleMgr::renderTiles( GvsDevice* device, GvsTileScheduler* scheduler, int worker ) {
+    GvsCamFilter filter = device->camera->getCamFilter();
+    bool progressive = useProgressive();
+
+    GvsTile tile;
+    while (scheduler->getNextTile(worker, tile)) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (progressive) {
+            renderProgressive(device, tile.x1, tile.y1, tile.x2, tile.y2);
+        } else {
+            for (int y = tile.y1; y <= tile.y2; y++) {
+                for (int x = tile.x1; x <= tile.x2; x++) {
+                    GvsColor pixcol;
+                    gvsData data;
+                    unsigned long numAllocs = GvsAllocCounter::numAllocations();
+                    tracePacket( device, x, y, tile.x1, tile.x2 );
+                    calcPixelColor( device, x, y, pixcol, data, sampleKey(x, y) );
+                    countAllocations( GvsAllocCounter::numAllocations() - numAllocs );
+                    storeColor( x, y, pixcol );
+
+                    if (filter == gvsCamFilterRGBIntersec && sampleIntersecPicture != NULL) {
+                        sampleIntersecPicture->setData( x, y, data );
+                    }
+                }
+            }
+        }
+
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (mJournalFile != NULL) {
+            journalTile(tile, seconds.count());
+        }
+        mProgress.addPixels(calcRegionPixels(tile.x1, tile.y1, tile.x2, tile.y2));
+        mProgress.addTile(tile.x1, tile.y1, tile.x2, tile.y2, seconds.count(), worker);
+    }
+}
+
+
+bool GvsSampleMgr::useProgressive() const {
+    return (sampleDevice->camera->getProgressiveBlock() > 1) && !haveMask
+            && (sampleDevice->camera->getCamFilter() == gvsCamFilterRGB);
+}
+
+
+void GvsSampleMgr::renderProgressive( GvsDevice* device, int x1, int y1, int x2, int y2 ) {
+    GvsProgressiveTile tile(device, x1, y1, x2, y2);
+    tile.render(device->camera->getProgressiveBlock(), device->camera->getProgressiveError());
+
+    for (int y = y1; y <= y2; y++) {
+        for (int x = x1; x <= x2; x++) {
+            storeColor( x, y, tile.color(x, y) );
+            gvsSampleKey* key = sampleKey(x, y);
+            if (key != NULL) {
+                *key = tile.key(x, y);
+            }
+        }
+    }
+    mNumInterpolated += tile.numInterpolated();
+}
+
+
+void GvsSampleMgr::printProgressive() const {
+    if (!useProgressive() || !mShowProgress) {
+        return;
+    }
+    int numPixels = calcRegionPixels(sampleRegionLL.x(0), sampleRegionLL.x(1),
+                                     sampleRegionUR.x(0), sampleRegionUR.x(1));
+    fprintf(stderr,"\nProgressive rendering: %d of %d pixels interpolated.\n",mNumInterpolated.load(),numPixels);
+}
+
+
+void GvsSampleMgr::prepareBackgroundTable( std::vector<GvsDevice*> &devices ) {
+    int step = sampleDevice->camera->getBackgroundTableStep();
+    if (step < 2 || sampleDevice->camera->getCamFilter() != gvsCamFilterRGB) {
+        return;
+    }
+
+    // The table of the last rendering may belong to another pose.
+    sampleDevice->bgTable = NULL;
+    for (unsigned int w = 0; w < devices.size(); w++) {
+        devices[w]->bgTable = NULL;
+    }
+    delete mBgTable;
+    mBgTable = new GvsBackgroundTable(step, sampleDevice->camera->getBackgroundTableError());
+    mBgTable->build(devices);
+
+    sampleDevice->bgTable = mBgTable;
+    for (unsigned int w = 0; w < devices.size(); w++) {
+        devices[w]->bgTable = mBgTable;
+    }
+    if (mShowProgress) {
+        fprintf(stderr,"Background table: %d of %d cells of %dx%d pixels resolved.\n",
+                mBgTable->getNumResolved(),mBgTable->getNumCells(),step,step);
+    }
+}
+
+
+void GvsSampleMgr::setAdaptiveSampling( int gridSize, double threshold, double budget ) {
+    mAdaptiveGrid = gridSize;
+    mAdaptiveThreshold = threshold;
+    mAdaptiveBudget = budget;
+}
+
+
+void GvsSampleMgr::prepareSampleKeys() {
+    mSampleKeys.clear();
+    if (mAdaptiveGrid < 2 || mAdaptiveBudget <= 0.0 || sampleDevice->camera->getCamFilter() != gvsCamFilterRGB) {
+        return;
+    }
+    mSampleKeys.resize(static_cast<size_t>(samplePicture->width()) * samplePicture->height());
+}
+
+
+gvsSampleKey* GvsSampleMgr::sampleKey( int x, int y ) {
+    if (mSampleKeys.empty()) {
+        return NULL;
+    }
+    return &mSampleKeys[static_cast<size_t>(y) * samplePicture->width() + x];
+}
+
+
+/**
+ * Each pixel is compared with its right and upper neighbor. If they differ,
+ * both become candidates with the strength of the edge. If there are more
+ * candidates than the budget allows, the strongest edges are refined.
+ */
+void GvsSampleMgr::refineAdaptive( std::vector<GvsDevice*> &devices ) {
+    if (mSampleKeys.empty() || devices.empty() || mJournalRefined) {
+        return;
+    }
+
+    int width = samplePicture->width();
+    int x1 = sampleRegionLL.x(0);
+    int y1 = sampleRegionLL.x(1);
+    int x2 = sampleRegionUR.x(0);
+    int y2 = sampleRegionUR.x(1);
+    int regWidth = x2 - x1 + 1;
+    int numPixels = calcRegionPixels(x1, y1, x2, y2);
+
+    std::vector<float> strength(numPixels, 0.0f);
+    for (int y = y1; y <= y2; y++) {
+        for (int x = x1; x <= x2; x++) {
+            // the keys of resumed pixels are unknown
+            if (isResumed(x, y)) {
+                continue;
+            }
+            GvsColor col = sampleHdrPicture->sampleColor(x, y);
+            const gvsSampleKey &key = *sampleKey(x, y);
+            int n = (y - y1) * regWidth + (x - x1);
+
+            for (int k = 0; k < 2; k++) {
+                int nx = x + 1 - k;
+                int ny = y + k;
+                if (nx > x2 || ny > y2 || isResumed(nx, ny)) {
+                    continue;
+                }
+                GvsColor ncol = sampleHdrPicture->sampleColor(nx, ny);
+                float s = static_cast<float>(gvsEdgeStrength(col, key, ncol, *sampleKey(nx, ny)));
+                if (s > mAdaptiveThreshold) {
+                    int nn = (ny - y1) * regWidth + (nx - x1);
+                    strength[n] = std::max(strength[n], s);
+                    strength[nn] = std::max(strength[nn], s);
+                }
+            }
+        }
+    }
+
+    std::vector<int> candidates;
+    for (int n = 0; n < numPixels; n++) {
+        if (strength[n] > 0.0f && !isMasked(x1 + n % regWidth, y1 + n / regWidth)) {
+            candidates.push_back(n);
+        }
+    }
+
+    size_t maxPixels = static_cast<size_t>(mAdaptiveBudget * numPixels / (mAdaptiveGrid * mAdaptiveGrid));
+    if (candidates.size() > maxPixels) {
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&strength](int a, int b) { return strength[a] > strength[b]; });
+        candidates.resize(maxPixels);
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    std::vector<int> pixels(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        pixels[i] = (y1 + candidates[i] / regWidth) * width + x1 + candidates[i] % regWidth;
+    }
+
+    std::atomic<size_t> next(0);
+    if (devices.size() == 1) {
+        refinePixels(devices[0], &pixels, &next);
+    } else {
+        std::vector<std::thread> workers;
+        for (unsigned int w = 0; w < devices.size(); w++) {
+            workers.push_back(std::thread(&GvsSampleMgr::refinePixels, this, devices[w], &pixels, &next));
+        }
+        for (unsigned int w = 0; w < workers.size(); w++) {
+            workers[w].join();
+        }
+    }
+    if (mJournalFile != NULL) {
+        journalRefinement(pixels);
+    }
+
+    if (mShowProgress) {
+        int numRays = mAdaptiveGrid * mAdaptiveGrid;
+        fprintf(stderr,"\nAdaptive sampling: %d of %d pixels refined with %d rays (%.2f rays per pixel).\n",
+                static_cast<int>(pixels.size()), numPixels, numRays,
+                1.0 + pixels.size() * numRays / static_cast<double>(numPixels));
+    }
+}
+
+
+void GvsSampleMgr::refinePixels( GvsDevice* device, const std::vector<int>* pixels, std::atomic<size_t>* next ) {
+    int width = samplePicture->width();
+    int numRays = mAdaptiveGrid * mAdaptiveGrid;
+
+    size_t n;
+    while ((n = (*next)++) < pixels->size()) {
+        int x = (*pixels)[n] % width;
+        int y = (*pixels)[n] / width;
+
+        GvsColor sum = RgbBlack;
+        for (int r = 0; r < numRays; r++) {
+            double px = x - 0.5 + (r % mAdaptiveGrid + subpixelJitter(x, y, 2*r)) / mAdaptiveGrid;
+            double py = y - 0.5 + (r / mAdaptiveGrid + subpixelJitter(x, y, 2*r+1)) / mAdaptiveGrid;
+
+            GvsColor col;
+            gvsData data;
+            device->projector->getSampleColor( device, px, py, col, data );
+            sum += col;
+        }
+        storeColor( x, y, sum / numRays );
+    }
+}
+
+
+bool GvsSampleMgr::writeReport( const std::string &filename, const std::string &frame ) const {
+    return mProgress.writeReport(filename, frame, resX, resY);
+}
+
+
+void GvsSampleMgr::setJournal( GvsRenderJournal* journal, const std::string &frame, const std::string &signature ) {
+    mJournal = journal;
+    mJournalFrame = frame;
+    mJournalSignature = signature;
+}
+
+
+void GvsSampleMgr::finishJournal() {
+    if (mJournal == NULL) {
+        return;
+    }
+    if (mJournalFile != NULL) {
+        fclose(mJournalFile);
+        mJournalFile = NULL;
+        remove((mJournalFrame + ".part").c_str());
+    }
+    mJournal->setFrameDone(mJournalFrame);
+}
+
+
+/**
+ * The '.part' file holds the unclamped colors of the whole image as
+ * float rgb, row by row. Tiles are written at their final position.
+ */
+void GvsSampleMgr::resumeJournal( std::vector<GvsTile> &finished ) {
+    GvsCamFilter filter = sampleDevice->camera->getCamFilter();
+    if (filter != gvsCamFilterRGB) {
+        return;
+    }
+
+    // Tiles of another scene or resolution are dropped; then, the '.part' file is created anew.
+    mJournal->beginFrame(mJournalFrame, mJournalSignature);
+    std::string partFilename = mJournalFrame + ".part";
+    std::vector<GvsJournalRegion> regions = mJournal->getRegions(mJournalFrame);
+    mJournalFile = regions.empty() ? NULL : fopen(partFilename.c_str(), "r+b");
+    if (mJournalFile == NULL) {
+        regions.clear();
+        mJournalFile = fopen(partFilename.c_str(), "w+b");
+        if (mJournalFile == NULL) {
+            fprintf(stderr,"Cannot open file %s for output!\n",partFilename.c_str());
+            return;
+        }
+    }
+
+    std::vector<float> row;
+    for (unsigned int i = 0; i < regions.size(); i++) {
+        const GvsJournalRegion &r = regions[i];
+        if (r.x1 < 0 || r.y1 < 0 || r.x2 >= resX || r.y2 >= resY || r.x1 > r.x2 || r.y1 > r.y2) {
+            continue;
+        }
+        row.resize(3*(r.x2 - r.x1 + 1));
+        bool isOkay = true;
+        for (int y = r.y1; y <= r.y2 && isOkay; y++) {
+            isOkay = (fseek(mJournalFile, 3*sizeof(float)*(static_cast<long>(y)*resX + r.x1), SEEK_SET) == 0)
+                  && (fread(&row[0], sizeof(float), row.size(), mJournalFile) == row.size());
+            for (int x = r.x1; x <= r.x2 && isOkay; x++) {
+                const float* c = &row[3*(x - r.x1)];
+                storeColor(x, y, GvsColor(c[0], c[1], c[2]));
+            }
+        }
+        if (isOkay) {
+            GvsTile tile = { r.x1, r.y1, r.x2, r.y2 };
+            finished.push_back(tile);
+            mResumedPixels.resize(static_cast<size_t>(resX) * resY, 0);
+            for (int y = r.y1; y <= r.y2; y++) {
+                std::fill(mResumedPixels.begin() + static_cast<size_t>(y) * resX + r.x1,
+                          mResumedPixels.begin() + static_cast<size_t>(y) * resX + r.x2 + 1, 1);
+            }
+        }
+    }
+    if (!finished.empty()) {
+        // the refined colors were stored after all tiles were finished
+        mJournalRefined = mJournal->isFrameRefined(mJournalFrame);
+        fprintf(stderr,"Resume %s: %d tiles already done%s.\n",mJournalFrame.c_str(),static_cast<int>(finished.size()),
+                mJournalRefined ? ", refinement done" : "");
+    }
+}
+
+
+bool GvsSampleMgr::isResumed( int x, int y ) const {
+    return !mResumedPixels.empty() && mResumedPixels[static_cast<size_t>(y) * resX + x];
+}
+
+
+void GvsSampleMgr::journalTile( const GvsTile &tile, double seconds ) {
+    std::vector<float> row(3*(tile.x2 - tile.x1 + 1));
+    bool isOkay = true;
+    {
+        std::lock_guard<std::mutex> lock(mJournalMutex);
+        for (int y = tile.y1; y <= tile.y2 && isOkay; y++) {
+            for (int x = tile.x1; x <= tile.x2; x++) {
+                GvsColor col = sampleHdrPicture->sampleColor(x, y);
+                row[3*(x - tile.x1) + 0] = static_cast<float>(col.red);
+                row[3*(x - tile.x1) + 1] = static_cast<float>(col.green);
+                row[3*(x - tile.x1) + 2] = static_cast<float>(col.blue);
+            }
+            isOkay = (fseek(mJournalFile, 3*sizeof(float)*(static_cast<long>(y)*resX + tile.x1), SEEK_SET) == 0)
+                  && (fwrite(&row[0], sizeof(float), row.size(), mJournalFile) == row.size());
+        }
+        // The tile is handed to the operating system before it is journaled; this
+        // survives a crash of the process, but not necessarily a power failure.
+        isOkay = isOkay && (fflush(mJournalFile) == 0);
+    }
+    if (isOkay) {
+        mJournal->addRegion(mJournalFrame, tile.x1, tile.y1, tile.x2, tile.y2, seconds);
+    }
+}
+
+
+void GvsSampleMgr::journalRefinement( const std::vector<int> &pixels ) {
+    int width = samplePicture->width();
+    bool isOkay = true;
+    for (size_t i = 0; i < pixels.size() && isOkay; i++) {
+        int x = pixels[i] % width;
+        int y = pixels[i] / width;
+        GvsColor col = sampleHdrPicture->sampleColor(x, y);
+        float c[3] = { static_cast<float>(col.red), static_cast<float>(col.green), static_cast<float>(col.blue) };
+        isOkay = (fseek(mJournalFile, 3*sizeof(float)*(static_cast<long>(y)*resX + x), SEEK_SET) == 0)
+              && (fwrite(c, sizeof(float), 3, mJournalFile) == 3);
+    }
+    isOkay = isOkay && (fflush(mJournalFile) == 0);
+    if (isOkay) {
+        mJournal->setFrameRefined(mJournalFrame);
+    }
+}
+
+
+void GvsSampleMgr::resetAllocations() {
+    mNumAllocations = 0;
+    mNumAllocPixels = 0;
+    mNumPixels = 0;
+}
+
+void GvsSampleMgr::countAllocations( unsigned long numAllocs ) {
+    if (!GvsAllocCounter::isEnabled()) {
+        return;
+    }
+    mNumPixels++;
+    if (numAllocs > 0) {
+        mNumAllocPixels++;
+        mNumAllocations += numAllocs;
+    }
+}
+
+void GvsSampleMgr::printAllocations( FILE* fptr ) const {
+    if (!GvsAllocCounter::isEnabled()) {
+        return;
+    }
+    int numPixels = mNumPixels.load();
+    unsigned long numAllocs = mNumAllocations.load();
+    fprintf(fptr,"Heap allocations: %lu in %d of %d pixels (%.4f per pixel)\n",
+            numAllocs, mNumAllocPixels.load(), numPixels,
+            (numPixels > 0) ? numAllocs/static_cast<double>(numPixels) : 0.0);
+}
+
+
 void GvsSampleMgr :: extractRegion ( int x1, int y1, int x2, int y2, uchar* p ) const {
     assert(samplePicture != NULL);
     assert (y2 >= y1);
@@ -286,7 +1070,7 @@ void GvsSampleMgr :: writePicture( char *filename ) const {
             std::string fileExt = newFilename.substr(pos+1,newFilename.length()-pos-1);
             std::string name = newFilename.substr(0,pos);
             newFilename = name + ".left." + fileExt;
-            GvsPicIOEnvelope().writeChannelImg( *samplePicture, newFilename.c_str() );
+            writeImage( *samplePicture, *sampleHdrPicture, newFilename.c_str() );
         }
     }
     else if (sampleDevice->camEye == gvsCamEyeRight) {
@@ -296,15 +1080,16 @@ void GvsSampleMgr :: writePicture( char *filename ) const {
             std::string fileExt = newFilename.substr(pos+1,newFilename.length()-pos-1);
             std::string name = newFilename.substr(0,pos);
             newFilename = name + ".right." + fileExt;
-            GvsPicIOEnvelope().writeChannelImg( *samplePicture, newFilename.c_str() );
+            writeImage( *samplePicture, *sampleHdrPicture, newFilename.c_str() );
         }
     }
     else {
-        GvsPicIOEnvelope().writeChannelImg( *samplePicture, filename );
+        writeImage( *samplePicture, *sampleHdrPicture, filename );
         GvsCamFilter filter = sampleDevice->camera->getCamFilter();
         if ((filter == gvsCamFilterRGBpdz) ||
                 (filter == gvsCamFilterRGBjac) ||
-                (filter == gvsCamFilterRGBpt)) {
+                (filter == gvsCamFilterRGBpt) ||
+                (filter == gvsCamFilterRGBcost)) {
             samplePicture->writeIntersecData(filename,filter);
         }
     }
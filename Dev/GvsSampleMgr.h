@@ -19,16 +19,25 @@
 #ifndef GVS_SAMPLE_MGR_H
 #define GVS_SAMPLE_MGR_H
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #include "GvsGlobalDefs.h"
 #include "Img/GvsColor.h"
 #include "Img/GvsChannelImg2D.h"
+#include "Img/GvsHdrImg2D.h"
 #include "Img/GvsIntersecOutput.h"
+#include "Utils/GvsProgress.h"
 
 #include "m4dGlobalDefs.h"
 
+class GvsBackgroundTable;
 class GvsDevice;
+class GvsRenderJournal;
+class GvsTileScheduler;
+struct GvsTile_t;
 
 /**
  * The sample manager is responsible for determining the color of each pixel.
@@ -94,14 +103,59 @@ public:
      */
     bool  putNextPixel();
 
+    /**
+     * Render region in parallel.
+     *   The region is split into tiles which are distributed to the worker threads
+     *   by a work-stealing tile scheduler. Each worker traces its rays with its own
+     *   projector, ray generator, geodesic solver, and metric. The result is
+     *   identical to the one of the putFirstPixel/putNextPixel loop.
+     * @param numThreads  number of worker threads
+     * @param tileSize    edge length of a tile in pixels
+     */
+    void  renderParallel ( int numThreads, int tileSize = 16 );
+
+    /**
+     * Journal finished tiles of renderParallel for checkpoint and resume.
+     *   The unclamped colors of finished tiles are stored in '<frame>.part'.
+     *   If the journal has tiles of this frame from an interrupted run, they
+     *   are read from that file instead of being rendered again. The refinement
+     *   pass of adaptive sampling is journaled when it is finished; it skips
+     *   the pixels of resumed tiles, whose keys are unknown. Frames with
+     *   intersection data are not resumed. Tiles journaled with another
+     *   signature are rendered again.
+     * @param journal    journal or NULL
+     * @param frame      name of the frame, i.e. its output file name
+     * @param signature  scene and resolution of the frame, see GvsRenderJournal::makeSignature
+     */
+    void  setJournal     ( GvsRenderJournal* journal, const std::string &frame, const std::string &signature );
+
+    //! Mark the frame as done in the journal and remove the '.part' file; call after writePicture.
+    void  finishJournal  ( );
+
+    /**
+     * Adaptive supersampling.
+     *   First, one ray per pixel is traced. Then, pixels whose clamped color
+     *   differs by more than the threshold from a neighbor, or whose ray hit
+     *   another object or stopped for another reason, are rendered again with
+     *   gridSize x gridSize stratified rays. The pixels with the strongest edges
+     *   are refined first until the budget is used up. Only the camera filter
+     *   'FilterRGB' is refined.
+     * @param gridSize   rays per edge of a refined pixel; less than 2 disables the refinement
+     * @param threshold  maximum difference of a color channel between neighbors
+     * @param budget     additional rays per pixel of the region on average
+     */
+    void  setAdaptiveSampling ( int gridSize, double threshold = 0.05, double budget = 1.0 );
+
     /**
      * For each individual pixel (i,j), the projector is instructed to determine
      * the color and additional data like frequency shift etc.
      * @param i  Horizontal pixel id.
      * @param j  Vertical pixel id.
+     * @param key  if not NULL, the hit object and break condition of the ray are stored.
      * @return  Color of the pixel.
      */
-    void calcPixelColor ( int i, int j, GvsColor &col, gvsData &data ) const;
+    void calcPixelColor ( int i, int j, GvsColor &col, gvsData &data, gvsSampleKey* key = NULL ) const;
+    void calcPixelColor ( GvsDevice* device, int i, int j, GvsColor &col, gvsData &data, gvsSampleKey* key = NULL ) const;
 
     /**
      * Read image pixels from the region defined by x_i,y_i.
@@ -136,6 +190,7 @@ public:
 
     /**
      * Write picture to file.
+     *   For high dynamic range formats (pfm, exr), the unclamped radiance is written.
      * @param filename
      */
     void  writePicture( char *filename ) const;
@@ -146,6 +201,85 @@ public:
      */
     void  writeIntersecData(char* filename) const;
 
+    /**
+     * Write report of the last rendering: wall time, rays per second, and
+     *   the rendering time of every tile. CSV if the filename ends with
+     *   '.csv', JSON otherwise.
+     * @param filename  report file
+     * @param frame     name of the frame written into the report
+     */
+    bool  writeReport ( const std::string &filename, const std::string &frame ) const;
+
+    /**
+     * Print the heap allocations counted while rendering.
+     *   Only available if GeoViS is configured with GVS_COUNT_ALLOCATIONS,
+     *   see GvsAllocCounter. Otherwise, nothing is printed.
+     */
+    void  printAllocations ( FILE* fptr = stderr ) const;
+
+protected:
+    /**
+     * Render all tiles the worker gets from the scheduler.
+     * @param device     device of the worker
+     * @param scheduler  tile scheduler
+     * @param worker     id of the worker
+     */
+    void  renderTiles ( GvsDevice* device, GvsTileScheduler* scheduler, int worker );
+
+    //! Open the '.part' file and read the tiles finished by an interrupted run.
+    void  resumeJournal  ( std::vector<GvsTile_t> &finished );
+    //! Store the colors of the tile in the '.part' file and add the tile to the journal.
+    void  journalTile    ( const GvsTile_t &tile, double seconds );
+    //! Store the colors of the refined pixels (image index y*width+x) and mark the frame as refined.
+    void  journalRefinement ( const std::vector<int> &pixels );
+    //! Pixel (x,y) was read from the '.part' file by resumeJournal.
+    bool  isResumed      ( int x, int y ) const;
+
+    //! Store unclamped color in the HDR picture and clamped color in the picture.
+    void  storeColor  ( int x, int y, const GvsColor& col );
+
+    //! The mask excludes pixel (i,j) from rendering.
+    bool  isMasked    ( int i, int j ) const;
+
+    /**
+     * Integrate the rays of the next pixels of row y as one packet, see GvsProjector::tracePacket.
+     *   Called for every pixel of the row; a packet is only traced every packet size pixels.
+     * @param x      current pixel
+     * @param xStart first pixel of the row
+     * @param xEnd   last pixel of the row
+     */
+    void  tracePacket ( GvsDevice* device, int x, int y, int xStart, int xEnd ) const;
+
+    //! Allocate the keys of the first rays if adaptive sampling is used for this rendering.
+    void           prepareSampleKeys ( );
+    //! Key of pixel (x,y) or NULL without adaptive sampling.
+    gvsSampleKey*  sampleKey         ( int x, int y );
+
+    /**
+     * Find the edges in the region and render them with subpixel rays.
+     * @param devices  one device per worker thread
+     */
+    void  refineAdaptive ( std::vector<GvsDevice*> &devices );
+    //! Refine the pixels (image index y*width+x) the worker takes from 'next'.
+    void  refinePixels   ( GvsDevice* device, const std::vector<int>* pixels, std::atomic<size_t>* next );
+
+    //! The camera asks for progressive rendering, see GvsCamera::setProgressive.
+    bool  useProgressive    ( ) const;
+    //! Render the rectangle progressively and store its colors.
+    void  renderProgressive ( GvsDevice* device, int x1, int y1, int x2, int y2 );
+    void  printProgressive  ( ) const;
+
+    /**
+     * Build the background table if the camera asks for it, see GvsCamera::setBackgroundTable.
+     *   The nodes are traced by the devices; afterwards, the table is set for
+     *   them and for the device of the sample manager.
+     * @param devices  one device per worker thread
+     */
+    void  prepareBackgroundTable ( std::vector<GvsDevice*> &devices );
+
+    void  resetAllocations ();
+    void  countAllocations ( unsigned long numAllocs );
+
 protected:
     int  resX;
     int  resY;
@@ -154,6 +288,7 @@ protected:
     m4d::ivec2   samplePixCoord;    //!< pixel which has to be calculated
 
     GvsChannelImg2D*  samplePicture;
+    GvsHdrImg2D*      sampleHdrPicture;
     GvsIntersecOutput*  sampleIntersecPicture;
     GvsDevice*        sampleDevice;
     double            aspectRatio;
@@ -163,6 +298,28 @@ protected:
     int               maskResX;
     int               maskResY;
     bool              haveMask;
+
+    GvsProgress       mProgress;
+
+    int                mAdaptiveGrid;       //!< rays per edge of a refined pixel
+    double             mAdaptiveThreshold;
+    double             mAdaptiveBudget;     //!< additional rays per pixel
+    std::vector<gvsSampleKey>  mSampleKeys; //!< keys of the first rays, empty without refinement
+    std::atomic<int>   mNumInterpolated;    //!< pixels interpolated by progressive rendering
+    GvsBackgroundTable*  mBgTable;          //!< table of the background of this frame, or NULL
+
+    GvsRenderJournal*  mJournal;
+    std::string        mJournalFrame;
+    std::string        mJournalSignature;
+    FILE*              mJournalFile;    //!< colors of finished tiles
+    bool               mJournalRefined; //!< the colors read from the journal are refined
+    std::vector<char>  mResumedPixels;  //!< pixels read from the journal, empty if none
+    std::mutex         mJournalMutex;
+
+    // heap allocations while rendering, see GvsAllocCounter
+    std::atomic<unsigned long>  mNumAllocations;
+    std::atomic<int>            mNumAllocPixels;   //!< pixels which allocated memory
+    std::atomic<int>            mNumPixels;
 };
 
 #endif
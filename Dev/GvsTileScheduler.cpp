@@ -0,0 +1,116 @@
+/**
+ * @file    GvsTileScheduler.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cassert>
+
+#include "Dev/GvsTileScheduler.h"
+
+GvsTileScheduler::GvsTileScheduler(int numWorkers)
+    : mNumTiles(0)
+{
+    assert(numWorkers > 0);
+    for (int w = 0; w < numWorkers; w++) {
+        mQueues.push_back(new WorkerQueue);
+    }
+}
+
+GvsTileScheduler::~GvsTileScheduler()
+{
+    for (unsigned int w = 0; w < mQueues.size(); w++) {
+        delete mQueues[w];
+    }
+    mQueues.clear();
+}
+
+static bool isFinished(const GvsTile& tile, const std::vector<GvsTile>& finished)
+{
+    for (unsigned int i = 0; i < finished.size(); i++) {
+        const GvsTile& f = finished[i];
+        if (tile.x1 >= f.x1 && tile.x2 <= f.x2 && tile.y1 >= f.y1 && tile.y2 <= f.y2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GvsTileScheduler::setRegion(const m4d::ivec2& corner1, const m4d::ivec2& corner2, int tileSize,
+    const std::vector<GvsTile>& finished)
+{
+    clear();
+    if (tileSize < 1) {
+        tileSize = 1;
+    }
+
+    std::vector<GvsTile> tiles;
+    for (int y = corner1.x(1); y <= corner2.x(1); y += tileSize) {
+        for (int x = corner1.x(0); x <= corner2.x(0); x += tileSize) {
+            GvsTile tile;
+            tile.x1 = x;
+            tile.y1 = y;
+            tile.x2 = GVS_MIN(x + tileSize - 1, corner2.x(0));
+            tile.y2 = GVS_MIN(y + tileSize - 1, corner2.x(1));
+            if (!isFinished(tile, finished)) {
+                tiles.push_back(tile);
+            }
+        }
+    }
+    mNumTiles = static_cast<int>(tiles.size());
+
+    // Every worker starts with a contiguous block of tiles. Thus, neighboring
+    // tiles are rendered by the same worker as long as nobody has to steal.
+    int numWorkers = static_cast<int>(mQueues.size());
+    for (int n = 0; n < mNumTiles; n++) {
+        int w = static_cast<int>((static_cast<long>(n) * numWorkers) / mNumTiles);
+        mQueues[w]->tiles.push_back(tiles[n]);
+    }
+}
+
+bool GvsTileScheduler::getNextTile(int worker, GvsTile& tile)
+{
+    assert(worker >= 0 && worker < static_cast<int>(mQueues.size()));
+    {
+        std::lock_guard<std::mutex> lock(mQueues[worker]->mutex);
+        if (!mQueues[worker]->tiles.empty()) {
+            tile = mQueues[worker]->tiles.front();
+            mQueues[worker]->tiles.pop_front();
+            return true;
+        }
+    }
+    return stealTile(worker, tile);
+}
+
+int GvsTileScheduler::numWorkers() const
+{
+    return static_cast<int>(mQueues.size());
+}
+
+int GvsTileScheduler::numTiles() const
+{
+    return mNumTiles;
+}
+
+bool GvsTileScheduler::stealTile(int worker, GvsTile& tile)
+{
+    int numWorkers = static_cast<int>(mQueues.size());
+    for (int n = 1; n < numWorkers; n++) {
+        WorkerQueue* victim = mQueues[(worker + n) % numWorkers];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->tiles.empty()) {
+            tile = victim->tiles.back();
+            victim->tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void GvsTileScheduler::clear()
+{
+    for (unsigned int w = 0; w < mQueues.size(); w++) {
+        std::lock_guard<std::mutex> lock(mQueues[w]->mutex);
+        mQueues[w]->tiles.clear();
+    }
+    mNumTiles = 0;
+}
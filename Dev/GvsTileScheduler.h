@@ -0,0 +1,77 @@
+/**
+ * @file    GvsTileScheduler.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_TILE_SCHEDULER_H
+#define GVS_TILE_SCHEDULER_H
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+#include "m4dGlobalDefs.h"
+
+/**
+ * Rectangular image tile given by its lower-left (x1,y1) and upper-right (x2,y2)
+ * pixel. Both corners belong to the tile.
+ */
+typedef struct GvsTile_t {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} GvsTile;
+
+/**
+ * The tile scheduler splits a sample region into tiles and distributes them to
+ * a fixed number of workers. Each worker owns a double-ended queue of tiles. A
+ * worker takes tiles from the front of its own queue; if the queue runs empty,
+ * it steals tiles from the back of the other workers' queues.
+ */
+class API_EXPORT GvsTileScheduler
+{
+public:
+    explicit GvsTileScheduler(int numWorkers);
+    virtual ~GvsTileScheduler();
+
+    /**
+     * Split the region into tiles of at most tileSize x tileSize pixels.
+     *   Neighboring tiles are assigned in contiguous blocks to the workers.
+     * @param corner1   lower-left corner of region
+     * @param corner2   upper-right corner of region
+     * @param tileSize  edge length of a tile in pixels
+     * @param finished  tiles within one of these regions are skipped
+     */
+    void setRegion(const m4d::ivec2& corner1, const m4d::ivec2& corner2, int tileSize,
+        const std::vector<GvsTile>& finished = std::vector<GvsTile>());
+
+    /**
+     * Get next tile for worker.
+     * @param worker  id of the worker [0,numWorkers-1]
+     * @param tile    reference to tile
+     * @return  false if there is no tile left
+     */
+    bool getNextTile(int worker, GvsTile& tile);
+
+    int numWorkers() const;
+    int numTiles() const;
+
+protected:
+    bool stealTile(int worker, GvsTile& tile);
+
+    void clear();
+
+protected:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<GvsTile> tiles;
+    };
+
+    std::vector<WorkerQueue*> mQueues;
+    int mNumTiles;
+};
+
+#endif
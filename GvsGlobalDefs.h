@@ -102,12 +102,13 @@ enum GvsCamFilter {
     gvsCamFilterRGBpdz, // rgb image + position-,direction-4-vectors + freqshift
     gvsCamFilterRGBjac, // rgb image + position-,direction-4-vectors + freqshift + Jacobi
     gvsCamFilterRGBpt, // rgb image + position-4-vector + texture
-    gvsCamFilterRGBIntersec // rgb image + save all intersections
+    gvsCamFilterRGBIntersec, // rgb image + save all intersections
+    gvsCamFilterRGBcost // rgb image + wall time, integrator steps, and segment tests per pixel
 };
 
-const int GvsNumCamFilters = 5;
+const int GvsNumCamFilters = 6;
 const std::string GvsCamFilterNames[GvsNumCamFilters]
-    = { "FilterRGB", "FilterRGBpdz", "FilterRGBjac", "FilterRGBpt", "FilterRGBIntersec" };
+    = { "FilterRGB", "FilterRGBpdz", "FilterRGBjac", "FilterRGBpt", "FilterRGBIntersec", "FilterRGBcost" };
 
 enum GvsCamEye { gvsCamEyeStandard = 0, gvsCamEyeLeft, gvsCamEyeRight };
 
@@ -118,6 +119,7 @@ const std::string GvsCamEyeFileExt[GvsNumCamEyes] = { ".", ".left.", ".right." }
 #define NUM_PDZ_CHANNELS 10
 #define NUM_JAC_CHANNELS 15
 #define NUM_PT_CHANNELS 7
+#define NUM_COST_CHANNELS 3
 
 typedef struct gvsData_T {
     double objID; // object ID of intersection object
@@ -126,6 +128,7 @@ typedef struct gvsData_T {
     double freqshift; // gravitational frequency shift
     double jacobi[5]; // jacobi parameters
     double uv[2]; // uv texture coordinates
+    double cost[3]; // wall time in seconds, integrator steps, segment tests
     gvsData_T()
     {
         objID = 0.0;
@@ -134,7 +137,22 @@ typedef struct gvsData_T {
         freqshift = 0.0;
         jacobi[0] = jacobi[1] = jacobi[2] = jacobi[3] = jacobi[4] = 0.0;
         uv[0] = uv[1] = 0.0;
+        cost[0] = cost[1] = cost[2] = 0.0;
     }
 } gvsData;
 
+class GvsSurface;
+
+// Hit object and break condition of the ray through a pixel. Adaptive sampling
+// refines pixels whose key differs from the key of a neighbor.
+typedef struct gvsSampleKey_T {
+    const GvsSurface* object; // surface hit by the ray, nullptr for the background
+    m4d::enum_break_condition breakCond; // why the integration of the ray stopped
+    gvsSampleKey_T()
+    {
+        object = nullptr;
+        breakCond = m4d::enum_break_none;
+    }
+} gvsSampleKey;
+
 #endif
@@ -18,6 +18,7 @@
 // ---------------------------------------------------------------------
 
 #include "GvsChannelImg2D.h"
+#include "GvsIntersecOutput.h"
 #include <cassert>
 #include <iostream>
 
@@ -800,112 +801,122 @@ void GvsChannelImg2D :: setWrapConstValue( uchar *col ) const {
         col[i] = ucharval;
 }
 
+//! Add channels 'name0', 'name1', ... to the writer.
+static void addIntersecChannels( GvsTiledDataWriter &writer, const char* name, int num, GvsTiledDataType type ) {
+    for (int i=0; i<num; i++) {
+        writer.addChannel(std::string(name) + std::to_string(i), type);
+    }
+}
+
 /**
- * The first 12 bytes give the image resolution (2 int)
- * and the number of entries per pixel (1 int).
- *
- * The intersection data is composed of
- *  position      (4 doubles)
- *  light vector  (4 doubles)
- *  object ID     (1 double)
- *  freqshift     (1 double)
- *
- *  jacobi parameters (5 doubles)
+ * The intersection data is stored in the tiled container (GvsTiledData.h),
+ * image rows from bottom to top (dat: from top to bottom). The channels are
+ *  pdz/jac: position (4, float64), light vector (4), object ID, freqshift,
+ *           and for jac the jacobi parameters (5)
+ *  pt     : position (4, float64), uv (2), object ID
+ *  cost   : wall time in seconds, integrator steps, segment tests
+ *  dat    : all entries of gvsData
  *
  * @param filename   Filename for data.
  * @param filter     Camera filter.
  */
 void GvsChannelImg2D::writeIntersecData( const char* filename , GvsCamFilter filter ) {
+std::cerr << "GvsChannelImg2D::WriteIntersecData() ... " << filename << std::endl;
+    GvsTiledDataWriter writer;
+    if (imgIntersecData==NULL || !openIntersecData(writer,filename,imgWidth,imgHeight,filter)) {
+        return;
+    }
+
+    writer.writeImage([&](int x, int y, double* values) {
+        int row = intersecFileRow(y,imgHeight,filter);
+        getIntersecValues(imgIntersecData[row*imgWidth+x], filter, values);
+    });
+    writer.close();
+}
+
+
+bool GvsChannelImg2D::openIntersecData( GvsTiledDataWriter &writer, const char *filename, int width, int height, GvsCamFilter filter ) {
     std::string baseFilename = std::string(filename);
     size_t pos = baseFilename.find_last_of(".");
     baseFilename = baseFilename.substr(0,pos);
-std::cerr << "GvsChannelImg2D::WriteIntersecData() ... " << filename << std::endl;
-    FILE* fptr = NULL;
 
     // position and direction;
     int nc = 0;
     switch(filter) {
-        case gvsCamFilterRGBpdz: {
-            nc = NUM_PDZ_CHANNELS;
-#ifdef _WIN32
-            fopen_s(&fptr, (baseFilename + ".pdz").c_str(), "wb");
-#else
-            fptr = fopen((baseFilename+".pdz").c_str(),"wb");
-#endif
-            break;
-        }
+        case gvsCamFilterRGBpdz:
         case gvsCamFilterRGBjac: {
-            nc = NUM_JAC_CHANNELS;
-#ifdef _WIN32
-            fopen_s(&fptr,(baseFilename + ".jac").c_str(), "wb");
-#else
-            fptr = fopen((baseFilename+".jac").c_str(),"wb");
-#endif
+            nc = (filter == gvsCamFilterRGBpdz ? NUM_PDZ_CHANNELS : NUM_JAC_CHANNELS);
+            baseFilename += (filter == gvsCamFilterRGBpdz ? ".pdz" : ".jac");
+            addIntersecChannels(writer, "pos", 4, gvsTiledFloat64);
+            addIntersecChannels(writer, "dir", 4, gvsTiledFloat32);
+            writer.addChannel("objID");
+            writer.addChannel("freqshift");
+            if (filter == gvsCamFilterRGBjac) {
+                addIntersecChannels(writer, "jacobi", 5, gvsTiledFloat32);
+            }
             break;
         }
         case gvsCamFilterRGBpt: {
             nc = NUM_PT_CHANNELS;
-#ifdef _WIN32
-            fopen_s(&fptr, (baseFilename + ".pt").c_str(), "wb");
-#else
-            fptr = fopen((baseFilename+".pt").c_str(),"wb");
-#endif
+            baseFilename += ".pt";
+            addIntersecChannels(writer, "pos", 4, gvsTiledFloat64);
+            addIntersecChannels(writer, "uv", 2, gvsTiledFloat32);
+            writer.addChannel("objID");
+            break;
+        }
+        case gvsCamFilterRGBcost: {
+            nc = NUM_COST_CHANNELS;
+            baseFilename += ".cost";
+            writer.addChannel("time");
+            writer.addChannel("steps");
+            writer.addChannel("segments");
             break;
         }
 
         case gvsCamFilterRGBIntersec: {
-#ifdef _WIN32
-            fopen_s(&fptr,(baseFilename + ".dat").c_str(), "wb");
-#else
-            fptr = fopen((baseFilename+".dat").c_str(),"wb");
-#endif
+            baseFilename += ".dat";
+            GvsIntersecOutput::addChannels(writer);
             nc = 0;
             break;
         }
         default:
         case gvsCamFilterRGB: {
-            break;
+            return false;
         }
     }
 
-    fprintf(stderr,"Write intersec data: %s (%d x %d, %d, %s)\n",baseFilename.c_str(),imgWidth,imgHeight,nc,GvsCamFilterNames[(int)filter].c_str());
-
-    if (fptr!=NULL && imgIntersecData!=NULL) {
-        fwrite((void*)&imgWidth,sizeof(int),1,fptr);
-        fwrite((void*)&imgHeight,sizeof(int),1,fptr);
-        if (nc > 0) {
-            fwrite((void*)&nc,sizeof(int),1,fptr);
-        }
+    fprintf(stderr,"Write intersec data: %s (%d x %d, %d, %s)\n",baseFilename.c_str(),width,height,nc,GvsCamFilterNames[(int)filter].c_str());
+    return writer.open(baseFilename.c_str(),width,height);
+}
 
 
-        if (filter == gvsCamFilterRGBIntersec) {
-            fwrite(imgIntersecData, sizeof(gvsData), imgWidth * imgHeight, fptr);
-        }
-        else {
+void GvsChannelImg2D::getIntersecValues( const gvsData &dat, GvsCamFilter filter, double *values ) {
+    if (filter == gvsCamFilterRGBIntersec) {
+        GvsIntersecOutput::getValues(dat, values);
+        return;
+    }
+    if (filter == gvsCamFilterRGBcost) {
+        memcpy(values, dat.cost, NUM_COST_CHANNELS*sizeof(double));
+        return;
+    }
+    memcpy(values, dat.pos, 4*sizeof(double));
+    if (filter == gvsCamFilterRGBpt) {
+        values[4] = dat.uv[0];
+        values[5] = dat.uv[1];
+        values[6] = dat.objID;
+        return;
+    }
+    memcpy(values+4, dat.dir, 4*sizeof(double));
+    values[8] = dat.objID;
+    values[9] = dat.freqshift;
+    if (filter == gvsCamFilterRGBjac) {
+        memcpy(values+10, dat.jacobi, 5*sizeof(double));
+    }
+}
 
-            long pos;
-            for(long y=imgHeight-1; y>=0; y--) {
-                for(long x=0; x<imgWidth; x++) {
-                    pos = y*imgWidth+x;
-                    fwrite((void*)imgIntersecData[pos].pos,sizeof(double),4,fptr);
 
-                    if (filter==gvsCamFilterRGBpdz || filter==gvsCamFilterRGBjac) {
-                        fwrite((void*)imgIntersecData[pos].dir,sizeof(double),4,fptr);
-                        fwrite((void*)&imgIntersecData[pos].objID,sizeof(double),1,fptr);
-                        fwrite((void*)&imgIntersecData[pos].freqshift,sizeof(double),1,fptr);
-                        if (filter==gvsCamFilterRGBjac) {
-                            fwrite((void*)imgIntersecData[pos].jacobi,sizeof(double),5,fptr);
-                        }
-                    }
-                    else if (filter==gvsCamFilterRGBpt) {
-                        fwrite((void*)imgIntersecData[pos].uv, sizeof(double), 2, fptr);
-                        fwrite((void*)&imgIntersecData[pos].objID,sizeof(double),1,fptr);
-                    }
-                }
-            }
-        }
-        fclose(fptr);
-    }
+int GvsChannelImg2D::intersecFileRow( int y, int height, GvsCamFilter filter ) {
+    return (filter == gvsCamFilterRGBIntersec ? y : height-1-y);
 }
 
 
@@ -21,6 +21,7 @@
 
 #include "GvsGlobalDefs.h"
 #include "Img/GvsColor.h"
+#include "Img/GvsTiledData.h"
 
 
 enum GvsImgOrder {
@@ -123,6 +124,13 @@ public:
     //! Write intersection data to file.
     void   writeIntersecData( const char *filename, GvsCamFilter filter );
 
+    //! Open the intersection data file of 'filter'; the extension of 'filename' is replaced.
+    static bool  openIntersecData   ( GvsTiledDataWriter &writer, const char *filename, int width, int height, GvsCamFilter filter );
+    //! Channel values of one pixel in the order of openIntersecData().
+    static void  getIntersecValues  ( const gvsData &dat, GvsCamFilter filter, double *values );
+    //! Row of the file in which image row y is stored.
+    static int   intersecFileRow    ( int y, int height, GvsCamFilter filter );
+
     virtual void Print ( FILE* fptr = stderr );
 
 protected:
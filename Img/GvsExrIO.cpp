@@ -0,0 +1,399 @@
+/**
+ * @file    GvsExrIO.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "Img/GvsExrIO.h"
+
+#define GVS_EXR_MAGIC      20000630
+#define GVS_EXR_HALF       1
+#define GVS_EXR_FLOAT      2
+
+// The file format is little endian; only little endian hosts are supported.
+
+namespace {
+
+void putInt( std::vector<uchar>& buf, int32_t val ) {
+    const uchar* p = reinterpret_cast<const uchar*>(&val);
+    buf.insert(buf.end(), p, p+4);
+}
+
+void putFloat( std::vector<uchar>& buf, float val ) {
+    const uchar* p = reinterpret_cast<const uchar*>(&val);
+    buf.insert(buf.end(), p, p+4);
+}
+
+void putString( std::vector<uchar>& buf, const char* str ) {
+    buf.insert(buf.end(), str, str + strlen(str) + 1);
+}
+
+void putAttrib( std::vector<uchar>& buf, const char* name, const char* type, int size ) {
+    putString(buf,name);
+    putString(buf,type);
+    putInt(buf,size);
+}
+
+int linesPerBlock( int compression ) {
+    return (compression == gvsExrZip) ? 16 : 1;
+}
+
+float halfToFloat( uint16_t h ) {
+    uint32_t sign = (h >> 15) & 0x1;
+    int32_t  expo = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    float val;
+    if (expo == 0) {
+        val = ldexpf(static_cast<float>(mant), -24);
+    } else if (expo == 31) {
+        val = (mant == 0) ? INFINITY : NAN;
+    } else {
+        val = ldexpf(static_cast<float>(mant | 0x400), expo - 25);
+    }
+    return sign ? -val : val;
+}
+
+// Zip predictor and byte interleaving of the OpenEXR zip compression.
+void zipEncode( const std::vector<uchar>& in, std::vector<uchar>& out ) {
+    size_t n = in.size();
+    out.resize(n);
+    size_t half = (n + 1) / 2;
+    for (size_t i = 0; i < n; i++) {
+        out[(i % 2 == 0) ? i/2 : half + i/2] = in[i];
+    }
+    int prev = out.empty() ? 0 : out[0];
+    for (size_t i = 1; i < n; i++) {
+        int d = int(out[i]) - prev + (128 + 256);
+        prev = out[i];
+        out[i] = static_cast<uchar>(d);
+    }
+}
+
+void zipDecode( const std::vector<uchar>& in, std::vector<uchar>& out ) {
+    size_t n = in.size();
+    std::vector<uchar> tmp(in);
+    for (size_t i = 1; i < n; i++) {
+        tmp[i] = static_cast<uchar>(int(tmp[i-1]) + int(tmp[i]) - 128);
+    }
+    out.resize(n);
+    size_t half = (n + 1) / 2;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = tmp[(i % 2 == 0) ? i/2 : half + i/2];
+    }
+}
+
+} // namespace
+
+
+GvsExrIO :: GvsExrIO() {
+#ifdef HAVE_ZLIB
+    mCompression = gvsExrZip;
+#else
+    mCompression = gvsExrNone;
+#endif
+}
+
+GvsExrIO :: ~GvsExrIO() {
+}
+
+
+void GvsExrIO :: setCompression( GvsExrCompression compression ) {
+#ifndef HAVE_ZLIB
+    if (compression != gvsExrNone) {
+        fprintf(stderr,"GvsExrIO: zip compression needs zlib, write uncompressed.\n");
+        compression = gvsExrNone;
+    }
+#endif
+    mCompression = compression;
+}
+
+
+bool GvsExrIO :: readChannelImg( GvsChannelImg2D& chanImg, const char *filename ) {
+    GvsHdrImg2D hdrImg;
+    if (!readHdrImg(hdrImg,filename)) {
+        return false;
+    }
+    hdrImg.toneMap(chanImg);
+    return true;
+}
+
+
+bool GvsExrIO :: writeChannelImg( GvsChannelImg2D& chanImg, const char *filename ) {
+    GvsHdrImg2D hdrImg;
+    hdrImg.copyFrom(chanImg);
+    return writeHdrImg(hdrImg,filename);
+}
+
+
+bool GvsExrIO :: writeHdrImg( GvsHdrImg2D& hdrImg, const char *filename ) {
+    int width  = hdrImg.width();
+    int height = hdrImg.height();
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr,"Cannot write empty image %s.\n",filename);
+        return false;
+    }
+
+    // header
+    std::vector<uchar> header;
+    putInt(header,GVS_EXR_MAGIC);
+    putInt(header,2);
+
+    const char* channels[3] = {"B","G","R"};   // channels are sorted by name
+    putAttrib(header,"channels","chlist",3*(2+16)+1);
+    for (int c = 0; c < 3; c++) {
+        putString(header,channels[c]);
+        putInt(header,GVS_EXR_FLOAT);
+        putInt(header,0);   // pLinear and reserved
+        putInt(header,1);   // xSampling
+        putInt(header,1);   // ySampling
+    }
+    header.push_back(0);
+
+    putAttrib(header,"compression","compression",1);
+    header.push_back(static_cast<uchar>(mCompression));
+
+    const char* windows[2] = {"dataWindow","displayWindow"};
+    for (int w = 0; w < 2; w++) {
+        putAttrib(header,windows[w],"box2i",16);
+        putInt(header,0);
+        putInt(header,0);
+        putInt(header,width-1);
+        putInt(header,height-1);
+    }
+
+    putAttrib(header,"lineOrder","lineOrder",1);
+    header.push_back(0);    // increasing y
+
+    putAttrib(header,"pixelAspectRatio","float",4);
+    putFloat(header,1.0f);
+
+    putAttrib(header,"screenWindowCenter","v2f",8);
+    putFloat(header,0.0f);
+    putFloat(header,0.0f);
+
+    putAttrib(header,"screenWindowWidth","float",4);
+    putFloat(header,1.0f);
+    header.push_back(0);
+
+    // scan line blocks
+    int numLines  = linesPerBlock(mCompression);
+    int numBlocks = (height + numLines - 1) / numLines;
+
+    std::vector<uint64_t> offsets(numBlocks);
+    std::vector<uchar> blocks;
+    std::vector<uchar> raw, encoded;
+    uint64_t offset = header.size() + numBlocks*sizeof(uint64_t);
+
+    const float* img = hdrImg.getImagePtr();
+    for (int b = 0; b < numBlocks; b++) {
+        int y1 = b*numLines;
+        int y2 = GVS_MIN(y1 + numLines, height);
+
+        raw.clear();
+        for (int y = y1; y < y2; y++) {
+            for (int c = 0; c < 3; c++) {
+                for (int x = 0; x < width; x++) {
+                    putFloat(raw, img[3*(static_cast<size_t>(y)*width + x) + (2-c)]);
+                }
+            }
+        }
+
+        const std::vector<uchar>* data = &raw;
+#ifdef HAVE_ZLIB
+        std::vector<uchar> compressed;
+        if (mCompression != gvsExrNone) {
+            zipEncode(raw,encoded);
+            uLongf size = compressBound(encoded.size());
+            compressed.resize(size);
+            if (compress(&compressed[0],&size,&encoded[0],encoded.size()) == Z_OK && size < raw.size()) {
+                compressed.resize(size);
+                data = &compressed;
+            }
+        }
+#endif
+        size_t start = blocks.size();
+        putInt(blocks,y1);
+        putInt(blocks,static_cast<int32_t>(data->size()));
+        blocks.insert(blocks.end(),data->begin(),data->end());
+
+        offsets[b] = offset;
+        offset += blocks.size() - start;
+    }
+
+    FILE* fptr = fopen(filename,"wb");
+    if (fptr==NULL) {
+        fprintf(stderr,"Cannot write image %s.\n",filename);
+        return false;
+    }
+    bool ok = (fwrite(&header[0],1,header.size(),fptr) == header.size())
+           && (fwrite(&offsets[0],sizeof(uint64_t),numBlocks,fptr) == static_cast<size_t>(numBlocks))
+           && (fwrite(&blocks[0],1,blocks.size(),fptr) == blocks.size());
+    if (!ok) {
+        fprintf(stderr,"Possible error writing data!\n");
+    }
+    fclose(fptr);
+    return ok;
+}
+
+
+bool GvsExrIO :: readHdrImg( GvsHdrImg2D& hdrImg, const char *filename ) {
+    FILE* fptr = fopen(filename,"rb");
+    if (fptr==NULL) {
+        fprintf(stderr,"Cannot read image %s.\n",filename);
+        return false;
+    }
+    std::vector<uchar> file;
+    uchar buf[65536];
+    size_t num;
+    while ((num = fread(buf,1,sizeof(buf),fptr)) > 0) {
+        file.insert(file.end(),buf,buf+num);
+    }
+    fclose(fptr);
+
+    size_t pos = 0;
+    auto getInt = [&](int32_t& val) -> bool {
+        if (pos + 4 > file.size()) return false;
+        memcpy(&val,&file[pos],4);
+        pos += 4;
+        return true;
+    };
+    auto getString = [&](std::string& str) -> bool {
+        size_t end = pos;
+        while (end < file.size() && file[end] != 0) end++;
+        if (end >= file.size()) return false;
+        str.assign(reinterpret_cast<const char*>(&file[pos]),end-pos);
+        pos = end + 1;
+        return true;
+    };
+
+    int32_t magic, version;
+    if (!getInt(magic) || !getInt(version) || magic != GVS_EXR_MAGIC || (version & 0xff) != 2 || (version & 0x200)) {
+        fprintf(stderr,"Only scan line OpenEXR images are supported: %s\n",filename);
+        return false;
+    }
+
+    // channel name, pixel type, offset within a scan line of one channel
+    std::vector<std::string> chanNames;
+    std::vector<int>         chanTypes;
+    int compression = -1;
+    int32_t box[4] = {0,0,-1,-1};
+
+    std::string name, type;
+    while (getString(name) && !name.empty()) {
+        int32_t size;
+        if (!getString(type) || !getInt(size) || pos + size > file.size()) {
+            fprintf(stderr,"Cannot read header of %s.\n",filename);
+            return false;
+        }
+        size_t next = pos + size;
+        if (name == "channels") {
+            std::string chan;
+            while (getString(chan) && !chan.empty()) {
+                int32_t ptype, dummy;
+                getInt(ptype); getInt(dummy); getInt(dummy); getInt(dummy);
+                chanNames.push_back(chan);
+                chanTypes.push_back(ptype);
+            }
+        } else if (name == "compression") {
+            compression = file[pos];
+        } else if (name == "dataWindow") {
+            for (int i = 0; i < 4; i++) getInt(box[i]);
+        }
+        pos = next;
+    }
+
+    int width  = box[2] - box[0] + 1;
+    int height = box[3] - box[1] + 1;
+    bool supported = (compression == gvsExrNone);
+#ifdef HAVE_ZLIB
+    supported = supported || (compression == gvsExrZips) || (compression == gvsExrZip);
+#endif
+    if (!supported || width <= 0 || height <= 0 || chanNames.empty()) {
+        fprintf(stderr,"Unsupported OpenEXR image %s.\n",filename);
+        return false;
+    }
+
+    int lineSize = 0;
+    std::vector<int> chanOffset;
+    int rgb[3] = {-1,-1,-1};
+    for (size_t c = 0; c < chanNames.size(); c++) {
+        if (chanTypes[c] != GVS_EXR_HALF && chanTypes[c] != GVS_EXR_FLOAT) {
+            fprintf(stderr,"Only half and float channels are supported: %s\n",filename);
+            return false;
+        }
+        chanOffset.push_back(lineSize);
+        lineSize += width * ((chanTypes[c] == GVS_EXR_HALF) ? 2 : 4);
+        if (chanNames[c] == "R" || chanNames[c] == "Y") rgb[0] = static_cast<int>(c);
+        if (chanNames[c] == "G" || chanNames[c] == "Y") rgb[1] = static_cast<int>(c);
+        if (chanNames[c] == "B" || chanNames[c] == "Y") rgb[2] = static_cast<int>(c);
+    }
+
+    int numLines  = linesPerBlock(compression);
+    int numBlocks = (height + numLines - 1) / numLines;
+    size_t offsetPos = pos;
+
+    hdrImg.resize(width,height);
+    std::vector<uchar> raw, packed;
+    for (int b = 0; b < numBlocks; b++) {
+        uint64_t offset;
+        if (offsetPos + 8*(b+1) > file.size()) {
+            return false;
+        }
+        memcpy(&offset,&file[offsetPos + 8*b],8);
+        pos = offset;
+
+        int32_t y, size;
+        if (!getInt(y) || !getInt(size) || pos + size > file.size()) {
+            fprintf(stderr,"Possible error reading data!\n");
+            return false;
+        }
+        y -= box[1];
+        int lines = GVS_MIN(numLines, height - y);
+        size_t rawSize = static_cast<size_t>(lines) * lineSize;
+
+        if (static_cast<size_t>(size) == rawSize) {
+            raw.assign(file.begin() + pos, file.begin() + pos + size);
+        } else {
+#ifdef HAVE_ZLIB
+            packed.resize(rawSize);
+            uLongf len = rawSize;
+            if (uncompress(&packed[0],&len,&file[pos],size) != Z_OK || len != rawSize) {
+                fprintf(stderr,"Cannot decompress %s.\n",filename);
+                return false;
+            }
+            zipDecode(packed,raw);
+#else
+            return false;
+#endif
+        }
+
+        for (int l = 0; l < lines; l++) {
+            const uchar* line = &raw[static_cast<size_t>(l) * lineSize];
+            for (int x = 0; x < width; x++) {
+                float val[3] = {0.0f,0.0f,0.0f};
+                for (int k = 0; k < 3; k++) {
+                    int c = rgb[k];
+                    if (c < 0) continue;
+                    if (chanTypes[c] == GVS_EXR_HALF) {
+                        uint16_t h;
+                        memcpy(&h,line + chanOffset[c] + 2*x,2);
+                        val[k] = halfToFloat(h);
+                    } else {
+                        memcpy(&val[k],line + chanOffset[c] + 4*x,4);
+                    }
+                }
+                hdrImg.setColor(x,y+l,GvsColor(val[0],val[1],val[2]));
+            }
+        }
+    }
+    return true;
+}
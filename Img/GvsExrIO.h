@@ -0,0 +1,45 @@
+/**
+ * @file    GvsExrIO.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_EXR_IO_H
+#define GVS_EXR_IO_H
+
+#include "GvsPictureIO.h"
+#include "GvsChannelImg2D.h"
+#include "GvsHdrImg2D.h"
+
+enum GvsExrCompression {
+    gvsExrNone = 0,
+    gvsExrZips = 2,     //!< zlib, one scan line per block
+    gvsExrZip  = 3      //!< zlib, 16 scan lines per block
+};
+
+/**
+ * @brief OpenEXR image handle.
+ *
+ *   Writes scan line images with 32bit float R,G,B channels, either
+ *   uncompressed or zip compressed. Zip compression needs zlib (HAVE_ZLIB).
+ *   Reads scan line images with half or float R,G,B (or Y) channels that
+ *   are uncompressed or zip compressed.
+ */
+class GvsExrIO : public GvsPictureIO
+{
+public:
+    GvsExrIO();
+    ~GvsExrIO();
+
+    void setCompression ( GvsExrCompression compression );
+
+    virtual bool readChannelImg  ( GvsChannelImg2D& chanImg, const char *filename );
+    virtual bool writeChannelImg ( GvsChannelImg2D& chanImg, const char *filename );
+
+    virtual bool readHdrImg      ( GvsHdrImg2D& hdrImg, const char *filename );
+    virtual bool writeHdrImg     ( GvsHdrImg2D& hdrImg, const char *filename );
+
+protected:
+    GvsExrCompression  mCompression;
+};
+
+#endif
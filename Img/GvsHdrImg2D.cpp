@@ -0,0 +1,118 @@
+/**
+ * @file    GvsHdrImg2D.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Img/GvsHdrImg2D.h"
+#include "Img/GvsChannelImg2D.h"
+
+
+GvsHdrImg2D::GvsHdrImg2D()
+    : imgWidth(0),
+      imgHeight(0) {
+}
+
+GvsHdrImg2D::GvsHdrImg2D( int width, int height )
+    : imgWidth(0),
+      imgHeight(0) {
+    resize(width, height);
+}
+
+GvsHdrImg2D::~GvsHdrImg2D() {
+}
+
+
+void GvsHdrImg2D::resize( int width, int height ) {
+    assert(width >= 0 && height >= 0);
+    if (width == imgWidth && height == imgHeight) {
+        return;
+    }
+    imgWidth  = width;
+    imgHeight = height;
+    imgData.assign(3 * static_cast<size_t>(width) * height, 0.0f);
+}
+
+void GvsHdrImg2D::clear() {
+    std::fill(imgData.begin(), imgData.end(), 0.0f);
+}
+
+
+void GvsHdrImg2D::setColor( int i, int j, const GvsColor& col ) {
+    assert(i >= 0 && i < imgWidth && j >= 0 && j < imgHeight);
+    float* ptr = &imgData[3 * (static_cast<size_t>(j) * imgWidth + i)];
+    ptr[0] = static_cast<float>(col.red);
+    ptr[1] = static_cast<float>(col.green);
+    ptr[2] = static_cast<float>(col.blue);
+}
+
+GvsColor GvsHdrImg2D::sampleColor( int i, int j ) const {
+    assert(i >= 0 && i < imgWidth && j >= 0 && j < imgHeight);
+    const float* ptr = &imgData[3 * (static_cast<size_t>(j) * imgWidth + i)];
+    return GvsColor(ptr[0], ptr[1], ptr[2]);
+}
+
+
+float* GvsHdrImg2D::getImagePtr() {
+    return imgData.empty() ? NULL : &imgData[0];
+}
+
+const float* GvsHdrImg2D::getImagePtr() const {
+    return imgData.empty() ? NULL : &imgData[0];
+}
+
+int GvsHdrImg2D::width() const {
+    return imgWidth;
+}
+
+int GvsHdrImg2D::height() const {
+    return imgHeight;
+}
+
+
+void GvsHdrImg2D::toneMap( GvsChannelImg2D& ldrImg, double exposure, double gamma, GvsToneMapOp op ) const {
+    assert(gamma > 0.0);
+    ldrImg.setSize(imgWidth, imgHeight, 3);
+
+    double scale    = pow(2.0, exposure);
+    double invGamma = 1.0 / gamma;
+    uchar  col[3];
+
+    const float* ptr = getImagePtr();
+    for (int j = 0; j < imgHeight; j++) {
+        for (int i = 0; i < imgWidth; i++) {
+            for (int c = 0; c < 3; c++) {
+                double val = GVS_MAX(0.0, scale * (*ptr++));
+                if (op == gvsToneMapReinhard) {
+                    val = val / (1.0 + val);
+                }
+                val = GVS_MIN(val, 1.0);
+                if (gamma != 1.0) {
+                    val = pow(val, invGamma);
+                }
+                col[c] = static_cast<uchar>(val * 255.0 + 0.5);
+            }
+            ldrImg.setChannels(i, j, col);
+        }
+    }
+}
+
+
+void GvsHdrImg2D::copyFrom( const GvsChannelImg2D& ldrImg ) {
+    resize(ldrImg.width(), ldrImg.height());
+    for (int j = 0; j < imgHeight; j++) {
+        for (int i = 0; i < imgWidth; i++) {
+            setColor(i, j, ldrImg.sampleColor(static_cast<long>(i), static_cast<long>(j)));
+        }
+    }
+}
+
+
+void GvsHdrImg2D::Print( FILE* fptr ) const {
+    fprintf(fptr, "GvsHdrImg2D {\n");
+    fprintf(fptr, "\tsize: %d x %d\n", imgWidth, imgHeight);
+    fprintf(fptr, "}\n");
+}
@@ -0,0 +1,68 @@
+/**
+ * @file    GvsHdrImg2D.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_HDR_IMG_2D_H
+#define GVS_HDR_IMG_2D_H
+
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+#include "Img/GvsColor.h"
+
+class GvsChannelImg2D;
+
+enum GvsToneMapOp {
+    gvsToneMapClamp = 0,   //!< scale by exposure and clamp to [0,1]
+    gvsToneMapReinhard     //!< scale by exposure and map c -> c/(1+c)
+};
+
+/**
+ * @brief High dynamic range RGB image with 32bit float channels.
+ *
+ *   In contrast to GvsChannelImg2D, colors are stored without clamping,
+ *   so the radiance of a rendered image can be tone mapped afterwards.
+ *   The channels of a pixel are stored interleaved, rows from top to bottom.
+ */
+class API_EXPORT GvsHdrImg2D
+{
+public:
+    GvsHdrImg2D ();
+    GvsHdrImg2D ( int width, int height );
+    virtual ~GvsHdrImg2D();
+
+    void      resize      ( int width, int height );
+    void      clear       ( );
+
+    void      setColor    ( int i, int j, const GvsColor& col );
+    GvsColor  sampleColor ( int i, int j ) const;
+
+    float*       getImagePtr ( );
+    const float* getImagePtr ( ) const;
+
+    int       width       ( ) const;
+    int       height      ( ) const;
+
+    /**
+     * Map radiance to the low dynamic range image.
+     * @param ldrImg    output image, is resized to three channels
+     * @param exposure  exposure correction in f-stops, the radiance is scaled by 2^exposure
+     * @param gamma     display gamma, has to be positive
+     * @param op        tone mapping operator
+     */
+    void      toneMap     ( GvsChannelImg2D& ldrImg, double exposure = 0.0, double gamma = 1.0,
+                            GvsToneMapOp op = gvsToneMapClamp ) const;
+
+    //! Set radiance from a low dynamic range image (channel values /255).
+    void      copyFrom    ( const GvsChannelImg2D& ldrImg );
+
+    void      Print       ( FILE* fptr = stderr ) const;
+
+protected:
+    int                 imgWidth;
+    int                 imgHeight;
+    std::vector<float>  imgData;
+};
+
+#endif
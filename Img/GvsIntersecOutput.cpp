@@ -1,4 +1,6 @@
+#include <cassert>
 
+#include <cstring>
 #include "GvsIntersecOutput.h"
 
 GvsIntersecOutput::GvsIntersecOutput() :
@@ -60,14 +62,39 @@ void GvsIntersecOutput::setData(int i, int j, gvsData &dat) {
 
 bool GvsIntersecOutput::write(const char* filename) {
     fprintf(stderr, "GvsIntersecOutput() .. save file '%s'\n", filename);
-    FILE* fptr = fopen(filename, "wb");
-    if (fptr == NULL) {
-        fprintf(stderr, "Cannot open file for output!\n");
+    if (m_data == NULL) {
+        return false;
+    }
+    GvsTiledDataWriter writer;
+    addChannels(writer);
+    if (!writer.open(filename, width, height)) {
         return false;
     }
-    fwrite((void*)&width, sizeof(int), 1, fptr);
-    fwrite((void*)&height, sizeof(int), 1, fptr);
-    fwrite(m_data, sizeof(gvsData), width * height, fptr);
-    fclose(fptr);
-    return true;
+    writer.writeImage([this](int x, int y, double* values) {
+        getValues(m_data[y * width + x], values);
+    });
+    return writer.close();
+}
+
+
+void GvsIntersecOutput::addChannels(GvsTiledDataWriter &writer) {
+    const char* names[] = { "objID",
+                            "pos0", "pos1", "pos2", "pos3",
+                            "dir0", "dir1", "dir2", "dir3",
+                            "freqshift",
+                            "jacobi0", "jacobi1", "jacobi2", "jacobi3", "jacobi4",
+                            "u", "v" };
+    for (int i = 0; i < 17; i++) {
+        writer.addChannel(names[i], (i >= 1 && i <= 4) ? gvsTiledFloat64 : gvsTiledFloat32);
+    }
+}
+
+
+void GvsIntersecOutput::getValues(const gvsData &dat, double* values) {
+    values[0] = dat.objID;
+    memcpy(values + 1, dat.pos, 4 * sizeof(double));
+    memcpy(values + 5, dat.dir, 4 * sizeof(double));
+    values[9] = dat.freqshift;
+    memcpy(values + 10, dat.jacobi, 5 * sizeof(double));
+    memcpy(values + 15, dat.uv, 2 * sizeof(double));
 }
@@ -2,6 +2,7 @@
 #define GVS_INTERSEC_OUTPUT_H
 
 #include "GvsGlobalDefs.h"
+#include "Img/GvsTiledData.h"
 
 class GvsIntersecOutput
 {
@@ -21,6 +22,10 @@ public:
 
     bool write(const char* filename);
 
+    //! Channels of the .dat file: all entries of gvsData.
+    static void addChannels(GvsTiledDataWriter &writer);
+    static void getValues(const gvsData &dat, double* values);
+
 private:
     // list of gvsData for every pixel
 
@@ -0,0 +1,130 @@
+/**
+ * @file    GvsPfmIO.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Img/GvsPfmIO.h"
+
+static bool isLittleEndian() {
+    uint16_t val = 1;
+    return *reinterpret_cast<uchar*>(&val) == 1;
+}
+
+static void swapBytes( float* data, size_t num ) {
+    for (size_t i = 0; i < num; i++) {
+        uchar* b = reinterpret_cast<uchar*>(&data[i]);
+        std::swap(b[0],b[3]);
+        std::swap(b[1],b[2]);
+    }
+}
+
+
+GvsPfmIO :: GvsPfmIO() {
+}
+
+GvsPfmIO :: ~GvsPfmIO() {
+}
+
+
+bool GvsPfmIO :: readChannelImg( GvsChannelImg2D& chanImg, const char *filename ) {
+    GvsHdrImg2D hdrImg;
+    if (!readHdrImg(hdrImg,filename)) {
+        return false;
+    }
+    hdrImg.toneMap(chanImg);
+    return true;
+}
+
+
+bool GvsPfmIO :: writeChannelImg( GvsChannelImg2D& chanImg, const char *filename ) {
+    GvsHdrImg2D hdrImg;
+    hdrImg.copyFrom(chanImg);
+    return writeHdrImg(hdrImg,filename);
+}
+
+
+bool GvsPfmIO :: readHdrImg( GvsHdrImg2D& hdrImg, const char *filename ) {
+    FILE* fptr = fopen(filename,"rb");
+    if (fptr==NULL) {
+        fprintf(stderr,"Cannot read image %s.\n",filename);
+        return false;
+    }
+
+    char  type[3];
+    int   width,height;
+    float scale;
+    if (fscanf(fptr,"%2s %d %d %f",type,&width,&height,&scale) != 4 || fgetc(fptr) == EOF) {
+        fprintf(stderr,"Cannot read header of %s.\n",filename);
+        fclose(fptr);
+        return false;
+    }
+
+    int numChannels = 0;
+    if (strcmp(type,"PF") == 0) {
+        numChannels = 3;
+    } else if (strcmp(type,"Pf") == 0) {
+        numChannels = 1;
+    }
+    if (numChannels == 0 || width <= 0 || height <= 0) {
+        fprintf(stderr,"Unsupported pfm image %s.\n",filename);
+        fclose(fptr);
+        return false;
+    }
+
+    size_t rowSize = static_cast<size_t>(width) * numChannels;
+    std::vector<float> row(rowSize);
+    bool swap = ((scale < 0.0f) != isLittleEndian());
+
+    hdrImg.resize(width,height);
+    // rows are stored from bottom to top
+    for (int j = height-1; j >= 0; j--) {
+        if (fread(&row[0],sizeof(float),rowSize,fptr) != rowSize) {
+            fprintf(stderr,"Possible error reading data!\n");
+            fclose(fptr);
+            return false;
+        }
+        if (swap) {
+            swapBytes(&row[0],rowSize);
+        }
+        for (int i = 0; i < width; i++) {
+            if (numChannels == 3) {
+                hdrImg.setColor(i,j,GvsColor(row[3*i],row[3*i+1],row[3*i+2]));
+            } else {
+                hdrImg.setColor(i,j,GvsColor(row[i]));
+            }
+        }
+    }
+    fclose(fptr);
+    return true;
+}
+
+
+bool GvsPfmIO :: writeHdrImg( GvsHdrImg2D& hdrImg, const char *filename ) {
+    FILE* fptr = fopen(filename,"wb");
+    if (fptr==NULL) {
+        fprintf(stderr,"Cannot write image %s.\n",filename);
+        return false;
+    }
+
+    int width  = hdrImg.width();
+    int height = hdrImg.height();
+
+    // negative scale: little endian
+    fprintf(fptr,"PF\n%d %d\n%s\n",width,height,isLittleEndian() ? "-1.0" : "1.0");
+
+    bool ok = true;
+    size_t rowSize = 3 * static_cast<size_t>(width);
+    for (int j = height-1; j >= 0 && ok; j--) {
+        ok = (fwrite(hdrImg.getImagePtr() + j*rowSize,sizeof(float),rowSize,fptr) == rowSize);
+    }
+    if (!ok) {
+        fprintf(stderr,"Possible error writing data!\n");
+    }
+    fclose(fptr);
+    return ok;
+}
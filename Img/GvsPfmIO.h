@@ -0,0 +1,30 @@
+/**
+ * @file    GvsPfmIO.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_PFM_IO_H
+#define GVS_PFM_IO_H
+
+#include "GvsPictureIO.h"
+#include "GvsChannelImg2D.h"
+#include "GvsHdrImg2D.h"
+
+/**
+ * @brief Portable float map (PFM) image handle.
+ *
+ *   RGB images with 32bit float channels, little endian.
+ */
+class GvsPfmIO : public GvsPictureIO
+{
+public:
+    GvsPfmIO();
+    ~GvsPfmIO();
+    virtual bool readChannelImg  ( GvsChannelImg2D& chanImg, const char *filename );
+    virtual bool writeChannelImg ( GvsChannelImg2D& chanImg, const char *filename );
+
+    virtual bool readHdrImg      ( GvsHdrImg2D& hdrImg, const char *filename );
+    virtual bool writeHdrImg     ( GvsHdrImg2D& hdrImg, const char *filename );
+};
+
+#endif
@@ -19,6 +19,9 @@
 
 #include "GvsPicIOEnvelope.h"
 #include "GvsChannelImg2D.h"
+#include "GvsHdrImg2D.h"
+#include "GvsPfmIO.h"
+#include "GvsExrIO.h"
 
 #ifdef HAVE_LIBTIFF
 #include "GvsTiffIO.h"
@@ -70,6 +73,16 @@ void GvsPicIOEnvelope :: allocPicIOMgr( const char *filename )
         return;
     }
 #endif // HAVE_LIBPPM
+
+    if ( has_extension( filename, ".pfm" ) ) {
+        PicIOMgr = new GvsPfmIO;
+        return;
+    }
+
+    if ( has_extension( filename, ".exr" ) ) {
+        PicIOMgr = new GvsExrIO;
+        return;
+    }
     fprintf(stderr,"File ending unknown: %s\n",filename);
     exit(1);
 }
@@ -81,7 +94,7 @@ bool GvsPicIOEnvelope :: testImageExtension ( const std::string filename ) {
     ext.assign(filename,k+1,filename.size());
 
     bool imageExt_exists = false;
-    if (ext=="ppm") {
+    if (ext=="ppm" || ext=="pfm" || ext=="exr") {
         imageExt_exists = true;
     }
 #ifdef HAVE_LIBTIFF
@@ -98,6 +111,11 @@ bool GvsPicIOEnvelope :: testImageExtension ( const std::string filename ) {
 }
 
 
+bool GvsPicIOEnvelope :: isHdrExtension ( const char *filename ) {
+    return has_extension( filename, ".pfm" ) || has_extension( filename, ".exr" );
+}
+
+
 bool GvsPicIOEnvelope :: readChannelImg( GvsChannelImg2D& chanImg,
                                         const char *filename ) {
     allocPicIOMgr( filename );
@@ -113,3 +131,16 @@ bool GvsPicIOEnvelope :: writeChannelImg( GvsChannelImg2D& chanImg,
     return PicIOMgr->writeChannelImg( chanImg, filename );
 }
 
+
+bool GvsPicIOEnvelope :: readHdrImg( GvsHdrImg2D& hdrImg,
+                                    const char *filename ) {
+    allocPicIOMgr( filename );
+    return PicIOMgr->readHdrImg( hdrImg, filename );
+}
+
+
+bool GvsPicIOEnvelope :: writeHdrImg( GvsHdrImg2D& hdrImg,
+                                     const char *filename ) {
+    allocPicIOMgr( filename );
+    return PicIOMgr->writeHdrImg( hdrImg, filename );
+}
@@ -23,6 +23,7 @@
 #include <GvsGlobalDefs.h>
 
 class GvsChannelImg2D;
+class GvsHdrImg2D;
 
 class API_EXPORT GvsPicIOEnvelope : public GvsPictureIO
 {
@@ -33,8 +34,14 @@ public:
     virtual bool readChannelImg  ( GvsChannelImg2D&, const char *filename );
     virtual bool writeChannelImg ( GvsChannelImg2D&, const char *filename );
 
+    virtual bool readHdrImg      ( GvsHdrImg2D&, const char *filename );
+    virtual bool writeHdrImg     ( GvsHdrImg2D&, const char *filename );
+
     virtual bool testImageExtension ( const std::string filename );
 
+    //! Image format stores high dynamic range (pfm, exr).
+    static  bool isHdrExtension ( const char *filename );
+
 protected:
     void allocPicIOMgr( const char *filename );	//weist PicIOMgr auf entsprechende Bildklasse gemaess Endung
 
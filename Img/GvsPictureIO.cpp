@@ -20,6 +20,18 @@
 #include "Img/GvsPictureIO.h"
 #include "Img/GvsChannelImg2D.h"
 
+bool GvsPictureIO::readHdrImg ( GvsHdrImg2D& , const char* filename ) {
+    fprintf(stderr,"Image format does not support high dynamic range: %s\n",filename);
+    return false;
+}
+
+
+bool GvsPictureIO::writeHdrImg ( GvsHdrImg2D& , const char* filename ) {
+    fprintf(stderr,"Image format does not support high dynamic range: %s\n",filename);
+    return false;
+}
+
+
 bool GvsPictureIO::has_extension ( const char* filename , const char* ext ) {
     size_t lfn  = strlen(filename);
     size_t lext = strlen(ext);
@@ -22,6 +22,7 @@
 #include <GvsGlobalDefs.h>
 
 class GvsChannelImg2D;
+class GvsHdrImg2D;
 
 /**
  * @brief The PictureIO class is responsible to read and write image data
@@ -36,6 +37,10 @@ public:
     virtual bool  readChannelImg  ( GvsChannelImg2D& chanImg, const char *filename ) = 0;
     virtual bool  writeChannelImg ( GvsChannelImg2D& chanImg, const char *filename ) = 0;
 
+    // High dynamic range images are only supported by floating-point formats.
+    virtual bool  readHdrImg      ( GvsHdrImg2D& hdrImg, const char *filename );
+    virtual bool  writeHdrImg     ( GvsHdrImg2D& hdrImg, const char *filename );
+
     static bool  has_extension  ( const char* filename , const char* ext );
     static bool  get_extension  ( const std::string filename, std::string& name, std::string& ext );
     static bool  add_string_ext ( const std::string filename, std::string  name, std::string &newname );
@@ -0,0 +1,572 @@
+/**
+ * @file    GvsTiledData.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cassert>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "Img/GvsTiledData.h"
+
+#define GVS_TILED_MAGIC          "GVSTILE"
+#define GVS_TILED_HEADER_SIZE    64
+#define GVS_TILED_CHANNEL_SIZE   32
+#define GVS_TILED_NAME_SIZE      24
+
+// The container is little endian; only little endian hosts are supported.
+
+namespace {
+
+void putU32( uchar* p, uint32_t val ) {
+    memcpy(p, &val, 4);
+}
+
+uint32_t getU32( const uchar* p ) {
+    uint32_t val;
+    memcpy(&val, p, 4);
+    return val;
+}
+
+uint64_t getU64( const uchar* p ) {
+    uint64_t val;
+    memcpy(&val, p, 8);
+    return val;
+}
+
+// Group the bytes of the values: all first bytes, all second bytes, ...
+void shuffle( const uchar* in, uchar* out, size_t num, int size ) {
+    for (size_t i = 0; i < num; i++) {
+        for (int b = 0; b < size; b++) {
+            out[b*num + i] = in[i*size + b];
+        }
+    }
+}
+
+void unshuffle( const uchar* in, uchar* out, size_t num, int size ) {
+    for (size_t i = 0; i < num; i++) {
+        for (int b = 0; b < size; b++) {
+            out[i*size + b] = in[b*num + i];
+        }
+    }
+}
+
+} // namespace
+
+
+// ---------------------------------------------------------------------
+//   GvsTiledDataWriter
+// ---------------------------------------------------------------------
+GvsTiledDataWriter::GvsTiledDataWriter()
+    : mFile(NULL),
+      mWidth(0),
+      mHeight(0),
+      mTileSize(0),
+      mNumTilesX(0),
+      mNumTilesY(0),
+      mOffset(0) {
+#ifdef HAVE_ZLIB
+    mCompression = gvsTiledZlibShuffle;
+#else
+    mCompression = gvsTiledNone;
+#endif
+}
+
+GvsTiledDataWriter::~GvsTiledDataWriter() {
+    close();
+}
+
+
+void GvsTiledDataWriter::addChannel( const std::string &name, GvsTiledDataType type ) {
+    assert(mFile == NULL);
+    Channel channel;
+    channel.name = name.substr(0, GVS_TILED_NAME_SIZE - 1);
+    channel.type = type;
+    mChannels.push_back(channel);
+}
+
+void GvsTiledDataWriter::setCompression( GvsTiledDataCompression compression ) {
+#ifndef HAVE_ZLIB
+    if (compression != gvsTiledNone) {
+        fprintf(stderr,"GvsTiledDataWriter: compression needs zlib, write uncompressed.\n");
+        compression = gvsTiledNone;
+    }
+#endif
+    mCompression = compression;
+}
+
+
+bool GvsTiledDataWriter::open( const char* filename, int width, int height, int tileSize ) {
+    close();
+    if (width <= 0 || height <= 0 || tileSize <= 0 || mChannels.empty()) {
+        fprintf(stderr,"GvsTiledDataWriter: invalid size or no channels for %s.\n",filename);
+        return false;
+    }
+
+    mFile = fopen(filename, "wb");
+    if (mFile == NULL) {
+        fprintf(stderr,"Cannot open file %s for output!\n",filename);
+        return false;
+    }
+    mFilename  = filename;
+    mWidth     = width;
+    mHeight    = height;
+    mTileSize  = tileSize;
+    mNumTilesX = (width  + tileSize - 1) / tileSize;
+    mNumTilesY = (height + tileSize - 1) / tileSize;
+    mIndex.assign(2 * mNumTilesX * mNumTilesY, 0);
+
+    // header and channel table are written by close()
+    mOffset = GVS_TILED_HEADER_SIZE + GVS_TILED_CHANNEL_SIZE * mChannels.size();
+    std::vector<uchar> empty(mOffset, 0);
+    return fwrite(&empty[0], 1, empty.size(), mFile) == empty.size();
+}
+
+
+bool GvsTiledDataWriter::writeTile( int tx, int ty, const GvsTiledDataPixelFunc &getPixel ) {
+    assert(mFile != NULL);
+    assert(tx >= 0 && tx < mNumTilesX && ty >= 0 && ty < mNumTilesY);
+
+    int x1 = tx * mTileSize;
+    int y1 = ty * mTileSize;
+    int w  = GVS_MIN(mTileSize, mWidth - x1);
+    int h  = GVS_MIN(mTileSize, mHeight - y1);
+    size_t numPixels   = static_cast<size_t>(w) * h;
+    size_t numChannels = mChannels.size();
+
+    size_t blockSize = 0;
+    for (size_t c = 0; c < numChannels; c++) {
+        blockSize += numPixels * mChannels[c].type;
+    }
+    mBlock.resize(blockSize);
+
+    // channel planes of the tile
+    std::vector<double> values(numChannels);
+    std::vector<size_t> planeOffset(numChannels);
+    size_t offset = 0;
+    for (size_t c = 0; c < numChannels; c++) {
+        planeOffset[c] = offset;
+        offset += numPixels * mChannels[c].type;
+    }
+
+    bool isZero = true;
+    size_t pix = 0;
+    for (int y = y1; y < y1 + h; y++) {
+        for (int x = x1; x < x1 + w; x++, pix++) {
+            std::fill(values.begin(), values.end(), 0.0);
+            getPixel(x, y, &values[0]);
+            for (size_t c = 0; c < numChannels; c++) {
+                isZero = isZero && (values[c] == 0.0);
+                uchar* dst = &mBlock[planeOffset[c] + pix * mChannels[c].type];
+                if (mChannels[c].type == gvsTiledFloat32) {
+                    float val = static_cast<float>(values[c]);
+                    memcpy(dst, &val, 4);
+                } else {
+                    memcpy(dst, &values[c], 8);
+                }
+            }
+        }
+    }
+
+    int tile = ty * mNumTilesX + tx;
+    if (isZero) {
+        mIndex[2*tile]   = 0;
+        mIndex[2*tile+1] = 0;
+        return true;
+    }
+
+    const std::vector<uchar>* data = &mBlock;
+#ifdef HAVE_ZLIB
+    if (mCompression == gvsTiledZlibShuffle) {
+        std::vector<uchar> shuffled(blockSize);
+        for (size_t c = 0; c < numChannels; c++) {
+            shuffle(&mBlock[planeOffset[c]], &shuffled[planeOffset[c]], numPixels, mChannels[c].type);
+        }
+        uLongf size = compressBound(blockSize);
+        mPacked.resize(size);
+        if (compress2(&mPacked[0], &size, &shuffled[0], blockSize, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            fprintf(stderr,"GvsTiledDataWriter: cannot compress tile %d.\n",tile);
+            return false;
+        }
+        // keep the raw block if it does not shrink
+        if (size < blockSize) {
+            mPacked.resize(size);
+            data = &mPacked;
+        }
+    }
+#endif
+
+    if (fwrite(&(*data)[0], 1, data->size(), mFile) != data->size()) {
+        fprintf(stderr,"Possible error writing data to %s!\n",mFilename.c_str());
+        return false;
+    }
+    mIndex[2*tile]   = mOffset;
+    mIndex[2*tile+1] = data->size();
+    mOffset += data->size();
+    return true;
+}
+
+
+bool GvsTiledDataWriter::writeImage( const GvsTiledDataPixelFunc &getPixel ) {
+    for (int ty = 0; ty < mNumTilesY; ty++) {
+        for (int tx = 0; tx < mNumTilesX; tx++) {
+            if (!writeTile(tx, ty, getPixel)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+bool GvsTiledDataWriter::close() {
+    if (mFile == NULL) {
+        return true;
+    }
+
+    bool ok = (fwrite(&mIndex[0], sizeof(uint64_t), mIndex.size(), mFile) == mIndex.size());
+
+    std::vector<uchar> header(GVS_TILED_HEADER_SIZE + GVS_TILED_CHANNEL_SIZE * mChannels.size(), 0);
+    memcpy(&header[0], GVS_TILED_MAGIC, strlen(GVS_TILED_MAGIC));
+    putU32(&header[8],  GVS_TILED_DATA_VERSION);
+    putU32(&header[12], mWidth);
+    putU32(&header[16], mHeight);
+    putU32(&header[20], static_cast<uint32_t>(mChannels.size()));
+    putU32(&header[24], mTileSize);
+    putU32(&header[28], mCompression);
+    putU32(&header[32], mNumTilesX);
+    putU32(&header[36], mNumTilesY);
+    memcpy(&header[40], &mOffset, 8);
+
+    for (size_t c = 0; c < mChannels.size(); c++) {
+        uchar* ptr = &header[GVS_TILED_HEADER_SIZE + GVS_TILED_CHANNEL_SIZE * c];
+        memcpy(ptr, mChannels[c].name.c_str(), mChannels[c].name.size());
+        putU32(ptr + GVS_TILED_NAME_SIZE, mChannels[c].type);
+    }
+
+    ok = ok && (fseek(mFile, 0, SEEK_SET) == 0);
+    ok = ok && (fwrite(&header[0], 1, header.size(), mFile) == header.size());
+    ok = (fclose(mFile) == 0) && ok;
+    mFile = NULL;
+
+    if (!ok) {
+        fprintf(stderr,"Possible error writing data to %s!\n",mFilename.c_str());
+    }
+    return ok;
+}
+
+
+int GvsTiledDataWriter::tileSize() const {
+    return mTileSize;
+}
+
+int GvsTiledDataWriter::numTilesX() const {
+    return mNumTilesX;
+}
+
+int GvsTiledDataWriter::numTilesY() const {
+    return mNumTilesY;
+}
+
+
+// ---------------------------------------------------------------------
+//   GvsTiledDataReader
+// ---------------------------------------------------------------------
+GvsTiledDataReader::GvsTiledDataReader()
+    : mData(NULL),
+      mSize(0),
+      mMapped(false),
+      mWidth(0),
+      mHeight(0),
+      mTileSize(0),
+      mNumTilesX(0),
+      mNumTilesY(0),
+      mCompression(gvsTiledNone),
+      mIndex(NULL) {
+}
+
+GvsTiledDataReader::~GvsTiledDataReader() {
+    close();
+}
+
+
+bool GvsTiledDataReader::isTiledData( const char* filename ) {
+    FILE* fptr = fopen(filename, "rb");
+    if (fptr == NULL) {
+        return false;
+    }
+    char magic[8];
+    bool isTiled = (fread(magic, 1, 8, fptr) == 8) && (strcmp(magic, GVS_TILED_MAGIC) == 0);
+    fclose(fptr);
+    return isTiled;
+}
+
+
+bool GvsTiledDataReader::open( const char* filename ) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(filename, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED) {
+                mData   = static_cast<const uchar*>(ptr);
+                mSize   = st.st_size;
+                mMapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+    if (!mMapped) {
+        FILE* fptr = fopen(filename, "rb");
+        if (fptr == NULL) {
+            fprintf(stderr,"Cannot read file %s.\n",filename);
+            return false;
+        }
+        uchar buf[65536];
+        size_t num;
+        while ((num = fread(buf, 1, sizeof(buf), fptr)) > 0) {
+            mBuffer.insert(mBuffer.end(), buf, buf + num);
+        }
+        fclose(fptr);
+        mData = mBuffer.empty() ? NULL : &mBuffer[0];
+        mSize = mBuffer.size();
+    }
+
+    if (!readHeader()) {
+        fprintf(stderr,"%s is not a valid tiled data file.\n",filename);
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+void GvsTiledDataReader::close() {
+#ifndef _WIN32
+    if (mMapped) {
+        munmap(const_cast<uchar*>(mData), mSize);
+    }
+#endif
+    mMapped = false;
+    mData   = NULL;
+    mSize   = 0;
+    mIndex  = NULL;
+    mBuffer.clear();
+    mChannelNames.clear();
+    mChannelTypes.clear();
+    mWidth = mHeight = mTileSize = mNumTilesX = mNumTilesY = 0;
+}
+
+
+bool GvsTiledDataReader::readHeader() {
+    if (mData == NULL || mSize < GVS_TILED_HEADER_SIZE || strcmp(reinterpret_cast<const char*>(mData), GVS_TILED_MAGIC) != 0) {
+        return false;
+    }
+    if (getU32(mData + 8) > GVS_TILED_DATA_VERSION) {
+        fprintf(stderr,"Tiled data version %u is not supported.\n",getU32(mData + 8));
+        return false;
+    }
+    mWidth       = getU32(mData + 12);
+    mHeight      = getU32(mData + 16);
+    int numChan  = getU32(mData + 20);
+    mTileSize    = getU32(mData + 24);
+    mCompression = getU32(mData + 28);
+    mNumTilesX   = getU32(mData + 32);
+    mNumTilesY   = getU32(mData + 36);
+    uint64_t indexOffset = getU64(mData + 40);
+
+    size_t tableEnd = GVS_TILED_HEADER_SIZE + static_cast<size_t>(GVS_TILED_CHANNEL_SIZE) * numChan;
+    if (mTileSize <= 0 || tableEnd > mSize || indexOffset + 16 * static_cast<uint64_t>(mNumTilesX) * mNumTilesY > mSize) {
+        return false;
+    }
+#ifndef HAVE_ZLIB
+    if (mCompression != gvsTiledNone) {
+        fprintf(stderr,"Compressed tiled data needs zlib.\n");
+        return false;
+    }
+#endif
+
+    for (int c = 0; c < numChan; c++) {
+        const uchar* ptr = mData + GVS_TILED_HEADER_SIZE + GVS_TILED_CHANNEL_SIZE * c;
+        mChannelNames.push_back(std::string(reinterpret_cast<const char*>(ptr), strnlen(reinterpret_cast<const char*>(ptr), GVS_TILED_NAME_SIZE)));
+        mChannelTypes.push_back(static_cast<GvsTiledDataType>(getU32(ptr + GVS_TILED_NAME_SIZE)));
+    }
+    mIndex = mData + indexOffset;
+    return true;
+}
+
+
+int GvsTiledDataReader::width() const {
+    return mWidth;
+}
+
+int GvsTiledDataReader::height() const {
+    return mHeight;
+}
+
+int GvsTiledDataReader::numChannels() const {
+    return static_cast<int>(mChannelNames.size());
+}
+
+int GvsTiledDataReader::tileSize() const {
+    return mTileSize;
+}
+
+int GvsTiledDataReader::numTilesX() const {
+    return mNumTilesX;
+}
+
+int GvsTiledDataReader::numTilesY() const {
+    return mNumTilesY;
+}
+
+std::string GvsTiledDataReader::channelName( int channel ) const {
+    assert(channel >= 0 && channel < numChannels());
+    return mChannelNames[channel];
+}
+
+GvsTiledDataType GvsTiledDataReader::channelType( int channel ) const {
+    assert(channel >= 0 && channel < numChannels());
+    return mChannelTypes[channel];
+}
+
+int GvsTiledDataReader::findChannel( const std::string &name ) const {
+    for (int c = 0; c < numChannels(); c++) {
+        if (mChannelNames[c] == name) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+
+void GvsTiledDataReader::tileExtent( int tx, int ty, int &x1, int &y1, int &w, int &h ) const {
+    x1 = tx * mTileSize;
+    y1 = ty * mTileSize;
+    w  = GVS_MIN(mTileSize, mWidth - x1);
+    h  = GVS_MIN(mTileSize, mHeight - y1);
+}
+
+
+bool GvsTiledDataReader::decodeTile( int tx, int ty, std::vector<uchar> &block ) const {
+    int x1, y1, w, h;
+    tileExtent(tx, ty, x1, y1, w, h);
+    size_t numPixels = static_cast<size_t>(w) * h;
+
+    size_t blockSize = 0;
+    for (int c = 0; c < numChannels(); c++) {
+        blockSize += numPixels * mChannelTypes[c];
+    }
+
+    int tile = ty * mNumTilesX + tx;
+    uint64_t offset = getU64(mIndex + 16 * tile);
+    uint64_t size   = getU64(mIndex + 16 * tile + 8);
+    if (size == 0) {
+        block.assign(blockSize, 0);
+        return true;
+    }
+    if (offset + size > mSize) {
+        return false;
+    }
+
+    if (mCompression == gvsTiledNone || size == blockSize) {
+        if (size != blockSize) {
+            return false;
+        }
+        block.assign(mData + offset, mData + offset + size);
+        return true;
+    }
+
+#ifdef HAVE_ZLIB
+    std::vector<uchar> shuffled(blockSize);
+    uLongf len = blockSize;
+    if (uncompress(&shuffled[0], &len, mData + offset, size) != Z_OK || len != blockSize) {
+        return false;
+    }
+    block.resize(blockSize);
+    size_t planeOffset = 0;
+    for (int c = 0; c < numChannels(); c++) {
+        unshuffle(&shuffled[planeOffset], &block[planeOffset], numPixels, mChannelTypes[c]);
+        planeOffset += numPixels * mChannelTypes[c];
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool GvsTiledDataReader::readTile( int tx, int ty, int channel, double* values ) const {
+    assert(channel >= 0 && channel < numChannels());
+    std::vector<uchar> block;
+    if (!decodeTile(tx, ty, block)) {
+        fprintf(stderr,"GvsTiledDataReader: cannot read tile (%d,%d).\n",tx,ty);
+        return false;
+    }
+
+    int x1, y1, w, h;
+    tileExtent(tx, ty, x1, y1, w, h);
+    size_t numPixels = static_cast<size_t>(w) * h;
+
+    size_t planeOffset = 0;
+    for (int c = 0; c < channel; c++) {
+        planeOffset += numPixels * mChannelTypes[c];
+    }
+    const uchar* ptr = &block[planeOffset];
+    for (size_t i = 0; i < numPixels; i++) {
+        if (mChannelTypes[channel] == gvsTiledFloat32) {
+            float val;
+            memcpy(&val, ptr + 4*i, 4);
+            values[i] = val;
+        } else {
+            memcpy(&values[i], ptr + 8*i, 8);
+        }
+    }
+    return true;
+}
+
+
+bool GvsTiledDataReader::readChannel( int channel, double* values ) const {
+    std::vector<double> tileValues(static_cast<size_t>(mTileSize) * mTileSize);
+    for (int ty = 0; ty < mNumTilesY; ty++) {
+        for (int tx = 0; tx < mNumTilesX; tx++) {
+            if (!readTile(tx, ty, channel, &tileValues[0])) {
+                return false;
+            }
+            int x1, y1, w, h;
+            tileExtent(tx, ty, x1, y1, w, h);
+            for (int y = 0; y < h; y++) {
+                memcpy(values + static_cast<size_t>(y1 + y) * mWidth + x1, &tileValues[y*w], w * sizeof(double));
+            }
+        }
+    }
+    return true;
+}
+
+
+bool GvsTiledDataReader::readAll( double* values ) const {
+    int numChan = numChannels();
+    std::vector<double> channelValues(static_cast<size_t>(mWidth) * mHeight);
+    for (int c = 0; c < numChan; c++) {
+        if (!readChannel(c, &channelValues[0])) {
+            return false;
+        }
+        for (size_t i = 0; i < channelValues.size(); i++) {
+            values[i*numChan + c] = channelValues[i];
+        }
+    }
+    return true;
+}
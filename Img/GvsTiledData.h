@@ -0,0 +1,153 @@
+/**
+ * @file    GvsTiledData.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_TILED_DATA_H
+#define GVS_TILED_DATA_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+#define GVS_TILED_DATA_VERSION  1
+
+enum GvsTiledDataType {
+    gvsTiledFloat32 = 4,
+    gvsTiledFloat64 = 8
+};
+
+enum GvsTiledDataCompression {
+    gvsTiledNone = 0,
+    gvsTiledZlibShuffle = 1    //!< byte shuffle per channel, then zlib (needs HAVE_ZLIB)
+};
+
+/**
+ * Callback that fills the values of all channels of pixel (x,y).
+ */
+typedef std::function<void(int x, int y, double* values)>  GvsTiledDataPixelFunc;
+
+/**
+ * @brief Writer of the tiled container for per-pixel data (.pdz, .jac, .pt, .dat).
+ *
+ *   File layout (little endian):
+ *     header (64 bytes): magic "GVSTILE", version, width, height, number of
+ *                        channels, tile size, compression, number of tiles in
+ *                        x and y, offset of the tile index
+ *     channel table:     name (24 chars), type, reserved per channel
+ *     tile blocks:       per channel all values of the tile, row by row
+ *     tile index:        offset and size of every tile block, row by row
+ *
+ *   Tiles whose values are all zero are not stored (size 0); a compressed
+ *   block that would not shrink is stored raw. Tiles can be
+ *   written in any order, the index is written by close().
+ */
+class API_EXPORT GvsTiledDataWriter
+{
+public:
+    GvsTiledDataWriter();
+    virtual ~GvsTiledDataWriter();
+
+    void  addChannel     ( const std::string &name, GvsTiledDataType type = gvsTiledFloat32 );
+    void  setCompression ( GvsTiledDataCompression compression );
+
+    bool  open       ( const char* filename, int width, int height, int tileSize = 64 );
+    bool  writeTile  ( int tx, int ty, const GvsTiledDataPixelFunc &getPixel );
+    bool  writeImage ( const GvsTiledDataPixelFunc &getPixel );
+    bool  close      ( );
+
+    int   tileSize   ( ) const;
+    int   numTilesX  ( ) const;
+    int   numTilesY  ( ) const;
+
+protected:
+    struct Channel {
+        std::string       name;
+        GvsTiledDataType  type;
+    };
+
+    FILE*                 mFile;
+    std::string           mFilename;
+    std::vector<Channel>  mChannels;
+    GvsTiledDataCompression  mCompression;
+    int                   mWidth;
+    int                   mHeight;
+    int                   mTileSize;
+    int                   mNumTilesX;
+    int                   mNumTilesY;
+    uint64_t              mOffset;
+    std::vector<uint64_t> mIndex;    //!< offset and size per tile
+    std::vector<uchar>    mBlock;
+    std::vector<uchar>    mPacked;
+};
+
+
+/**
+ * @brief Reader of the tiled container.
+ *
+ *   The file is mapped into memory; only the requested tiles are decoded.
+ */
+class API_EXPORT GvsTiledDataReader
+{
+public:
+    GvsTiledDataReader();
+    virtual ~GvsTiledDataReader();
+
+    //! File starts with the magic of the tiled container.
+    static bool  isTiledData ( const char* filename );
+
+    bool  open  ( const char* filename );
+    void  close ( );
+
+    int   width       ( ) const;
+    int   height      ( ) const;
+    int   numChannels ( ) const;
+    int   tileSize    ( ) const;
+    int   numTilesX   ( ) const;
+    int   numTilesY   ( ) const;
+
+    std::string       channelName ( int channel ) const;
+    GvsTiledDataType  channelType ( int channel ) const;
+    int               findChannel ( const std::string &name ) const;
+
+    //! Size of the tile in pixels; tiles in the last column and row may be smaller.
+    void  tileExtent  ( int tx, int ty, int &x1, int &y1, int &w, int &h ) const;
+
+    /**
+     * Read one channel of one tile.
+     * @param values  w*h values of the tile, row by row
+     */
+    bool  readTile    ( int tx, int ty, int channel, double* values ) const;
+
+    //! Read one channel of the whole image: width*height values.
+    bool  readChannel ( int channel, double* values ) const;
+
+    //! Read all channels: width*height*numChannels values, interleaved per pixel.
+    bool  readAll     ( double* values ) const;
+
+protected:
+    bool  decodeTile  ( int tx, int ty, std::vector<uchar> &block ) const;
+    bool  readHeader  ( );
+
+protected:
+    const uchar*  mData;
+    size_t        mSize;
+    std::vector<uchar>  mBuffer;    //!< file content if it cannot be mapped
+    bool          mMapped;
+
+    int           mWidth;
+    int           mHeight;
+    int           mTileSize;
+    int           mNumTilesX;
+    int           mNumTilesY;
+    int           mCompression;
+    std::vector<std::string>       mChannelNames;
+    std::vector<GvsTiledDataType>  mChannelTypes;
+    const uchar*  mIndex;
+};
+
+#endif
@@ -30,26 +30,40 @@ enum TaskStatus { TASK_WAITING, TASK_RUNNING, TASK_FINISHED };
 
 class GvsMpiTask {
 public:
-    GvsMpiTask() : status(TASK_WAITING) {};
+    GvsMpiTask() : status(TASK_WAITING), seconds(-1.0) {};
 
     TaskStatus status;
     int x1;
     int y1;
     int x2;
     int y2;
-    int size;
-    GvsDevice device;
 
     int imageNr;
+    double seconds;   //!< measured rendering time
 };
 
 
+/**
+ * Task message sent from master to slave. A negative task id
+ * tells the slave to stop.
+ */
+typedef struct _MPITaskMsg {
+    int task;
+    int imageNr;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} MPITaskMsg;
+
+
 typedef struct _MPIMsgPt {
     int continueCalc;
     int node;
     int task;
     long bytes;
     long numPixels;
+    double seconds;
 } MPIMsgPt;
 
 #endif
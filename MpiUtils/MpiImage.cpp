@@ -22,6 +22,7 @@
 #include "Img/GvsPicIOEnvelope.h"
 #include "Img/GvsPictureIO.h"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -29,9 +30,12 @@ GvsMpiImage ::GvsMpiImage()
     : mNumChannels(3)
     , mImageWidth(0)
     , mImageHeight(0)
-    , mBuffer(NULL)
-    , mData(NULL)
+    , mGamma(1.0)
+    , mRawFile(NULL)
+    , mRawOffset(0)
+    , mFilter(gvsCamFilterRGB)
     , mWithData(false)
+    , mResume(false)
     , mNumTasksLeft(0)
     , mActive(false)
 {
@@ -40,17 +44,37 @@ GvsMpiImage ::GvsMpiImage()
 
 GvsMpiImage ::~GvsMpiImage()
 {
-    if (mBuffer != NULL) {
-        delete[] mBuffer;
-    }
-    if (mData != NULL) {
-        delete[] mData;
-    }
+    stop();
+}
+
+void GvsMpiImage::setCamFilter(GvsCamFilter filter)
+{
+    mFilter = filter;
+    mWithData = (filter == gvsCamFilterRGBpdz || filter == gvsCamFilterRGBjac || filter == gvsCamFilterRGBpt
+        || filter == gvsCamFilterRGBIntersec || filter == gvsCamFilterRGBcost);
+}
+
+void GvsMpiImage::setGamma(double gamma)
+{
+    mGamma = gamma;
+}
+
+void GvsMpiImage::setResume(bool resume)
+{
+    mResume = resume;
 }
 
-void GvsMpiImage::setWithData(bool withData)
+bool GvsMpiImage::canResume() const
 {
-    mWithData = withData;
+    if (mWithData) {
+        return false;
+    }
+    FILE* fptr = fopen(rawFilename().c_str(), "rb");
+    if (fptr == NULL) {
+        return false;
+    }
+    fclose(fptr);
+    return true;
 }
 
 void GvsMpiImage::setOutfilename(const std::string filename, const std::string fileExt, const int num)
@@ -98,24 +122,89 @@ void GvsMpiImage ::insertRegion(int x1, int y1, int x2, int y2, uchar* p, gvsDat
         activate();
     }
 
-    assert(mBuffer != NULL);
     assert(!((x1 >= mImageWidth) || (x2 >= mImageWidth) || (x1 < 0) || (x2 < 0) || (y1 >= mImageHeight)
         || (y2 >= mImageHeight) || (y1 < 0) || (y2 < 0)));
 
+    if (mGamma != 0.0 && mGamma != 1.0) {
+        double invGamma = 1.0 / mGamma;
+        int regionSize = (x2 - x1 + 1) * (y2 - y1 + 1) * mNumChannels;
+        for (int i = 0; i < regionSize; i++) {
+            p[i] = (uchar)pow((double)p[i], invGamma);
+        }
+    }
+
+    // write every row of the region at its final position
+    if (mRawFile != NULL) {
+        size_t rowSize = (x2 - x1 + 1) * mNumChannels;
+        for (int j = y1; j <= y2; j++) {
+            long offset = mRawOffset + ((long)j * mImageWidth + x1) * mNumChannels;
+            if (fseek(mRawFile, offset, SEEK_SET) != 0 || fwrite(p, 1, rowSize, mRawFile) != rowSize) {
+                fprintf(stderr, "Possible error writing data to %s!\n", mRawFilename.c_str());
+            }
+            p += rowSize;
+        }
+        // The region is handed to the operating system before it is journaled; this
+        // survives a crash of the process, but not necessarily a power failure.
+        fflush(mRawFile);
+    }
+
+    if (data != nullptr && mWithData) {
+        insertData(x1, y1, x2, y2, data);
+    }
+    decreaseNumTasksLeft();
+}
+
+/**
+ * Collect the data of the region in the tiles of the data file.
+ * Completed tiles are written and released.
+ */
+void GvsMpiImage ::insertData(int x1, int y1, int x2, int y2, gvsData* data)
+{
+    int tileSize = mDataWriter.tileSize();
+    int numTilesX = mDataWriter.numTilesX();
+
     gvsData* dptr = data;
     for (int j = y1; j <= y2; j++) {
-        for (int i = x1; i <= x2; i++) {
-            for (int c = 0; c < mNumChannels; c++) {
-                mBuffer[(i + mImageWidth * j) * mNumChannels + c] += *p;
-                p++;
+        int row = GvsChannelImg2D::intersecFileRow(j, mImageHeight, mFilter);
+        int ty = row / tileSize;
+        int h = GVS_MIN(tileSize, mImageHeight - ty * tileSize);
+
+        for (int i = x1; i <= x2; i++, dptr++) {
+            int tx = i / tileSize;
+            int w = GVS_MIN(tileSize, mImageWidth - tx * tileSize);
+
+            PendingTile& tile = mPendingTiles[ty * numTilesX + tx];
+            if (tile.data.empty()) {
+                tile.data.resize(w * h);
+                tile.numPixels = 0;
             }
-            if (data != nullptr && mData != nullptr) {
-                memcpy(&mData[j * mImageWidth + i], dptr, sizeof(gvsData));
-                dptr++;
+            tile.data[(row - ty * tileSize) * w + (i - tx * tileSize)] = *dptr;
+
+            if (++tile.numPixels == w * h) {
+                mDataWriter.writeTile(tx, ty, [&](int x, int y, double* values) {
+                    GvsChannelImg2D::getIntersecValues(
+                        tile.data[(y - ty * tileSize) * w + (x - tx * tileSize)], mFilter, values);
+                });
+                mPendingTiles.erase(ty * numTilesX + tx);
             }
         }
     }
-    decreaseNumTasksLeft();
+}
+
+void GvsMpiImage ::addTiming(int x1, int y1, int x2, int y2, double seconds, int node)
+{
+    GvsTileTiming timing = { x1, y1, x2, y2, seconds, node };
+    mTimings.push_back(timing);
+}
+
+const std::vector<GvsTileTiming>& GvsMpiImage ::getTimings() const
+{
+    return mTimings;
+}
+
+double GvsMpiImage ::getWallTime() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
 }
 
 void GvsMpiImage ::setNumTasks(int num)
@@ -128,25 +217,74 @@ int GvsMpiImage ::getNumTasksLeft(void) const
     return mNumTasksLeft;
 }
 
-void GvsMpiImage ::writePicture(GvsCamFilter filter, double gamma)
+void GvsMpiImage ::writePicture()
 {
     std::cerr << "GvsMpiImage :: writePicture\n";
     assert(mOutfilename != "");
+    if (mActive == false) {
+        // all regions were resumed from a previous run
+        activate();
+    }
 
-    GvsChannelImg2D image(mImageWidth, mImageHeight, mNumChannels, mWithData);
-    correctGamma(gamma);
-    image.setBlock(0, 0, mImageWidth, mImageHeight, mBuffer);
     if (mWithData) {
-        image.setDataBlock(0, 0, mImageWidth, mImageHeight, mData);
-        image.writeIntersecData(mOutfilename.c_str(), filter);
+        // tiles are only left if regions are missing
+        int tileSize = mDataWriter.tileSize();
+        int numTilesX = mDataWriter.numTilesX();
+        for (std::map<int, PendingTile>::iterator itr = mPendingTiles.begin(); itr != mPendingTiles.end(); ++itr) {
+            int tx = itr->first % numTilesX;
+            int ty = itr->first / numTilesX;
+            int w = GVS_MIN(tileSize, mImageWidth - tx * tileSize);
+            const std::vector<gvsData>& tileData = itr->second.data;
+            mDataWriter.writeTile(tx, ty, [&](int x, int y, double* values) {
+                GvsChannelImg2D::getIntersecValues(
+                    tileData[(y - ty * tileSize) * w + (x - tx * tileSize)], mFilter, values);
+            });
+        }
+        mPendingTiles.clear();
+        mDataWriter.close();
+    }
+
+    if (mRawFile != NULL) {
+        fclose(mRawFile);
+        mRawFile = NULL;
+        if (mRawFilename != mOutfilename) {
+            convertPicture();
+        }
     }
+}
+
+/**
+ * Read the raw pixels and write them in the format of the output file.
+ */
+bool GvsMpiImage ::convertPicture()
+{
+    FILE* fptr = fopen(mRawFilename.c_str(), "rb");
+    if (fptr == NULL) {
+        fprintf(stderr, "Cannot read file %s.\n", mRawFilename.c_str());
+        return false;
+    }
+
+    GvsChannelImg2D image(mImageWidth, mImageHeight, mNumChannels);
+    std::vector<uchar> row(mImageWidth * mNumChannels);
+    bool isOkay = true;
+    for (int j = 0; j < mImageHeight && isOkay; j++) {
+        isOkay = (fread(&row[0], 1, row.size(), fptr) == row.size());
+        image.setBlock(0, j, mImageWidth, 1, &row[0]);
+    }
+    fclose(fptr);
+    if (!isOkay) {
+        fprintf(stderr, "Possible error reading data from %s!\n", mRawFilename.c_str());
+    }
+
     GvsPicIOEnvelope().writeChannelImg(image, mOutfilename.c_str());
+    remove(mRawFilename.c_str());
+    return isOkay;
 }
 
-bool GvsMpiImage ::writeImageFileIfPossible(GvsCamFilter filter, double gamma)
+bool GvsMpiImage ::writeImageFileIfPossible()
 {
     if (mNumTasksLeft <= 0) {
-        writePicture(filter, gamma);
+        writePicture();
         stop(); // leert den Speicher
         return true;
     }
@@ -156,45 +294,54 @@ bool GvsMpiImage ::writeImageFileIfPossible(GvsCamFilter filter, double gamma)
 void GvsMpiImage ::Print(FILE* fptr) const
 {
     fprintf(fptr, "GvsMpiImage: {\n");
-    fprintf(fptr, "\tout:%s  tasks left: %d\n", mOutfilename.c_str(), mNumTasksLeft);
+    fprintf(fptr, "\tout:%s  tasks left: %d\n", mOutfilename.c_str(), (int)mNumTasksLeft);
     fprintf(fptr, "}\n");
 }
 
-void GvsMpiImage ::correctGamma(double gamma)
-{
-    if (gamma == 0.0 || gamma == 1.0)
-        return;
-
-    double invGamma = 1.0 / gamma;
-
-    int bufferSize = mImageWidth * mImageHeight * mNumChannels;
-    double buf;
-    for (int i = 0; i < bufferSize; i++) {
-        buf = pow((double)mBuffer[i], invGamma);
-        mBuffer[i] = (uchar)buf;
-    }
-}
-
-// If there is no buffer yet, do allocate it.
+// If there is no output file yet, do create it.
 void GvsMpiImage::activate()
 {
-    if (mBuffer == NULL) {
-        int bufferSize = mImageWidth * mImageHeight * mNumChannels;
-        mBuffer = new uchar[bufferSize];
+    mStartTime = std::chrono::steady_clock::now();
 
-        for (int i = 0; i < bufferSize; i++) {
-            mBuffer[i] = 0;
+    if (mRawFile == NULL) {
+        bool isPpm = isPpmOutput();
+        mRawFilename = rawFilename();
+        if (mResume) {
+            mRawFile = fopen(mRawFilename.c_str(), "r+b");
+        }
+        if (mRawFile == NULL) {
+            mRawFile = fopen(mRawFilename.c_str(), "wb");
+        }
+        if (mRawFile == NULL) {
+            fprintf(stderr, "Cannot open file %s for output!\n", mRawFilename.c_str());
+        } else if (isPpm) {
+            fprintf(mRawFile, "P6\n%d %d\n%d\n", mImageWidth, mImageHeight, 255);
+            mRawOffset = ftell(mRawFile);
+        } else {
+            mRawOffset = 0;
         }
     }
 
-    if (mWithData && mData == NULL) {
-        int bufferSize = mImageWidth * mImageHeight;
-        mData = new gvsData[bufferSize];
+    if (mWithData) {
+        GvsChannelImg2D::openIntersecData(mDataWriter, mOutfilename.c_str(), mImageWidth, mImageHeight, mFilter);
     }
 
     mActive = true;
 }
 
+bool GvsMpiImage::isPpmOutput() const
+{
+    std::string fName;
+    std::string fExt;
+    GvsPictureIO::get_extension(mOutfilename, fName, fExt);
+    return (fExt == "ppm" || fExt == "PPM") && mNumChannels == 3;
+}
+
+std::string GvsMpiImage::rawFilename() const
+{
+    return isPpmOutput() ? mOutfilename : mOutfilename + ".part";
+}
+
 void GvsMpiImage ::decreaseNumTasksLeft(void)
 {
     mNumTasksLeft--;
@@ -202,13 +349,12 @@ void GvsMpiImage ::decreaseNumTasksLeft(void)
 
 void GvsMpiImage ::stop(void)
 {
-    if (mBuffer != NULL) {
-        delete[] mBuffer;
-        mBuffer = NULL;
-    }
-    if (mData != NULL) {
-        delete[] mData;
-        mData = NULL;
+    if (mRawFile != NULL) {
+        fclose(mRawFile);
+        mRawFile = NULL;
     }
+    mPendingTiles.clear();
+    mDataWriter.close();
+    std::vector<GvsTileTiming>().swap(mTimings);
     mActive = false;
 }
@@ -19,20 +19,43 @@
 #ifndef MPI_IMAGE
 #define MPI_IMAGE
 
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include <GvsGlobalDefs.h>
 #include <MpiUtils/GvsMpiDefs.h>
+#include "Img/GvsTiledData.h"
+#include "Utils/GvsProgress.h"
 
 class GvsChannelImg2D;
 
+/**
+ * Image of the MPI master that is written while its regions arrive.
+ *
+ *   The pixels are written into a raw file at their final position. For ppm
+ *   output this file already is the image, any other format is converted
+ *   when the image is finished. The intersection data is written tile by
+ *   tile into the tiled container; only tiles that are not complete yet are
+ *   kept in memory. Thus, the memory of the master does not depend on the
+ *   image resolution or on the number of images in progress.
+ */
 class GvsMpiImage
 {
   public:
     GvsMpiImage();
     virtual ~GvsMpiImage ();
 
-    void    setWithData( bool withData );
+    void    setCamFilter ( GvsCamFilter filter );
+    void    setGamma     ( double gamma );
+
+    /**
+     * Continue the raw file of an interrupted run instead of creating it.
+     *   Only possible without intersection data, see canResume().
+     */
+    void    setResume    ( bool resume );
+    bool    canResume    ( ) const;
 
     void         setOutfilename( const std::string filename, const std::string fileExt, const int num = 0 );
     std::string  getOutfilename() const;
@@ -43,33 +66,59 @@ class GvsMpiImage
 
     void    insertRegion       ( int x1, int y1, int x2, int y2, uchar* p, gvsData* data );
 
+    //! Store the rendering time of a region for the report of the image.
+    void    addTiming          ( int x1, int y1, int x2, int y2, double seconds, int node );
+    const std::vector<GvsTileTiming>&  getTimings ( ) const;
+    double  getWallTime        ( ) const;   //!< seconds since the first region arrived
+
     void    setNumTasks        ( int num );
     int     getNumTasksLeft    ( void ) const;
 
-    void    writePicture       ( GvsCamFilter filter = gvsCamFilterRGB, double gamma = 1.0 );    
-    bool    writeImageFileIfPossible ( GvsCamFilter filter = gvsCamFilterRGB, double gamma = 1.0 );
+    void    writePicture       ( );
+    bool    writeImageFileIfPossible ( );
 
     void    Print ( FILE* fptr = stderr ) const;
 
 
-    void    correctGamma          ( double gamma );
     void    activate              ( void );
     void    decreaseNumTasksLeft  ( void );
     void    stop                  ( void );
 
   protected:
+    void    insertData      ( int x1, int y1, int x2, int y2, gvsData* data );
+    bool    isPpmOutput     ( ) const;
+    std::string  rawFilename ( ) const;
+    bool    convertPicture  ( );
+
+  protected:
+    //! Tile of the intersection data that is not complete yet.
+    struct PendingTile {
+        std::vector<gvsData>  data;
+        int                   numPixels;
+    };
+
     std::string   mOutfilename;
+    std::string   mRawFilename;   //!< pixels in final order, mOutfilename if ppm
 
     int      mNumChannels;
     int      mImageWidth;
     int      mImageHeight;
+    double   mGamma;
 
-    uchar*   mBuffer;
-    gvsData* mData;
+    FILE*    mRawFile;
+    long     mRawOffset;          //!< size of the ppm header
+    GvsCamFilter  mFilter;
     bool     mWithData;
+    bool     mResume;
+
+    GvsTiledDataWriter          mDataWriter;
+    std::map<int,PendingTile>   mPendingTiles;
 
-    int      mNumTasksLeft;
+    std::atomic<int>  mNumTasksLeft;
     bool     mActive;
+
+    std::vector<GvsTileTiming>  mTimings;
+    std::chrono::steady_clock::time_point  mStartTime;
 };
 
 
@@ -0,0 +1,87 @@
+/**
+ * @file    MpiResultWriter.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cassert>
+
+#include "MpiUtils/MpiResultWriter.h"
+
+
+GvsMpiResultWriter::GvsMpiResultWriter ( GvsMpiTaskManager* taskManager )
+    : mTaskManager(taskManager),
+      mFinish(false),
+      mNumImagesWritten(0) {
+    assert(mTaskManager != NULL);
+}
+
+GvsMpiResultWriter::~GvsMpiResultWriter() {
+    finish();
+}
+
+
+void GvsMpiResultWriter::start() {
+    if (!mThread.joinable()) {
+        mFinish = false;
+        mThread = std::thread(&GvsMpiResultWriter::run, this);
+    }
+}
+
+
+void GvsMpiResultWriter::push ( int task, uchar* region, gvsData* data, double seconds, int node ) {
+    Result result;
+    result.task    = task;
+    result.region  = region;
+    result.data    = data;
+    result.seconds = seconds;
+    result.node    = node;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(result);
+    }
+    mCondition.notify_one();
+}
+
+
+void GvsMpiResultWriter::finish() {
+    if (!mThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFinish = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+
+int GvsMpiResultWriter::getNumImagesWritten() const {
+    return mNumImagesWritten;
+}
+
+
+void GvsMpiResultWriter::run() {
+    while (true) {
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mFinish || !mQueue.empty(); });
+            if (mQueue.empty()) {
+                return;
+            }
+            result = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        mTaskManager->insertRegion(result.task, result.region, result.data, result.seconds, result.node);
+        delete [] result.region;
+        if (result.data != NULL) {
+            delete [] result.data;
+        }
+
+        if (mTaskManager->writeImageFileIfPossible(result.task)) {
+            mNumImagesWritten++;
+        }
+    }
+}
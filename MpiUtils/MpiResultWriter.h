@@ -0,0 +1,69 @@
+/**
+ * @file    MpiResultWriter.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef MPI_RESULT_WRITER
+#define MPI_RESULT_WRITER
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "MpiUtils/MpiTaskManager.h"
+
+/**
+ * Writer thread of the MPI master.
+ *
+ *   Received regions are queued by the master and inserted into their images
+ *   by the writer thread. Finished images are written from the writer thread,
+ *   too, so the master can keep on distributing tasks and receiving results.
+ *   The writer thread does not call any MPI function.
+ */
+class GvsMpiResultWriter
+{
+  public:
+    explicit GvsMpiResultWriter ( GvsMpiTaskManager* taskManager );
+    virtual ~GvsMpiResultWriter();
+
+    void  start  ( );
+
+    /**
+     * Queue region of a finished task. The writer takes ownership of the buffers.
+     * @param task     task id
+     * @param region   region buffer (new[])
+     * @param data     data buffer (new[]) or NULL
+     * @param seconds  measured rendering time of the task
+     * @param node     node that rendered the task
+     */
+    void  push   ( int task, uchar* region, gvsData* data, double seconds, int node );
+
+    //! Insert all queued regions and wait for the writer thread to finish.
+    void  finish ( );
+
+    int   getNumImagesWritten ( ) const;
+
+  protected:
+    void  run    ( );
+
+  protected:
+    struct Result {
+        int      task;
+        uchar*   region;
+        gvsData* data;
+        double   seconds;
+        int      node;
+    };
+
+    GvsMpiTaskManager*       mTaskManager;
+
+    std::thread              mThread;
+    std::mutex               mMutex;
+    std::condition_variable  mCondition;
+    std::deque<Result>       mQueue;
+    bool                     mFinish;
+    int                      mNumImagesWritten;
+};
+
+#endif
@@ -38,10 +38,21 @@ GvsMpiTaskManager :: GvsMpiTaskManager( const std::string infile, const std::str
 
     mRenderDevice = -1;  // alle Devices Rendern
     mStartDevice = 0;
+
+    mNumImages = 0;
+    mDevices = NULL;
+    mImage = NULL;
+    mTileSize = 64;
+    mMinTileSize = 8;
+    mGamma = 1.0;
+    mJournal = NULL;
+    mProgress = NULL;
 }
 
 
 GvsMpiTaskManager::~GvsMpiTaskManager ( ) {
+    delete [] mDevices;
+    delete [] mImage;
     delete parser;
 }
 
@@ -54,6 +65,28 @@ bool GvsMpiTaskManager :: setStartDevice ( int startdev ) {
 }
 
 
+void GvsMpiTaskManager :: setTileSize ( int tileSize, int minTileSize ) {
+    mMinTileSize = GVS_MAX(minTileSize,1);
+    mTileSize    = GVS_MAX(tileSize,mMinTileSize);
+}
+
+
+void GvsMpiTaskManager :: setGamma ( double gamma ) {
+    mGamma = gamma;
+}
+
+
+void GvsMpiTaskManager :: setJournal ( GvsRenderJournal* journal ) {
+    mJournal = journal;
+}
+
+
+void GvsMpiTaskManager :: setProgress ( GvsProgress* progress, const std::string &reportFormat ) {
+    mProgress = progress;
+    mReportFormat = reportFormat;
+}
+
+
 int GvsMpiTaskManager :: getStartDevNr() const {
     return mStartDevice;
 }
@@ -67,7 +100,7 @@ void GvsMpiTaskManager :: setRenderDevice ( int renderdev ) {
 }
 
 
-bool GvsMpiTaskManager :: initialize ( int , int numNodesImage ) {
+bool GvsMpiTaskManager :: initialize ( int numNodes, int numNodesImage ) {
     //fprintf(stderr,"Parse scm file...\n");
     parser->read_scene(inFileName.c_str());
     mNumDevices = parser->getNumDevices();
@@ -89,38 +122,28 @@ bool GvsMpiTaskManager :: initialize ( int , int numNodesImage ) {
         }
     }
 
-    mImage = new GvsMpiImage[mNumDevices - mStartDevice*(isStereo?2:1)];
+    mNumImages = mNumDevices - mStartDevice*(isStereo?2:1);
+    mImage   = new GvsMpiImage[mNumImages];
+    mDevices = new GvsDevice[mNumImages];
     mImageWidth  = res.x(0);
     mImageHeight = res.x(1);
 
-    mNumNodesImage = numNodesImage;
-
-    // image size smaller than the number of nodes per image
-    if (mImageHeight < mNumNodesImage )
-        mNumNodesImage = mImageHeight;
-
-    // step size
-    int yStepsize = mImageHeight / mNumNodesImage;
-    if (yStepsize < 1)
-        yStepsize = 1;
-
-    mNumNodesImage = mImageHeight / yStepsize;
-    if (mNumNodesImage*yStepsize < mImageHeight)
-        mNumNodesImage++;
+    mNumNodesImage = GVS_MAX(numNodesImage,1);
 
+    // Reduce the initial tile size until every image has at least 'numNodesImage' tiles.
+    int tileSize = mTileSize;
+    while (tileSize > mMinTileSize &&
+           ((mImageWidth + tileSize - 1)/tileSize) * ((mImageHeight + tileSize - 1)/tileSize) < mNumNodesImage) {
+        tileSize = GVS_MAX(tileSize/2,mMinTileSize);
+    }
 
-    // Anzahl der Tasks ergibt sich aus der Anzahl Teilaufgaben je Bild mal der Anzahl Bilder,
-    // wobei die Anzahl der Bilder gleich der Anzahl der Devices ist
-    mNumTasks = mNumNodesImage * (mNumDevices - mStartDevice*(isStereo?2:1));
-    mTasks = new GvsMpiTask[mNumTasks];
-    assert( mTasks != NULL );
+    mScheduler.setNumWorkers(numNodes);
+    mScheduler.setTileSize(tileSize,mMinTileSize);
+    mScheduler.setImages(mNumImages,mImageWidth,mImageHeight);
 
     GvsCamFilter  camFilter;
 
-    // Subdivide images into tasks
-    int actTask = 0;
-    for ( int image = 0; image < (mNumDevices - mStartDevice*(isStereo?2:1)); image++)   {
-        mImage[image].setNumTasks(mNumNodesImage);
+    for ( int image = 0; image < mNumImages; image++)   {
         mImage[image].setImageResolution(mImageWidth,mImageHeight);
 
         if (isStereo) {
@@ -134,45 +157,67 @@ bool GvsMpiTaskManager :: initialize ( int , int numNodesImage ) {
         }
 
         camFilter = mDevice.camera->getCamFilter();
+        mImage[image].setCamFilter(camFilter);
+        mImage[image].setGamma(mGamma);
 
-        //int numChannels;
-        switch (camFilter) {
-            default:
-            case gvsCamFilterRGB: {
-                //numChannels = 3;
-                break;
-            }
-            case gvsCamFilterRGBpdz:
-            case gvsCamFilterRGBjac:
-            case gvsCamFilterRGBpt:
-            case gvsCamFilterRGBIntersec: {
-                //numChannels = 3;
-                mImage[image].setWithData(true);
-                break;
-            }
-        }
+        // assign a device to each image
+        parser->getDevice(&mDevices[image],image + mStartDevice*(isStereo?2:1));
+    }
 
-        int startY = 0;
-        for ( int imageRegion = 0; imageRegion < mNumNodesImage; imageRegion++ ) {
-            mTasks[actTask].x1 = 0;
-            mTasks[actTask].y1 = startY;
-            mTasks[actTask].x2 = mImageWidth-1;
-            startY += yStepsize;
-            mTasks[actTask].y2 = startY-1;
+    if (mJournal != NULL) {
+        resumeImages();
+    }
+    for ( int image = 0; image < mNumImages; image++)   {
+        mImage[image].setNumTasks(mScheduler.getNumTasksLeft(image));
+    }
+    return true;
+}
 
-            mTasks[actTask].status = TASK_WAITING;
 
-            // assign a device to each task
-            parser->getDevice(&(mTasks[actTask].device),image + mStartDevice*(isStereo?2:1));
+/**
+ * @brief GvsMpiTaskManager::resumeImages
+ *   Skip images and regions finished by a previous run. Regions are only
+ *   resumed if the raw file of the image is still there and the scene file
+ *   and the resolution did not change; images with intersection data are
+ *   rendered again completely.
+ */
+void GvsMpiTaskManager :: resumeImages ( ) {
+    int numImagesDone = 0;
+    long numPixelsDone = 0;
+    bool isStereo = mDevice.camera->isStereoCam();
 
-            // Every task stores in specific image.
-            mTasks[actTask].imageNr = image;
+    for ( int image = 0; image < mNumImages; image++)   {
+        std::string frame = mImage[image].getOutfilename();
+        if (mJournal->isFrameDone(frame)) {
+            mScheduler.restoreRegion(image,0,0,mImageWidth-1,mImageHeight-1,-1.0);
+            numImagesDone++;
+            continue;
+        }
 
-            actTask++;
+        // regions of another scene or resolution are rendered again
+        int devNum = image + mStartDevice*(isStereo?2:1);
+        mJournal->beginFrame(frame, GvsRenderJournal::makeSignature(inFileName,devNum,mImageWidth,mImageHeight));
+
+        std::vector<GvsJournalRegion> regions = mJournal->getRegions(frame);
+        if (regions.empty() || !mImage[image].canResume()) {
+            continue;
+        }
+        mImage[image].setResume(true);
+        for (unsigned int i = 0; i < regions.size(); i++) {
+            const GvsJournalRegion &r = regions[i];
+            numPixelsDone += mScheduler.restoreRegion(image,r.x1,r.y1,r.x2,r.y2,r.seconds);
+        }
+
+        // interrupted after the last region, but before the image was written
+        if (mScheduler.getNumTasksLeft(image) == 0) {
+            mImage[image].setNumTasks(0);
+            if (mImage[image].writeImageFileIfPossible()) {
+                mJournal->setFrameDone(frame);
+                numImagesDone++;
+            }
         }
-        mTasks[actTask-1].y2 = mImageHeight-1;
     }
-    return true;
+    fprintf(stderr,"Resume: %d images and %ld pixels already done.\n",numImagesDone,numPixelsDone);
 }
 
 
@@ -196,87 +241,125 @@ void GvsMpiTaskManager :: getDevice( GvsDevice *device, unsigned int k ) {
 
 
 int GvsMpiTaskManager::getNumTasks ( ) const {
-    return mNumTasks;
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScheduler.getNumTasks();
 }
 
+long GvsMpiTaskManager::getNumPixelsLeft ( ) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScheduler.getNumPixelsLeft();
+}
 
-void GvsMpiTaskManager::activateTask ( int task ) {
-    mTasks[task].status = TASK_RUNNING;
+/**
+ * @brief GvsMpiTaskManager::getNextTask
+ * @return task id or -1 if all tasks are distributed
+ */
+int GvsMpiTaskManager::getNextTask ( ) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    int task = mScheduler.getNextTask();
+    if (task >= 0) {
+        // the task might have been split
+        int image = mScheduler.getTask(task).imageNr;
+        mImage[image].setNumTasks(mScheduler.getNumTasksLeft(image));
+    }
+    return task;
 }
 
 
 void GvsMpiTaskManager::getViewPort ( int task, int &x1, int &y1, int &x2, int &y2) const {
-    x1 = mTasks[task].x1;
-    y1 = mTasks[task].y1;
-    x2 = mTasks[task].x2;
-    y2 = mTasks[task].y2;
+    std::lock_guard<std::mutex> lock(mMutex);
+    const GvsMpiTask &t = mScheduler.getTask(task);
+    x1 = t.x1;
+    y1 = t.y1;
+    x2 = t.x2;
+    y2 = t.y2;
 }
 
 
 int GvsMpiTaskManager::getImageNr ( int task ) const {
-    return mTasks[task].imageNr;
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScheduler.getTask(task).imageNr;
 }
 
 
-void GvsMpiTaskManager :: insertRegion ( int task, uchar* p, gvsData* data ) {
+/**
+ * @brief GvsMpiTaskManager::insertRegion
+ *   Regions are inserted by one thread only. The region is written to
+ *   the image outside of the lock, so distributing tasks is not blocked
+ *   by file output.
+ */
+void GvsMpiTaskManager :: insertRegion ( int task, uchar* p, gvsData* data, double seconds, int node ) {
     //  cerr << "GvsMpiTaskManager :: insertRegion: " << task << endl;
-    int x1 = mTasks[task].x1;
-    int y1 = mTasks[task].y1;
-    int x2 = mTasks[task].x2;
-    int y2 = mTasks[task].y2;
-
-    mImage[mTasks[task].imageNr].insertRegion(x1,y1,x2,y2,p,data);
-}
+    GvsMpiTask t;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        t = mScheduler.getTask(task);
+    }
 
+    mImage[t.imageNr].insertRegion(t.x1,t.y1,t.x2,t.y2,p,data);
+    mImage[t.imageNr].addTiming(t.x1,t.y1,t.x2,t.y2,seconds,node);
+    if (mProgress != NULL) {
+        mProgress->addPixels(static_cast<long>(t.x2 - t.x1 + 1) * (t.y2 - t.y1 + 1));
+    }
+    if (mJournal != NULL) {
+        mJournal->addRegion(mImage[t.imageNr].getOutfilename(),t.x1,t.y1,t.x2,t.y2,seconds);
+    }
 
-bool GvsMpiTaskManager :: writeImageFileIfPossible ( int task, double gamma ) {
-    GvsCamFilter filter = mDevice.camera->getCamFilter();
-    return mImage[mTasks[task].imageNr].writeImageFileIfPossible( filter, gamma );
+    std::lock_guard<std::mutex> lock(mMutex);
+    mScheduler.finishTask(task,seconds);
+    mImage[t.imageNr].setNumTasks(mScheduler.getNumTasksLeft(t.imageNr));
 }
 
-/**
- * @brief GvsMpiTaskManager::getNextAvailableTask
- * @param task
- * @return
- */
-int GvsMpiTaskManager :: getNextAvailableTask ( int task ) const {
-    while ((mTasks[task].status != TASK_WAITING) && (task < mNumTasks-1))   {
-        task++;
-    }
 
-    if (task == mNumTasks-1)   {
-        if (mTasks[task].status != TASK_WAITING) {
-            task++;
+bool GvsMpiTaskManager :: writeImageFileIfPossible ( int task ) {
+    int image;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        image = mScheduler.getTask(task).imageNr;
+        if (mImage[image].getNumTasksLeft() > 0) {
+            return false;
         }
     }
-    else if (task >= mNumTasks) {
-        task = mNumTasks;
+    // no task of this image is left, so nobody else touches it
+    if (!mReportFormat.empty()) {
+        std::string frame = mImage[image].getOutfilename();
+        double eta = (mProgress != NULL) ? GVS_MAX(mProgress->eta(),0.0) : 0.0;
+        GvsProgress::writeReport(frame + "." + mReportFormat, frame, mImageWidth, mImageHeight,
+                                 mImage[image].getWallTime(), eta, mImage[image].getTimings());
     }
-
-    return task;
+    if (!mImage[image].writeImageFileIfPossible()) {
+        return false;
+    }
+    if (mJournal != NULL) {
+        mJournal->setFrameDone(mImage[image].getOutfilename());
+    }
+    return true;
 }
 
 /**
  * @brief GvsMpiTaskManager::createScene
- * @param task
+ * @param imageNr
  * @param device
  */
-void GvsMpiTaskManager :: createScene( int task, GvsDevice *device ) {
-    device->metric   = (mTasks[task].device).metric;
+void GvsMpiTaskManager :: createScene( int imageNr, GvsDevice *device ) {
+    assert(imageNr >= 0 && imageNr < mNumImages);
+    const GvsDevice &imgDevice = mDevices[imageNr];
+
+    device->metric   = imgDevice.metric;
 
-    device->camera      = (mTasks[task].device).camera;
-    device->projector   = (mTasks[task].device).projector;
+    device->camera      = imgDevice.camera;
+    device->projector   = imgDevice.projector;
 
-    device->lightSrcMgr = (mTasks[task].device).lightSrcMgr;
-    device->sceneGraph  = (mTasks[task].device).sceneGraph;
+    device->lightSrcMgr = imgDevice.lightSrcMgr;
+    device->sceneGraph  = imgDevice.sceneGraph;
 
     // clear previous list because of copy operation
     if (!device->mChangeObj.empty()) {
         device->mChangeObj.clear();
     }
-    device->mChangeObj  = (mTasks[task].device).mChangeObj;
+    device->mChangeObj  = imgDevice.mChangeObj;
 
-    device->camEye = (mTasks[task].device).camEye;
+    device->camEye = imgDevice.camEye;
 
     // make changes
     device->makeChange();
@@ -287,8 +370,10 @@ void GvsMpiTaskManager :: Print ( FILE* fptr ) const {
     fprintf(fptr,"\nMpiTaskManager:   \n---------------\n");
     fprintf(fptr,"\tno devices:      %d\n",mNumDevices);
     fprintf(fptr,"\tno nodes/image:  %d\n",mNumNodesImage);
-    fprintf(fptr,"\tno tasks:        %d\n",mNumTasks);
+    fprintf(fptr,"\tno images:       %d\n",mNumImages);
+    fprintf(fptr,"\tno tasks:        %d\n",mScheduler.getNumTasks());
     fprintf(fptr,"\tscene file:      %s\n",inFileName.c_str());
     fprintf(fptr,"\timage file:      %s\n",outFileName.c_str());
     fprintf(fptr,"\n");
+    mScheduler.Print(fptr);
 }
@@ -19,13 +19,22 @@
 #ifndef MPI_TASK_MANAGER
 #define MPI_TASK_MANAGER
 
+#include <mutex>
 
 #include "Dev/GvsDevice.h"
 #include "Parser/GvsParser.h"
 #include "MpiUtils/GvsMpiDefs.h"
 #include "MpiUtils/MpiImage.h"
+#include "MpiUtils/MpiTileScheduler.h"
+#include "Utils/GvsProgress.h"
+#include "Utils/GvsRenderJournal.h"
 
 
+/**
+ * Task manager of the MPI master. Distributing tasks and inserting regions
+ * may happen on different threads; the scheduler and the image counters
+ * are protected by a mutex.
+ */
 class GvsMpiTaskManager
 {
   public:
@@ -37,24 +46,57 @@ class GvsMpiTaskManager
 
     void  setRenderDevice ( int renderdev );
 
+    /**
+     * Set tile sizes of the scheduler.
+     * @param tileSize     edge length of the initial tiles
+     * @param minTileSize  tiles are not split below this edge length
+     */
+    void  setTileSize     ( int tileSize, int minTileSize );
+
+    //! Gamma correction of the images; has to be set before initialize().
+    void  setGamma        ( double gamma );
+
+    /**
+     * Journal of finished regions and images; has to be set before initialize().
+     *   Images and regions that are finished according to the journal are
+     *   skipped. Only the master needs the journal.
+     */
+    void  setJournal      ( GvsRenderJournal* journal );
+
+    /**
+     * Progress of the whole job; inserted regions are counted.
+     * @param progress      progress or NULL
+     * @param reportFormat  "json" or "csv": write the timing of all regions
+     *                      of an image to '<image>.json|csv', empty: no report
+     */
+    void  setProgress     ( GvsProgress* progress, const std::string &reportFormat = "" );
+
+    /**
+     * Parse scene and split all images into tiles.
+     * @param numNodes       number of rendering nodes
+     * @param numNodesImage  minimum number of tiles per image
+     */
     virtual bool   initialize ( int numNodes, int numNodesImage );
 
     virtual void   getDevice  ( GvsDevice *device, unsigned int k = 0 );
 
-    void  createScene ( int task, GvsDevice *device );
+    void  createScene ( int imageNr, GvsDevice *device );
 
     int   getNumTasks          ( ) const;
-    void  activateTask         ( int task );
-    int   getNextAvailableTask ( int task ) const;
+    long  getNumPixelsLeft     ( ) const;
+    int   getNextTask          ( );
     void  getViewPort          ( int task, int &x1, int &y1, int &x2, int &y2) const;
     int   getImageNr           ( int task ) const;
 
-    void  insertRegion         ( int task, uchar* p, gvsData* data );
+    void  insertRegion         ( int task, uchar* p, gvsData* data, double seconds = -1.0, int node = 0 );
 
-    bool  writeImageFileIfPossible( int task, double gamma = 1.0 );
+    bool  writeImageFileIfPossible( int task );
     void  Print ( FILE* fptr = stderr ) const;
 
 
+  protected:
+    void  resumeImages ( );
+
   protected:
 
     GvsParser*   parser;
@@ -68,9 +110,16 @@ class GvsMpiTaskManager
     int          mStartDevice;
     int          mRenderDevice;
 
-    int          mNumTasks;
-    GvsMpiTask*  mTasks;
-
+    int          mNumImages;
+    GvsDevice*   mDevices;      //!< one device per image
+    GvsMpiTileScheduler  mScheduler;
+    mutable std::mutex   mMutex;
+    int          mTileSize;
+    int          mMinTileSize;
+    double       mGamma;
+    GvsRenderJournal*  mJournal;
+    GvsProgress*       mProgress;
+    std::string        mReportFormat;
 
     GvsMpiImage* mImage;
     int          mImageHeight;
@@ -0,0 +1,308 @@
+/**
+ * @file    MpiTileScheduler.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cassert>
+
+#include "GvsGlobalDefs.h"
+#include "MpiUtils/MpiTileScheduler.h"
+
+// A tile may cost at most the remaining work divided by (factor * number of workers).
+#define GVS_MPI_GUIDED_FACTOR   2.0
+
+
+static long tilePixels ( const GvsMpiTask &task ) {
+    return static_cast<long>(task.x2 - task.x1 + 1) * (task.y2 - task.y1 + 1);
+}
+
+
+GvsMpiTileScheduler::GvsMpiTileScheduler()
+    : mNumWorkers(1),
+      mTileSize(64),
+      mMinTileSize(8),
+      mWidth(0),
+      mHeight(0),
+      mNumSplits(0),
+      mCellsX(0),
+      mCellsY(0),
+      mSumSeconds(0.0),
+      mSumPixels(0) {
+}
+
+GvsMpiTileScheduler::~GvsMpiTileScheduler() {
+}
+
+
+void GvsMpiTileScheduler::setNumWorkers ( int numWorkers ) {
+    mNumWorkers = GVS_MAX(numWorkers,1);
+}
+
+void GvsMpiTileScheduler::setTileSize ( int tileSize, int minTileSize ) {
+    mMinTileSize = GVS_MAX(minTileSize,1);
+    mTileSize    = GVS_MAX(tileSize,mMinTileSize);
+}
+
+
+void GvsMpiTileScheduler::setImages ( int numImages, int width, int height ) {
+    assert(numImages >= 0 && width > 0 && height > 0);
+    mWidth  = width;
+    mHeight = height;
+    mNumSplits = 0;
+
+    mTasks.clear();
+    mWaiting.assign(numImages,std::deque<int>());
+    mNumTasksLeft.assign(numImages,0);
+    mPixelsLeft.assign(numImages,0);
+    mWaitingPixels.assign(numImages,0);
+
+    mCellsX = (mWidth  + mMinTileSize - 1) / mMinTileSize;
+    mCellsY = (mHeight + mMinTileSize - 1) / mMinTileSize;
+    mCellCost.assign(mCellsX*mCellsY,-1.0);
+    mSumSeconds = 0.0;
+    mSumPixels  = 0;
+
+    for (int image = 0; image < numImages; image++) {
+        for (int y = 0; y < mHeight; y += mTileSize) {
+            for (int x = 0; x < mWidth; x += mTileSize) {
+                int task = addTask(image, x, y, GVS_MIN(x + mTileSize, mWidth) - 1, GVS_MIN(y + mTileSize, mHeight) - 1);
+                mWaiting[image].push_back(task);
+                mNumTasksLeft[image]++;
+                mPixelsLeft[image]    += tilePixels(mTasks[task]);
+                mWaitingPixels[image] += tilePixels(mTasks[task]);
+            }
+        }
+    }
+}
+
+
+int GvsMpiTileScheduler::getNextTask() {
+    int image = selectImage();
+    if (image < 0) {
+        return -1;
+    }
+
+    int task = mWaiting[image].front();
+    mWaiting[image].pop_front();
+
+    // Split expensive tiles; the other parts are handed out next.
+    double maxCost = remainingCost() / (GVS_MPI_GUIDED_FACTOR * mNumWorkers);
+    while (estimateCost(mTasks[task]) > maxCost) {
+        if (splitTask(task) < 2) {
+            break;
+        }
+    }
+
+    mTasks[task].status = TASK_RUNNING;
+    mWaitingPixels[image] -= tilePixels(mTasks[task]);
+    return task;
+}
+
+
+void GvsMpiTileScheduler::finishTask ( int task, double seconds ) {
+    assert(task >= 0 && task < getNumTasks());
+    GvsMpiTask &t = mTasks[task];
+    if (t.status != TASK_RUNNING) {
+        return;
+    }
+    t.status  = TASK_FINISHED;
+    t.seconds = seconds;
+
+    mNumTasksLeft[t.imageNr]--;
+    mPixelsLeft[t.imageNr] -= tilePixels(t);
+    storeCost(t, seconds);
+}
+
+
+long GvsMpiTileScheduler::restoreRegion ( int image, int x1, int y1, int x2, int y2, double seconds ) {
+    assert(image >= 0 && image < getNumImages());
+    long pixels = 0;
+    std::deque<int> &waiting = mWaiting[image];
+
+    size_t k = 0;
+    while (k < waiting.size()) {
+        int task = waiting[k];
+        const GvsMpiTask &t = mTasks[task];
+        if (t.x2 < x1 || t.x1 > x2 || t.y2 < y1 || t.y1 > y2) {
+            k++;
+            continue;
+        }
+
+        if (t.x1 >= x1 && t.x2 <= x2 && t.y1 >= y1 && t.y2 <= y2) {
+            long tp = tilePixels(t);
+            double partSeconds = (seconds < 0.0) ? -1.0 : seconds * tp / (static_cast<long>(x2 - x1 + 1) * (y2 - y1 + 1));
+            mTasks[task].status  = TASK_FINISHED;
+            mTasks[task].seconds = partSeconds;
+            mNumTasksLeft[image]--;
+            mPixelsLeft[image]    -= tp;
+            mWaitingPixels[image] -= tp;
+            storeCost(mTasks[task], partSeconds);
+            waiting.erase(waiting.begin() + k);
+            pixels += tp;
+        }
+        else {
+            // the parts are queued in front of the task, so start again
+            if (splitTask(task) < 2) {
+                k++;
+            } else {
+                k = 0;
+            }
+        }
+    }
+    return pixels;
+}
+
+
+int GvsMpiTileScheduler::getNumTasks() const {
+    return static_cast<int>(mTasks.size());
+}
+
+int GvsMpiTileScheduler::getNumImages() const {
+    return static_cast<int>(mWaiting.size());
+}
+
+int GvsMpiTileScheduler::getNumTasksLeft ( int image ) const {
+    assert(image >= 0 && image < getNumImages());
+    return mNumTasksLeft[image];
+}
+
+long GvsMpiTileScheduler::getNumPixelsLeft() const {
+    long pixels = 0;
+    for (int i = 0; i < getNumImages(); i++) {
+        pixels += mPixelsLeft[i];
+    }
+    return pixels;
+}
+
+const GvsMpiTask& GvsMpiTileScheduler::getTask ( int task ) const {
+    assert(task >= 0 && task < getNumTasks());
+    return mTasks[task];
+}
+
+
+double GvsMpiTileScheduler::estimateCost ( const GvsMpiTask &task ) const {
+    double cost = 0.0;
+    for (int cy = task.y1 / mMinTileSize; cy <= task.y2 / mMinTileSize; cy++) {
+        int h = GVS_MIN(task.y2, (cy + 1)*mMinTileSize - 1) - GVS_MAX(task.y1, cy*mMinTileSize) + 1;
+        for (int cx = task.x1 / mMinTileSize; cx <= task.x2 / mMinTileSize; cx++) {
+            int w = GVS_MIN(task.x2, (cx + 1)*mMinTileSize - 1) - GVS_MAX(task.x1, cx*mMinTileSize) + 1;
+            cost += costPerPixel(cx, cy) * w * h;
+        }
+    }
+    return cost;
+}
+
+
+void GvsMpiTileScheduler::Print ( FILE* fptr ) const {
+    fprintf(fptr,"MpiTileScheduler {\n");
+    fprintf(fptr,"\ttile size:      %d (min %d)\n",mTileSize,mMinTileSize);
+    fprintf(fptr,"\t# images:       %d\n",getNumImages());
+    fprintf(fptr,"\t# tasks:        %d\n",getNumTasks());
+    fprintf(fptr,"\t# splits:       %d\n",mNumSplits);
+    fprintf(fptr,"\ttime per pixel: %g s\n",meanCostPerPixel());
+    fprintf(fptr,"}\n");
+}
+
+
+int GvsMpiTileScheduler::addTask ( int image, int x1, int y1, int x2, int y2 ) {
+    GvsMpiTask task;
+    task.status  = TASK_WAITING;
+    task.x1      = x1;
+    task.y1      = y1;
+    task.x2      = x2;
+    task.y2      = y2;
+    task.imageNr = image;
+    task.seconds = -1.0;
+    mTasks.push_back(task);
+    return getNumTasks() - 1;
+}
+
+
+int GvsMpiTileScheduler::splitTask ( int task ) {
+    GvsMpiTask t = mTasks[task];
+    int w = t.x2 - t.x1 + 1;
+    int h = t.y2 - t.y1 + 1;
+
+    // Split positions are multiples of the minimum tile size to match the cost map.
+    int xs[3] = { t.x1, t.x2 + 1, t.x2 + 1 };
+    int ys[3] = { t.y1, t.y2 + 1, t.y2 + 1 };
+    int nx = 1;
+    int ny = 1;
+    if (w >= 2*mMinTileSize) {
+        xs[1] = t.x1 + GVS_MAX(mMinTileSize, (w/2 / mMinTileSize) * mMinTileSize);
+        nx = 2;
+    }
+    if (h >= 2*mMinTileSize) {
+        ys[1] = t.y1 + GVS_MAX(mMinTileSize, (h/2 / mMinTileSize) * mMinTileSize);
+        ny = 2;
+    }
+    if (nx*ny < 2) {
+        return 1;
+    }
+
+    // The task itself becomes the first part; the others are queued in front.
+    for (int j = ny - 1; j >= 0; j--) {
+        for (int i = nx - 1; i >= 0; i--) {
+            if (i == 0 && j == 0) {
+                continue;
+            }
+            int part = addTask(t.imageNr, xs[i], ys[j], xs[i+1] - 1, ys[j+1] - 1);
+            mWaiting[t.imageNr].push_front(part);
+        }
+    }
+    mTasks[task].x2 = xs[1] - 1;
+    mTasks[task].y2 = ys[1] - 1;
+
+    mNumTasksLeft[t.imageNr] += nx*ny - 1;
+    mNumSplits++;
+    return nx*ny;
+}
+
+
+void GvsMpiTileScheduler::storeCost ( const GvsMpiTask &task, double seconds ) {
+    if (seconds < 0.0) {
+        return;
+    }
+    long pixels = tilePixels(task);
+    mSumSeconds += seconds;
+    mSumPixels  += pixels;
+
+    double cost = seconds / pixels;
+    for (int cy = task.y1 / mMinTileSize; cy <= task.y2 / mMinTileSize; cy++) {
+        for (int cx = task.x1 / mMinTileSize; cx <= task.x2 / mMinTileSize; cx++) {
+            mCellCost[cy*mCellsX + cx] = cost;
+        }
+    }
+}
+
+
+int GvsMpiTileScheduler::selectImage() const {
+    int image = -1;
+    for (int i = 0; i < getNumImages(); i++) {
+        if (mWaiting[i].empty()) {
+            continue;
+        }
+        if (image < 0 || mPixelsLeft[i] < mPixelsLeft[image]) {
+            image = i;
+        }
+    }
+    return image;
+}
+
+
+double GvsMpiTileScheduler::costPerPixel ( int cellX, int cellY ) const {
+    double cost = mCellCost[cellY*mCellsX + cellX];
+    return (cost < 0.0) ? meanCostPerPixel() : cost;
+}
+
+double GvsMpiTileScheduler::meanCostPerPixel() const {
+    return (mSumPixels > 0) ? mSumSeconds / mSumPixels : 1.0;
+}
+
+double GvsMpiTileScheduler::remainingCost() const {
+    long pixels = 0;
+    for (int i = 0; i < getNumImages(); i++) {
+        pixels += mWaitingPixels[i];
+    }
+    return pixels * meanCostPerPixel();
+}
@@ -0,0 +1,115 @@
+/**
+ * @file    MpiTileScheduler.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef MPI_TILE_SCHEDULER
+#define MPI_TILE_SCHEDULER
+
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include "MpiUtils/GvsMpiDefs.h"
+
+/**
+ * Dynamic scheduler for the tiles of several images of equal resolution.
+ *
+ *   The images are split into square tiles which are handed out first-come-
+ *   first-served. Tiles are taken from the image that is closest to completion,
+ *   so that images are finished and written one after the other.
+ *
+ *   The measured rendering time of every finished tile is stored in a cost map
+ *   with a cell size of the minimum tile size. The cost map is shared by all
+ *   images because consecutive images of an animation are similar. Before a
+ *   tile is handed out, its cost is estimated from the cost map. If the tile is
+ *   more expensive than the remaining work divided among the workers (guided
+ *   self-scheduling), it is split into quarters until it is cheap enough or
+ *   reaches the minimum tile size.
+ */
+class GvsMpiTileScheduler
+{
+  public:
+    GvsMpiTileScheduler();
+    virtual ~GvsMpiTileScheduler();
+
+    void   setNumWorkers ( int numWorkers );
+
+    /**
+     * Set tile sizes.
+     * @param tileSize     edge length of the initial tiles
+     * @param minTileSize  tiles are not split below this edge length
+     */
+    void   setTileSize   ( int tileSize, int minTileSize );
+
+    /**
+     * Split all images into initial tiles.
+     * @param numImages  number of images
+     * @param width      width of every image
+     * @param height     height of every image
+     */
+    void   setImages     ( int numImages, int width, int height );
+
+    /**
+     * Get the next task and mark it as running.
+     * @return task id or -1 if no task is waiting
+     */
+    int    getNextTask   ( );
+
+    /**
+     * Mark task as finished and store its cost.
+     * @param task     task id
+     * @param seconds  measured rendering time, negative if unknown
+     */
+    void   finishTask    ( int task, double seconds );
+
+    /**
+     * Mark a region finished by a previous run as done (see GvsRenderJournal).
+     *   Waiting tiles within the region are finished, tiles that overlap the
+     *   region partly are split as far as possible. Call before getNextTask.
+     * @return number of finished pixels
+     */
+    long   restoreRegion ( int image, int x1, int y1, int x2, int y2, double seconds );
+
+    int    getNumTasks     ( ) const;
+    int    getNumImages    ( ) const;
+    int    getNumTasksLeft ( int image ) const;   //!< waiting and running tasks of image
+    long   getNumPixelsLeft ( ) const;            //!< pixels of waiting and running tasks of all images
+    const GvsMpiTask&  getTask ( int task ) const;
+
+    //! Estimated rendering time of the task in seconds (arbitrary units without measurements).
+    double estimateCost  ( const GvsMpiTask &task ) const;
+
+    void   Print ( FILE* fptr = stderr ) const;
+
+  protected:
+    int    addTask        ( int image, int x1, int y1, int x2, int y2 );
+    int    splitTask      ( int task );
+    void   storeCost      ( const GvsMpiTask &task, double seconds );
+    int    selectImage    ( ) const;
+    double costPerPixel   ( int cellX, int cellY ) const;
+    double meanCostPerPixel ( ) const;
+    double remainingCost  ( ) const;
+
+  protected:
+    int  mNumWorkers;
+    int  mTileSize;
+    int  mMinTileSize;
+    int  mWidth;
+    int  mHeight;
+    int  mNumSplits;
+
+    std::vector<GvsMpiTask>       mTasks;
+    std::vector<std::deque<int> > mWaiting;         //!< waiting tasks per image
+    std::vector<int>              mNumTasksLeft;    //!< waiting and running tasks per image
+    std::vector<long>             mPixelsLeft;      //!< pixels of waiting and running tasks per image
+    std::vector<long>             mWaitingPixels;   //!< pixels of waiting tasks per image
+
+    int                  mCellsX;
+    int                  mCellsY;
+    std::vector<double>  mCellCost;      //!< seconds per pixel, negative if not measured yet
+    double               mSumSeconds;
+    long                 mSumPixels;
+};
+
+#endif
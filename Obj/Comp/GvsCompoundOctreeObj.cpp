@@ -17,15 +17,34 @@
 //  along with GeoViS.  If not, see <http://www.gnu.org/licenses/>.
 // ---------------------------------------------------------------------
 
+#include <deque>
 #include <iostream>
 #include "Obj/Comp/GvsCompoundOctreeObj.h"
 
+/**
+ * Scratch buffers of the run collection in testIntersection.
+ *   Between two rays all run entries are -1; only the entries of the touched
+ *   objects are reset. Nested compound objects use the buffers of their own
+ *   nesting level.
+ */
+struct GvsOctreeScratch {
+    std::vector<int>  runStart;
+    std::vector<int>  runEnd;
+    std::vector<unsigned int>     touched;
+    std::vector<const GvsOctree*> leaves;
+};
+
+static thread_local std::deque<GvsOctreeScratch>  gvsOctreeScratch;
+static thread_local unsigned int                  gvsOctreeDepth = 0;
+
 GvsCompoundOctreeObj :: GvsCompoundOctreeObj() : GvsSceneObj() {
     mOctree.setBounds(0.0, 0.0, 0.0, 1.0, 1.0, 1.0);
     mNumSubDivs = 0;
 
     objList  = new GvsObjPtrList();
     mNumObjects = 0;
+    mIsSorted = false;
+    mSortedChange = 0;
 }
 
 GvsCompoundOctreeObj::~GvsCompoundOctreeObj() {
@@ -42,6 +61,7 @@ void GvsCompoundOctreeObj::Add( GvsSceneObj *obj ) {
     objList->Add(obj);
     compBoundBox += obj->boundingBox();
     mNumObjects = objList->length();
+    mIsSorted = false;
 }
 
 
@@ -57,16 +77,90 @@ unsigned int GvsCompoundOctreeObj::getNumObjs() const {
 }
 
 bool GvsCompoundOctreeObj::testIntersection(GvsRay &ray) {
-    int i;
-    GvsSceneObj* obj;
+    // Objects are sorted at the first test because the parameters of the
+    // objects are set by the device only right before rendering. The device
+    // may move or resize the objects for every frame.
+    unsigned int changeCount = GvsSceneObj::getSceneChangeCount();
+    if (!mIsSorted || mSortedChange != changeCount) {
+        std::lock_guard<std::mutex> lock(mSortMutex);
+        if (!mIsSorted || mSortedChange != changeCount) {
+            sortObjects();
+            mSortedChange = changeCount;
+            mIsSorted = true;
+        }
+    }
+
+    int startSeg = ray.getStartSegment();
+    int endSeg   = ray.getEndSegment();
+
     bool intersecFound = false;
-    for (i = 0; i < (objList->length()); i++ ) {
-        obj = objList->getObj(i);
-        if (obj!=nullptr) {
-            bool result = obj->testIntersection(ray);
-            intersecFound = intersecFound || result;
+    for(unsigned int i = 0; i < mAlwaysTested.size(); i++) {
+        bool result = testObject(ray, mAlwaysTested[i], startSeg, endSeg);
+        intersecFound = intersecFound || result;
+    }
+    if (mAlwaysTested.size() == mNumObjects) {
+        return intersecFound;
+    }
+
+    // Every object collects the contiguous run of segments touching its leaves.
+    // A run is tested as soon as it is interrupted.
+    if (gvsOctreeScratch.size() <= gvsOctreeDepth) {
+        gvsOctreeScratch.resize(gvsOctreeDepth + 1);
+    }
+    GvsOctreeScratch &scratch = gvsOctreeScratch[gvsOctreeDepth++];
+    std::vector<int> &runStart = scratch.runStart;
+    std::vector<int> &runEnd   = scratch.runEnd;
+    std::vector<unsigned int> &touched = scratch.touched;
+    std::vector<const GvsOctree*> &leaves = scratch.leaves;
+    if (runStart.size() < mNumObjects) {
+        runStart.resize(mNumObjects, -1);
+        runEnd.resize(mNumObjects, -1);
+    }
+    touched.clear();
+
+    for(int seg = startSeg; seg < endSeg; seg++) {
+        m4d::vec4 p0, p1;
+        int chart0, chart1;
+        ray.getPseudoCartSegment(seg, p0, p1, chart0, chart1);
+
+        m4d::vec3 lower, upper;
+        for(int d = 0; d < 3; d++) {
+            lower.setX(d, GVS_MIN(p0.x(d+1), p1.x(d+1)));
+            upper.setX(d, GVS_MAX(p0.x(d+1), p1.x(d+1)));
         }
+
+        leaves.clear();
+        mOctree.findLeaves(lower, upper, leaves);
+        for(unsigned int l = 0; l < leaves.size(); l++) {
+            const std::vector<unsigned int> &nums = leaves[l]->objNums;
+            for(unsigned int k = 0; k < nums.size(); k++) {
+                unsigned int num = nums[k];
+                if (runEnd[num] == seg) {
+                    continue;
+                }
+                if (runEnd[num] == seg-1 && runStart[num] >= 0) {
+                    runEnd[num] = seg;
+                    continue;
+                }
+                if (runStart[num] >= 0) {
+                    bool result = testObject(ray, num, runStart[num], runEnd[num]+1);
+                    intersecFound = intersecFound || result;
+                }
+                else {
+                    touched.push_back(num);
+                }
+                runStart[num] = runEnd[num] = seg;
+            }
+        }
+    }
+
+    for(unsigned int i = 0; i < touched.size(); i++) {
+        unsigned int num = touched[i];
+        bool result = testObject(ray, num, runStart[num], runEnd[num]+1);
+        intersecFound = intersecFound || result;
+        runStart[num] = runEnd[num] = -1;
     }
+    gvsOctreeDepth--;
     return intersecFound;
 }
 
@@ -92,6 +186,7 @@ void GvsCompoundOctreeObj::Print( FILE* fptr ) {
 
 void GvsCompoundOctreeObj::setBounds(m4d::vec3 lower, m4d::vec3 upper) {
     mOctree.setBounds(lower, upper);
+    mIsSorted = false;
 }
 
 
@@ -99,5 +194,56 @@ void GvsCompoundOctreeObj::subDivide(int numSubDivs) {
     if (numSubDivs >= 0) {
         mNumSubDivs = numSubDivs;
         mOctree.createSons(numSubDivs);
+        mIsSorted = false;
+    }
+}
+
+
+void GvsCompoundOctreeObj::sortObjects() {
+    mOctree.clearObjects();
+    mAlwaysTested.clear();
+
+    for(unsigned int num = 0; num < mNumObjects; num++) {
+        GvsSceneObj* obj = objList->getObj(num);
+        if (obj == nullptr) {
+            continue;
+        }
+        m4d::vec3 lower, upper;
+        if (!isCullable(obj, lower, upper)) {
+            mAlwaysTested.push_back(num);
+            continue;
+        }
+        mOctree.insert(num, lower, upper);
+    }
+}
+
+
+bool GvsCompoundOctreeObj::isCullable(GvsSceneObj* obj, m4d::vec3 &lower, m4d::vec3 &upper) const {
+    if (!obj->getRayCullBox(lower, upper)) {
+        return false;
     }
+
+    m4d::vec3 octLower = mOctree.box.lowBounds();
+    m4d::vec3 octUpper = mOctree.box.uppBounds();
+    for(int d = 0; d < 3; d++) {
+        if (lower.x(d) < octLower.x(d) || upper.x(d) > octUpper.x(d)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool GvsCompoundOctreeObj::testObject(GvsRay &ray, unsigned int num, int startSeg, int endSeg) {
+    GvsSceneObj* obj = objList->getObj(num);
+    if (obj == nullptr) {
+        return false;
+    }
+
+    int oldStartSeg, oldEndSeg;
+    ray.getSegmentWindow(oldStartSeg, oldEndSeg);
+    ray.setSegmentWindow(startSeg, endSeg);
+    bool result = obj->testIntersection(ray);
+    ray.setSegmentWindow(oldStartSeg, oldEndSeg);
+    return result;
 }
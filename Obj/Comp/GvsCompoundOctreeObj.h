@@ -28,6 +28,10 @@
 #include "Obj/STMotion/GvsStMotion.h"
 #include "Ray/GvsRay.h"
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 
 class GvsCompoundOctreeObj : public GvsSceneObj
 {
@@ -41,6 +45,14 @@ public:
     unsigned int getNumObjs () const;
 
 
+    /**
+     * Test ray for intersections with the objects.
+     *   Each ray segment is mapped to pseudo-Cartesian coordinates. Only those
+     *   objects whose octree leaves are touched by the segment's bounding box
+     *   are tested for this segment.
+     * @param ray  reference to ray
+     * @return true if an intersection was found
+     */
     virtual bool testIntersection(GvsRay &ray);
 
     virtual GvsBoundBox    boundingBox    ( ) const;
@@ -51,12 +63,29 @@ public:
     virtual void Print( FILE* fptr = stderr );
 
 
+protected:
+    /**
+     * Sort objects into the octree leaves.
+     *   Objects without a box for ray culling (see GvsSceneObj::getRayCullBox)
+     *   and objects not completely inside the octree are always tested.
+     */
+    void sortObjects();
+
+    bool isCullable(GvsSceneObj* obj, m4d::vec3 &lower, m4d::vec3 &upper) const;
+
+    bool testObject(GvsRay &ray, unsigned int num, int startSeg, int endSeg);
+
 protected:
     GvsOctree  mOctree;
     int        mNumSubDivs;
     GvsBoundBox     compBoundBox;  // Bounding Box with respect to local frame
     GvsObjPtrList*  objList;
     unsigned int    mNumObjects;
+
+    std::vector<unsigned int>  mAlwaysTested;   //!< Objects that are not sorted into the octree
+    std::atomic<bool>          mIsSorted;
+    std::atomic<unsigned int>  mSortedChange;   //!< Scene change count at the last sort
+    std::mutex                 mSortMutex;
 };
 
 
@@ -19,6 +19,7 @@
 
 #include "Obj/Comp/GvsLocalCompObj.h"
 #include "Obj/STMotion/GvsStMotionGeodesic.h"
+#include "Utils/GvsStatistics.h"
 
 #include "metric/m4dMetric.h"
 
@@ -188,10 +189,14 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
     bool result;
     bool intersecFound = false;
 
+    // The metric of the ray belongs to the thread which traces the ray,
+    // whereas the metric of the local tetrad is shared by all threads.
+    m4d::Metric* rayMetric = ray.getMetric();
+
     if (!haveMotion) {
         // locT0    = stMotion->getLocalTetrad(0);
         locT0    = staticTetrad;
-        stMetric = locT0->getMetric();       // metric at position of local tetrad
+        stMetric = (rayMetric != NULL) ? rayMetric : locT0->getMetric();       // metric at position of local tetrad
         pos      = locT0->getPosition();     // position of the local tetrad
 
         box0 = (locT0->getSTBoundBox())->uppBounds();
@@ -199,9 +204,8 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
 
         locT1 = locT0;
 
-        int maxSeg   = ray.getNumPoints()-2;
-        int startSeg = int(0);
-        int endSeg   = maxSeg;
+        int startSeg = ray.getStartSegment();
+        int endSeg   = ray.getEndSegment();
 
         for (int seg = startSeg; seg < endSeg; seg++) {
             m4d::vec4 p0 = ray.getPoint(seg);
@@ -220,6 +224,7 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
 
                 for(int i = 0; i < (objList->length()); i++ ) {
                     obj = objList->getObj(i);
+                    GvsStatistics::countSegmentTest(obj);
                     result = obj->testLocalIntersection(ray,seg,locT0,locT1,p0loc,p1loc);
                     intersecFound = intersecFound || result;
                 }
@@ -230,9 +235,8 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
         // local object in motion
         assert(stMotion!=NULL);
 
-        int maxSeg   = ray.getNumPoints()-2;
-        int startSeg = int(0);
-        int endSeg   = maxSeg;
+        int startSeg = ray.getStartSegment();
+        int endSeg   = ray.getEndSegment();
 
         int numMotionPos = stMotion->getNumPositions();
 
@@ -253,7 +257,7 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
             }
             //localTime0 = stMotion->getLocalTime(num0);
 
-            stMetric = locT0->getMetric();
+            stMetric = (rayMetric != NULL) ? rayMetric : locT0->getMetric();
             pos      = locT0->getPosition();
 
             if (!stMetric->calcSepDist( pos,p0,spaceDist0,timeDist0)) {
@@ -274,10 +278,9 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
             {
                 if ((num0+1) >= numMotionPos)
                 {
-                    if ( mPointsWarning )
+                    if ( mPointsWarning.exchange(false) )
                     {
                         std::cerr << "Motion has not enough points !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
-                        mPointsWarning = false;
                         continue;
                     }
                    // localTime1 = localTime0;
@@ -290,7 +293,7 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
                 }
             }
 
-            stMetric = locT1->getMetric();
+            stMetric = (rayMetric != NULL) ? rayMetric : locT1->getMetric();
             pos      = locT1->getPosition();
 
             if (!stMetric->calcSepDist( pos,p1,spaceDist1,timeDist1)) {
@@ -315,6 +318,7 @@ bool GvsLocalCompObj :: testIntersection( GvsRay &ray ) {
 
                 for(int i = 0; i < (objList->length()); i++ ) {
                     obj = objList->getObj(i);
+                    GvsStatistics::countSegmentTest(obj);
                     result = obj->testLocalIntersection(ray,seg,locT0,locT1,p0loc,p1loc);
                     intersecFound = intersecFound || result;
                 }
@@ -27,6 +27,7 @@
 #include <Obj/GvsSceneObj.h>
 #include <Obj/STMotion/GvsStMotion.h>
 #include <Ray/GvsRay.h>
+#include <atomic>
 #include <iostream>
 
 
@@ -72,7 +73,7 @@ protected:
     GvsObjPtrList*   objList;
     int              mNumObjects;
 
-    bool             mPointsWarning;
+    std::atomic<bool> mPointsWarning;  // tested by all worker threads
     
     // (Moving) time box size
     // ... can be very crucial for particular spacetimes and motion (e.g. Kerr)
@@ -6,6 +6,8 @@
  */
 #include "GvsBase.h"
 
+#include "metric/m4dMetricDatabase.h"
+
 int GvsBase::mObjCounter = 0;
 
 GvsBase::GvsBase()
@@ -571,6 +573,39 @@ void Gvsm4dMetricDummy::Print(FILE* fptr)
     fprintf(fptr, "\n");
 }
 
+m4d::Metric* Gvsm4dMetricDummy::cloneMetric(m4d::Metric* metric)
+{
+    if (metric == nullptr) {
+        return nullptr;
+    }
+
+    m4d::MetricDatabase md;
+    m4d::MetricList::enum_metric nr = md.getMetricNr(metric->getMetricName());
+    if (nr == m4d::MetricList::enum_metric_unknown) {
+        return nullptr;
+    }
+
+    m4d::Metric* newMetric = md.getMetric(nr);
+    if (newMetric != nullptr) {
+        copyParams(metric, newMetric);
+    }
+    return newMetric;
+}
+
+bool Gvsm4dMetricDummy::copyParams(m4d::Metric* src, m4d::Metric* dst)
+{
+    bool isOkay = true;
+    std::vector<std::string> paramNames;
+    src->getParamNames(paramNames);
+    for (unsigned int i = 0; i < paramNames.size(); i++) {
+        double val;
+        if (src->getParam(paramNames[i].c_str(), val) && !dst->setParam(paramNames[i].c_str(), val)) {
+            isOkay = false;
+        }
+    }
+    return isOkay;
+}
+
 Gvsm4dMetricDummy::~Gvsm4dMetricDummy()
 {
     // delete m4dMetric;
@@ -106,6 +106,23 @@ public:
     virtual int SetParam(std::string pName, double val);
     virtual bool GetParam(std::string pName, double& val);
     virtual void Print(FILE* fptr = stderr);
+
+    /**
+     * Create a new instance of the same metric type with the same parameters.
+     *   Metrics cache their coefficients while evaluating, hence every thread
+     *   needs its own metric instance. The caller owns the new metric.
+     * @param metric  pointer to metric
+     * @return pointer to new metric, or nullptr if the metric is unknown
+     */
+    static m4d::Metric* cloneMetric(m4d::Metric* metric);
+
+    /**
+     * Copy all parameters of one metric to another metric of the same type.
+     * @param src  pointer to source metric
+     * @param dst  pointer to destination metric
+     * @return false if one of the parameters could not be set
+     */
+    static bool copyParams(m4d::Metric* src, m4d::Metric* dst);
 };
 
 #endif
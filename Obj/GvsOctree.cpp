@@ -12,12 +12,19 @@ GvsOctree::GvsOctree() {
     }
 }
 
+GvsOctree::~GvsOctree() {
+    deleteSons();
+}
+
 
 void GvsOctree::createSons(GvsOctree* t, int maxSubDivs) {
     if (t->lod >= maxSubDivs) {
         return;
     }
 
+    t->deleteSons();
+    t->objNums.clear();
+
     long llid = lower(t->id);
     for(int c=0; c < 8; c++) {
         t->son[c] = new GvsOctree();
@@ -71,10 +78,6 @@ void GvsOctree::createSons(GvsOctree* t, int maxSubDivs) {
             mid(ll[0],ur[0]), mid(ll[1],ur[1]), mid(ll[2],ur[2]),
             ur[0], ur[1], ur[2]);
 
-    for(int c=0; c < 8; c++) {
-        t->son[c]->box.Print();
-    }
-
     for(int c=0; c < 8; c++) {
         createSons(t->son[c], maxSubDivs);
     }
@@ -84,6 +87,69 @@ void GvsOctree::createSons(int maxSubDivs) {
     createSons(this, maxSubDivs);
 }
 
+void GvsOctree::deleteSons() {
+    for(int c=0; c < 8; c++) {
+        delete son[c];
+        son[c] = nullptr;
+    }
+}
+
+
+bool GvsOctree::isLeaf() const {
+    return (son[0] == nullptr);
+}
+
+
+void GvsOctree::insert(unsigned int num, const m4d::vec3& lower, const m4d::vec3& upper) {
+    if (!overlaps(lower, upper)) {
+        return;
+    }
+    if (isLeaf()) {
+        objNums.push_back(num);
+        return;
+    }
+    for(int c=0; c < 8; c++) {
+        son[c]->insert(num, lower, upper);
+    }
+}
+
+
+void GvsOctree::findLeaves(const m4d::vec3& lower, const m4d::vec3& upper, std::vector<const GvsOctree*>& leaves) const {
+    if (!overlaps(lower, upper)) {
+        return;
+    }
+    if (isLeaf()) {
+        if (!objNums.empty()) {
+            leaves.push_back(this);
+        }
+        return;
+    }
+    for(int c=0; c < 8; c++) {
+        son[c]->findLeaves(lower, upper, leaves);
+    }
+}
+
+
+void GvsOctree::clearObjects() {
+    objNums.clear();
+    if (!isLeaf()) {
+        for(int c=0; c < 8; c++) {
+            son[c]->clearObjects();
+        }
+    }
+}
+
+
+bool GvsOctree::overlaps(const m4d::vec3& lower, const m4d::vec3& upper) const {
+    // Boxes that only touch each other do overlap; planar objects have flat boxes.
+    for(int d=0; d < 3; d++) {
+        if (upper.x(d) < box.lowBounds().x(d) || lower.x(d) > box.uppBounds().x(d)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 
 long GvsOctree::lower(long id) {
     return (id << 3);
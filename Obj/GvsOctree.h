@@ -21,6 +21,7 @@
 
 #include <iostream>
 #include <float.h>
+#include <vector>
 
 #include "GvsGlobalDefs.h"
 #include "GvsBoundBox.h"
@@ -30,9 +31,34 @@ class GvsOctree {
 
 public:
     GvsOctree();
+    ~GvsOctree();
 
     void createSons(GvsOctree* t, int maxSubDivs);
     void createSons(int maxSubDivs);
+    void deleteSons();
+
+    bool isLeaf() const;
+
+    /**
+     * Insert the object number into all leaves that overlap the box.
+     * @param num     number of the object
+     * @param lower   lower bounds of the object's box
+     * @param upper   upper bounds of the object's box
+     */
+    void insert(unsigned int num, const m4d::vec3& lower, const m4d::vec3& upper);
+
+    /**
+     * Collect all leaves that overlap the box.
+     * @param lower   lower bounds of the box
+     * @param upper   upper bounds of the box
+     * @param leaves  list of leaves the leaves are appended to
+     */
+    void findLeaves(const m4d::vec3& lower, const m4d::vec3& upper, std::vector<const GvsOctree*>& leaves) const;
+
+    //! Remove all object numbers from the tree.
+    void clearObjects();
+
+    bool overlaps(const m4d::vec3& lower, const m4d::vec3& upper) const;
 
     static long super(long id);
     static long lower(long id);
@@ -50,6 +76,7 @@ public:
     long  id;
     GvsBoundBox box;
     GvsOctree* son[8];
+    std::vector<unsigned int> objNums;   //!< Objects overlapping this leaf
 };
 
 
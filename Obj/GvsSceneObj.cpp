@@ -19,6 +19,8 @@
 
 #include "Obj/GvsSceneObj.h"
 
+std::atomic<unsigned int> GvsSceneObj::mSceneChangeCount(0);
+
 GvsSceneObj::GvsSceneObj() {
     mObjType = local;
     mMetric  = nullptr;
@@ -78,6 +80,35 @@ GvsStMotion* GvsSceneObj :: getMotion ( void ) const {
     return stMotion;
 }
 
+
+bool GvsSceneObj :: getRayCullBox ( m4d::vec3 &lower, m4d::vec3 &upper ) const {
+    if (mObjType != inCoords || haveMotion) {
+        return false;
+    }
+
+    GvsBoundBox box = boundingBox();
+    lower = box.lowBounds();
+    upper = box.uppBounds();
+
+    bool isPoint = true;
+    for(int d = 0; d < 3; d++) {
+        if (!(lower.x(d) <= upper.x(d))) {
+            return false;
+        }
+        isPoint = isPoint && (lower.x(d) == upper.x(d));
+    }
+    // A box that shrinks to a point has never been set.
+    return !isPoint;
+}
+
+void GvsSceneObj :: countSceneChange ( ) {
+    mSceneChangeCount++;
+}
+
+unsigned int GvsSceneObj :: getSceneChangeCount ( ) {
+    return mSceneChangeCount;
+}
+
 bool GvsSceneObj :: testIntersection(GvsRay&) {
     std::cerr << "Error in GvsSceneObj::testIntersection(GvsRay&): not implemented." << std::endl;
     return false;
@@ -19,6 +19,7 @@
 #ifndef GVS_SCENE_OBJ_h
 #define GVS_SCENE_OBJ_h
 
+#include <atomic>
 #include <iostream>
 
 #include "Obj/GvsBoundBox.h"
@@ -61,6 +62,20 @@ public:
 
     virtual GvsBoundBox  boundingBox ( ) const = 0;
 
+    /**
+     * Bounding box in pseudo-Cartesian coordinates used to skip ray segments.
+     *   The box must enclose the object as it is tested in 'testIntersection'.
+     * @return false if the object cannot be bounded this way, e.g. if it moves
+     */
+    virtual bool         getRayCullBox ( m4d::vec3 &lower, m4d::vec3 &upper ) const;
+
+    /**
+     * Count a change of the parameters of the scene, e.g. by the device for a new frame.
+     *   Objects that sort their children by position compare the count to sort them again.
+     */
+    static void          countSceneChange    ( );
+    static unsigned int  getSceneChangeCount ( );
+
     virtual bool testIntersection      ( GvsRay &ray );
     virtual bool testLocalIntersection ( GvsRay &ray, const int seg,
                                          GvsLocalTetrad* lt0, GvsLocalTetrad* lt1,
@@ -74,6 +89,9 @@ protected:
     GvsStMotion*  stMotion;         // Bewegung des Objekts
     bool          haveMotion;
     int           numPositions;
+
+private:
+    static std::atomic<unsigned int>  mSceneChangeCount;
 };
 
 #endif
@@ -0,0 +1,358 @@
+/**
+ * @file    GvsMeshBVH.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Obj/MeshObj/GvsMeshBVH.h"
+
+#define GVS_BVH_NUM_BINS       16
+#define GVS_BVH_MAX_LEAF_SIZE  4
+#define GVS_BVH_MAX_DEPTH      48
+#define GVS_BVH_BOX_EPS        1e-9
+
+static double boxArea ( const double* bmin, const double* bmax ) {
+    double dx = bmax[0] - bmin[0];
+    double dy = bmax[1] - bmin[1];
+    double dz = bmax[2] - bmin[2];
+    if (dx < 0.0 || dy < 0.0 || dz < 0.0) {
+        return 0.0;
+    }
+    return 2.0*(dx*dy + dy*dz + dz*dx);
+}
+
+static void boxReset ( double* bmin, double* bmax ) {
+    for (int k = 0; k < 3; k++) {
+        bmin[k] =  DBL_MAX;
+        bmax[k] = -DBL_MAX;
+    }
+}
+
+static void boxExtend ( double* bmin, double* bmax, const m4d::vec3 &pt ) {
+    for (int k = 0; k < 3; k++) {
+        bmin[k] = GVS_MIN(bmin[k], pt.x(k));
+        bmax[k] = GVS_MAX(bmax[k], pt.x(k));
+    }
+}
+
+
+GvsMeshBVH::GvsMeshBVH() {
+}
+
+GvsMeshBVH::~GvsMeshBVH() {
+    clear();
+}
+
+void GvsMeshBVH::clear() {
+    mNodes.clear();
+    mTriangles.clear();
+    mCentroids.clear();
+}
+
+
+void GvsMeshBVH::build ( const std::vector<gvs_bvh_triangle_t> &triangles ) {
+    clear();
+    if (triangles.empty()) {
+        return;
+    }
+
+    mTriangles = triangles;
+    int num = static_cast<int>(mTriangles.size());
+
+    mCentroids.resize(num);
+    for (int i = 0; i < num; i++) {
+        const gvs_bvh_triangle_t &tri = mTriangles[i];
+        mCentroids[i] = tri.A + (1.0/3.0)*(tri.u + tri.v);
+    }
+
+    mNodes.reserve(2*num);
+    buildNode(0, num, 0);
+
+    // centroids are only needed during construction
+    std::vector<m4d::vec3>().swap(mCentroids);
+}
+
+
+bool GvsMeshBVH::isEmpty() const {
+    return mNodes.empty();
+}
+
+int GvsMeshBVH::numNodes() const {
+    return static_cast<int>(mNodes.size());
+}
+
+int GvsMeshBVH::numTriangles() const {
+    return static_cast<int>(mTriangles.size());
+}
+
+
+bool GvsMeshBVH::intersect ( const m4d::vec3 &p0, const m4d::vec3 &p1,
+                             double &alpha, double &r, double &s, int &faceID ) const {
+    alpha  = 1.0;
+    faceID = -1;
+    if (mNodes.empty()) {
+        return false;
+    }
+
+    m4d::vec3 d = p1 - p0;
+
+    double orig[3], invDir[3];
+    bool   isParallel[3];
+    for (int k = 0; k < 3; k++) {
+        orig[k] = p0.x(k);
+        isParallel[k] = (d.x(k) == 0.0);
+        invDir[k] = isParallel[k] ? 0.0 : 1.0/d.x(k);
+    }
+
+    double t, tr, ts;
+    int stack[GVS_BVH_MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = 0;
+
+    while (sp > 0) {
+        int nodeIdx = stack[--sp];
+        const bvh_node_t &node = mNodes[nodeIdx];
+        if (!hitBox(node, orig, invDir, isParallel, alpha)) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.offset; i < node.offset + node.count; i++) {
+                const gvs_bvh_triangle_t &tri = mTriangles[i];
+                if (!intersectTriangle(tri, p0, d, t, tr, ts)) {
+                    continue;
+                }
+                // Same result as a linear search over all faces in ascending order.
+                if (t < alpha || (t == alpha && faceID >= 0 && tri.faceID < faceID)) {
+                    alpha  = t;
+                    r      = tr;
+                    s      = ts;
+                    faceID = tri.faceID;
+                }
+            }
+        }
+        else {
+            // visit the near child first
+            int nearIdx = nodeIdx + 1;
+            int farIdx  = node.offset;
+            if (d.x(node.axis) < 0.0) {
+                nearIdx = node.offset;
+                farIdx  = nodeIdx + 1;
+            }
+            stack[sp++] = farIdx;
+            stack[sp++] = nearIdx;
+        }
+    }
+    return (faceID >= 0);
+}
+
+
+bool GvsMeshBVH::intersectTriangle ( const gvs_bvh_triangle_t &tri, const m4d::vec3 &P, const m4d::vec3 &d,
+                                     double &t, double &r, double &s ) {
+    m4d::vec3 w  = P - tri.A;
+    m4d::vec3 dv = d^tri.v;
+    m4d::vec3 wu = w^tri.u;
+
+    if (dv.isZero() || wu.isZero()) {
+        return false;
+    }
+
+    double hn = dv|tri.u;
+    if (fabs(hn)<1e-6) {
+        return false;
+    }
+    hn = 1.0/hn;
+
+    t = hn * (wu|tri.v);
+    r = hn * (dv|w);
+    s = hn * (wu|d);
+    return (r>=0 && r<=1 && s>=0 && s<=1 && s+r<=1 && t>=0 && t<=1);
+}
+
+
+void GvsMeshBVH::Print ( FILE* fptr ) {
+    fprintf(fptr,"MeshBVH {\n");
+    fprintf(fptr,"\t# nodes:     %d\n",numNodes());
+    fprintf(fptr,"\t# triangles: %d\n",numTriangles());
+    fprintf(fptr,"}\n");
+}
+
+
+int GvsMeshBVH::buildNode ( int first, int count, int depth ) {
+    int nodeIdx = static_cast<int>(mNodes.size());
+    mNodes.push_back(bvh_node_t());
+
+    bvh_node_t node;
+    calcBounds(first, count, node.bmin, node.bmax);
+    node.offset = first;
+    node.count  = count;
+    node.axis   = 0;
+    mNodes[nodeIdx] = node;
+
+    if (count <= GVS_BVH_MAX_LEAF_SIZE || depth >= GVS_BVH_MAX_DEPTH) {
+        return nodeIdx;
+    }
+
+    // bounds of the centroids
+    double cmin[3], cmax[3];
+    boxReset(cmin, cmax);
+    for (int i = first; i < first + count; i++) {
+        boxExtend(cmin, cmax, mCentroids[i]);
+    }
+
+    // binned surface area heuristic
+    int    bestAxis = -1;
+    int    bestBin  = -1;
+    double bestCost = DBL_MAX;
+
+    for (int axis = 0; axis < 3; axis++) {
+        double extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0) {
+            continue;
+        }
+
+        int    binCount[GVS_BVH_NUM_BINS];
+        double binMin[GVS_BVH_NUM_BINS][3];
+        double binMax[GVS_BVH_NUM_BINS][3];
+        for (int b = 0; b < GVS_BVH_NUM_BINS; b++) {
+            binCount[b] = 0;
+            boxReset(binMin[b], binMax[b]);
+        }
+
+        double scale = GVS_BVH_NUM_BINS / extent;
+        for (int i = first; i < first + count; i++) {
+            int b = GVS_MIN(static_cast<int>((mCentroids[i].x(axis) - cmin[axis]) * scale), GVS_BVH_NUM_BINS - 1);
+            binCount[b]++;
+            const gvs_bvh_triangle_t &tri = mTriangles[i];
+            boxExtend(binMin[b], binMax[b], tri.A);
+            boxExtend(binMin[b], binMax[b], tri.A + tri.u);
+            boxExtend(binMin[b], binMax[b], tri.A + tri.v);
+        }
+
+        // sweep from the right to get the area of all right partitions
+        double rightArea[GVS_BVH_NUM_BINS];
+        int    rightCount[GVS_BVH_NUM_BINS];
+        double rmin[3], rmax[3];
+        boxReset(rmin, rmax);
+        int rc = 0;
+        for (int b = GVS_BVH_NUM_BINS - 1; b > 0; b--) {
+            rc += binCount[b];
+            for (int k = 0; k < 3; k++) {
+                rmin[k] = GVS_MIN(rmin[k], binMin[b][k]);
+                rmax[k] = GVS_MAX(rmax[k], binMax[b][k]);
+            }
+            rightCount[b] = rc;
+            rightArea[b]  = boxArea(rmin, rmax);
+        }
+
+        double lmin[3], lmax[3];
+        boxReset(lmin, lmax);
+        int lc = 0;
+        for (int b = 0; b < GVS_BVH_NUM_BINS - 1; b++) {
+            lc += binCount[b];
+            for (int k = 0; k < 3; k++) {
+                lmin[k] = GVS_MIN(lmin[k], binMin[b][k]);
+                lmax[k] = GVS_MAX(lmax[k], binMax[b][k]);
+            }
+            if (lc == 0 || rightCount[b+1] == 0) {
+                continue;
+            }
+            double cost = lc * boxArea(lmin, lmax) + rightCount[b+1] * rightArea[b+1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin  = b;
+            }
+        }
+    }
+
+    if (bestAxis < 0) {
+        // all centroids coincide
+        return nodeIdx;
+    }
+
+    // A split only pays off if traversal plus the children is cheaper than the leaf.
+    double nodeArea = boxArea(node.bmin, node.bmax);
+    if (nodeArea > 0.0) {
+        double splitCost = 1.0 + bestCost / nodeArea;
+        if (splitCost >= static_cast<double>(count)) {
+            return nodeIdx;
+        }
+    }
+
+    // partition triangles and centroids
+    double scale = GVS_BVH_NUM_BINS / (cmax[bestAxis] - cmin[bestAxis]);
+    int i = first;
+    int j = first + count - 1;
+    while (i <= j) {
+        int b = GVS_MIN(static_cast<int>((mCentroids[i].x(bestAxis) - cmin[bestAxis]) * scale), GVS_BVH_NUM_BINS - 1);
+        if (b <= bestBin) {
+            i++;
+        }
+        else {
+            std::swap(mTriangles[i], mTriangles[j]);
+            std::swap(mCentroids[i], mCentroids[j]);
+            j--;
+        }
+    }
+
+    int numLeft = i - first;
+    if (numLeft == 0 || numLeft == count) {
+        return nodeIdx;
+    }
+
+    mNodes[nodeIdx].count = 0;
+    mNodes[nodeIdx].axis  = bestAxis;
+
+    buildNode(first, numLeft, depth + 1);
+    int rightIdx = buildNode(first + numLeft, count - numLeft, depth + 1);
+    mNodes[nodeIdx].offset = rightIdx;
+    return nodeIdx;
+}
+
+
+void GvsMeshBVH::calcBounds ( int first, int count, double* bmin, double* bmax ) const {
+    boxReset(bmin, bmax);
+    for (int i = first; i < first + count; i++) {
+        const gvs_bvh_triangle_t &tri = mTriangles[i];
+        boxExtend(bmin, bmax, tri.A);
+        boxExtend(bmin, bmax, tri.A + tri.u);
+        boxExtend(bmin, bmax, tri.A + tri.v);
+    }
+
+    // Slightly enlarge the box to be on the safe side with rounding errors.
+    for (int k = 0; k < 3; k++) {
+        double eps = GVS_BVH_BOX_EPS * (1.0 + GVS_MAX(fabs(bmin[k]), fabs(bmax[k])));
+        bmin[k] -= eps;
+        bmax[k] += eps;
+    }
+}
+
+
+bool GvsMeshBVH::hitBox ( const bvh_node_t &node, const double* orig, const double* invDir,
+                          const bool* isParallel, double tmax ) const {
+    double t0 = 0.0;
+    double t1 = tmax;
+    for (int k = 0; k < 3; k++) {
+        if (isParallel[k]) {
+            if (orig[k] < node.bmin[k] || orig[k] > node.bmax[k]) {
+                return false;
+            }
+            continue;
+        }
+        double ta = (node.bmin[k] - orig[k]) * invDir[k];
+        double tb = (node.bmax[k] - orig[k]) * invDir[k];
+        if (ta > tb) {
+            std::swap(ta, tb);
+        }
+        t0 = GVS_MAX(t0, ta);
+        t1 = GVS_MIN(t1, tb);
+        if (t0 > t1) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file    GvsMeshBVH.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_MESH_BVH_H
+#define GVS_MESH_BVH_H
+
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+//! Flattened triangle: vertex A and the edges u = B-A and v = C-A.
+typedef struct gvs_bvh_triangle_struct {
+    m4d::vec3  A;
+    m4d::vec3  u;
+    m4d::vec3  v;
+    int        faceID;   //!< index of the face in the mesh
+} gvs_bvh_triangle_t;
+
+
+/**
+ * Bounding volume hierarchy over the triangles of a mesh.
+ *   The hierarchy is built with the surface area heuristic (SAH) using binned
+ *   centroids. Nodes are stored depth-first in a flat array: the left child of
+ *   an inner node directly follows its parent, the right child is referenced
+ *   by index. Leaf nodes reference a contiguous range of triangles.
+ */
+class GvsMeshBVH
+{
+public:
+    GvsMeshBVH();
+    virtual ~GvsMeshBVH();
+
+    void  clear();
+
+    /**
+     * Build the hierarchy. The triangles are copied and reordered internally.
+     * @param triangles  list of flattened triangles
+     */
+    void  build ( const std::vector<gvs_bvh_triangle_t> &triangles );
+
+    bool  isEmpty      () const;
+    int   numNodes     () const;
+    int   numTriangles () const;
+
+    /**
+     * Find the closest intersection of the segment p0 + t*(p1-p0), t in [0,1),
+     * with the triangles. If several triangles are hit at the same t, the one
+     * with the smallest face index wins.
+     * @param p0      start point of segment
+     * @param p1      end point of segment
+     * @param alpha   segment parameter of the intersection
+     * @param r       barycentric coordinate wrt vertex B
+     * @param s       barycentric coordinate wrt vertex C
+     * @param faceID  face index of the triangle hit
+     * @return true if a triangle is hit
+     */
+    bool  intersect ( const m4d::vec3 &p0, const m4d::vec3 &p1,
+                      double &alpha, double &r, double &s, int &faceID ) const;
+
+    /**
+     * Intersection of the line P + t*d with a single triangle.
+     * @return true if the line hits the triangle with t in [0,1]
+     */
+    static bool intersectTriangle ( const gvs_bvh_triangle_t &tri, const m4d::vec3 &P, const m4d::vec3 &d,
+                                    double &t, double &r, double &s );
+
+    void  Print ( FILE* fptr = stderr );
+
+protected:
+    typedef struct bvh_node_struct {
+        double  bmin[3];
+        double  bmax[3];
+        int     offset;   //!< first triangle (leaf) or right child (inner node)
+        int     count;    //!< number of triangles, zero for inner nodes
+        int     axis;     //!< split axis of inner node
+    } bvh_node_t;
+
+    int   buildNode ( int first, int count, int depth );
+    void  calcBounds ( int first, int count, double* bmin, double* bmax ) const;
+    bool  hitBox ( const bvh_node_t &node, const double* orig, const double* invDir,
+                   const bool* isParallel, double tmax ) const;
+
+protected:
+    std::vector<bvh_node_t>          mNodes;
+    std::vector<gvs_bvh_triangle_t>  mTriangles;
+    std::vector<m4d::vec3>           mCentroids;
+};
+
+#endif // GVS_MESH_BVH_H
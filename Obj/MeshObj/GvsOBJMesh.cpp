@@ -19,21 +19,15 @@
 
 #include "GvsOBJMesh.h"
 #include "Ray/GvsSurfIntersec.h"
+#include "Utils/GvsStatistics.h"
 #include "math/TransfMat.h"
 #include <fstream>
 
 
-typedef struct hit_object_struct {
-    unsigned int faceID;
-    double      r;
-    double      s;
-} hit_object_t;
-
-
-
 GvsOBJMesh::GvsOBJMesh(GvsSurfaceShader* shader) : GvsSurface(shader),
     mObjOffsets(NULL),mNumDrawObjects(0),mNumAllObjVertices(0) {
     mHaveSetParamTransfMat = false;
+    mUseBVH = true;
 
     AddParam("objfilename",gvsDT_STRING);
 }
@@ -46,6 +40,7 @@ GvsOBJMesh::GvsOBJMesh(const char* pathname, const char* filename, GvsSurfaceSha
     mMetric = metric;
 
     mHaveSetParamTransfMat = false;
+    mUseBVH = true;
     volTransfMat.setIdent();
     volInvTransfMat.setIdent();
     volParamTransfMat.setIdent();
@@ -164,6 +159,8 @@ bool GvsOBJMesh::ReadObjFile( const char* pathname, const char* filename ) {
     float mm = 1.0f/(float)mVertices.size();
     mCenterOfVertices = mCenterOfVertices*mm;
     //fprintf(stderr,"center: %f %f %f\n",mCenterOfVertices.x(0),mCenterOfVertices.x(1),mCenterOfVertices.x(2));
+
+    buildBVH();
     return true;
 }
 
@@ -328,6 +325,8 @@ void GvsOBJMesh::ClearAll() {
     if (!mTags.empty())
         mTags.clear();
 
+    mBVH.clear();
+
     if (!mMaterial.empty()) {
         for(unsigned int i=0; i<mMaterial.size(); i++) {
             if (mMaterial[i]!=NULL) {
@@ -591,6 +590,8 @@ void GvsOBJMesh :: rotate ( const m4d::vec3 &rotAxis, double rotAngle) {
 }
 
 
+// The vertices are never transformed; instead, the ray segments are transformed
+// into object space. Hence, the hierarchy does not have to be rebuilt here.
 void GvsOBJMesh :: transform ( const m4d::Matrix<double,3,4> &mat) {
     //  std::cerr << "GvsSolConvexPrim :: transform()...\n";
     if ( !mat.isIdentMat() ) {
@@ -610,25 +611,27 @@ bool GvsOBJMesh::testIntersection( GvsRay &ray ) {
 
     int chart0,chart1;
 
-    m4d::enum_coordinate_type  coords = mMetric->getCoordType();
-
     int maxSeg   = ray.getNumPoints()-2;
-    int startSeg = int(0);
-    int endSeg   = maxSeg;
+    int startSeg = ray.getStartSegment();
+    int endSeg   = ray.getEndSegment();
+
+    m4d::vec3 cullLower, cullUpper;
+    bool useCulling = getRayCullBox(cullLower, cullUpper);
 
     // --- loop over all segments of the ray
     for (int seg = startSeg; seg < endSeg; seg++) {
+        if (useCulling) {
+            seg = ray.findNextSegment(seg, endSeg, cullLower, cullUpper);
+            if (seg >= endSeg) {
+                break;
+            }
+        }
+        GvsStatistics::countSegmentTest(this);
         m4d::vec4 p0 = ray.getPoint(seg);
         m4d::vec4 p1 = ray.getPoint(seg+1);
 
-        m4d::vec4 p0trans4D = p0;
-        m4d::vec4 p1trans4D = p1;
-
-        chart0 = chart1 = 0;
-        if (coords != m4d::enum_coordinate_cartesian)  {
-            chart0 = mMetric->transToPseudoCart( p0, p0trans4D );
-            chart1 = mMetric->transToPseudoCart( p1, p1trans4D );
-        }
+        m4d::vec4 p0trans4D, p1trans4D;
+        ray.getPseudoCartSegment(seg, p0trans4D, p1trans4D, chart0, chart1);
 
         if (chart0!=mChart && chart1!=mChart) {
             continue;
@@ -710,24 +713,57 @@ bool GvsOBJMesh :: rayIntersect(const m4d::vec3& p0, const m4d::vec3& p1,
                                  double &thit,
                                  m4d::vec3& rayIntersecPnt , m4d::vec3 &rayIntersecNormal, m4d::vec2 &rayIntersecTexUV) const
 {
+    double r,s;
+    int fid;
+
+    bool hit;
+    if (mUseBVH && !mBVH.isEmpty()) {
+        hit = mBVH.intersect(p0,p1,alpha,r,s,fid);
+    }
+    else {
+        hit = intersectFaces(p0,p1,alpha,r,s,fid);
+    }
+
+    if (hit) {
+        thit = tp0 + (tp1-tp0) * alpha;
+        rayIntersecPnt = p0 + alpha*(p1-p0);
+
+        const obj_face_t &face = mFaces[fid];
+        m4d::vec3 n1 = mNormals[face[0].nID-1];
+        m4d::vec3 n2 = mNormals[face[1].nID-1];
+        m4d::vec3 n3 = mNormals[face[2].nID-1];
 
-    // TODO: test bounding box!
+        m4d::vec2 t1 = mTexCoords[face[0].texID-1];
+        m4d::vec2 t2 = mTexCoords[face[1].texID-1];
+        m4d::vec2 t3 = mTexCoords[face[2].texID-1];
 
-    double delta_t = tp1-tp0;
+        rayIntersecNormal = (1-r-s)*n1 + r*n2 + s*n3;
+        rayIntersecTexUV  = (1-r-s)*t1 + r*t2 + s*t3;
 
+        //rayIntersecPnt.print();
+        //rayIntersecNormal.print();
+        //rayIntersecTexUV.print();
+        return true;
+    }
+
+    return false;
+}
+
+
+bool GvsOBJMesh::intersectFaces( const m4d::vec3& p0, const m4d::vec3& p1,
+                                 double &alpha, double &r, double &s, int &faceID ) const
+{
     m4d::vec3 P = p0;
     m4d::vec3 d = p1-p0;
 
     int v1id, v2id, v3id;
     m4d::vec3 A,B,C, u,v,w, dv,wu;
-    double t,r,s,hn;
-
-    bool hit = false;
-    hit_object_t hitObj;
+    double t,tr,ts,hn;
 
+    faceID = -1;
     alpha=1.0;
     for(unsigned int fid = 0; fid < mFaces.size(); fid++ ) {
-        obj_face_t face = mFaces[fid];
+        const obj_face_t &face = mFaces[fid];
         if (face.size()<3) {
             continue;
         }
@@ -758,48 +794,105 @@ bool GvsOBJMesh :: rayIntersect(const m4d::vec3& p0, const m4d::vec3& p1,
 
         hn = 1.0/hn;
 
-        t = hn * (wu|v);
-        r = hn * (dv|w);
-        s = hn * (wu|d);
+        t  = hn * (wu|v);
+        tr = hn * (dv|w);
+        ts = hn * (wu|d);
 
-        if (r>=0 && r<=1 && s>=0 && s<=1 && s+r<=1 && t>=0 && t<=1) {
+        if (tr>=0 && tr<=1 && ts>=0 && ts<=1 && ts+tr<=1 && t>=0 && t<=1) {
             // hit
             if (t<alpha) {
-                alpha = t;
-                {
-                    //fprintf(stderr," %f %f %f \n",t,r,s);
-                    hit = true;
-                    hitObj.faceID = fid;
-                    hitObj.r = r;
-                    hitObj.s = s;
-                }
+                alpha  = t;
+                r      = tr;
+                s      = ts;
+                faceID = static_cast<int>(fid);
             }
         }
     }
+    return (faceID >= 0);
+}
 
-    if (hit) {
-        thit = tp0 + delta_t * alpha;
-        rayIntersecPnt = P + alpha*d;
-        unsigned int fid = hitObj.faceID;
 
-        m4d::vec3 n1 = mNormals[mFaces[fid][0].nID-1];
-        m4d::vec3 n2 = mNormals[mFaces[fid][1].nID-1];
-        m4d::vec3 n3 = mNormals[mFaces[fid][2].nID-1];
+void GvsOBJMesh::buildBVH() {
+    std::vector<gvs_bvh_triangle_t> triangles;
+    triangles.reserve(mFaces.size());
 
-        m4d::vec2 t1 = mTexCoords[mFaces[fid][0].texID-1];
-        m4d::vec2 t2 = mTexCoords[mFaces[fid][1].texID-1];
-        m4d::vec2 t3 = mTexCoords[mFaces[fid][2].texID-1];
+    int numVertices = static_cast<int>(mVertices.size());
+    for(unsigned int fid = 0; fid < mFaces.size(); fid++ ) {
+        const obj_face_t &face = mFaces[fid];
+        if (face.size()<3) {
+            continue;
+        }
 
-        rayIntersecNormal = (1-hitObj.r-hitObj.s)*n1 + hitObj.r*n2 + hitObj.s*n3;
-        rayIntersecTexUV  = (1-hitObj.r-hitObj.s)*t1 + hitObj.r*t2 + hitObj.s*t3;
+        int v1id = face[0].vID - 1;
+        int v2id = face[1].vID - 1;
+        int v3id = face[2].vID - 1;
+        if (v1id<0 || v2id<0 || v3id<0 || v1id>=numVertices || v2id>=numVertices || v3id>=numVertices) {
+            continue;
+        }
 
-        //rayIntersecPnt.print();
-        //rayIntersecNormal.print();
-        //rayIntersecTexUV.print();
-        return true;
+        gvs_bvh_triangle_t tri;
+        tri.A = mVertices[v1id];
+        tri.u = mVertices[v2id] - tri.A;
+        tri.v = mVertices[v3id] - tri.A;
+        tri.faceID = static_cast<int>(fid);
+        triangles.push_back(tri);
     }
+    mBVH.build(triangles);
+}
 
-    return false;
+
+void GvsOBJMesh::setUseBVH( bool useBVH ) {
+    mUseBVH = useBVH;
+}
+
+bool GvsOBJMesh::getUseBVH() const {
+    return mUseBVH;
+}
+
+bool GvsOBJMesh::intersectSegment( const m4d::vec3& p0, const m4d::vec3& p1,
+                                   double &alpha, int &faceID, bool useBVH ) const
+{
+    double r,s;
+    if (useBVH && !mBVH.isEmpty()) {
+        return mBVH.intersect(p0,p1,alpha,r,s,faceID);
+    }
+    return intersectFaces(p0,p1,alpha,r,s,faceID);
+}
+
+int GvsOBJMesh::getNumFaces() const {
+    return static_cast<int>(mFaces.size());
+}
+
+void GvsOBJMesh::getVertexBounds( m4d::vec3 &lower, m4d::vec3 &upper ) const {
+    lower = upper = m4d::vec3();
+    for(unsigned int i=0; i<mVertices.size(); i++) {
+        for(int k=0; k<3; k++) {
+            if (i==0 || mVertices[i].x(k) < lower.x(k)) lower.setX(k,mVertices[i].x(k));
+            if (i==0 || mVertices[i].x(k) > upper.x(k)) upper.setX(k,mVertices[i].x(k));
+        }
+    }
+}
+
+
+bool GvsOBJMesh::getRayCullBox( m4d::vec3 &lower, m4d::vec3 &upper ) const {
+    if (mObjType != inCoords || haveMotion || mVertices.empty()) {
+        return false;
+    }
+
+    m4d::vec3 vlower, vupper;
+    getVertexBounds(vlower,vupper);
+
+    for(int c=0; c<8; c++) {
+        m4d::vec3 corner( (c & 1) ? vupper.x(0) : vlower.x(0),
+                          (c & 2) ? vupper.x(1) : vlower.x(1),
+                          (c & 4) ? vupper.x(2) : vlower.x(2) );
+        m4d::vec3 pt = mHaveSetParamTransfMat ? volParamTransfMat * corner : volTransfMat * corner;
+        for(int k=0; k<3; k++) {
+            if (c==0 || pt.x(k) < lower.x(k)) lower.setX(k,pt.x(k));
+            if (c==0 || pt.x(k) > upper.x(k)) upper.setX(k,pt.x(k));
+        }
+    }
+    return true;
 }
 
 
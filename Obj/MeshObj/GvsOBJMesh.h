@@ -21,6 +21,7 @@
 #define GVS_OBJ_MESH_H
 
 #include <Obj/GvsSurface.h>
+#include <Obj/MeshObj/GvsMeshBVH.h>
 #include <Ray/GvsRay.h>
 #include <iostream>
 
@@ -134,6 +135,33 @@ public:
 
     virtual bool haveSetParamTransfMat () const;
 
+    //! Bounds of the vertices transformed into coordinates.
+    virtual bool getRayCullBox ( m4d::vec3 &lower, m4d::vec3 &upper ) const;
+
+    /**
+     * Use the bounding volume hierarchy for the triangle intersection (default).
+     *   Otherwise, all faces are tested one after the other.
+     */
+    void  setUseBVH ( bool useBVH );
+    bool  getUseBVH () const;
+
+    /**
+     * Find the closest face hit by a line segment given in object coordinates.
+     * @param p0      start point of segment
+     * @param p1      end point of segment
+     * @param alpha   segment parameter of the intersection
+     * @param faceID  index of the face hit
+     * @param useBVH  use the bounding volume hierarchy instead of testing all faces
+     * @return true if a face is hit
+     */
+    bool  intersectSegment ( const m4d::vec3& p0, const m4d::vec3& p1,
+                             double &alpha, int &faceID, bool useBVH = true ) const;
+
+    int   getNumFaces () const;
+
+    //! Axis-aligned bounds of all vertices in object space.
+    void  getVertexBounds ( m4d::vec3 &lower, m4d::vec3 &upper ) const;
+
     virtual void Print ( FILE* fptr = stderr );
 
 
@@ -146,6 +174,13 @@ protected:
     bool tokenizeFile ( const std::string filename, std::vector<std::vector<std::string> > &tokens, bool useStandardIgnoreTokens = true );
     void lowCase ( std::string &s );    
 
+    //! Build bounding volume hierarchy over all faces in object space.
+    void buildBVH();
+
+    //! Test all faces for an intersection with the line segment.
+    bool intersectFaces ( const m4d::vec3& p0, const m4d::vec3& p1,
+                          double &alpha, double &r, double &s, int &faceID ) const;
+
     bool rayIntersect ( const m4d::vec3& p0, const m4d::vec3& p1,
                         double tp0, double tp1,
                         double &alpha, double &thit,
@@ -183,6 +218,9 @@ protected:
 
     GvsBoundBox  meshBoundBox;
 
+    GvsMeshBVH   mBVH;          //!< Hierarchy over the faces in object space
+    bool         mUseBVH;
+
     m4d::Matrix<double,3,4>   volTransfMat;
     m4d::Matrix<double,3,4>   volInvTransfMat;
 
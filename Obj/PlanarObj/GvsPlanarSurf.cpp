@@ -21,6 +21,7 @@
 
 #include <Ray/GvsRay.h>
 #include <Ray/GvsRayAllIS.h>
+#include "Utils/GvsStatistics.h"
 
 #include "math/TransfMat.h"
 
@@ -60,23 +61,16 @@ bool GvsPlanarSurf::testIntersection(GvsRay& ray)
     int chart0, chart1;
 
     int maxSeg = ray.getNumPoints() - 2;
-    int startSeg = int(0);
-    int endSeg = maxSeg;
-
-    m4d::enum_coordinate_type coords = mMetric->getCoordType();
+    int startSeg = ray.getStartSegment();
+    int endSeg = ray.getEndSegment();
 
     for (int seg = startSeg; seg <= endSeg; seg++) {
+        GvsStatistics::countSegmentTest(this);
         m4d::vec4 p0 = ray.getPoint(seg);
         m4d::vec4 p1 = ray.getPoint(seg + 1);
 
-        m4d::vec4 p0trans4D = p0;
-        m4d::vec4 p1trans4D = p1;
-
-        chart0 = chart1 = 0;
-        if (coords != m4d::enum_coordinate_cartesian) {
-            chart0 = mMetric->transToPseudoCart(p0, p0trans4D);
-            chart1 = mMetric->transToPseudoCart(p1, p1trans4D);
-        }
+        m4d::vec4 p0trans4D, p1trans4D;
+        ray.getPseudoCartSegment(seg, p0trans4D, p1trans4D, chart0, chart1);
 
         if (chart0 != mChart && chart1 != mChart) {
             continue;
@@ -215,6 +209,12 @@ GvsBoundBox GvsPlanarSurf::boundingBox(void) const
     return planarSurfBoundBox;
 }
 
+bool GvsPlanarSurf::getRayCullBox(m4d::vec3&, m4d::vec3&) const
+{
+    // The bounding box of a planar ring does not enclose the whole ring.
+    return false;
+}
+
 bool GvsPlanarSurf::rayIntersect(const m4d::vec3& p0, const m4d::vec3& p1, double tp0, double tp1, double& alpha,
     double& thit, m4d::vec3& rayIntersecPnt) const
 {
@@ -50,6 +50,8 @@ public:
 
     virtual GvsBoundBox boundingBox(void) const;
 
+    virtual bool getRayCullBox(m4d::vec3& lower, m4d::vec3& upper) const;
+
     virtual bool isValidHit(m4d::vec3 rp);
 
     virtual void scale(const m4d::vec3& scaleVec);
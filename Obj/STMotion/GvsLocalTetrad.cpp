@@ -100,7 +100,10 @@ GvsLocalTetrad :: GvsLocalTetrad(const GvsLocalTetrad* lt) {
         exit(1);
     }
 
-    stBoundBox = new GvsBoundBox4D(*(lt->getSTBoundBox()));
+    stBoundBox = NULL;
+    if (lt->getSTBoundBox() != NULL) {
+        stBoundBox = new GvsBoundBox4D(*(lt->getSTBoundBox()));
+    }
 
     AddParam("pos",gvsDT_VEC4);
     AddParam("e0",gvsDT_VEC4);
@@ -846,6 +849,12 @@ GvsLocalTetrad :: localToCoord ( const m4d::vec4 &vec ) const
 
 m4d::vec4
 GvsLocalTetrad :: coordToLocal ( const m4d::vec4 &vec ) const
+{
+    return coordToLocal(vec,locTetradMetric);
+}
+
+m4d::vec4
+GvsLocalTetrad :: coordToLocal ( const m4d::vec4 &vec, m4d::Metric* metric ) const
 {
     m4d::vec4 newVec;
 
@@ -866,7 +875,7 @@ GvsLocalTetrad :: coordToLocal ( const m4d::vec4 &vec ) const
         // ansonsten transformiert man zunaechst auf die natuerliche Tetrade und anschliessend
         // auf die eigentliche Tetrade
         m4d::vec4 oldVec;
-        locTetradMetric->coordToLocal(pos,vec,oldVec,lfType);
+        metric->coordToLocal(pos,vec,oldVec,lfType);
         for (int mu=0; mu<4; mu++)
         {
             newVec[mu]=0.0;
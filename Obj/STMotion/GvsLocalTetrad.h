@@ -98,6 +98,8 @@ public:
 
     m4d::vec4 localToCoord     ( const m4d::vec4 &vec ) const;
     m4d::vec4 coordToLocal     ( const m4d::vec4 &vec ) const;
+    //! Transformation with respect to 'metric', e.g. the metric of a worker thread.
+    m4d::vec4 coordToLocal     ( const m4d::vec4 &vec, m4d::Metric* metric ) const;
 
 
     void       setMetric ( m4d::Metric* metric );
@@ -22,6 +22,7 @@
 #include "Ray/GvsRay.h"
 #include "Ray/GvsSurfIntersec.h"
 #include "Shader/Surface/GvsSurfaceShader.h"
+#include "Utils/GvsStatistics.h"
 
 #include "math/TransfMat.h"
 #include "metric/m4dMetric.h"
@@ -162,18 +163,22 @@ GvsSolBox :: getRaySpanList ( GvsRay &ray, GvsSolObjSpanList &spanList )
 
     GvsSurfIntersec insecEntry, insecExit;
 
-    m4d::enum_coordinate_type coords;
-
-    // mMetric->setActualMetricNr(mChart);
-    m4d::Metric* stMetric = mMetric;
-    coords = stMetric->getCoordType();
-
     int maxSeg   = ray.getNumPoints()-2;
-    int startSeg = int(0);
-    int endSeg   = int(maxSeg);
+    int startSeg = ray.getStartSegment();
+    int endSeg   = ray.getEndSegment();
+
+    m4d::vec3 cullLower, cullUpper;
+    bool useCulling = getRayCullBox(cullLower, cullUpper);
 
     for( int seg = startSeg; seg < endSeg; seg++ )
     {
+        if (useCulling) {
+            seg = ray.findNextSegment(seg, endSeg, cullLower, cullUpper);
+            if (seg >= endSeg) {
+                break;
+            }
+        }
+        GvsStatistics::countSegmentTest(this);
         m4d::vec4 p0 = ray.getPoint(seg);
         m4d::vec4 p1 = ray.getPoint(seg+1);
 
@@ -181,15 +186,8 @@ GvsSolBox :: getRaySpanList ( GvsRay &ray, GvsSolObjSpanList &spanList )
         double tp1 = p1.x(0);
 
         m4d::vec4 p0trans4D, p1trans4D;
-
-        p0trans4D = p0;
-        p1trans4D = p1;
-
-        if (coords!=m4d::enum_coordinate_cartesian)
-        {
-            stMetric->transToPseudoCart (  p0,  p0trans4D );
-            stMetric->transToPseudoCart (  p1,  p1trans4D );
-        }
+        int chart0, chart1;
+        ray.getPseudoCartSegment( seg, p0trans4D, p1trans4D, chart0, chart1 );
 
         //m4d::vec3 p0trans = volInvTransfMat * m4d::vec3(p0trans4D.x(1),p0trans4D.x(2),p0trans4D.x(3));
         //m4d::vec3 p1trans = volInvTransfMat * m4d::vec3(p1trans4D.x(1),p1trans4D.x(2),p1trans4D.x(3));
@@ -22,6 +22,7 @@
 #include "Ray/GvsRay.h"
 #include "Ray/GvsSurfIntersec.h"
 #include "Shader/Surface/GvsSurfaceShader.h"
+#include "Utils/GvsStatistics.h"
 
 #include <metric/m4dMetric.h>
 #include "math/TransfMat.h"
@@ -149,26 +150,26 @@ bool GvsSolEllipsoid::getRaySpanList( GvsRay& ray, GvsSolObjSpanList& spanList )
 
     GvsSurfIntersec insecEntry, insecExit;
 
-    m4d::Metric* stMetric = mMetric;
-    m4d::enum_coordinate_type coords = stMetric->getCoordType();
-
     int maxSeg   = ray.getNumPoints()-2;
-    int startSeg = int(0);
-    int endSeg   = maxSeg;
+    int startSeg = ray.getStartSegment();
+    int endSeg   = ray.getEndSegment();
 
+    m4d::vec3 cullLower, cullUpper;
+    bool useCulling = getRayCullBox(cullLower, cullUpper);
 
     for( int seg = startSeg; seg < endSeg; seg++ ) {
+        if (useCulling) {
+            seg = ray.findNextSegment(seg, endSeg, cullLower, cullUpper);
+            if (seg >= endSeg) {
+                break;
+            }
+        }
+        GvsStatistics::countSegmentTest(this);
         m4d::vec4 p0 = ray.getPoint(seg);
         m4d::vec4 p1 = ray.getPoint(seg+1);
 
-        m4d::vec4 p0trans4D = p0;
-        m4d::vec4 p1trans4D = p1;
-
-        chart0 = chart1 = 0;
-        if (coords != m4d::enum_coordinate_cartesian) {
-            chart0 = stMetric->transToPseudoCart( p0, p0trans4D );
-            chart1 = stMetric->transToPseudoCart( p1, p1trans4D );
-        }
+        m4d::vec4 p0trans4D, p1trans4D;
+        ray.getPseudoCartSegment(seg, p0trans4D, p1trans4D, chart0, chart1);
 
         if ((chart0!=mChart) || (chart1!=mChart)) {
             continue;
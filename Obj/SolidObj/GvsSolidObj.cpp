@@ -64,3 +64,12 @@ bool GvsSolidObj ::haveSetParamTransfMat() const
 {
     return mHaveSetParamTransfMat;
 }
+
+bool GvsSolidObj::getRayCullBox(m4d::vec3& lower, m4d::vec3& upper) const
+{
+    // The bounding box does not follow a transformation set via 'setparam'.
+    if (mHaveSetParamTransfMat) {
+        return false;
+    }
+    return GvsSceneObj::getRayCullBox(lower, upper);
+}
@@ -43,6 +43,8 @@ public:
 
     virtual bool haveSetParamTransfMat() const;
 
+    virtual bool getRayCullBox(m4d::vec3& lower, m4d::vec3& upper) const;
+
 protected:
     m4d::Matrix<double, 3, 4> volTransfMat;
     m4d::Matrix<double, 3, 4> volInvTransfMat;
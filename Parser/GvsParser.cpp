@@ -186,6 +186,12 @@ void GvsParser::deleteAll()
     }
     gpLightMgr.clear();
 
+    // The devices share their change objects with the copies made by
+    // getDevice; thus, they are not deleted. But a further scene must not
+    // find the IDs and devices of this scene.
+    gpTypeID.clear();
+    gpDevice.clear();
+
     /*
     fprintf(stderr,"GvsParser: delete all devices...\n");
     for (i=0;i<gpDevice.size();i++) {
@@ -20,6 +20,28 @@
 extern std::vector<GvsCamera*> gpCamera;
 extern std::map<std::string, GvsTypeID> gpTypeID;
 
+// Progressive rendering is available for all camera types.
+static void readProgressive(GvsParseScheme* gP, GvsCamera* camera)
+{
+    int blockSize = 0;
+    double maxError = camera->getProgressiveError();
+    if (gP->getParameter("progressive", blockSize)) {
+        gP->getParameter("progressive_err", &maxError);
+        camera->setProgressive(blockSize, maxError);
+    }
+}
+
+// The background table is available for all camera types.
+static void readBackgroundTable(GvsParseScheme* gP, GvsCamera* camera)
+{
+    int step = 0;
+    double maxError = camera->getBackgroundTableError();
+    if (gP->getParameter("bgtable", step)) {
+        gP->getParameter("bgtable_err", &maxError);
+        camera->setBackgroundTable(step, maxError);
+    }
+}
+
 pointer gvsP_init_camera(scheme* sc, pointer args)
 {
 #ifdef GVS_VERBOSE
@@ -31,7 +53,8 @@ pointer gvsP_init_camera(scheme* sc, pointer args)
         scheme_error("init-camera: less arguments");
 
     std::string allowedNames[]
-        = { "type", "id", "dir", "vup", "fov", "res", "filter", "param", "angle", "heading", "pitch", "sep" };
+        = { "type", "id", "dir", "vup", "fov", "res", "filter", "param", "angle", "heading", "pitch", "sep",
+              "progressive", "progressive_err", "bgtable", "bgtable_err" };
 
     GvsParseAllowedNames allowedTypes[] = {
         { gp_string_string, 0 }, // type
@@ -45,10 +68,14 @@ pointer gvsP_init_camera(scheme* sc, pointer args)
         { gp_string_double, 1 }, // angle
         { gp_string_double, 1 }, // heading
         { gp_string_double, 1 }, // pitch
-        { gp_string_double, 1 } // eye sep
+        { gp_string_double, 1 }, // eye sep
+        { gp_string_int, 1 }, // progressive
+        { gp_string_double, 1 }, // progressive_err
+        { gp_string_int, 1 }, // bgtable
+        { gp_string_double, 1 } // bgtable_err
     };
 
-    GvsParseScheme* gvsParser = new GvsParseScheme(sc, allowedNames, allowedTypes, 12);
+    GvsParseScheme* gvsParser = new GvsParseScheme(sc, allowedNames, allowedTypes, 16);
     args = gvsParser->parse(args);
 
     std::string cameraType;
@@ -122,6 +149,8 @@ void gvsP_init_pinHoleCam(GvsParseScheme* gP)
         phCamera->setParameter(param);
     }
 
+    readProgressive(gP, phCamera);
+    readBackgroundTable(gP, phCamera);
     gpCamera.push_back(phCamera);
     // phCamera->print(cerr);
 
@@ -185,6 +214,8 @@ void gvsP_init_pinHoleStereoCam(GvsParseScheme* gP)
         phCamera->setParameter(param);
     }
 
+    readProgressive(gP, phCamera);
+    readBackgroundTable(gP, phCamera);
     gpCamera.push_back(phCamera);
     // phCamera->print(cerr);
 
@@ -245,6 +276,8 @@ void gvsP_init_panoramaCam(GvsParseScheme* gP)
         phCamera->setParameter(param);
     }
 
+    readProgressive(gP, phCamera);
+    readBackgroundTable(gP, phCamera);
     gpCamera.push_back(phCamera);
     // phCamera->print(cerr);
 
@@ -300,6 +333,8 @@ void gvsP_init_4PICam(GvsParseScheme* gP)
         phCamera->setParameter(param);
     }
 
+    readProgressive(gP, phCamera);
+    readBackgroundTable(gP, phCamera);
     gpCamera.push_back(phCamera);
     // phCamera->print(cerr);
 
@@ -353,6 +388,8 @@ void gvsP_init_2PICam(GvsParseScheme* gP)
     if (haveFilter)
         phCamera->setCamFilter(filter);
 
+    readProgressive(gP, phCamera);
+    readBackgroundTable(gP, phCamera);
     gpCamera.push_back(phCamera);
     // phCamera->print(cerr);
 
@@ -72,6 +72,29 @@
 
 
     Camera filters can be "FilterRGB", "FilterRGBpdz", and "FilterRGBjac".
+
+    All cameras with the filter "FilterRGB" can be rendered progressively:
+    @verbatim
+                 '(progressive  int)
+                 '(progressive_err  double)
+    @endverbatim
+    Blocks of 'progressive' pixels are interpolated where the texture
+    coordinates deviate at most 'progressive_err' (default 0.001) from
+    the bilinear interpolation of the corner rays and where the shading
+    of the interpolated center agrees with its traced color.
+
+    With the filter "FilterRGB", samples can also be taken from a table
+    of the background:
+    @verbatim
+                 '(bgtable  int)
+                 '(bgtable_err  double)
+    @endverbatim
+    The table is traced on cells of 'bgtable' pixels for each frame. The
+    samples of a cell whose corner and center rays all hit the background
+    object, or all miss every object, are interpolated instead of traced
+    unless a neighbouring cell has to be traced;
+    'bgtable_err' (default 0.001) bounds the error of the texture
+    coordinates.
  *
  *
  *  This file is part of GeoViS.
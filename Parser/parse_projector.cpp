@@ -22,10 +22,15 @@
     @verbatim
     (init-projector '(localTetrad "locTedObs")
                    ['(color  #(0.1 0.1 0.1)) ]
+                   ['(symmetry 2048) ]
                     '(id "proj")
     )@endverbatim
     The default background color is black (0,0,0).
 
+    In static spherically symmetric spacetimes like Schwarzschild or Morris-Thorne,
+    'symmetry' integrates a family of that many light rays once per observer radius;
+    each pixel takes its ray by rotating and interpolating the family, see GvsRayFamily.
+
 
     The local tetrad could also be defined within the initialization of the projector:
     @verbatim
@@ -81,7 +86,7 @@ pointer gvsP_init_projector (scheme *sc, pointer args) {
 
     std::string allowedNames[] = {
         "raygen","localtetrad","color","id","pos","e0","e1","e2","e3","incoords","motion",
-        "errcolor","cstrcolor","breakcolor"
+        "errcolor","cstrcolor","breakcolor","symmetry"
     };
     GvsParseAllowedNames allowedTypes[] = {{gp_string_string,0}, // raygen
                                            {gp_string_string,0}, // localtetrad
@@ -96,10 +101,11 @@ pointer gvsP_init_projector (scheme *sc, pointer args) {
                                            {gp_string_string,0}, // motion
                                            {gp_string_double,3}, // error color
                                            {gp_string_double,3}, // constraint color
-                                           {gp_string_double,3}  // break down color
+                                           {gp_string_double,3}, // break down color
+                                           {gp_string_int,1}     // symmetry
                                           };
 
-    GvsParseScheme* gvsParser = new GvsParseScheme(sc,allowedNames,allowedTypes,14);
+    GvsParseScheme* gvsParser = new GvsParseScheme(sc,allowedNames,allowedTypes,15);
 
     bool haveLocTed = false;
     bool haveMotion = false;
@@ -231,6 +237,14 @@ pointer gvsP_init_projector (scheme *sc, pointer args) {
         currProj->setBreakDownColor(GvsColor(bdcolor[0],bdcolor[1],bdcolor[2]));
     }
 
+    int symmetryRays;
+    if (gvsParser->getParameter("symmetry",symmetryRays)) {
+        if (symmetryRays < 0 || symmetryRays == 1) {
+            scheme_error("init-projector: symmetry must be 0 or at least 2!");
+        }
+        currProj->setSymmetryRays(symmetryRays);
+    }
+
     if ((!haveLocTed) && (!haveMotion)) {
         msg = "init-projector: ";
         msg.append(locTedID);
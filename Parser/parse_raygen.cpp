@@ -21,11 +21,17 @@
     @verbatim
     (init-raygen '(type "RayGenSimple")
                  '(maxNumPoints  3000     )
+             [   '(chunkSize     100      )  ]
              [   '(solver        "solver1")  ]
              [   '(boundBoxLL  #( (- dblmax) -50.0 -50.0 -50.0))  ]
              [   '(boundBoxUR  #(  dblmax   50.0  50.0  50.0))  ]
     )@endverbatim
 
+    If 'chunkSize' is set, the geodesic is integrated in chunks of this number of
+    points and the integration stops as soon as the closest intersection is known.
+    Because the step size control restarts with every chunk, the result is not
+    bit-identical to the full integration.
+
     @verbatim
     (calc-ray '(filename "points.dat")
               '(pos      #(0.0 10.0 1.5708 0.0 0))
@@ -84,15 +90,16 @@ pointer gvsP_init_raygen (scheme *sc, pointer args)
     if (args == sc->NIL) scheme_error("init-raygen: no arguments");
     if (!is_pair(args)) scheme_error("init-raygen: less arguments");
 
-    std::string allowedNames[] = {"type","solver","maxnumpoints","boundBoxLL","boundBoxUR","id"};
+    std::string allowedNames[] = {"type","solver","maxnumpoints","chunksize","boundBoxLL","boundBoxUR","id"};
     GvsParseAllowedNames allowedTypes[] = {{gp_string_string,0}, // type
                                            {gp_string_string,0}, // solver
                                            {gp_string_int,1},    // maxnumpoints
+                                           {gp_string_int,1},    // chunksize
                                            {gp_string_double,4}, // boundBoxLL
                                            {gp_string_double,4}, // boundBoxUR
                                            {gp_string_string,0}  // id
                                           };
-    GvsParseScheme* gvsParser = new GvsParseScheme(sc,allowedNames,allowedTypes,6);
+    GvsParseScheme* gvsParser = new GvsParseScheme(sc,allowedNames,allowedTypes,7);
     args = gvsParser->parse(args);
 
     std::string raygenType;
@@ -155,6 +162,9 @@ void gvsP_init_raygenSimple (GvsParseScheme* gP) {
     int maxNumPoints = 3000;
     if (gP->getParameter("maxnumpoints",maxNumPoints)) currRayGen->setMaxNumPoints(maxNumPoints);
 
+    int chunkSize = 0;
+    if (gP->getParameter("chunksize",chunkSize)) currRayGen->setChunkSize(chunkSize);
+
     double boundBoxLL[4] = {-DBL_MAX,-50.0,-50.0,-50.0};
     double boundBoxUR[4] = { DBL_MAX, 50.0, 50.0, 50.0};
 
@@ -27,6 +27,8 @@
                [ '(max_step <double>)    ]
                [ '(eps_abs <double>)     ]
                [ '(eps_rel <double>)     ]
+               [ '(packet <int>)         ]
+               [ '(native #t)            ]
                [ '(id "solver")          ]
     )@endverbatim
 
@@ -34,6 +36,12 @@
     - The geodesic type (geodType) can be either 'lightlike' or 'timelike'.
     - The direction can only be 'forward' or 'backward'. If the solver is used for raytracing, then
       the direction is automatically set to 'backward'.
+    - With 'packet' 4 or 8, light rays are integrated as packets of 4 or 8 geodesics by the
+      native kernels of GvsPacketSolver (Minkowski, Schwarzschild, MorrisThorne, KerrBL). Packets
+      need lightlike geodesics, 'native #t', and the type 'GSL_RK_Cash-Karp' or 'GSL_RK_Fehlberg';
+      otherwise, a warning is printed and the light rays are integrated one by one.
+    - Single light rays use the same native kernels if the type is 'GSL_RK_Cash-Karp' or
+      'GSL_RK_Fehlberg', see GvsKernelSolver. 'native #f' forces the Motion4D library.
 */
 
 #include "Parser/parse_solver.h"
@@ -67,7 +75,7 @@ pointer gvsP_init_solver (scheme *sc, pointer args) {
 
     std::string allowedNames[] = {
         "type","metric","geodtype","geoddir","step_ctrl","step_size","max_step",
-        "eps_abs","eps_rel","boundboxll","boundboxur","id"};
+        "eps_abs","eps_rel","boundboxll","boundboxur","packet","native","id"};
 
     GvsParseAllowedNames allowedTypes[] = {{gp_string_string,0},  // type
                                            {gp_string_string,0},  // metric
@@ -80,10 +88,12 @@ pointer gvsP_init_solver (scheme *sc, pointer args) {
                                            {gp_string_double,1},  // eps_rel
                                            {gp_string_double,4},  // boundBoxLL
                                            {gp_string_double,4},  // boundBoxUR
+                                           {gp_string_int,1},     // packet
+                                           {gp_string_bool,0},    // native
                                            {gp_string_string,0}   // id
                                           };
 
-    GvsParseScheme* gvsParser = new GvsParseScheme(sc,allowedNames,allowedTypes,12);
+    GvsParseScheme* gvsParser = new GvsParseScheme(sc,allowedNames,allowedTypes,14);
     args = gvsParser->parse(args);
     gvsParser->testParamNames("init-solver");
 
@@ -161,6 +171,20 @@ pointer gvsP_init_solver (scheme *sc, pointer args) {
         currSolver->setBoundingBox(boundBoxLL,boundBoxUR);
     }
 
+    // The packets depend on the native kernels.
+    bool useNative;
+    if (gvsParser->getParameter("native",useNative)) {
+        currSolver->setNativeKernel(useNative);
+    }
+
+    int packetSize;
+    if (gvsParser->getParameter("packet",packetSize)) {
+        if (packetSize != 0 && packetSize != 4 && packetSize != 8) {
+            scheme_error("init-solver: packet must be 0, 4, or 8!");
+        }
+        currSolver->setPacketSize(packetSize);
+    }
+
     gpSolver.push_back(currSolver);
 
 #ifdef GVS_VERBOSE
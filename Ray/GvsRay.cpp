@@ -20,22 +20,18 @@
 #include "Ray/GvsRay.h"
 #include "Ray/GvsRayGen.h"
 
+std::atomic<ulong> GvsRay::rayCounter(1UL);
 
 GvsRay :: GvsRay() {
-    rayGen   = NULL;
-    rayPoints= NULL;
-    rayDirs  = NULL;
-    rayLambda = NULL;
-    raySachs1 = NULL;
-    raySachs2 = NULL;
-    rayJacobi = NULL;
-
-    rayTetrad = NULL;
+    rayGen = NULL;
     rayHasTetrad = false;
 
     rayID = getNextRayID();
 
     rayNumPoints = 0;
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
     rayBreakCond = m4d::enum_break_none;
 }
 
@@ -43,44 +39,34 @@ GvsRay :: GvsRay ( GvsRayGen* gen ) {
     assert (gen!=NULL);
 
     rayGen = gen;
-    rayPoints = NULL;
-    rayDirs   = NULL;
-    rayLambda = NULL;
-    raySachs1 = NULL;
-    raySachs2 = NULL;
-    rayJacobi = NULL;
-
-    rayTetrad = NULL;
     rayHasTetrad = false;
 
     rayID = getNextRayID();
 
     rayNumPoints = 0;
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
     rayBreakCond = m4d::enum_break_none;
 }
 
 GvsRay :: GvsRay ( const m4d::vec4 &orig, const m4d::vec4 &dir, GvsRayGen* gen ) {
     assert (gen!=NULL);
     rayGen = gen;
-    rayLambda = NULL;
-    raySachs1 = NULL;
-    raySachs2 = NULL;
-    rayJacobi = NULL;
 
     rayID = getNextRayID();
 
-    rayPoints = NULL;
-    rayDirs = NULL;
-
-    rayNumPoints = 0;
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
 
-    rayBreakCond = rayGen->calcPolyline(orig,dir,rayPoints,rayDirs,rayNumPoints);
+    rayBreakCond = rayGen->calcPolyline(orig,dir,rayPoints,rayDirs);
+    rayNumPoints = static_cast<int>(rayPoints.size());
     assert(rayNumPoints >= 2);
 
     rayMinSearchDist = GVS_EPS;
     rayMaxSearchDist = double(rayNumPoints-1); // ???
 
-    rayTetrad = NULL;
     rayHasTetrad = false;
 }
 
@@ -91,22 +77,17 @@ GvsRay :: GvsRay ( const m4d::vec4 &orig, const m4d::vec4 &dir, GvsRayGen* gen,
     // std::cerr << "GvsRay :: GvsRay()...min.max.\n";
     assert (gen!=NULL);
     rayGen = gen;
-    rayLambda = NULL;
-    raySachs1 = NULL;
-    raySachs2 = NULL;
-    rayJacobi = NULL;
 
     rayID = getNextRayID();
 
-    rayPoints = NULL;
-    rayDirs = NULL;
-
-    rayNumPoints = 0;
-    rayBreakCond = rayGen->calcPolyline(orig,dir,rayPoints,rayDirs,rayNumPoints);
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
+    rayBreakCond = rayGen->calcPolyline(orig,dir,rayPoints,rayDirs);
+    rayNumPoints = static_cast<int>(rayPoints.size());
 
     setSearchInterval(minSearchDist,maxSearchDist);
 
-    rayTetrad = NULL;
     rayHasTetrad = false;
 }
 
@@ -117,18 +98,14 @@ GvsRay :: GvsRay ( const m4d::vec4 &orig, const m4d::vec4 &dir, const GvsLocalTe
     // std::cerr << "GvsRay :: GvsRay()...\n";
     assert (gen!=NULL);
     rayGen = gen;
-    rayLambda = NULL;
-    raySachs1 = NULL;
-    raySachs2 = NULL;
-    rayJacobi = NULL;
 
     rayID = getNextRayID();
 
-    rayPoints = NULL;
-    rayDirs  = NULL;
-
     rayNumPoints = 0;
-    rayTetrad = rayGen->calcParTransport(orig,dir,tetrad,rayNumPoints,rayBreakCond);
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
+    rayGen->calcParTransport(orig,dir,tetrad,rayTetrad,rayNumPoints,rayBreakCond);
     assert(rayNumPoints >= 2);
     rayHasTetrad = true;
 
@@ -145,15 +122,11 @@ GvsRay :: GvsRay ( const m4d::vec4 &orig, const m4d::vec4 &dir, const GvsLocalTe
 
     rayID = getNextRayID();
 
-    rayPoints = NULL;
-    rayDirs   = NULL;
-    rayLambda = NULL;
-    raySachs1 = NULL;
-    raySachs2 = NULL;
-    rayJacobi = NULL;
-
     rayNumPoints = 0;
-    rayTetrad = rayGen->calcParTransport(orig,dir,tetrad,rayNumPoints,rayBreakCond);
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
+    rayGen->calcParTransport(orig,dir,tetrad,rayTetrad,rayNumPoints,rayBreakCond);
     assert(rayNumPoints >= 2);
     rayHasTetrad = true;
 
@@ -163,46 +136,36 @@ GvsRay :: GvsRay ( const m4d::vec4 &orig, const m4d::vec4 &dir, const GvsLocalTe
 
 GvsRay::~GvsRay() {
     rayGen = NULL;
-    deleteAll();
     rayHasTetrad = false;
 }
 
-void GvsRay::deleteAll() {
+void GvsRay::clearBuffers() {
+    // clear() keeps the capacity, thus a recalculated ray reuses the memory.
+    rayPoints.clear();
+    rayDirs.clear();
+    rayLambda.clear();
+    raySachs1.clear();
+    raySachs2.clear();
+    rayJacobi.clear();
 
-    if (rayPoints!=NULL) {
-        delete [] rayPoints;
-        rayPoints = NULL;
-    }
-
-    if (rayDirs!=NULL) {
-        delete [] rayDirs;
-        rayDirs = NULL;
-    }
-
-    if (rayTetrad!=NULL) {
-        delete [] rayTetrad;
-        rayTetrad = NULL;
-    }
+    raySegTree.clear();
+}
 
-    if (rayLambda!=NULL) {
-        delete [] rayLambda;
-        rayLambda = NULL;
-    }
+void GvsRay::resetRay() {
+    clearBuffers();
+    clearIntersections();
+    rayHasTetrad = false;
 
-    if (raySachs1!=NULL) {
-        delete [] raySachs1;
-        raySachs1 = NULL;
-    }
+    rayID = getNextRayID();
 
-    if (raySachs2!=NULL) {
-        delete [] raySachs2;
-        raySachs2 = NULL;
-    }
+    rayNumPoints = 0;
+    rayStartSeg = 0;
+    rayEndSeg = -1;
+    rayIsComplete = true;
+}
 
-    if (rayJacobi!=NULL) {
-        delete [] rayJacobi;
-        rayJacobi = NULL;
-    }
+void GvsRay::clearIntersections() {
+    // nothing to clear
 }
 
 
@@ -257,15 +220,11 @@ m4d::enum_break_condition  GvsRay::getBreakCond() {
 
 bool  GvsRay :: recalc ( const m4d::vec4 &orig, const m4d::vec4 &dir ) {
     assert (rayGen != NULL);
+    resetRay();
 
-    deleteAll();
-    rayHasTetrad = false;
-
-    rayID = getNextRayID();
-
-    rayNumPoints = 0;
-    rayBreakCond = rayGen->calcPolyline(orig,dir,rayPoints,rayNumPoints);
-    if (rayPoints==NULL || rayNumPoints<2) {
+    rayBreakCond = rayGen->calcPolyline(orig,dir,rayPoints,rayDirs);
+    rayNumPoints = static_cast<int>(rayPoints.size());
+    if (rayNumPoints<2) {
         return false;
     }
 
@@ -280,13 +239,11 @@ bool  GvsRay :: recalc (const m4d::vec4 &orig, const m4d::vec4 &dir, const GvsLo
     //  tetrad.print(cerr);
 
     assert (rayGen != NULL);
-    deleteAll();
-
-    rayNumPoints = 0;
+    resetRay();
     //rayGen->Print();
 
-    rayTetrad = rayGen->calcParTransport(orig,dir,tetrad,rayNumPoints,rayBreakCond);
-    if (rayTetrad==NULL || rayNumPoints<2) {
+    if (!rayGen->calcParTransport(orig,dir,tetrad,rayTetrad,rayNumPoints,rayBreakCond) || rayNumPoints<2) {
+        rayNumPoints = 0;
         return false;
     }
     rayHasTetrad = true;
@@ -297,15 +254,57 @@ bool  GvsRay :: recalc (const m4d::vec4 &orig, const m4d::vec4 &dir, const GvsLo
 }
 
 
+bool  GvsRay::setPolyline ( std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs,
+                           m4d::enum_break_condition bc ) {
+    assert (rayGen != NULL);
+    resetRay();
+
+    rayPoints.swap(points);
+    rayDirs.swap(dirs);
+    rayBreakCond = bc;
+    rayNumPoints = static_cast<int>(rayPoints.size());
+    if (rayNumPoints<2) {
+        return false;
+    }
+
+    rayMinSearchDist = GVS_EPS;
+    rayMaxSearchDist = double(rayNumPoints-1);
+    return true;
+}
+
+
+template <typename T>
+static void moveToBuffer ( T*& data, int num, std::vector<T> &buf ) {
+    if (data!=NULL) {
+        buf.assign(data,data+num);
+        delete [] data;
+        data = NULL;
+    }
+}
+
 bool  GvsRay::recalcJacobi ( const m4d::vec4 &orig, const m4d::vec4 &dir,
                             const m4d::vec3 &locRayDir, const GvsLocalTetrad* tetrad ) {
     assert (rayGen != NULL);
     //fprintf(stderr,"GvsRay::recalcJacobi() ... \n");
-    deleteAll();
-
-    rayNumPoints = 0;
+    resetRay();
+
+    // The Sachs-Jacobi integration of libMotion4D allocates the arrays itself.
+    m4d::vec4* points = NULL;
+    m4d::vec4* dirs = NULL;
+    double*    lambda = NULL;
+    m4d::vec4* sachs1 = NULL;
+    m4d::vec4* sachs2 = NULL;
+    m4d::vec5* jacobi = NULL;
     rayGen->calcSachsJacobi(orig,dir,locRayDir,tetrad,
-                            rayPoints,rayDirs,rayLambda,raySachs1,raySachs2,rayJacobi,rayMaxJacobi,rayNumPoints,rayBreakCond);
+                            points,dirs,lambda,sachs1,sachs2,jacobi,rayMaxJacobi,rayNumPoints,rayBreakCond);
+
+    int num = GVS_MAX(rayNumPoints,0);
+    moveToBuffer(points,num,rayPoints);
+    moveToBuffer(dirs,num,rayDirs);
+    moveToBuffer(lambda,num,rayLambda);
+    moveToBuffer(sachs1,num,raySachs1);
+    moveToBuffer(sachs2,num,raySachs2);
+    moveToBuffer(jacobi,num,rayJacobi);
     if (rayNumPoints<2) {
         return false;
     }
@@ -317,25 +316,142 @@ bool  GvsRay::recalcJacobi ( const m4d::vec4 &orig, const m4d::vec4 &dir,
 
 
 
+bool  GvsRay::recalcFirstChunk ( const m4d::vec4 &orig, const m4d::vec4 &dir, int chunkSize ) {
+    assert (rayGen != NULL);
+    resetRay();
+    rayIsComplete = false;
+
+    int maxNumPoints = rayGen->getMaxNumPoints();
+    if (maxNumPoints < 2) {
+        rayIsComplete = true;
+        return false;
+    }
+    rayPoints.reserve(maxNumPoints);
+    rayDirs.reserve(maxNumPoints);
+
+    if (!appendChunk(orig,dir,chunkSize) || rayNumPoints<2) {
+        return false;
+    }
+
+    rayMinSearchDist = GVS_EPS;
+    rayMaxSearchDist = double(rayNumPoints-1);
+    return true;
+}
+
+
+bool  GvsRay::recalcNextChunk ( int chunkSize ) {
+    assert (rayGen != NULL);
+    if (rayIsComplete || rayNumPoints<2) {
+        return false;
+    }
+
+    m4d::vec4 orig = rayPoints[rayNumPoints-1];
+    m4d::vec4 dir  = rayDirs[rayNumPoints-1];
+    if (!appendChunk(orig,dir,chunkSize)) {
+        return false;
+    }
+
+    // An already stored intersection limits the search interval.
+    if (!intersecFound()) {
+        rayMaxSearchDist = double(rayNumPoints-1);
+    }
+    return true;
+}
+
+
+bool  GvsRay::appendChunk ( const m4d::vec4 &orig, const m4d::vec4 &dir, int chunkSize ) {
+    int maxNumPoints = rayGen->getMaxNumPoints();
+
+    // The first point of a chunk coincides with the last point of the previous one.
+    int offset = (rayNumPoints>0) ? rayNumPoints-1 : 0;
+    int numPoints = GVS_MIN(GVS_MAX(chunkSize,2),maxNumPoints-offset);
+    if (numPoints<2) {
+        rayIsComplete = true;
+        return false;
+    }
+
+    m4d::enum_break_condition bc = rayGen->calcPolylineChunk(orig,dir,numPoints,rayChunkPoints,rayChunkDirs);
+    int num = static_cast<int>(GVS_MIN(rayChunkPoints.size(),rayChunkDirs.size()));
+    if (num<2) {
+        if (rayNumPoints==0) {
+            rayBreakCond = bc;
+        }
+        rayIsComplete = true;
+        return false;
+    }
+
+    // The first point of the chunk replaces the last point of the ray.
+    rayPoints.resize(offset);
+    rayDirs.resize(offset);
+    rayPoints.insert(rayPoints.end(),rayChunkPoints.begin(),rayChunkPoints.begin()+num);
+    rayDirs.insert(rayDirs.end(),rayChunkDirs.begin(),rayChunkDirs.begin()+num);
+
+    // Segment (rayNumPoints-2) has not been tested yet, see the segment loops of the objects.
+    rayStartSeg = GVS_MAX(rayNumPoints-2,0);
+    rayNumPoints = offset + num;
+    rayBreakCond = bc;
+
+    if (num<numPoints || rayNumPoints>=maxNumPoints
+            || (bc!=m4d::enum_break_none && bc!=m4d::enum_break_num_exceed)) {
+        rayIsComplete = true;
+    }
+    return true;
+}
+
+
+
+void GvsRay::setSegmentWindow ( int startSeg, int endSeg ) {
+    rayStartSeg = GVS_MAX(startSeg,0);
+    rayEndSeg   = endSeg;
+}
+
+void GvsRay::getSegmentWindow ( int &startSeg, int &endSeg ) const {
+    startSeg = rayStartSeg;
+    endSeg   = rayEndSeg;
+}
+
+
+void GvsRay::getPseudoCartSegment ( int seg, m4d::vec4 &p0, m4d::vec4 &p1, int &chart0, int &chart1 ) {
+    assert ( (seg >= 0) && (seg+1 < rayNumPoints) );
+    raySegTree.update(*this,getMetric());
+    p0 = raySegTree.getPoint(seg);
+    p1 = raySegTree.getPoint(seg+1);
+    chart0 = raySegTree.getChart(seg);
+    chart1 = raySegTree.getChart(seg+1);
+}
+
+int GvsRay::findNextSegment ( int seg, int endSeg, const m4d::vec3 &lower, const m4d::vec3 &upper ) {
+    raySegTree.update(*this,getMetric());
+    return raySegTree.findNextSegment(seg,endSeg,lower,upper);
+}
+
+
 GvsRayGen*  GvsRay::getRayGen() const {
     return rayGen;
 }
 
+m4d::Metric* GvsRay::getMetric() const {
+    if (rayGen == NULL || rayGen->getActualSolver() == NULL) {
+        return NULL;
+    }
+    return rayGen->getActualSolver()->getMetric();
+}
+
 
 m4d::vec4* GvsRay::points() {
     assert(rayNumPoints>=2);
 
-    if ((rayHasTetrad) && (rayPoints==NULL)) {
-        rayPoints= new m4d::vec4[rayNumPoints];
+    if (rayHasTetrad && static_cast<int>(rayPoints.size())!=rayNumPoints) {
+        rayPoints.resize(rayNumPoints);
         for (int i=0; i<rayNumPoints; i++)
             rayPoints[i] = rayTetrad[i].getPosition();
     }
-    return rayPoints;
+    return rayPoints.data();
 }
 
 
 m4d::vec4* GvsRay::tangents() {
-    return rayDirs;
+    return rayDirs.empty() ? NULL : rayDirs.data();
 }
 
 int GvsRay :: getNumPoints() const {
@@ -344,10 +460,10 @@ int GvsRay :: getNumPoints() const {
 
 m4d::vec4 GvsRay :: getPoint ( int index ) const {
     assert ( (index >= 0) && (index < rayNumPoints) );
-    if (rayHasTetrad && rayTetrad!=NULL) {
+    if (rayHasTetrad) {
         return rayTetrad[index].getPosition();
     } else {
-        if (rayPoints!=NULL) {
+        if (index < static_cast<int>(rayPoints.size())) {
             return rayPoints[index];
         }
     }
@@ -356,10 +472,10 @@ m4d::vec4 GvsRay :: getPoint ( int index ) const {
 
 m4d::vec4 GvsRay :: getTangente ( int index ) const {
     assert ( (index >= 0) && (index < rayNumPoints) );
-    if (rayHasTetrad && rayTetrad!=NULL) {
+    if (rayHasTetrad) {
         return rayTetrad[index].getVelocity();
     } else {
-        if (rayDirs!=NULL) {
+        if (index < static_cast<int>(rayDirs.size())) {
             return rayDirs[index];
         }
     }
@@ -368,7 +484,7 @@ m4d::vec4 GvsRay :: getTangente ( int index ) const {
 
 m4d::vec5 GvsRay::getJacobi( int index ) const {
     assert ( (index >= 0) && (index < rayNumPoints) );
-    if (rayJacobi!=NULL) {
+    if (index < static_cast<int>(rayJacobi.size())) {
         return rayJacobi[index];
     }
     return m4d::vec5(0);
@@ -376,28 +492,24 @@ m4d::vec5 GvsRay::getJacobi( int index ) const {
 
 GvsLocalTetrad GvsRay :: getTetrad ( int index ) const {
     assert ( (index >= 0) && (index < rayNumPoints) );
-    if (rayHasTetrad && rayTetrad!=NULL) {
+    if (rayHasTetrad) {
         return rayTetrad[index];
     }
     return GvsLocalTetrad();
 }
 
-void GvsRay :: setPoints( m4d::vec4* points ) {
-    if ( rayPoints!= NULL ) {
-        delete [] rayPoints;
-    }
-    rayPoints = points;
+void GvsRay :: setPoints( const m4d::vec4* pts, int num ) {
+    raySegTree.clear();
+    rayPoints.assign(pts,pts+num);
 }
 
-void GvsRay :: setDirs( m4d::vec4* dirs ) {
-    if ( rayDirs != NULL ) {
-        delete [] rayDirs;
-    }
-    rayDirs = dirs;
+void GvsRay :: setDirs( const m4d::vec4* dirs, int num ) {
+    rayDirs.assign(dirs,dirs+num);
 }
 
 void GvsRay :: setNumPoints( int noPts ) {
     rayNumPoints = noPts;
+    raySegTree.clear();
 
     rayMinSearchDist = GVS_EPS;
     rayMaxSearchDist = double(rayNumPoints-1); // ???
@@ -421,22 +533,25 @@ bool GvsRay :: isValidSurfIntersec ( double dist ) const {
 }
 
 ulong GvsRay :: getNextRayID() {
-    static ulong RayID = 1UL;
+    ulong id = rayCounter.load();
+    ulong next;
+    do {
+        next = (id == ULONG_MAX) ? 1UL : id + 1UL;
+    } while (!rayCounter.compare_exchange_weak(id, next));
 
-    if ( RayID == ULONG_MAX )
-        return (RayID = 1UL);
-    else
-        return RayID++;
+    return (id == ULONG_MAX) ? 1UL : id;
 } 
 
 void GvsRay :: timeShiftRay( double timeDelta ) {
+    raySegTree.clear();
     if (!rayHasTetrad) {
-        assert(rayPoints!=NULL);
+        assert(static_cast<int>(rayPoints.size())>=rayNumPoints);
         for (int i=0; i<rayNumPoints; i++)
             rayPoints[i].setX( 0, rayPoints[i].x(0)+timeDelta);
     }
     else {
-        assert(rayTetrad!=NULL);
+        // The positions are cached by points() and must follow the tetrads.
+        rayPoints.clear();
         for (int i=0; i<rayNumPoints; i++)
             rayTetrad[i].setPositionX( 0, rayTetrad[i].getPosition().x(0)+timeDelta );
     }
@@ -445,13 +560,13 @@ void GvsRay :: timeShiftRay( double timeDelta ) {
 
 void GvsRay :: Print( FILE* fptr ) {
     if (!rayHasTetrad)     {
-        assert(rayPoints!=NULL);
+        assert(static_cast<int>(rayPoints.size())>=rayNumPoints);
         for (int i=0; i<rayNumPoints; i++) {
             rayPoints[i].printS(fptr);
         }
     }
     else {
-        assert(rayTetrad!=NULL);
+        assert(static_cast<int>(rayTetrad.size())>=rayNumPoints);
 
         m4d::vec4 pos;
         m4d::vec4 vel;
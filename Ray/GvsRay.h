@@ -21,12 +21,14 @@
 
 #include "GvsGlobalDefs.h"
 #include "Obj/STMotion/GvsLocalTetrad.h"
+#include "Ray/GvsRaySegTree.h"
 //#include <Shader/GvsShader.h>
 //#include <Shader/Surface/GvsSurfaceShader.h>
 
 #include <m4dGlobalDefs.h>
 #include <metric/m4dMetric.h>
 
+#include <atomic>
 #include <cassert>
 #include <vector>
 #include <iostream>
@@ -70,15 +72,94 @@ public:
     virtual bool  recalcJacobi ( const m4d::vec4 &orig, const m4d::vec4 &dir,
                                  const m4d::vec3 &locRayDir, const GvsLocalTetrad* tetrad );
 
+    /**
+     * Streaming alternative to recalc(orig,dir).
+     *   Only the first chunk of the geodesic is integrated. Further chunks are
+     *   appended by 'recalcNextChunk' until the geodesic is complete.
+     * @param orig       initial position in coordinates
+     * @param dir        initial direction in coordinates
+     * @param chunkSize  number of points per chunk
+     * @return true if the first chunk has at least two points
+     */
+    virtual bool  recalcFirstChunk ( const m4d::vec4 &orig, const m4d::vec4 &dir, int chunkSize );
+
+    /**
+     * Append the next chunk of the geodesic.
+     *   The chunk starts with the last point and tangent of the current ray.
+     * @param chunkSize  number of points per chunk
+     * @return false if the geodesic is already complete
+     */
+    virtual bool  recalcNextChunk  ( int chunkSize );
+
+    /**
+     * Take a polyline that has already been integrated, e.g. as part of a packet.
+     *   The buffers are swapped with those of the ray; thus, the caller gets
+     *   the old buffers of the ray back and no points are copied.
+     * @param points  ray points
+     * @param dirs    ray directions
+     * @param bc      break condition of the integration
+     * @return true if the ray has at least two points
+     */
+    bool  setPolyline ( std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs, m4d::enum_break_condition bc );
+
+    //! Integration of the geodesic has finished (break condition or maximum number of points).
+    bool           isComplete       () const;
+
+    /**
+     * First segment which has not been tested for intersections yet.
+     *   Objects start their segment loop here. The value is zero unless the
+     *   ray is integrated chunk by chunk.
+     */
+    int            getStartSegment  () const;
+
+    /**
+     * Segment after the last segment to be tested for intersections.
+     *   Usually, this is the last segment (numPoints-2) which itself is not
+     *   tested. A compound object may restrict the segments with
+     *   'setSegmentWindow'.
+     */
+    int            getEndSegment    () const;
+
+    /**
+     * Restrict the intersection test to the segments [startSeg,endSeg).
+     * @param startSeg  first segment to be tested
+     * @param endSeg    segment after the last one to be tested; -1 means up to the last segment
+     */
+    void           setSegmentWindow ( int startSeg, int endSeg );
+    void           getSegmentWindow ( int &startSeg, int &endSeg ) const;
+
+    /**
+     * End points of a segment in pseudo-Cartesian coordinates.
+     *   All points of the ray are transformed only once with the metric of the
+     *   ray; the objects share the result.
+     * @param seg     segment index
+     * @param p0      start point of segment
+     * @param p1      end point of segment
+     * @param chart0  chart of start point
+     * @param chart1  chart of end point
+     */
+    void           getPseudoCartSegment ( int seg, m4d::vec4 &p0, m4d::vec4 &p1, int &chart0, int &chart1 );
+
+    /**
+     * Find the first segment in [seg,endSeg) whose bounding box in
+     * pseudo-Cartesian coordinates overlaps the box [lower,upper].
+     * @return segment index or endSeg if there is none
+     */
+    int            findNextSegment  ( int seg, int endSeg, const m4d::vec3 &lower, const m4d::vec3 &upper );
+
     void           setSearchInterval ( double minDist, double maxDist );
 
     GvsRayGen*     getRayGen    () const;
+
+    //! Metric instance of the ray generator's solver; objects may use it as workspace.
+    m4d::Metric*   getMetric    () const;
     m4d::vec4*     points       ();
     m4d::vec4*     tangents     ();
     int            getNumPoints () const;
 
-    void         setPoints      ( m4d::vec4* pts  );
-    void         setDirs        ( m4d::vec4* dirs );
+    //! Copy the points; the ray keeps its own buffer.
+    void         setPoints      ( const m4d::vec4* pts, int num );
+    void         setDirs        ( const m4d::vec4* dirs, int num );
     void         setNumPoints   ( int noPts );
 
     m4d::vec4      getPoint       ( int index ) const;
@@ -122,30 +203,53 @@ protected:
     void  setMinSearchDist ( double minDist );
     void  setMaxSearchDist ( double maxDist );
 
-    void deleteAll();
+    /**
+     * Forget the points of the ray.
+     *   The buffers keep their capacity. Thus, a ray that is recalculated
+     *   again and again does not allocate memory once its buffers are large enough.
+     */
+    void clearBuffers();
+
+    //! Clear the buffers, the stored intersections, and the segment window for a new geodesic.
+    void resetRay();
+
+    //! Forget the stored intersections; called whenever the ray is recalculated.
+    virtual void clearIntersections();
+
+    bool appendChunk ( const m4d::vec4 &orig, const m4d::vec4 &dir, int chunkSize );
 
 private:
     static ulong  getNextRayID();
 
+    //! Ray counter shared by all threads.
+    static std::atomic<ulong>  rayCounter;
+
 
 protected:
     ulong               rayID;
     GvsRayGen*          rayGen;       // only pointer to rayGen, do not delete here!!
-    m4d::vec4*          rayPoints;
-    m4d::vec4*          rayDirs;
-    GvsLocalTetrad*     rayTetrad;    
-    double*             rayLambda;
-    m4d::vec4*          raySachs1;
-    m4d::vec4*          raySachs2;
-    m4d::vec5*          rayJacobi;
+    std::vector<m4d::vec4>       rayPoints;
+    std::vector<m4d::vec4>       rayDirs;
+    std::vector<GvsLocalTetrad>  rayTetrad;    //!< may hold more than rayNumPoints tetrads, see GvsGeodSolver
+    std::vector<double>          rayLambda;
+    std::vector<m4d::vec4>       raySachs1;
+    std::vector<m4d::vec4>       raySachs2;
+    std::vector<m4d::vec5>       rayJacobi;
+    std::vector<m4d::vec4>       rayChunkPoints;   //!< scratch buffer of appendChunk
+    std::vector<m4d::vec4>       rayChunkDirs;     //!< scratch buffer of appendChunk
     m4d::vec5           rayMaxJacobi;
 
     int                 rayNumPoints;
+    int                 rayStartSeg;
+    int                 rayEndSeg;
+    bool                rayIsComplete;
     double              rayMinSearchDist;
     double              rayMaxSearchDist;
 
     bool                rayHasTetrad;
     m4d::enum_break_condition rayBreakCond;
+
+    GvsRaySegTree       raySegTree;   //!< pseudo-Cartesian points and segment hierarchy, built on demand
 };
 
 //----------------------------------------------------------------------------
@@ -156,7 +260,20 @@ inline ulong GvsRay :: getNonRayID () {
 }
 
 inline ulong GvsRay :: getNumRaysTraced () {
-  return getNextRayID() - 1;
+  return rayCounter.load() - 1;
+}
+
+inline bool GvsRay :: isComplete () const {
+    return rayIsComplete;
+}
+
+inline int GvsRay :: getStartSegment () const {
+    return rayStartSeg;
+}
+
+inline int GvsRay :: getEndSegment () const {
+    int maxSeg = rayNumPoints - 2;
+    return (rayEndSeg < 0 || rayEndSeg > maxSeg) ? maxSeg : rayEndSeg;
 }
 
 #endif
@@ -63,6 +63,12 @@ GvsRayStatus GvsRayAllIS::store( const GvsSurfIntersec &surfIntersec ) {
 }
 
 
+void GvsRayAllIS::clearIntersections() {
+    raySurfIntersecs.clear();
+    currSurfIntersec = 0;
+}
+
+
 GvsSurfIntersec* GvsRayAllIS::getFirstSurfIntersec() {
     currSurfIntersec = 0;
     if (currSurfIntersec < raySurfIntersecs.size()) {
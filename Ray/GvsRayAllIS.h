@@ -45,6 +45,9 @@ public:
     GvsSurfIntersec* getFirstSurfIntersec();
     GvsSurfIntersec* getNextSurfIntersec();
 
+protected:
+    virtual void clearIntersections();
+
 protected:
     std::vector<GvsSurfIntersec>  raySurfIntersecs;
     size_t currSurfIntersec;
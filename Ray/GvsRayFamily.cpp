@@ -0,0 +1,267 @@
+/**
+ * @file    GvsRayFamily.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Ray/GvsRayFamily.h"
+#include "Ray/GvsRayGen.h"
+
+#include <cmath>
+
+GvsRayFamily::GvsRayFamily( int numRays )
+    : mNumRays(GVS_MAX(numRays, 2)),
+      mValid(false),
+      mSupported(false),
+      mRadius(0.0),
+      mTimeSign(0.0),
+      mMetric(nullptr)
+{
+}
+
+
+int GvsRayFamily::getNumRays() const {
+    return mNumRays;
+}
+
+
+bool GvsRayFamily::isSupported( m4d::Metric* metric, double r ) {
+    if (metric == nullptr || metric->getCoordType() != m4d::enum_coordinate_spherical) {
+        return false;
+    }
+
+    // (t,theta,phi) of the samples at each radius
+    const double samples[2][3] = {{0.0, 0.7, 0.3}, {3.7, 2.1, 4.1}};
+    const double radii[2] = {r, r + 1.0};
+    for (int n = 0; n < 2; n++) {
+        double gRef[3] = {0.0, 0.0, 0.0};
+        for (int s = 0; s < 2; s++) {
+            double pos[4] = {samples[s][0], radii[n], samples[s][1], samples[s][2]};
+            metric->calculateMetric(pos);
+            double g[3] = {metric->getMetricCoeff(0,0), metric->getMetricCoeff(1,1), metric->getMetricCoeff(2,2)};
+            double scale = fabs(g[0]) + fabs(g[1]) + fabs(g[2]);
+
+            for (int i = 0; i < 4; i++) {
+                for (int j = i + 1; j < 4; j++) {
+                    if (fabs(metric->getMetricCoeff(i,j)) > 1.0e-12*scale) {
+                        return false;
+                    }
+                }
+            }
+
+            double st = sin(samples[s][1]);
+            if (fabs(metric->getMetricCoeff(3,3) - g[2]*st*st) > 1.0e-9*fabs(g[2])) {
+                return false;
+            }
+
+            if (s == 0) {
+                if (n == 0 && !(g[0] < 0.0 && g[1] > 0.0 && g[2] > 0.0)) {
+                    return false;
+                }
+                for (int i = 0; i < 3; i++) {
+                    gRef[i] = g[i];
+                }
+            }
+            else {
+                for (int i = 0; i < 3; i++) {
+                    if (fabs(g[i] - gRef[i]) > 1.0e-9*fabs(gRef[i])) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+bool GvsRayFamily::prepare( GvsRayGen* rayGen, const m4d::vec4 &orig, const m4d::vec4 &dir ) {
+    assert(rayGen != NULL && rayGen->getActualSolver() != NULL);
+    m4d::Metric* metric = rayGen->getActualSolver()->getMetric();
+
+    double r = orig.x(1);
+    double timeSign = (dir.x(0) < 0.0) ? -1.0 : 1.0;
+    readMetricParams(metric, mParamsTmp);
+    if (!mValid || r != mRadius || timeSign != mTimeSign || mParamsTmp != mMetricParams) {
+        mValid = true;
+        mRadius = r;
+        mTimeSign = timeSign;
+        mMetricParams.swap(mParamsTmp);
+        mSupported = isSupported(metric, r) && build(rayGen, r, timeSign);
+    }
+    return mSupported;
+}
+
+
+bool GvsRayFamily::getRay( m4d::Metric* metric, const m4d::vec4 &orig, const m4d::vec4 &dir,
+                           std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs,
+                           m4d::enum_break_condition &bc ) const {
+    double timeSign = (dir.x(0) < 0.0) ? -1.0 : 1.0;
+    if (!mValid || !mSupported || orig.x(1) != mRadius || timeSign != mTimeSign) {
+        return false;
+    }
+
+    // Direction of the ray with respect to the static frame (e_r, e_theta, e_phi).
+    metric->calculateMetric(orig);
+    double dr  = sqrt(metric->getMetricCoeff(1,1))*dir.x(1);
+    double dth = sqrt(metric->getMetricCoeff(2,2))*dir.x(2);
+    double dph = sqrt(metric->getMetricCoeff(3,3))*dir.x(3);
+    double dTan = sqrt(dth*dth + dph*dph);
+    double energy = sqrt(dr*dr + dTan*dTan);
+    if (!(energy > 0.0)) {
+        return false;
+    }
+
+    // The same directions in the euclidean space of the pseudo-cartesian coordinates.
+    // The plane of the ray is spanned by e1 (radial) and e2 (tangential).
+    double st = sin(orig.x(2));
+    double ct = cos(orig.x(2));
+    double sp = sin(orig.x(3));
+    double cp = cos(orig.x(3));
+    double e1[3] = {st*cp, st*sp, ct};
+    double e2[3] = {ct*cp, ct*sp, -st};
+    if (dTan > 0.0) {
+        for (int i = 0; i < 3; i++) {
+            e2[i] = (dth*e2[i] + dph*((i == 0) ? -sp : ((i == 1) ? cp : 0.0)))/dTan;
+        }
+    }
+
+    // The two closest family members: 'a' gives the affine parameters, 'b' is interpolated.
+    double u = atan2(dTan, dr)/M_PI*(mNumRays - 1);
+    int j = GVS_MIN(static_cast<int>(floor(u)), mNumRays - 2);
+    double w = u - j;
+    int a = (w < 0.5) ? j : j + 1;
+    int b = (w < 0.5) ? j + 1 : j;
+    double wb = (w < 0.5) ? w : 1.0 - w;
+    bool blend = (wb > 0.0) && (mBreakCond[a] == mBreakCond[b]) && (mPoints[b].size() >= 2);
+
+    points.clear();
+    dirs.clear();
+    points.push_back(orig);
+    dirs.push_back(dir);
+
+    size_t seg = 0;
+    double lastPhi = orig.x(3);
+    const std::vector<m4d::vec4> &pa = mPoints[a];
+    const std::vector<m4d::vec4> &va = mDirs[a];
+    for (size_t k = 1; k < pa.size(); k++) {
+        m4d::vec4 p = pa[k];
+        m4d::vec4 v = va[k];
+        double lambda = mLambdas[a][k];
+        if (blend && lambda <= mLambdas[b].back()) {
+            m4d::vec4 pb, vb;
+            interpolate(b, lambda, seg, pb, vb);
+            p = (1.0 - wb)*p + wb*pb;
+            v = (1.0 - wb)*v + wb*vb;
+        }
+
+        // Rotate the point (t,r,pi/2,phi) of the equatorial plane into the plane of the ray.
+        double cf = cos(p.x(3));
+        double sf = sin(p.x(3));
+        double U[3], W[3];
+        for (int i = 0; i < 3; i++) {
+            U[i] = cf*e1[i] + sf*e2[i];
+            W[i] = cf*e2[i] - sf*e1[i];
+        }
+        double rho2 = U[0]*U[0] + U[1]*U[1];
+        double rho = sqrt(rho2);
+        double theta = atan2(rho, U[2]);
+        double phi = atan2(U[1], U[0]);
+        phi += 2.0*M_PI*floor((lastPhi - phi)/(2.0*M_PI) + 0.5);
+        lastPhi = phi;
+
+        double dTheta = 0.0;
+        double dPhi = 0.0;
+        if (rho > GVS_EPS) {
+            dTheta = -W[2]*v.x(3)/rho;
+            dPhi = (U[0]*W[1] - U[1]*W[0])*v.x(3)/rho2;
+        }
+        points.push_back(m4d::vec4(orig.x(0) + p.x(0), p.x(1), theta, phi));
+        dirs.push_back(energy*m4d::vec4(v.x(0), v.x(1), dTheta, dPhi));
+    }
+    bc = mBreakCond[a];
+    return true;
+}
+
+
+bool GvsRayFamily::build( GvsRayGen* rayGen, double r, double timeSign ) {
+    GvsGeodSolver* solver = rayGen->getActualSolver();
+    m4d::Metric* metric = solver->getMetric();
+
+    m4d::vec4 orig(0.0, r, 0.5*M_PI, 0.0);
+    if (metric->breakCondition(orig)) {
+        return false;
+    }
+
+    metric->calculateMetric(orig);
+    double at = timeSign/sqrt(-metric->getMetricCoeff(0,0));
+    double ar = 1.0/sqrt(metric->getMetricCoeff(1,1));
+    double ap = 1.0/sqrt(metric->getMetricCoeff(3,3));
+
+    mPoints.resize(mNumRays);
+    mDirs.resize(mNumRays);
+    mLambdas.resize(mNumRays);
+    mBreakCond.resize(mNumRays);
+    for (int m = 0; m < mNumRays; m++) {
+        double xi = M_PI*m/(mNumRays - 1);
+        m4d::vec4 dir(at, cos(xi)*ar, 0.0, sin(xi)*ap);
+        mBreakCond[m] = solver->calculateGeodesic(orig, dir, rayGen->getMaxNumPoints(),
+                                                  mPoints[m], mDirs[m], mLambdas[m]);
+        if (mPoints[m].size() != mLambdas[m].size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void GvsRayFamily::interpolate( int m, double lambda, size_t &seg, m4d::vec4 &pos, m4d::vec4 &dir ) const {
+    const std::vector<double> &L = mLambdas[m];
+    while (seg + 2 < L.size() && L[seg+1] < lambda) {
+        seg++;
+    }
+
+    const m4d::vec4 &p0 = mPoints[m][seg];
+    const m4d::vec4 &p1 = mPoints[m][seg+1];
+    const m4d::vec4 &v0 = mDirs[m][seg];
+    const m4d::vec4 &v1 = mDirs[m][seg+1];
+    double h = L[seg+1] - L[seg];
+    if (!(h > 0.0)) {
+        pos = p0;
+        dir = v0;
+        return;
+    }
+
+    double s = GVS_MIN(GVS_MAX((lambda - L[seg])/h, 0.0), 1.0);
+    double s2 = s*s;
+    double s3 = s2*s;
+    pos = (2.0*s3 - 3.0*s2 + 1.0)*p0 + (h*(s3 - 2.0*s2 + s))*v0 + (3.0*s2 - 2.0*s3)*p1 + (h*(s3 - s2))*v1;
+    dir = (6.0*(s2 - s)/h)*(p0 - p1) + (3.0*s2 - 4.0*s + 1.0)*v0 + (3.0*s2 - 2.0*s)*v1;
+}
+
+
+void GvsRayFamily::readMetricParams( m4d::Metric* metric, std::vector<double> &params ) {
+    if (metric != mMetric) {
+        mMetric = metric;
+        mParamNames.clear();
+        metric->getParamNames(mParamNames);
+        mValid = false;
+    }
+
+    params.clear();
+    for (size_t i = 0; i < mParamNames.size(); i++) {
+        double val = 0.0;
+        metric->getParam(mParamNames[i].c_str(), val);
+        params.push_back(val);
+    }
+}
+
+
+void GvsRayFamily::Print( FILE* fptr ) const {
+    fprintf(fptr,"RayFamily {\n");
+    fprintf(fptr,"\tnumRays : %d\n",mNumRays);
+    if (mValid) {
+        fprintf(fptr,"\tradius  : %f\n",mRadius);
+        fprintf(fptr,"\tsupported : %s\n",mSupported ? "yes" : "no");
+    }
+    fprintf(fptr,"}\n");
+}
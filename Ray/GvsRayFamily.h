@@ -0,0 +1,122 @@
+/**
+ * @file    GvsRayFamily.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_RAY_FAMILY_H
+#define GVS_RAY_FAMILY_H
+
+#include <string>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+#include <m4dGlobalDefs.h>
+#include <metric/m4dMetric.h>
+
+class GvsRayGen;
+
+/**
+ * One-parameter family of light rays of a static spherically symmetric spacetime.
+ *
+ *   In a metric like Schwarzschild, Morris-Thorne, or Janis-Newman-Winicour,
+ *   every light ray lies in a plane through the center and, up to a rotation
+ *   and a scale of its tangent, only depends on the radius of its origin and
+ *   on the angle xi between its initial direction and the radial direction.
+ *
+ *   The family holds the rays of 'numRays' angles xi between 0 (outward) and
+ *   pi (inward), integrated once in the equatorial plane. The ray of any
+ *   origin with this radius is the linear interpolation of the two closest
+ *   family members at equal affine parameters, rotated into the plane of its
+ *   direction. If the two members stop for different reasons, e.g. at the
+ *   photon sphere, the closer one is taken as it is.
+ *
+ *   The family is prepared for the observer of a frame before its pixels are
+ *   rendered; it is integrated again if the radius of the origin, the time
+ *   direction of the rays, or a parameter of the metric has changed. During
+ *   the frame the family is only read; thus, it is shared by all worker
+ *   threads. Rays of another radius or time direction are not taken.
+ *
+ *   The metric has to be given in spherical coordinates (t,r,theta,phi) with
+ *   a diagonal metric that does not depend on t and phi and whose angular part
+ *   is that of a sphere; this is verified at some sample points. The bounding
+ *   box of the solver is applied to the family members in the equatorial plane.
+ */
+class GvsRayFamily
+{
+public:
+    /**
+     * @param numRays  number of family members, at least 2
+     */
+    explicit GvsRayFamily( int numRays );
+
+    int   getNumRays ( ) const;
+
+    /**
+     * Test if the metric is static and spherically symmetric near radius r.
+     * @param metric  metric in spherical coordinates
+     * @param r       radius of the origin of the rays
+     */
+    static bool  isSupported ( m4d::Metric* metric, double r );
+
+    /**
+     * Prepare the family for the rays of an origin.
+     *   The family is integrated with the solver of the ray generator if it
+     *   does not fit the origin and the time direction of the ray.
+     * @param rayGen  ray generator of the rays
+     * @param orig    initial position of the rays in coordinates
+     * @param dir     initial direction of one of the rays in coordinates
+     * @return false if the metric is not supported
+     */
+    bool  prepare ( GvsRayGen* rayGen, const m4d::vec4 &orig, const m4d::vec4 &dir );
+
+    /**
+     * Get the light ray of an origin and a direction from the prepared family.
+     * @param metric  metric of the calling thread, the same as that of the family
+     * @param orig    initial position of the ray in coordinates
+     * @param dir     initial direction of the ray in coordinates
+     * @param points  ray points; the buffer is cleared first
+     * @param dirs    ray directions; the buffer is cleared first
+     * @param bc      break condition of the ray
+     * @return false if the family does not fit the ray; the ray has to be integrated
+     */
+    bool  getRay ( m4d::Metric* metric, const m4d::vec4 &orig, const m4d::vec4 &dir,
+                   std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs,
+                   m4d::enum_break_condition &bc ) const;
+
+    void  Print ( FILE* fptr = stderr ) const;
+
+protected:
+    //! Integrate the family for radius r and the sign of the time component of the rays.
+    bool  build ( GvsRayGen* rayGen, double r, double timeSign );
+
+    //! State of member m at affine parameter lambda by cubic Hermite interpolation.
+    void  interpolate ( int m, double lambda, size_t &seg, m4d::vec4 &pos, m4d::vec4 &dir ) const;
+
+    //! Current values of the metric parameters; a new metric invalidates the family.
+    void  readMetricParams ( m4d::Metric* metric, std::vector<double> &params );
+
+private:
+    int  mNumRays;
+
+    // Key of the current family
+    bool    mValid;
+    bool    mSupported;
+    double  mRadius;
+    double  mTimeSign;
+    std::vector<double>  mMetricParams;
+
+    // The members in the equatorial plane, starting at t=0 and phi=0.
+    std::vector< std::vector<m4d::vec4> >  mPoints;
+    std::vector< std::vector<m4d::vec4> >  mDirs;
+    std::vector< std::vector<double> >     mLambdas;
+    std::vector<m4d::enum_break_condition> mBreakCond;
+
+    m4d::Metric*  mMetric;
+    std::vector<std::string>  mParamNames;
+
+    // Scratch buffers
+    std::vector<double>  mParamsTmp;
+};
+
+#endif // GVS_RAY_FAMILY_H
@@ -22,6 +22,7 @@
 GvsRayGen :: GvsRayGen() :
     actualSolver(NULL) {
     maxNumPoints = 2;
+    chunkSize = 0;
 }
 
 GvsRayGen :: GvsRayGen( GvsGeodSolver *solver ) :
@@ -29,6 +30,7 @@ GvsRayGen :: GvsRayGen( GvsGeodSolver *solver ) :
     actualSolver->setGeodType(m4d::enum_geodesic_lightlike);
     actualSolver->setTimeDir(m4d::enum_time_backward);
     maxNumPoints = 2;
+    chunkSize = 0;
 }
 
 GvsRayGen :: GvsRayGen( GvsGeodSolver *solver,
@@ -37,6 +39,7 @@ GvsRayGen :: GvsRayGen( GvsGeodSolver *solver,
     actualSolver->setGeodType(type);
     actualSolver->setTimeDir(dir);
     maxNumPoints = 2;
+    chunkSize = 0;
 }
 
 GvsRayGen :: ~GvsRayGen() {
@@ -44,6 +47,16 @@ GvsRayGen :: ~GvsRayGen() {
 }
 
 
+GvsRayGen* GvsRayGen :: clone ( GvsGeodSolver* solver ) const {
+    GvsRayGen* rayGen = new GvsRayGen();
+    rayGen->actualSolver = solver;
+    rayGen->boundBox     = boundBox;
+    rayGen->maxNumPoints = maxNumPoints;
+    rayGen->chunkSize    = chunkSize;
+    return rayGen;
+}
+
+
 void GvsRayGen :: setBoundBox ( const GvsBoundBox4D &box ) {
     boundBox = box;
     actualSolver->setBoundingBox(box.lowBounds(),box.uppBounds());
@@ -61,6 +74,21 @@ int GvsRayGen :: getMaxNumPoints() const {
     return maxNumPoints;
 }
 
+void GvsRayGen :: setChunkSize(const int numPoints) {
+    chunkSize = (numPoints > 0) ? GVS_MAX(numPoints,2) : 0;
+}
+
+int GvsRayGen :: getChunkSize() const {
+    return chunkSize;
+}
+
+int GvsRayGen :: getPacketSize() const {
+    if (actualSolver == NULL || chunkSize > 0) {
+        return 0;
+    }
+    return actualSolver->getPacketSize();
+}
+
 
 void GvsRayGen :: setActualSolver( GvsGeodSolver *solver ) {
     actualSolver = solver;
@@ -115,37 +143,130 @@ GvsRayGen :: calcPolyline(const m4d::vec4 &startOrig, const m4d::vec4 &startDir,
 }
 
 
+m4d::enum_break_condition
+GvsRayGen :: calcPolyline(const m4d::vec4 &startOrig, const m4d::vec4 &startDir,
+                          std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs)
+{
+    assert(actualSolver!=NULL);
+
+    points.clear();
+    dirs.clear();
+
+    m4d::Metric* metric = actualSolver->getMetric();
+    if ( metric!=NULL) {
+        if (metric->breakCondition(startOrig) ) {
+            std::cerr << "error in GvsRayGenSimple :: calcPolyline" << std::endl;
+            std::cerr << "StartPos already satisfies breakCondition" << std::endl;
+            return m4d::enum_break_other;
+        }
+    }
+
+    return actualSolver->calculateGeodesic(startOrig,startDir,maxNumPoints,points,dirs);
+}
+
+
+m4d::enum_break_condition
+GvsRayGen :: calcPolylineChunk(const m4d::vec4 &startOrig, const m4d::vec4 &startDir, int maxPoints,
+                               std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs)
+{
+    assert(actualSolver!=NULL);
+
+    points.clear();
+    dirs.clear();
+
+    m4d::Metric* metric = actualSolver->getMetric();
+    if (metric!=NULL && metric->breakCondition(startOrig)) {
+        return m4d::enum_break_cond;
+    }
+
+    return actualSolver->calculateGeodesic(startOrig,startDir,GVS_MIN(maxPoints,maxNumPoints),points,dirs);
+}
+
+
+bool
+GvsRayGen :: calcPolylinePacket(int num, const m4d::vec4* startOrig, const m4d::vec4* startDir,
+                                std::vector<m4d::vec4>* points, std::vector<m4d::vec4>* dirs,
+                                m4d::enum_break_condition* bc)
+{
+    assert(actualSolver!=NULL);
+    assert(num <= GVS_PACKET_MAX_LANES);
+    if (getPacketSize() <= 0) {
+        return false;
+    }
+
+    // Only rays that start outside of the break condition form the packet.
+    m4d::vec4 orig[GVS_PACKET_MAX_LANES];
+    m4d::vec4 dir[GVS_PACKET_MAX_LANES];
+    int index[GVS_PACKET_MAX_LANES];
+    int numRays = 0;
+
+    m4d::Metric* metric = actualSolver->getMetric();
+    for (int i=0; i<num; i++) {
+        if (metric!=NULL && metric->breakCondition(startOrig[i])) {
+            std::cerr << "error in GvsRayGenSimple :: calcPolylinePacket" << std::endl;
+            std::cerr << "StartPos already satisfies breakCondition" << std::endl;
+            points[i].clear();
+            dirs[i].clear();
+            bc[i] = m4d::enum_break_other;
+            continue;
+        }
+        orig[numRays] = startOrig[i];
+        dir[numRays] = startDir[i];
+        index[numRays++] = i;
+    }
+
+    if (numRays == num) {
+        return actualSolver->calculateGeodesics(num,startOrig,startDir,maxNumPoints,points,dirs,bc);
+    }
+
+    std::vector<m4d::vec4> packetPoints[GVS_PACKET_MAX_LANES];
+    std::vector<m4d::vec4> packetDirs[GVS_PACKET_MAX_LANES];
+    m4d::enum_break_condition packetBC[GVS_PACKET_MAX_LANES];
+    for (int n=0; n<numRays; n++) {
+        packetPoints[n].swap(points[index[n]]);
+        packetDirs[n].swap(dirs[index[n]]);
+    }
+    bool ok = actualSolver->calculateGeodesics(numRays,orig,dir,maxNumPoints,packetPoints,packetDirs,packetBC);
+    for (int n=0; n<numRays; n++) {
+        points[index[n]].swap(packetPoints[n]);
+        dirs[index[n]].swap(packetDirs[n]);
+        bc[index[n]] = packetBC[n];
+    }
+    return ok;
+}
+
+
 //----------------------------------------------------------------------------
 //         calcParTransport
 //----------------------------------------------------------------------------
 //  Neben der Geodaetenintegration wird noch zusaetzlich die lokale Tetrade
 //  des Beobachters bis zum Emissionszeitpunkt parallel-transportiert.
 //
-GvsLocalTetrad*
+bool
 GvsRayGen :: calcParTransport ( const m4d::vec4 &startOrig, const m4d::vec4 &startDir, const GvsLocalTetrad *lt,
-                                int &numPoints, m4d::enum_break_condition &bc )
+                                std::vector<GvsLocalTetrad> &tetrads, int &numPoints, m4d::enum_break_condition &bc )
 {
     //  std::cerr << "GvsRayGenSimple :: calcParTransport () ...\n";
     assert(actualSolver!=NULL);
 
+    numPoints = 0;
     m4d::Metric* metric = actualSolver->getMetric();
     if ( metric!=NULL) {
         if (metric->breakCondition(startOrig) ) {
             std::cerr << "error in GvsRayGenSimple :: calcPolyline" << std::endl;
             std::cerr << "StartPos already satisfies breakCondition" << std::endl;
             bc = m4d::enum_break_other;
-            return NULL;
+            return false;
         }
     }
 
-    m4d::vec4 base[4]; // = new m4d::vec4[4];
+    m4d::vec4 base[4];
     for (int i=0; i<4; i++) {
         base[i] = lt->getE(i);
     }
 
-    GvsLocalTetrad* localT = NULL;
-    bc = actualSolver->calcParTransport(startOrig,startDir,base,maxNumPoints,localT,numPoints);
-    return localT;
+    bc = actualSolver->calcParTransport(startOrig,startDir,base,maxNumPoints,tetrads,numPoints);
+    return true;
 }
 
 
@@ -177,5 +298,6 @@ void GvsRayGen::Print( FILE* fptr )
 {
     fprintf(fptr,"RayGen {\n");
     fprintf(fptr,"\tmaxNumPoints: %d",maxNumPoints);
+    fprintf(fptr,"\n\tchunkSize: %d\n",chunkSize);
     fprintf(fptr,"}\n");
 }
@@ -29,6 +29,8 @@
 #include <m4dGlobalDefs.h>
 #include <metric/m4dMetric.h>
 
+#include <vector>
+
 /**
  * @brief The GvsRayGen class
  */
@@ -55,6 +57,14 @@ public:
     GvsRayGen( GvsGeodSolver *solver, m4d::enum_geodesic_type type, m4d::enum_time_direction dir );
     virtual ~GvsRayGen();
 
+    /**
+     * Create a new ray generator with the same settings that uses the given solver.
+     *   The settings of the solver itself are not touched.
+     * @param solver  pointer to geodesic solver, e.g. a clone of the actual solver
+     * @return pointer to new ray generator
+     */
+    GvsRayGen* clone( GvsGeodSolver* solver ) const;
+
     void           setBoundBox ( const GvsBoundBox4D &box );
     GvsBoundBox4D  getBoundBox ( ) const;
 
@@ -70,6 +80,28 @@ public:
      */
     int  getMaxNumPoints ( ) const;
 
+    /**
+     * Set number of points per chunk for streaming integration.
+     *   If the chunk size is positive, the geodesic is integrated chunk by chunk
+     *   and each chunk is tested for intersections before the next one is
+     *   calculated. A chunk size of zero disables streaming.
+     * @param numPoints  number of points per chunk
+     */
+    void setChunkSize ( const int numPoints );
+
+    /**
+     * Get currently set number of points per chunk.
+     * @return  zero if streaming is disabled
+     */
+    int  getChunkSize ( ) const;
+
+    /**
+     * Number of light rays that are integrated together by calcPolylinePacket.
+     *   Packets are not used with streaming integration.
+     * @return  zero if the solver does not integrate packets
+     */
+    int  getPacketSize ( ) const;
+
     void           setActualSolver ( GvsGeodSolver* solver );
     GvsGeodSolver* getActualSolver ( ) const;
 
@@ -88,9 +120,57 @@ public:
     m4d::enum_break_condition calcPolyline( const m4d::vec4 &startOrig, const m4d::vec4 &startDir,
                                             m4d::vec4*& points, m4d::vec4*& dirs, int &numPoints);
 
-    //! Calculate light ray and parallel transported local tetrad.
-    GvsLocalTetrad* calcParTransport( const m4d::vec4 &startOrig, const m4d::vec4 &startDir, const GvsLocalTetrad *lt,
-                                      int &numPoints, m4d::enum_break_condition &bc );
+    /**
+     * Calculate simple light ray into buffers provided by the caller.
+     *   The buffers keep their capacity; reusing them avoids memory allocations.
+     * @param startOrig   Initial position of the ray in coordinates.
+     * @param startDir    Initial direction of the ray in coordinates.
+     * @param points      Ray points.
+     * @param dirs        Ray directions.
+     * @return break condition
+     */
+    m4d::enum_break_condition calcPolyline( const m4d::vec4 &startOrig, const m4d::vec4 &startDir,
+                                            std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs );
+
+    /**
+     * Calculate a part of a light ray with at most 'maxPoints' points.
+     *   In contrast to calcPolyline, a start position that already satisfies
+     *   the break condition is not reported as an error because a chunk may
+     *   start where the previous chunk ended.
+     * @param startOrig   Initial position of the chunk in coordinates.
+     * @param startDir    Initial direction of the chunk in coordinates.
+     * @param maxPoints   Maximum number of points of the chunk.
+     * @param points      Chunk points; the buffer is cleared first.
+     * @param dirs        Chunk directions; the buffer is cleared first.
+     * @return break condition
+     */
+    m4d::enum_break_condition calcPolylineChunk( const m4d::vec4 &startOrig, const m4d::vec4 &startDir, int maxPoints,
+                                                 std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs );
+
+    /**
+     * Calculate several light rays as one packet, see GvsGeodSolver::calculateGeodesics.
+     *   A ray whose start position already satisfies the break condition gets no points.
+     * @param num        number of rays, at most GVS_PACKET_MAX_LANES
+     * @param startOrig  initial positions of the rays in coordinates
+     * @param startDir   initial directions of the rays in coordinates
+     * @param points     'num' buffers of ray points
+     * @param dirs       'num' buffers of ray directions
+     * @param bc         'num' break conditions
+     * @return false if the solver does not integrate packets
+     */
+    bool calcPolylinePacket( int num, const m4d::vec4* startOrig, const m4d::vec4* startDir,
+                             std::vector<m4d::vec4>* points, std::vector<m4d::vec4>* dirs,
+                             m4d::enum_break_condition* bc );
+
+    /**
+     * Calculate light ray and parallel transported local tetrad.
+     * @param tetrads     Buffer of local tetrads, see GvsGeodSolver::calcParTransport.
+     * @param numPoints   Reference to number of points calculated.
+     * @param bc          Break condition.
+     * @return false if the start position already satisfies the break condition
+     */
+    bool calcParTransport( const m4d::vec4 &startOrig, const m4d::vec4 &startDir, const GvsLocalTetrad *lt,
+                           std::vector<GvsLocalTetrad> &tetrads, int &numPoints, m4d::enum_break_condition &bc );
 
     //! Calculate light ray, parallel transport the Sachs basis vectors, and integrate the Jacobi equation.
     bool calcSachsJacobi( const m4d::vec4 &startOrig, const m4d::vec4 &startDir, const m4d::vec3 &localDir,
@@ -108,6 +188,7 @@ protected:
     GvsBoundBox4D  boundBox;        //!< Bounding box for ray tracing
 
     int    maxNumPoints;    //!< Maximum number of points to calculate    
+    int    chunkSize;       //!< Number of points per chunk for streaming integration (0: off)
 };
 
 #endif
@@ -18,6 +18,7 @@
 // ---------------------------------------------------------------------
 
 #include "GvsRayOneIS.h"
+#include <cfloat>
 #include <iostream>
 
 
@@ -62,6 +63,11 @@ GvsRayStatus GvsRayOneIS :: store( const GvsSurfIntersec &surfIntersec ) {
 }
 
 
+void GvsRayOneIS :: clearIntersections() {
+    raySurfIntersec.reset();
+}
+
+
 GvsSurfIntersec&  GvsRayOneIS::surfIntersec()  {
     return raySurfIntersec;
 }
@@ -83,7 +89,8 @@ int GvsRayOneIS :: intersecIndex ( ) const {
     else
   return ( rayVolIntersec.exitDist < DBL_MAX ) ? 2 : 0;
   */
-    return 0;
+    // Volume intersections are not supported yet.
+    return ( raySurfIntersec.dist() < DBL_MAX ) ? 1 : 0;
 }
 
 
@@ -65,6 +65,9 @@ public:
 
     GvsSceneObj*     intersecObject  ( ) const;
 
+protected:
+    virtual void    clearIntersections();
+
 protected:
     GvsSurfIntersec raySurfIntersec;
 };
@@ -0,0 +1,180 @@
+/**
+ * @file    GvsRaySegTree.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cfloat>
+#include <cmath>
+
+#include "Ray/GvsRay.h"
+#include "Ray/GvsRaySegTree.h"
+
+#define GVS_SEGTREE_LEAF_SIZE   8
+#define GVS_SEGTREE_STACK_SIZE  128
+#define GVS_SEGTREE_BOX_EPS     1e-9
+
+
+GvsRaySegTree::GvsRaySegTree() {
+    mMetric = NULL;
+    mNumTreePoints = 0;
+}
+
+GvsRaySegTree::~GvsRaySegTree() {
+    clear();
+}
+
+void GvsRaySegTree::clear() {
+    mPoints.clear();
+    mCharts.clear();
+    mNodes.clear();
+    mRoots.clear();
+    mNumTreePoints = 0;
+}
+
+
+void GvsRaySegTree::update ( const GvsRay &ray, m4d::Metric* metric ) {
+    int num = ray.getNumPoints();
+    if (metric != mMetric || num < numPoints()) {
+        clear();
+        mMetric = metric;
+    }
+
+    bool isCartesian = (metric == NULL) || (metric->getCoordType() == m4d::enum_coordinate_cartesian);
+
+    for (int i = numPoints(); i < num; i++) {
+        m4d::vec4 p  = ray.getPoint(i);
+        m4d::vec4 cp = p;
+        int chart = 0;
+        if (!isCartesian) {
+            chart = metric->transToPseudoCart(p, cp);
+        }
+        mPoints.push_back(cp);
+        mCharts.push_back(chart);
+    }
+
+    if (num > mNumTreePoints && num >= 2) {
+        // The segments of the new points start at the last point of the old ones.
+        mRoots.push_back(buildNode(GVS_MAX(mNumTreePoints-1, 0), num-1));
+
+        // Join the new tree with the trees before it which are not larger.
+        while (mRoots.size() >= 2) {
+            int n = static_cast<int>(mRoots.size());
+            const seg_node_t &left  = mNodes[mRoots[n-2]];
+            const seg_node_t &right = mNodes[mRoots[n-1]];
+            if (left.last - left.first > right.last - right.first) {
+                break;
+            }
+            mRoots[n-2] = joinNodes(mRoots[n-2], mRoots[n-1]);
+            mRoots.pop_back();
+        }
+    }
+    mNumTreePoints = num;
+}
+
+
+int GvsRaySegTree::findNextSegment ( int seg, int endSeg, const m4d::vec3 &lower, const m4d::vec3 &upper ) const {
+    int limit = GVS_MIN(endSeg, mNumTreePoints-1);
+    seg = GVS_MAX(seg, 0);
+    if (mNodes.empty() || seg >= limit) {
+        return endSeg;
+    }
+
+    // Slightly enlarge the box to be on the safe side with rounding errors.
+    double lo[3], up[3];
+    for (int k = 0; k < 3; k++) {
+        double eps = GVS_SEGTREE_BOX_EPS * (1.0 + GVS_MAX(fabs(lower.x(k)), fabs(upper.x(k))));
+        lo[k] = lower.x(k) - eps;
+        up[k] = upper.x(k) + eps;
+    }
+
+    // Trees of lower segments are visited first.
+    int stack[GVS_SEGTREE_STACK_SIZE];
+    int sp = 0;
+    for (int r = static_cast<int>(mRoots.size())-1; r >= 0; r--) {
+        stack[sp++] = mRoots[r];
+    }
+
+    while (sp > 0) {
+        const seg_node_t &node = mNodes[stack[--sp]];
+        if (node.last <= seg || node.first >= limit || !overlaps(node.bmin, node.bmax, lo, up)) {
+            continue;
+        }
+
+        if (node.right < 0) {
+            int last = GVS_MIN(node.last, limit);
+            for (int s = GVS_MAX(node.first, seg); s < last; s++) {
+                double bmin[3], bmax[3];
+                for (int k = 0; k < 3; k++) {
+                    bmin[k] = GVS_MIN(mPoints[s].x(k+1), mPoints[s+1].x(k+1));
+                    bmax[k] = GVS_MAX(mPoints[s].x(k+1), mPoints[s+1].x(k+1));
+                }
+                if (overlaps(bmin, bmax, lo, up)) {
+                    return s;
+                }
+            }
+        }
+        else {
+            // Left subtree holds the lower segments and is visited first.
+            stack[sp++] = node.right;
+            stack[sp++] = node.left;
+        }
+    }
+    return endSeg;
+}
+
+
+int GvsRaySegTree::buildNode ( int first, int last ) {
+    if (last - first > GVS_SEGTREE_LEAF_SIZE) {
+        int mid = first + (last - first)/2;
+        int leftIdx  = buildNode(first, mid);
+        int rightIdx = buildNode(mid, last);
+        return joinNodes(leftIdx, rightIdx);
+    }
+
+    seg_node_t node;
+    node.first = first;
+    node.last  = last;
+    node.left  = -1;
+    node.right = -1;
+    for (int k = 0; k < 3; k++) {
+        node.bmin[k] =  DBL_MAX;
+        node.bmax[k] = -DBL_MAX;
+    }
+    for (int i = first; i <= last; i++) {
+        for (int k = 0; k < 3; k++) {
+            node.bmin[k] = GVS_MIN(node.bmin[k], mPoints[i].x(k+1));
+            node.bmax[k] = GVS_MAX(node.bmax[k], mPoints[i].x(k+1));
+        }
+    }
+    mNodes.push_back(node);
+    return static_cast<int>(mNodes.size()) - 1;
+}
+
+
+int GvsRaySegTree::joinNodes ( int leftIdx, int rightIdx ) {
+    const seg_node_t &left  = mNodes[leftIdx];
+    const seg_node_t &right = mNodes[rightIdx];
+
+    seg_node_t node;
+    node.first = left.first;
+    node.last  = right.last;
+    node.left  = leftIdx;
+    node.right = rightIdx;
+    for (int k = 0; k < 3; k++) {
+        node.bmin[k] = GVS_MIN(left.bmin[k], right.bmin[k]);
+        node.bmax[k] = GVS_MAX(left.bmax[k], right.bmax[k]);
+    }
+    mNodes.push_back(node);
+    return static_cast<int>(mNodes.size()) - 1;
+}
+
+
+bool GvsRaySegTree::overlaps ( const double* bmin, const double* bmax,
+                               const double* lower, const double* upper ) const {
+    for (int k = 0; k < 3; k++) {
+        if (bmax[k] < lower[k] || bmin[k] > upper[k]) {
+            return false;
+        }
+    }
+    return true;
+}
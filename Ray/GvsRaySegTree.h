@@ -0,0 +1,104 @@
+/**
+ * @file    GvsRaySegTree.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_RAY_SEG_TREE_H
+#define GVS_RAY_SEG_TREE_H
+
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+#include <m4dGlobalDefs.h>
+#include <metric/m4dMetric.h>
+
+class GvsRay;
+
+/**
+ * Segment hierarchy of a ray polyline.
+ *   The points of the ray are transformed once into pseudo-Cartesian
+ *   coordinates together with their chart. A binary tree over the axis-aligned
+ *   bounding boxes of the segments allows to find those segments which overlap
+ *   the bounding box of an object. The tree is built over contiguous ranges of
+ *   segments, thus segments are found in ascending order.
+ *
+ *   The structure is owned by the ray and updated lazily; points appended by
+ *   chunked integration are transformed incrementally. The segments of the
+ *   appended points get a tree of their own, and adjacent trees are joined
+ *   like the digits of a binary counter; thus, the tree is never rebuilt and
+ *   the ray is covered by a few trees of decreasing size.
+ */
+class GvsRaySegTree
+{
+public:
+    GvsRaySegTree();
+    virtual ~GvsRaySegTree();
+
+    //! Forget all points; must be called whenever the points of the ray change.
+    void  clear();
+
+    /**
+     * Transform all points not transformed yet and extend the trees by the
+     * segments of the appended points.
+     * @param ray     ray the tree belongs to
+     * @param metric  metric for the transformation; NULL means Cartesian coordinates
+     */
+    void  update ( const GvsRay &ray, m4d::Metric* metric );
+
+    int   numPoints () const;
+
+    /**
+     * Pseudo-Cartesian point and chart of a ray point.
+     */
+    const m4d::vec4&  getPoint ( int index ) const;
+    int               getChart ( int index ) const;
+
+    /**
+     * Find the first segment in [seg,endSeg) whose bounding box overlaps the box [lower,upper].
+     * @return segment index or endSeg if there is none
+     */
+    int   findNextSegment ( int seg, int endSeg, const m4d::vec3 &lower, const m4d::vec3 &upper ) const;
+
+protected:
+    typedef struct seg_node_struct {
+        double  bmin[3];
+        double  bmax[3];
+        int     first;    //!< first segment
+        int     last;     //!< segment after the last one
+        int     left;     //!< index of left child, -1 for leaf nodes
+        int     right;    //!< index of right child, -1 for leaf nodes
+    } seg_node_t;
+
+    int   buildNode ( int first, int last );
+
+    //! Add the parent node of two adjacent subtrees.
+    int   joinNodes ( int leftIdx, int rightIdx );
+
+    bool  overlaps ( const double* bmin, const double* bmax,
+                     const double* lower, const double* upper ) const;
+
+protected:
+    std::vector<m4d::vec4>   mPoints;
+    std::vector<int>         mCharts;
+    std::vector<seg_node_t>  mNodes;
+    std::vector<int>         mRoots;    //!< roots of the trees in ascending order of their segments
+
+    m4d::Metric*  mMetric;
+    int           mNumTreePoints;   //!< number of points covered by the tree
+};
+
+
+inline int GvsRaySegTree::numPoints() const {
+    return static_cast<int>(mPoints.size());
+}
+
+inline const m4d::vec4& GvsRaySegTree::getPoint( int index ) const {
+    return mPoints[index];
+}
+
+inline int GvsRaySegTree::getChart( int index ) const {
+    return mCharts[index];
+}
+
+#endif // GVS_RAY_SEG_TREE_H
@@ -83,11 +83,11 @@ GvsRayVisual :: GvsRayVisual ( const m4d::vec4 &orig, const m4d::vec4 &dir, cons
     rayMaxContrib = 1.0;
 }
 
-GvsRayVisual :: GvsRayVisual ( m4d::vec4* geodPoints, m4d::vec4* geodTangents, int numPoints, int index )
+GvsRayVisual :: GvsRayVisual ( const m4d::vec4* geodPoints, const m4d::vec4* geodTangents, int numPoints, int index )
     : GvsRayClosestIS ( )
 {
-    setPoints( geodPoints );
-    setDirs( geodTangents );
+    setPoints( geodPoints, numPoints );
+    setDirs( geodTangents, numPoints );
     setNumPoints( numPoints );
 
     rayIndex = index;
@@ -30,7 +30,7 @@ public:
     GvsRayVisual ( const m4d::vec4 &orig, const m4d::vec4 &dir, GvsRayGen* gen, int index = 1);
     GvsRayVisual ( const m4d::vec4 &orig, const m4d::vec4 &dir, GvsRayGen* gen,
                    double minSearchDist, double maxSearchDist, int index = 1 );
-    GvsRayVisual( m4d::vec4* geodPoints, m4d::vec4* geodTangents, int numPoints, int index = 1 );
+    GvsRayVisual( const m4d::vec4* geodPoints, const m4d::vec4* geodTangents, int numPoints, int index = 1 );
 
     GvsRayVisual ( const m4d::vec4 &orig, const m4d::vec4 &dir, const GvsLocalTetrad *tetrad,
                    GvsRayGen* gen, int index = 1);
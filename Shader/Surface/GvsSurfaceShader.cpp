@@ -103,7 +103,7 @@ GvsColor GvsSurfaceShader::reflLightColor( GvsDevice* device, GvsRayVisual &ray
             m4d::vec4 rayDir = m4d::vec4(-1.0,lightDir.x(0),lightDir.x(1),lightDir.x(2));
 
             // calculate a shadow ray
-            GvsRayVisual* eyeRay = new GvsRayVisual(device->projector->getRayGen());
+            GvsRayVisual* eyeRay = device->projector->getSecondaryRay();
             eyeRay->recalc( isecPoint, rayDir );
 
             if (device->sceneGraph != nullptr) {
@@ -112,8 +112,6 @@ GvsColor GvsSurfaceShader::reflLightColor( GvsDevice* device, GvsRayVisual &ray
                     outLight += light->color();
                 }
             }
-
-            delete eyeRay;
         }
     }
     return outLight;
@@ -0,0 +1,77 @@
+/**
+ * @file    GvsAllocCounter.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cstdlib>
+#include <new>
+
+#include "Utils/GvsAllocCounter.h"
+
+#ifdef GVS_COUNT_ALLOCATIONS
+
+static thread_local unsigned long gvsNumAllocations = 0;
+
+static void* countedAlloc ( std::size_t size ) {
+    gvsNumAllocations++;
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new ( std::size_t size ) {
+    void* p = countedAlloc(size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[] ( std::size_t size ) {
+    void* p = countedAlloc(size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new ( std::size_t size, const std::nothrow_t& ) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[] ( std::size_t size, const std::nothrow_t& ) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete ( void* p ) noexcept {
+    std::free(p);
+}
+
+void operator delete[] ( void* p ) noexcept {
+    std::free(p);
+}
+
+void operator delete ( void* p, std::size_t ) noexcept {
+    std::free(p);
+}
+
+void operator delete[] ( void* p, std::size_t ) noexcept {
+    std::free(p);
+}
+
+void operator delete ( void* p, const std::nothrow_t& ) noexcept {
+    std::free(p);
+}
+
+void operator delete[] ( void* p, const std::nothrow_t& ) noexcept {
+    std::free(p);
+}
+
+#endif // GVS_COUNT_ALLOCATIONS
+
+
+unsigned long GvsAllocCounter::numAllocations() {
+#ifdef GVS_COUNT_ALLOCATIONS
+    return gvsNumAllocations;
+#else
+    return 0UL;
+#endif
+}
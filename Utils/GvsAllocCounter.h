@@ -0,0 +1,37 @@
+/**
+ * @file    GvsAllocCounter.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_ALLOC_COUNTER_H
+#define GVS_ALLOC_COUNTER_H
+
+/**
+ * Counter of heap allocations.
+ *   If GeoViS is configured with GVS_COUNT_ALLOCATIONS, the global operators
+ *   new and delete are replaced and every call of 'new' is counted per thread.
+ *   Direct calls of malloc, e.g. within the GSL, are not counted. Without
+ *   GVS_COUNT_ALLOCATIONS, the counter is always zero.
+ *
+ *   The sample manager uses the counter to check that rendering a pixel does
+ *   not allocate memory once the buffers of the rays are large enough.
+ */
+class GvsAllocCounter
+{
+public:
+    static bool           isEnabled ();
+
+    //! Number of allocations of the calling thread so far.
+    static unsigned long  numAllocations ();
+};
+
+
+inline bool GvsAllocCounter::isEnabled() {
+#ifdef GVS_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#endif // GVS_ALLOC_COUNTER_H
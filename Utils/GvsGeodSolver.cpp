@@ -1,5 +1,8 @@
 
 #include "GvsGeodSolver.h"
+#include "Utils/GvsStatistics.h"
+
+#include <algorithm>
 
 #include <metric/m4dMetricDatabase.h>
 #include <motion/m4dMotionList.h>
@@ -20,6 +23,9 @@ GvsGeodSolver::GvsGeodSolver( m4d::Metric *metric, m4d::enum_integrator m4dGeodS
     maxStepsize = DEF_MAX_STEPSIZE;
 
     m4dSolver = nullptr;
+    mPacketSolver = nullptr;
+    mKernelSolver = nullptr;
+    mUseNative = true;
     setSolver( m4dGeodSolver );
 
     int solverID = static_cast<int>(m4dGeodSolver);
@@ -28,6 +34,7 @@ GvsGeodSolver::GvsGeodSolver( m4d::Metric *metric, m4d::enum_integrator m4dGeodS
     } else {
         solverName = std::string("Unknown");
     }
+    updateKernelSolver(mMetric);
 }
 
 GvsGeodSolver::GvsGeodSolver( m4d::Metric *metric, m4d::enum_geodesic_type gType,
@@ -44,6 +51,9 @@ GvsGeodSolver::GvsGeodSolver( m4d::Metric *metric, m4d::enum_geodesic_type gType
     maxStepsize = DEF_MAX_STEPSIZE;
 
     m4dSolver = nullptr;
+    mPacketSolver = nullptr;
+    mKernelSolver = nullptr;
+    mUseNative = true;
     setSolver( m4dGeodSolver );
 
     int solverID = static_cast<int>(m4dGeodSolver);
@@ -52,17 +62,45 @@ GvsGeodSolver::GvsGeodSolver( m4d::Metric *metric, m4d::enum_geodesic_type gType
     } else {
         solverName = std::string("Unknown");
     }
+    updateKernelSolver(mMetric);
 }
 
 
 GvsGeodSolver::~GvsGeodSolver() {
     delete m4dSolver;
+    delete mPacketSolver;
+    delete mKernelSolver;
     mMetric = nullptr;
 }
 
 
+GvsGeodSolver* GvsGeodSolver::clone( m4d::Metric* metric ) const {
+    GvsGeodSolver* solver = new GvsGeodSolver(metric, mGeodType, mTimeDir, m4dGeodSolverType);
+    solver->setGeodType(mGeodType);
+    solver->setStepSizeControl(stepSizeControlled);
+    solver->setStepsize(stepSize);
+    solver->setMaxStepsize(maxStepsize);
+    solver->setEpsilons(epsilon_abs, epsilon_rel);
+    solver->setNativeKernel(mUseNative);
+
+    m4d::vec4 boxMin, boxMax;
+    m4dSolver->getBoundingBox(boxMin, boxMax);
+    solver->setBoundingBox(boxMin, boxMax);
+
+    if (mPacketSolver != nullptr) {
+        solver->setPacketSize(mPacketSolver->getNumLanes());
+    }
+    return solver;
+}
+
+
 void GvsGeodSolver::setMetric( m4d::Metric* metric) {
     m4dSolver->setMetric(metric);
+    if (mPacketSolver != nullptr && !mPacketSolver->setMetric(metric)) {
+        delete mPacketSolver;
+        mPacketSolver = nullptr;
+    }
+    updateKernelSolver(metric);
 }
 
 m4d::Metric* GvsGeodSolver::getMetric() {
@@ -87,12 +125,25 @@ bool GvsGeodSolver::setSolver( m4d::enum_integrator m4dGeodSolver ) {
     m4dGeodSolverType = m4dGeodSolver;
     m4dSolver = intDB.getIntegrator(mMetric, m4dGeodSolver);
     solverName = intDB.getIntegratorName(m4dGeodSolver);
+    updateKernelSolver(mMetric);
+    if (mPacketSolver != nullptr && !canIntegratePackets("setSolver")) {
+        delete mPacketSolver;
+        mPacketSolver = nullptr;
+    }
     return true;
 }
 
+m4d::enum_integrator GvsGeodSolver::getSolverType() const {
+    return m4dGeodSolverType;
+}
+
 void GvsGeodSolver::setGeodType( m4d::enum_geodesic_type gType ) {
     m4dSolver->setGeodesicType(gType);
     mGeodType = gType;
+    if (mPacketSolver != nullptr && !canIntegratePackets("setGeodType")) {
+        delete mPacketSolver;
+        mPacketSolver = nullptr;
+    }
 }
 
 m4d::enum_geodesic_type GvsGeodSolver::getGeodType() const {
@@ -146,6 +197,80 @@ double GvsGeodSolver::getMaxStepsize() const {
     return maxStepsize;
 }
 
+void GvsGeodSolver::setPacketSize( int numLanes ) {
+    delete mPacketSolver;
+    mPacketSolver = nullptr;
+    if (numLanes <= 0 || !canIntegratePackets("setPacketSize")) {
+        return;
+    }
+
+    mPacketSolver = new GvsPacketSolver(mMetric, numLanes);
+    if (!mPacketSolver->isValid()) {
+        fprintf(stderr,"GvsGeodSolver::setPacketSize() ... no packet kernel for metric %s. Using the scalar solver.\n",
+                (mMetric != nullptr) ? mMetric->getMetricName() : "none");
+        delete mPacketSolver;
+        mPacketSolver = nullptr;
+    }
+}
+
+int GvsGeodSolver::getPacketSize() const {
+    return (mPacketSolver != nullptr) ? mPacketSolver->getNumLanes() : 0;
+}
+
+void GvsGeodSolver::setNativeKernel( bool useNative ) {
+    mUseNative = useNative;
+    updateKernelSolver(m4dSolver->getMetric());
+    if (mPacketSolver != nullptr && !canIntegratePackets("setNativeKernel")) {
+        delete mPacketSolver;
+        mPacketSolver = nullptr;
+    }
+}
+
+bool GvsGeodSolver::getNativeKernel() const {
+    return (mKernelSolver != nullptr);
+}
+
+void GvsGeodSolver::updateKernelSolver( m4d::Metric* metric ) {
+    delete mKernelSolver;
+    mKernelSolver = nullptr;
+    if (mUseNative) {
+        mKernelSolver = GvsKernelSolver::create(metric, solverName.c_str());
+    }
+}
+
+bool GvsGeodSolver::canIntegratePackets( const char* caller ) const {
+    if (!mUseNative) {
+        fprintf(stderr,"GvsGeodSolver::%s() ... packets need the native kernels. Using the scalar solver.\n",caller);
+        return false;
+    }
+    if (mGeodType != m4d::enum_geodesic_lightlike) {
+        fprintf(stderr,"GvsGeodSolver::%s() ... packets only hold light rays. Using the scalar solver.\n",caller);
+        return false;
+    }
+    if (gvsFindRKTableau(solverName.c_str()) == NULL) {
+        fprintf(stderr,"GvsGeodSolver::%s() ... no packet integrator for solver %s. Using the scalar solver.\n",
+                caller,solverName.c_str());
+        return false;
+    }
+    return true;
+}
+
+void GvsGeodSolver::getRKParams( GvsRKParams &params ) {
+    params.tableau = gvsFindRKTableau(solverName.c_str());
+    params.stepSize = stepSize;
+    params.maxStepSize = maxStepsize;
+    params.stepCtrl = stepSizeControlled;
+    params.epsAbs = epsilon_abs;
+    params.epsRel = epsilon_rel;
+
+    m4d::vec4 boxMin, boxMax;
+    m4dSolver->getBoundingBox(boxMin, boxMax);
+    for (int i = 0; i < 4; i++) {
+        params.boxMin[i] = boxMin.x(i);
+        params.boxMax[i] = boxMax.x(i);
+    }
+}
+
 
 int GvsGeodSolver::startConditionLocal( const m4d::vec4* , m4d::vec4 &dir ) {
     int l;
@@ -346,10 +471,22 @@ GvsGeodSolver::calculateGeodesic( const m4d::vec4& yStart, const m4d::vec4& yDir
                                     const double maxNumPoints,
                                     m4d::vec4 *&points, m4d::vec4 *&dirs, int &numPoints )
 {
+    if (mKernelSolver != nullptr && mGeodType == m4d::enum_geodesic_lightlike) {
+        m4d::enum_break_condition breakCond = calculateGeodesic(yStart, yDir, static_cast<int>(maxNumPoints), mPoints, mDirs);
+        numPoints = static_cast<int>(mPoints.size());
+        points = new m4d::vec4[numPoints];
+        dirs   = new m4d::vec4[numPoints];
+        std::copy(mPoints.begin(), mPoints.end(), points);
+        std::copy(mDirs.begin(), mDirs.end(), dirs);
+        return breakCond;
+    }
+
     // std::cerr << "Starte CalcGeod tg\n";
     m4dSolver->setMaxAffineParamStep(maxStepsize);
     m4dSolver->setAffineParamStep(stepSize);
-    return m4dSolver->calculateGeodesic(yStart, yDir, maxNumPoints, points, dirs, numPoints);
+    m4d::enum_break_condition breakCond = m4dSolver->calculateGeodesic(yStart, yDir, maxNumPoints, points, dirs, numPoints);
+    GvsStatistics::countGeodesic(numPoints, breakCond);
+    return breakCond;
 }
 
 m4d::enum_break_condition
@@ -364,50 +501,132 @@ GvsGeodSolver::calcSachsJacobi( const m4d::vec4 &startOrig, const m4d::vec4 &sta
     m4d::vec3 locX = m4d::vec3(1.0,0.0,0.0);
     m4d::vec3 locY = m4d::vec3(0.0,1.0,0.0);
     m4d::vec3 locZ = m4d::vec3(0.0,0.0,1.0);
-    return m4dSolver->calcSachsJacobi(startOrig, startDir, localDir,locX,locY,locZ,
+    m4d::enum_break_condition breakCond = m4dSolver->calcSachsJacobi(startOrig, startDir, localDir,locX,locY,locZ,
                                       lt->getE(0),lt->getE(1),lt->getE(2),lt->getE(3),
                                       lt->getLFType(),maxNumPoints,
                                       points,dirs,lambda,sachs1,sachs2,rayJacobi,rayMaxJacobi,numPoints);
+    GvsStatistics::countGeodesic(numPoints, breakCond);
+    return breakCond;
 }
 
 m4d::enum_break_condition
-GvsGeodSolver::calcParTransport( const m4d::vec4& yStart, const m4d::vec4& yDir, const m4d::vec4 base[],
-                                   const double maxNumPoints,
-                                   GvsLocalTetrad *&lt, int &numPoints )
+GvsGeodSolver::calculateGeodesic( const m4d::vec4& yStart, const m4d::vec4& yDir,
+                                    const int maxNumPoints,
+                                    std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs )
+{
+    return calculateGeodesic(yStart, yDir, maxNumPoints, points, dirs, mLambdas);
+}
+
+m4d::enum_break_condition
+GvsGeodSolver::calculateGeodesic( const m4d::vec4& yStart, const m4d::vec4& yDir,
+                                    const int maxNumPoints,
+                                    std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs,
+                                    std::vector<double> &lambdas )
 {
-    //return m4d::enum_break_other;
+    if (mKernelSolver != nullptr && mGeodType == m4d::enum_geodesic_lightlike) {
+        GvsRKParams params;
+        getRKParams(params);
+        mKernelSolver->setParams(params);
+        m4d::enum_break_condition breakCond = mKernelSolver->calculateGeodesic(yStart, yDir, maxNumPoints, points, dirs, &lambdas);
+        GvsStatistics::countGeodesic(static_cast<int>(points.size()), breakCond);
+        return breakCond;
+    }
+
     m4dSolver->setMaxAffineParamStep(maxStepsize);
     m4dSolver->setAffineParamStep(stepSize);
-    std::vector<double> lambdas;
-    std::vector<m4d::vec4> points;
-    std::vector<m4d::vec4> dirs;
-    // ToDo Stimmt lt=e ???
-    std::vector<m4d::vec4> lt0, lt1, lt2, lt3;
+    points.clear();
+    dirs.clear();
+    lambdas.clear();
+    m4d::enum_break_condition breakCond = m4dSolver->calculateGeodesic(yStart, yDir, maxNumPoints, points, dirs, lambdas);
+    GvsStatistics::countGeodesic(static_cast<int>(points.size()), breakCond);
+    return breakCond;
+}
 
-    m4d::enum_break_condition breakCond = m4dSolver->calcParTransport(yStart, yDir, base[0], base[1], base[2], base[3], maxNumPoints, points, dirs, lambdas, lt0, lt1, lt2, lt3);
+bool GvsGeodSolver::calculateGeodesics( int num, const m4d::vec4* yStart, const m4d::vec4* yDir, const int maxNumPoints,
+                                        std::vector<m4d::vec4>* points, std::vector<m4d::vec4>* dirs,
+                                        m4d::enum_break_condition* breakConds )
+{
+    if (mPacketSolver == nullptr) {
+        return false;
+    }
+
+    GvsRKParams params;
+    getRKParams(params);
+    mPacketSolver->setParams(params);
+    mPacketSolver->calculateGeodesics(num, yStart, yDir, maxNumPoints, points, dirs, breakConds);
+    for (int i = 0; i < num; i++) {
+        GvsStatistics::countGeodesic(static_cast<int>(points[i].size()), breakConds[i]);
+    }
+    return true;
+}
 
-    //m4d::vec4 acc, olddir;
-    //double oldtime = 0;
-    numPoints = points.size();
+m4d::enum_break_condition
+GvsGeodSolver::calcParTransport( const m4d::vec4& yStart, const m4d::vec4& yDir, const m4d::vec4 base[],
+                                   const double maxNumPoints,
+                                   GvsLocalTetrad *&lt, int &numPoints )
+{
+    m4d::enum_break_condition breakCond = calcParTransportScratch(yStart, yDir, base, static_cast<int>(maxNumPoints));
+    numPoints = static_cast<int>(mPoints.size());
     if (numPoints<2) {
         return m4d::enum_break_other;
     }
 
     lt = new GvsLocalTetrad[numPoints];
-    for (unsigned int i=0; i<points.size(); i++) {
-        lt[i].setLocalTime(lambdas[i]);
-        lt[i].setMetric(mMetric);
-        lt[i].setPosition(points[i]);
-        lt[i].setVelocity(dirs[i]);
-        //for (int j= 0; j<4; j++){ acc.setX(j,(dirs[i][j]-olddir[j])/(points[i][0]-oldtime));    }
-        //oldtime=points[i][0];
-        //olddir=dirs[i];
-        //lt[i].setAccel(acc); ???
-        lt[i].setTetrad(lt0[i],lt1[i],lt2[i],lt3[i]);
+    for (int i=0; i<numPoints; i++) {
+        setTetradFromScratch(i, lt[i]);
     }
     return breakCond;
 }
 
+m4d::enum_break_condition
+GvsGeodSolver::calcParTransport( const m4d::vec4& yStart, const m4d::vec4& yDir, const m4d::vec4 base[],
+                                   const int maxNumPoints,
+                                   std::vector<GvsLocalTetrad> &lt, int &numPoints )
+{
+    m4d::enum_break_condition breakCond = calcParTransportScratch(yStart, yDir, base, maxNumPoints);
+    numPoints = static_cast<int>(mPoints.size());
+    if (numPoints<2) {
+        return m4d::enum_break_other;
+    }
+
+    // Constructing a local tetrad is expensive; existing ones are only overwritten.
+    if (static_cast<int>(lt.size()) < numPoints) {
+        lt.resize(numPoints);
+    }
+    for (int i=0; i<numPoints; i++) {
+        setTetradFromScratch(i, lt[i]);
+    }
+    return breakCond;
+}
+
+m4d::enum_break_condition
+GvsGeodSolver::calcParTransportScratch( const m4d::vec4& yStart, const m4d::vec4& yDir,
+                                          const m4d::vec4 base[], const int maxNumPoints )
+{
+    m4dSolver->setMaxAffineParamStep(maxStepsize);
+    m4dSolver->setAffineParamStep(stepSize);
+    mLambdas.clear();
+    mPoints.clear();
+    mDirs.clear();
+    for (int i=0; i<4; i++) {
+        mTetradE[i].clear();
+    }
+    // ToDo Stimmt lt=e ???
+    m4d::enum_break_condition breakCond = m4dSolver->calcParTransport(yStart, yDir, base[0], base[1], base[2], base[3], maxNumPoints,
+                                       mPoints, mDirs, mLambdas, mTetradE[0], mTetradE[1], mTetradE[2], mTetradE[3]);
+    GvsStatistics::countGeodesic(static_cast<int>(mPoints.size()), breakCond);
+    return breakCond;
+}
+
+void GvsGeodSolver::setTetradFromScratch( int index, GvsLocalTetrad &lt ) const {
+    lt.setLocalTime(mLambdas[index]);
+    lt.setMetric(mMetric);
+    lt.setPosition(mPoints[index]);
+    lt.setVelocity(mDirs[index]);
+    //lt.setAccel(acc); ???
+    lt.setTetrad(mTetradE[0][index],mTetradE[1][index],mTetradE[2][index],mTetradE[3][index]);
+}
+
 
 void GvsGeodSolver::setBoundingBox( const double p1[4], const double p2[4] ) {
     m4dSolver->setBoundingBox(p1, p2);
@@ -460,5 +679,7 @@ void GvsGeodSolver::Print( FILE* fptr ) {
     fprintf(fptr,"\tstepCtr : %s\n", (stepSizeControlled?"yes":"no"));
     fprintf(fptr,"\teps_abs : %6.3f\n",epsilon_abs);
     fprintf(fptr,"\teps_rel : %6.3f\n",epsilon_rel);
+    fprintf(fptr,"\tpacket  : %d\n",getPacketSize());
+    fprintf(fptr,"\tkernel  : %s\n",(mKernelSolver != nullptr) ? gvsKernelName(mKernelSolver->getKernel()) : "none");
     fprintf(fptr,"}");
 }
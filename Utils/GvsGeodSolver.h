@@ -3,9 +3,12 @@
 
 #include <iostream>
 #include <cstdio>
+#include <vector>
 
 #include "Obj/GvsBase.h"
 #include "Obj/STMotion/GvsLocalTetrad.h"
+#include "Utils/GvsKernelSolver.h"
+#include "Utils/GvsPacketSolver.h"
 #include "motion/m4dGeodesic.h"
 #include "motion/m4dMotionList.h"
 #include "metric/m4dMetric.h"
@@ -22,10 +25,20 @@ public:
 
     ~GvsGeodSolver();
 
+    /**
+     * Create a new solver with the same settings but its own integrator.
+     *   The new solver works on the given metric, which should be a copy of the
+     *   metric of this solver. Thus, both solvers can be used concurrently.
+     * @param metric  pointer to metric used by the new solver
+     * @return pointer to new solver
+     */
+    GvsGeodSolver* clone( m4d::Metric* metric ) const;
+
     void setMetric( m4d::Metric* metric );
     m4d::Metric* getMetric();
 
     bool setSolver( m4d::enum_integrator m4dGeodSolver );
+    m4d::enum_integrator  getSolverType() const;
 
     void                     setGeodType( m4d::enum_geodesic_type gType );
     m4d::enum_geodesic_type  getGeodType() const;
@@ -45,6 +58,29 @@ public:
     void   setMaxStepsize( double step );
     double getMaxStepsize() const;
 
+    /**
+     * Integrate light rays packet by packet, see GvsPacketSolver.
+     *   Only light rays of metrics with a native kernel can be integrated as
+     *   packets, and only with the native kernels switched on and a Runge-Kutta
+     *   solver of GvsRungeKutta.h; otherwise, a warning is printed and the
+     *   scalar solver is used.
+     * @param numLanes  geodesics per packet, 4 or 8; zero switches packets off
+     */
+    void   setPacketSize( int numLanes );
+
+    //! Number of geodesics per packet; zero if packets are not used.
+    int    getPacketSize() const;
+
+    /**
+     * Use the native kernel of the metric for single light rays, see GvsKernelSolver.
+     *   The kernel is only available for some metrics and solvers; it is used by default.
+     * @param useNative  false forces the solver of libMotion4D
+     */
+    void   setNativeKernel( bool useNative );
+
+    //! The native kernel is used for single light rays.
+    bool   getNativeKernel() const;
+
 
     int startConditionLocal ( const m4d::vec4* pos, m4d::vec4 &dir );
 
@@ -63,6 +99,56 @@ public:
                                                  const double maxNumPoints,
                                                  GvsLocalTetrad *&lt, int &numPoints );
 
+    /**
+     * Calculate a geodesic into buffers provided by the caller.
+     *   The buffers are cleared but keep their capacity. Thus, reusing the same
+     *   buffers for many geodesics does not allocate memory once they are large enough.
+     * @param yStart        initial position in coordinates
+     * @param yDir          initial direction in coordinates
+     * @param maxNumPoints  maximum number of points
+     * @param points        geodesic points
+     * @param dirs          geodesic tangents
+     * @return break condition
+     */
+    m4d::enum_break_condition calculateGeodesic ( const m4d::vec4& yStart, const m4d::vec4& yDir,
+                                                  const int maxNumPoints,
+                                                  std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs );
+
+    //! Calculate a geodesic into buffers provided by the caller and keep the affine parameters of the points.
+    m4d::enum_break_condition calculateGeodesic ( const m4d::vec4& yStart, const m4d::vec4& yDir,
+                                                  const int maxNumPoints,
+                                                  std::vector<m4d::vec4> &points, std::vector<m4d::vec4> &dirs,
+                                                  std::vector<double> &lambdas );
+
+    /**
+     * Calculate a geodesic and parallel transport the local tetrad into a buffer provided by the caller.
+     *   The tetrads of the buffer are overwritten. The buffer only grows, hence
+     *   it may hold more than 'numPoints' tetrads.
+     * @param lt         buffer of local tetrads
+     * @param numPoints  number of valid tetrads
+     * @return break condition
+     */
+    /**
+     * Calculate several geodesics with the packet solver.
+     *   The points and tangents of geodesic i are stored into points[i] and
+     *   dirs[i]; the buffers are cleared but keep their capacity.
+     * @param num           number of geodesics
+     * @param yStart        initial positions in coordinates
+     * @param yDir          initial directions in coordinates
+     * @param maxNumPoints  maximum number of points of a geodesic
+     * @param points        'num' buffers of geodesic points
+     * @param dirs          'num' buffers of geodesic tangents
+     * @param breakConds    'num' break conditions
+     * @return false if packets are not used
+     */
+    bool calculateGeodesics ( int num, const m4d::vec4* yStart, const m4d::vec4* yDir, const int maxNumPoints,
+                              std::vector<m4d::vec4>* points, std::vector<m4d::vec4>* dirs,
+                              m4d::enum_break_condition* breakConds );
+
+    m4d::enum_break_condition calcParTransport ( const m4d::vec4& yStart, const m4d::vec4& yDir, const m4d::vec4 base[4],
+                                                 const int maxNumPoints,
+                                                 std::vector<GvsLocalTetrad> &lt, int &numPoints );
+
     m4d::enum_break_condition calcSachsJacobi ( const m4d::vec4 &startOrig, const m4d::vec4 &startDir, const m4d::vec3 &localDir,
                                                 const int maxNumPoints,
                                                 const GvsLocalTetrad *lt,
@@ -84,6 +170,20 @@ public:
 protected:
     bool   outsideBoundingBox ( const double* pos );
 
+    //! Create the native kernel solver for the current metric and solver, if any.
+    void   updateKernelSolver ( m4d::Metric* metric );
+
+    //! Packets can be integrated with the current solver and geodesic type; warns otherwise.
+    bool   canIntegratePackets ( const char* caller ) const;
+
+    //! Current integration parameters for the native solvers.
+    void   getRKParams ( GvsRKParams &params );
+
+    //! Integrate the parallel transport into the scratch buffers.
+    m4d::enum_break_condition calcParTransportScratch ( const m4d::vec4& yStart, const m4d::vec4& yDir,
+                                                        const m4d::vec4 base[4], const int maxNumPoints );
+    void   setTetradFromScratch ( int index, GvsLocalTetrad &lt ) const;
+
 private:
     m4d::Metric*     mMetric;
     m4d::enum_geodesic_type  mGeodType;
@@ -100,11 +200,21 @@ private:
     double stepSize;       //!< Initial stepsize for calculateGeodesic
     double maxStepsize;    //!< Maximum stepsize for calculation
 
+    GvsPacketSolver*  mPacketSolver;   //!< NULL if packets are not used
+    GvsKernelSolver*  mKernelSolver;   //!< NULL if the metric or solver has no native kernel
+    bool              mUseNative;
+
 
     // The bounding box parameters for the four coordinates
     double  boundBoxMin[4];
     double  boundBoxMax[4];
 
+    // Scratch buffers of the integration; they keep their capacity between geodesics.
+    std::vector<double>     mLambdas;
+    std::vector<m4d::vec4>  mPoints;
+    std::vector<m4d::vec4>  mDirs;
+    std::vector<m4d::vec4>  mTetradE[4];
+
 };
 
 #endif
@@ -0,0 +1,185 @@
+/**
+ * @file    GvsKernelSolver.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Utils/GvsKernelSolver.h"
+#include "Utils/GvsStatistics.h"
+
+#include <cassert>
+
+/**
+ * Integrator of one metric kernel.
+ */
+template <class K>
+class GvsKernelSolverT : public GvsKernelSolver
+{
+public:
+    GvsKernelSolverT( m4d::Metric* metric, GvsMetricKernel kernel )
+        : GvsKernelSolver(metric, kernel) {
+    }
+
+    virtual m4d::enum_break_condition calculateGeodesic( const m4d::vec4 &yStart, const m4d::vec4 &yDir,
+                                                         int maxNumPoints, std::vector<m4d::vec4> &points,
+                                                         std::vector<m4d::vec4> &dirs, std::vector<double>* lambdas );
+
+protected:
+    //! Right hand side of the geodesic equation.
+    void derivs( const double* y, double* dydx ) const {
+        for (int i = 0; i < 4; i++) {
+            dydx[i] = y[i+4];
+        }
+        gvsGeodesicAccel(mMetricKernel, y, y + 4, dydx + 4);
+    }
+
+    //! One step of the embedded Runge-Kutta method.
+    void step( const double* y, double h, double* yNew, double* yErr ) const;
+
+private:
+    K  mMetricKernel;
+};
+
+
+template <class K>
+void GvsKernelSolverT<K>::step( const double* y, double h, double* yNew, double* yErr ) const {
+    const GvsRKTableau &tab = *mParams.tableau;
+    double k[6][8];
+    double yTmp[8];
+    derivs(y, k[0]);
+    for (int s = 1; s < 6; s++) {
+        for (int i = 0; i < 8; i++) {
+            double sum = 0.0;
+            for (int j = 0; j < s; j++) {
+                sum += tab.b[s][j]*k[j][i];
+            }
+            yTmp[i] = y[i] + h*sum;
+        }
+        derivs(yTmp, k[s]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        double sum = 0.0;
+        double err = 0.0;
+        for (int s = 0; s < 6; s++) {
+            sum += tab.c[s]*k[s][i];
+            err += tab.e[s]*k[s][i];
+        }
+        yNew[i] = y[i] + h*sum;
+        yErr[i] = h*err;
+    }
+}
+
+
+template <class K>
+m4d::enum_break_condition GvsKernelSolverT<K>::calculateGeodesic( const m4d::vec4 &yStart, const m4d::vec4 &yDir,
+                                                                  int maxNumPoints, std::vector<m4d::vec4> &points,
+                                                                  std::vector<m4d::vec4> &dirs, std::vector<double>* lambdas ) {
+    assert(mParams.tableau != NULL);
+    points.clear();
+    dirs.clear();
+    if (lambdas != nullptr) {
+        lambdas->clear();
+    }
+    if (maxNumPoints < 1) {
+        return m4d::enum_break_num_exceed;
+    }
+
+    // The parameters of the metric may change from frame to frame.
+    mMetricKernel.readParams(mMetric);
+
+    double y[8], yNew[8], yErr[8];
+    for (int i = 0; i < 4; i++) {
+        y[i]   = yStart.x(i);
+        y[i+4] = yDir.x(i);
+    }
+    points.push_back(yStart);
+    dirs.push_back(yDir);
+
+    double lambda = 0.0;
+    if (lambdas != nullptr) {
+        lambdas->push_back(lambda);
+    }
+
+    double h = std::min(mParams.stepSize, mParams.maxStepSize);
+    while (static_cast<int>(points.size()) < maxNumPoints) {
+        double hStep = h;
+        step(y, h, yNew, yErr);
+
+        bool finite = true;
+        for (int i = 0; i < 8; i++) {
+            finite = finite && std::isfinite(yNew[i]);
+        }
+        if (!finite) {
+            return m4d::enum_break_other;
+        }
+
+        if (mParams.stepCtrl && !gvsAdjustStep(mParams.errorRatio(yNew, yErr), mParams.tableau->order, h, mParams.maxStepSize)) {
+            GvsStatistics::countRejectedStep();
+            if (h < GVS_RK_MIN_STEP) {
+                return m4d::enum_break_step_size;
+            }
+            continue;
+        }
+
+        memcpy(y, yNew, sizeof(y));
+        m4d::vec4 pos(y[0], y[1], y[2], y[3]);
+        points.push_back(pos);
+        dirs.push_back(m4d::vec4(y[4], y[5], y[6], y[7]));
+        lambda += hStep;
+        if (lambdas != nullptr) {
+            lambdas->push_back(lambda);
+        }
+
+        if (mMetric->breakCondition(pos)) {
+            return m4d::enum_break_cond;
+        }
+        if (fabs(gvsNullConstraint(mMetricKernel, y, y + 4)) > GVS_RK_CONSTRAINT_EPS) {
+            return m4d::enum_break_constraint;
+        }
+        if (mParams.outsideBox(y)) {
+            return m4d::enum_break_outside;
+        }
+    }
+    return m4d::enum_break_num_exceed;
+}
+
+
+GvsKernelSolver::GvsKernelSolver( m4d::Metric* metric, GvsMetricKernel kernel )
+    : mMetric(metric),
+      mKernel(kernel)
+{
+}
+
+GvsKernelSolver::~GvsKernelSolver() {
+}
+
+
+GvsKernelSolver* GvsKernelSolver::create( m4d::Metric* metric, const char* solverName ) {
+    if (gvsFindRKTableau(solverName) == NULL) {
+        return NULL;
+    }
+
+    GvsMetricKernel kernel = gvsFindKernel(metric);
+    switch (kernel) {
+        case gvsKernelNone:
+            break;
+        case gvsKernelMinkowski:
+            return new GvsKernelSolverT<GvsKernelMinkowski>(metric, kernel);
+        case gvsKernelSchwarzschild:
+            return new GvsKernelSolverT<GvsKernelSchwarzschild>(metric, kernel);
+        case gvsKernelMorrisThorne:
+            return new GvsKernelSolverT<GvsKernelMorrisThorne>(metric, kernel);
+        case gvsKernelKerrBL:
+            return new GvsKernelSolverT<GvsKernelKerrBL>(metric, kernel);
+    }
+    return NULL;
+}
+
+
+GvsMetricKernel GvsKernelSolver::getKernel() const {
+    return mKernel;
+}
+
+void GvsKernelSolver::setParams( const GvsRKParams &params ) {
+    mParams = params;
+}
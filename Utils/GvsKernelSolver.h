@@ -0,0 +1,74 @@
+/**
+ * @file    GvsKernelSolver.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_KERNEL_SOLVER_H
+#define GVS_KERNEL_SOLVER_H
+
+#include <vector>
+
+#include <m4dGlobalDefs.h>
+#include <metric/m4dMetric.h>
+
+#include "Utils/GvsMetricKernels.h"
+#include "Utils/GvsRungeKutta.h"
+
+/**
+ * Geodesic integrator with a native metric kernel.
+ *
+ *   The integrator is instantiated for each kernel of GvsMetricKernels.h;
+ *   thus, the Christoffel symbols are inlined into the Runge-Kutta steps
+ *   and the vanishing ones are skipped at compile time. Only the break
+ *   condition of the metric is still a virtual call, once per accepted step.
+ *
+ *   GvsGeodSolver uses it automatically for light rays if the metric has a
+ *   kernel and the solver is 'GSL_RK_Cash-Karp' or 'GSL_RK_Fehlberg'. The
+ *   step size control and the break conditions, the null constraint
+ *   included, are those of the GSL solvers of libMotion4D; the constraint
+ *   is evaluated from the inlined metric coefficients of the kernel.
+ */
+class GvsKernelSolver
+{
+public:
+    virtual ~GvsKernelSolver();
+
+    /**
+     * Create a solver for the metric with the method of a solver of libMotion4D.
+     * @param metric      metric of the geodesics
+     * @param solverName  name of the solver of libMotion4D
+     * @return NULL if the metric has no kernel or the method is not available
+     */
+    static GvsKernelSolver*  create ( m4d::Metric* metric, const char* solverName );
+
+    GvsMetricKernel  getKernel ( ) const;
+
+    //! Set the parameters of the integration; the method must not be NULL.
+    void  setParams ( const GvsRKParams &params );
+
+    /**
+     * Calculate a geodesic into buffers provided by the caller.
+     *   The buffers are cleared but keep their capacity.
+     * @param yStart        initial position in coordinates
+     * @param yDir          initial direction in coordinates
+     * @param maxNumPoints  maximum number of points
+     * @param points        geodesic points
+     * @param dirs          geodesic tangents
+     * @param lambdas       affine parameters of the points, if not NULL
+     * @return break condition
+     */
+    virtual m4d::enum_break_condition  calculateGeodesic ( const m4d::vec4 &yStart, const m4d::vec4 &yDir,
+                                                           int maxNumPoints, std::vector<m4d::vec4> &points,
+                                                           std::vector<m4d::vec4> &dirs,
+                                                           std::vector<double>* lambdas = nullptr ) = 0;
+
+protected:
+    GvsKernelSolver ( m4d::Metric* metric, GvsMetricKernel kernel );
+
+protected:
+    m4d::Metric*     mMetric;
+    GvsMetricKernel  mKernel;
+    GvsRKParams      mParams;
+};
+
+#endif // GVS_KERNEL_SOLVER_H
@@ -0,0 +1,76 @@
+/**
+ * @file    GvsMetricKernels.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Utils/GvsMetricKernels.h"
+
+/**
+ * Compare the metric coefficients of the kernel with those of libMotion4D.
+ *   Both sample points lie outside of a horizon or throat.
+ */
+template <class K>
+static bool verifyKernel( m4d::Metric* metric ) {
+    if (strcmp(metric->getMetricName(), K::name()) != 0 || metric->getCoordType() != K::coordType()) {
+        return false;
+    }
+
+    K kernel;
+    if (!kernel.readParams(metric)) {
+        return false;
+    }
+
+    double scale = kernel.scale();
+    double samples[2][4] = {{0.0, scale + 7.5, 1.1, 0.4},
+                            {1.0, 2.0*scale + 3.0, 2.3, 4.0}};
+    for (int n = 0; n < 2; n++) {
+        double g[4][4] = {{0.0}};
+        kernel.metric(samples[n], g);
+        metric->calculateMetric(samples[n]);
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                if (fabs(metric->getMetricCoeff(i, j) - g[i][j]) > 1.0e-9*(1.0 + fabs(g[i][j]))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+GvsMetricKernel gvsFindKernel( m4d::Metric* metric ) {
+    if (metric == nullptr) {
+        return gvsKernelNone;
+    }
+    if (verifyKernel<GvsKernelMinkowski>(metric)) {
+        return gvsKernelMinkowski;
+    }
+    if (verifyKernel<GvsKernelSchwarzschild>(metric)) {
+        return gvsKernelSchwarzschild;
+    }
+    if (verifyKernel<GvsKernelMorrisThorne>(metric)) {
+        return gvsKernelMorrisThorne;
+    }
+    if (verifyKernel<GvsKernelKerrBL>(metric)) {
+        return gvsKernelKerrBL;
+    }
+    return gvsKernelNone;
+}
+
+
+const char* gvsKernelName( GvsMetricKernel kernel ) {
+    switch (kernel) {
+        case gvsKernelNone:
+            break;
+        case gvsKernelMinkowski:
+            return GvsKernelMinkowski::name();
+        case gvsKernelSchwarzschild:
+            return GvsKernelSchwarzschild::name();
+        case gvsKernelMorrisThorne:
+            return GvsKernelMorrisThorne::name();
+        case gvsKernelKerrBL:
+            return GvsKernelKerrBL::name();
+    }
+    return "none";
+}
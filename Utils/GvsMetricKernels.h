@@ -0,0 +1,387 @@
+/**
+ * @file    GvsMetricKernels.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_METRIC_KERNELS_H
+#define GVS_METRIC_KERNELS_H
+
+#include <cmath>
+#include <cstring>
+
+#include <m4dGlobalDefs.h>
+#include <metric/m4dMetric.h>
+
+// The loops over the indices are unrolled completely; thus, the loops over
+// the lanes of a packet that contain them can be vectorized.
+#if defined(__clang__)
+#define GVS_KERNEL_UNROLL  _Pragma("unroll 4")
+#elif defined(__GNUC__)
+#define GVS_KERNEL_UNROLL  _Pragma("GCC unroll 4")
+#else
+#define GVS_KERNEL_UNROLL
+#endif
+
+//! Metrics with a native kernel.
+enum GvsMetricKernel
+{
+    gvsKernelNone = 0,
+    gvsKernelMinkowski,       //!< Minkowski, cartesian coordinates (t,x,y,z)
+    gvsKernelSchwarzschild,   //!< Schwarzschild, coordinates (t,r,theta,phi)
+    gvsKernelMorrisThorne,    //!< Morris-Thorne wormhole, coordinates (t,l,theta,phi)
+    gvsKernelKerrBL           //!< Kerr, Boyer-Lindquist coordinates (t,r,theta,phi)
+};
+
+/**
+ * Find the native kernel of a metric.
+ *   The kernel is chosen by the name and the coordinates of the metric and
+ *   verified against the metric coefficients of libMotion4D at two points.
+ * @return gvsKernelNone if there is no kernel or it does not agree with the metric, e.g. with physical units
+ */
+GvsMetricKernel  gvsFindKernel ( m4d::Metric* metric );
+
+//! Name of the metric of a kernel.
+const char*      gvsKernelName ( GvsMetricKernel kernel );
+
+
+/*
+ * The kernels evaluate the metric and its Christoffel symbols with inlined
+ * formulas instead of the virtual functions of libMotion4D. Each kernel has
+ *
+ *   static const char* name()                      name of the metric in libMotion4D
+ *   static m4d::enum_coordinate_type coordType()
+ *   static constexpr bool isNonZero(mu,a,b)        G^mu_ab (a<=b) may be non-zero
+ *   bool   readParams   (m4d::Metric* metric)
+ *   double scale        () const                   length scale, e.g. the horizon
+ *   void   metric       (const double* pos, double g[4][4]) const
+ *   void   christoffels (const double* pos, double G[4][4][4]) const
+ *   void   christoffels (const double* pos, double st, double ct, double G[4][4][4]) const
+ *
+ * 'metric' only sets the non-zero coefficients, 'christoffels' only the
+ * symbols with isNonZero and a<=b. Because isNonZero is known at compile
+ * time, gvsGeodesicAccel only sums these. The second 'christoffels' takes
+ * st = sin(theta) and ct = cos(theta) from the caller and calls no function;
+ * thus, gvsGeodesicAccelPacket can evaluate it for all lanes in one loop.
+ */
+
+//! Minkowski in cartesian coordinates: all Christoffel symbols vanish.
+struct GvsKernelMinkowski
+{
+    static const char* name() { return "Minkowski"; }
+    static m4d::enum_coordinate_type coordType() { return m4d::enum_coordinate_cartesian; }
+
+    static constexpr bool isNonZero( int, int, int ) {
+        return false;
+    }
+
+    bool readParams( m4d::Metric* ) {
+        return true;
+    }
+
+    double scale() const {
+        return 1.0;
+    }
+
+    void metric( const double*, double g[4][4] ) const {
+        g[0][0] = -1.0;
+        g[1][1] = g[2][2] = g[3][3] = 1.0;
+    }
+
+    void christoffels( const double*, double (&)[4][4][4] ) const {
+    }
+
+    void christoffels( const double*, double, double, double (&)[4][4][4] ) const {
+    }
+};
+
+
+//! Schwarzschild with rs = 2M.
+struct GvsKernelSchwarzschild
+{
+    double  mass;
+
+    static const char* name() { return "Schwarzschild"; }
+    static m4d::enum_coordinate_type coordType() { return m4d::enum_coordinate_spherical; }
+
+    static constexpr bool isNonZero( int mu, int a, int b ) {
+        return (mu == 0 && a == 0 && b == 1)
+            || (mu == 1 && a == b)
+            || (mu == 2 && ((a == 1 && b == 2) || (a == 3 && b == 3)))
+            || (mu == 3 && b == 3 && (a == 1 || a == 2));
+    }
+
+    bool readParams( m4d::Metric* metric ) {
+        return metric->getParam("mass", mass);
+    }
+
+    double scale() const {
+        return 2.0*fabs(mass);
+    }
+
+    void metric( const double* pos, double g[4][4] ) const {
+        double f = 1.0 - 2.0*mass/pos[1];
+        double st = sin(pos[2]);
+        g[0][0] = -f;
+        g[1][1] = 1.0/f;
+        g[2][2] = pos[1]*pos[1];
+        g[3][3] = pos[1]*pos[1]*st*st;
+    }
+
+    void christoffels( const double* pos, double (&G)[4][4][4] ) const {
+        christoffels(pos, sin(pos[2]), cos(pos[2]), G);
+    }
+
+    void christoffels( const double* pos, double st, double ct, double (&G)[4][4][4] ) const {
+        double r  = pos[1];
+        double f  = 1.0 - 2.0*mass/r;
+        double h  = mass/(r*r);
+
+        G[0][0][1] = h/f;
+        G[1][0][0] = h*f;
+        G[1][1][1] = -h/f;
+        G[1][2][2] = -r*f;
+        G[1][3][3] = -r*f*st*st;
+        G[2][1][2] = 1.0/r;
+        G[2][3][3] = -st*ct;
+        G[3][1][3] = 1.0/r;
+        G[3][2][3] = ct/st;
+    }
+};
+
+
+//! Morris-Thorne wormhole with throat radius b0.
+struct GvsKernelMorrisThorne
+{
+    double  b0;
+
+    static const char* name() { return "MorrisThorne"; }
+    static m4d::enum_coordinate_type coordType() { return m4d::enum_coordinate_spherical; }
+
+    static constexpr bool isNonZero( int mu, int a, int b ) {
+        return (mu == 1 && a == b && a >= 2)
+            || (mu == 2 && ((a == 1 && b == 2) || (a == 3 && b == 3)))
+            || (mu == 3 && b == 3 && (a == 1 || a == 2));
+    }
+
+    bool readParams( m4d::Metric* metric ) {
+        return metric->getParam("b0", b0);
+    }
+
+    double scale() const {
+        return fabs(b0);
+    }
+
+    void metric( const double* pos, double g[4][4] ) const {
+        double R2 = b0*b0 + pos[1]*pos[1];
+        double st = sin(pos[2]);
+        g[0][0] = -1.0;
+        g[1][1] = 1.0;
+        g[2][2] = R2;
+        g[3][3] = R2*st*st;
+    }
+
+    void christoffels( const double* pos, double (&G)[4][4][4] ) const {
+        christoffels(pos, sin(pos[2]), cos(pos[2]), G);
+    }
+
+    void christoffels( const double* pos, double st, double ct, double (&G)[4][4][4] ) const {
+        double l  = pos[1];
+        double lR = l/(b0*b0 + l*l);
+
+        G[1][2][2] = -l;
+        G[1][3][3] = -l*st*st;
+        G[2][1][2] = lR;
+        G[2][3][3] = -st*ct;
+        G[3][1][3] = lR;
+        G[3][2][3] = ct/st;
+    }
+};
+
+
+//! Kerr in Boyer-Lindquist coordinates with mass M and angular momentum a = J/M.
+struct GvsKernelKerrBL
+{
+    double  mass;
+    double  a;
+
+    static const char* name() { return "KerrBL"; }
+    static m4d::enum_coordinate_type coordType() { return m4d::enum_coordinate_spherical; }
+
+    //! The metric depends on r and theta only and mixes t with phi.
+    static constexpr bool isNonZero( int mu, int a, int b ) {
+        return ((mu == 1 || mu == 2) + (a == 1 || a == 2) + (b == 1 || b == 2)) % 2 == 1;
+    }
+
+    bool readParams( m4d::Metric* metric ) {
+        return metric->getParam("mass", mass) && metric->getParam("angmom", a);
+    }
+
+    double scale() const {
+        return 2.0*(fabs(mass) + fabs(a));
+    }
+
+    void metric( const double* pos, double g[4][4] ) const {
+        double r  = pos[1];
+        double st = sin(pos[2]);
+        double ct = cos(pos[2]);
+        double sigma = r*r + a*a*ct*ct;
+        double delta = r*r - 2.0*mass*r + a*a;
+        g[0][0] = -1.0 + 2.0*mass*r/sigma;
+        g[0][3] = g[3][0] = -2.0*mass*a*r*st*st/sigma;
+        g[1][1] = sigma/delta;
+        g[2][2] = sigma;
+        g[3][3] = (r*r + a*a + 2.0*mass*a*a*r*st*st/sigma)*st*st;
+    }
+
+    void christoffels( const double* pos, double (&G)[4][4][4] ) const {
+        christoffels(pos, sin(pos[2]), cos(pos[2]), G);
+    }
+
+    void christoffels( const double* pos, double st, double ct, double (&G)[4][4][4] ) const {
+        double r  = pos[1];
+        double s2 = st*st;
+        double a2 = a*a;
+
+        double sigma  = r*r + a2*ct*ct;
+        double delta  = r*r - 2.0*mass*r + a2;
+        double sigma2 = sigma*sigma;
+        double sigR   = 2.0*r;
+        double sigTh  = -2.0*a2*st*ct;
+
+        double gtt = -1.0 + 2.0*mass*r/sigma;
+        double gtp = -2.0*mass*a*r*s2/sigma;
+        double grr = sigma/delta;
+        double gpp = (r*r + a2 + 2.0*mass*a2*r*s2/sigma)*s2;
+
+        // derivatives with respect to r and theta
+        double gttR  = 2.0*mass*(sigma - r*sigR)/sigma2;
+        double gttTh = -2.0*mass*r*sigTh/sigma2;
+        double gtpR  = -2.0*mass*a*s2*(sigma - r*sigR)/sigma2;
+        double gtpTh = -2.0*mass*a*r*(2.0*st*ct*sigma - s2*sigTh)/sigma2;
+        double grrR  = (sigR*delta - sigma*(2.0*r - 2.0*mass))/(delta*delta);
+        double grrTh = sigTh/delta;
+        double gppR  = 2.0*r*s2 + 2.0*mass*a2*s2*s2*(sigma - r*sigR)/sigma2;
+        double gppTh = 2.0*(r*r + a2)*st*ct + 2.0*mass*a2*r*(4.0*s2*st*ct*sigma - s2*s2*sigTh)/sigma2;
+
+        // inverse of the (t,phi) block
+        double det = gtt*gpp - gtp*gtp;
+        double itt =  gpp/det;
+        double itp = -gtp/det;
+        double ipp =  gtt/det;
+
+        // G^t_ab and G^phi_ab with a in {t,phi}, b in {r,theta}
+        G[0][0][1] = 0.5*(itt*gttR  + itp*gtpR);
+        G[0][0][2] = 0.5*(itt*gttTh + itp*gtpTh);
+        G[0][1][3] = 0.5*(itt*gtpR  + itp*gppR);
+        G[0][2][3] = 0.5*(itt*gtpTh + itp*gppTh);
+        G[3][0][1] = 0.5*(itp*gttR  + ipp*gtpR);
+        G[3][0][2] = 0.5*(itp*gttTh + ipp*gtpTh);
+        G[3][1][3] = 0.5*(itp*gtpR  + ipp*gppR);
+        G[3][2][3] = 0.5*(itp*gtpTh + ipp*gppTh);
+
+        // G^r_ab and G^theta_ab with a,b both in {t,phi} or both in {r,theta}
+        double irr = 0.5/grr;
+        double ihh = 0.5/sigma;
+        G[1][0][0] = -irr*gttR;
+        G[1][0][3] = -irr*gtpR;
+        G[1][3][3] = -irr*gppR;
+        G[1][1][1] =  irr*grrR;
+        G[1][1][2] =  irr*grrTh;
+        G[1][2][2] = -irr*sigR;
+        G[2][0][0] = -ihh*gttTh;
+        G[2][0][3] = -ihh*gtpTh;
+        G[2][3][3] = -ihh*gppTh;
+        G[2][1][1] = -ihh*grrTh;
+        G[2][1][2] =  ihh*sigR;
+        G[2][2][2] =  ihh*sigTh;
+    }
+};
+
+
+//! Contract the Christoffel symbols with the tangent: acc^mu = -G^mu_ab u^a u^b.
+template <class K>
+inline void gvsContractChristoffels( const double (&G)[4][4][4], const double* u, double* acc ) {
+    GVS_KERNEL_UNROLL
+    for (int mu = 0; mu < 4; mu++) {
+        double sum = 0.0;
+        GVS_KERNEL_UNROLL
+        for (int a = 0; a < 4; a++) {
+            GVS_KERNEL_UNROLL
+            for (int b = a; b < 4; b++) {
+                if (K::isNonZero(mu, a, b)) {
+                    sum += ((a == b) ? 1.0 : 2.0)*G[mu][a][b]*u[a]*u[b];
+                }
+            }
+        }
+        acc[mu] = -sum;
+    }
+}
+
+/**
+ * Second derivative of the geodesic, d^2x^mu/dl^2 = -G^mu_ab u^a u^b.
+ * @param kernel  metric kernel
+ * @param pos     coordinates
+ * @param u       tangent
+ * @param acc     result
+ */
+template <class K>
+inline void gvsGeodesicAccel( const K& kernel, const double* pos, const double* u, double* acc ) {
+    double G[4][4][4];
+    kernel.christoffels(pos, G);
+    gvsContractChristoffels<K>(G, u, acc);
+}
+
+/**
+ * Second derivative of the geodesics of the first 'num' lanes of a packet.
+ *   The states are stored lane by lane (structure of arrays): y[0..3][l] are
+ *   the coordinates, y[4..7][l] the tangent of lane l. The sines and cosines
+ *   of theta are taken first; the loop over the lanes that evaluates the
+ *   Christoffel symbols then calls no function and is vectorized by the compiler.
+ * @param kernel  metric kernel
+ * @param num     number of lanes to evaluate
+ * @param y       states of the lanes
+ * @param acc     result, acc[mu][l]
+ */
+template <class K, int N>
+inline void gvsGeodesicAccelPacket( const K& kernel, int num, const double (&y)[8][N], double (&acc)[4][N] ) {
+    double st[N], ct[N];
+    for (int l = 0; l < num; l++) {
+        bool spherical = (K::coordType() == m4d::enum_coordinate_spherical);
+        st[l] = spherical ? sin(y[2][l]) : 0.0;
+        ct[l] = spherical ? cos(y[2][l]) : 0.0;
+    }
+
+    for (int l = 0; l < num; l++) {
+        const double pos[4] = {y[0][l], y[1][l], y[2][l], y[3][l]};
+        const double u[4]   = {y[4][l], y[5][l], y[6][l], y[7][l]};
+        double G[4][4][4];
+        double a[4];
+        kernel.christoffels(pos, st[l], ct[l], G);
+        gvsContractChristoffels<K>(G, u, a);
+        acc[0][l] = a[0];
+        acc[1][l] = a[1];
+        acc[2][l] = a[2];
+        acc[3][l] = a[3];
+    }
+}
+
+/**
+ * Null constraint g_ab u^a u^b of a light ray, as m4d::Metric::testConstraint with kappa = 0.
+ * @param kernel  metric kernel
+ * @param pos     coordinates
+ * @param u       tangent
+ */
+template <class K>
+inline double gvsNullConstraint( const K& kernel, const double* pos, const double* u ) {
+    double g[4][4] = {};
+    kernel.metric(pos, g);
+    double sum = 0.0;
+    for (int a = 0; a < 4; a++) {
+        for (int b = 0; b < 4; b++) {
+            sum += g[a][b]*u[a]*u[b];
+        }
+    }
+    return sum;
+}
+
+#endif // GVS_METRIC_KERNELS_H
@@ -0,0 +1,246 @@
+/**
+ * @file    GvsPacketSolver.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Utils/GvsPacketSolver.h"
+#include "Utils/GvsStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Right hand side of the geodesic equation for the first 'num' lanes.
+ *   y[0..3] are the coordinates, y[4..7] the tangent of each lane.
+ */
+template <class K, int N>
+static void packetDerivs( const K &kernel, int num, const double (&y)[8][N], double (&dydx)[8][N] ) {
+    double acc[4][N];
+    gvsGeodesicAccelPacket<K,N>(kernel, num, y, acc);
+    for (int i = 0; i < 4; i++) {
+        for (int l = 0; l < num; l++) {
+            dydx[i][l]   = y[i+4][l];
+            dydx[i+4][l] = acc[i][l];
+        }
+    }
+}
+
+
+GvsPacketSolver::GvsPacketSolver( m4d::Metric* metric, int numLanes )
+    : mMetric(nullptr),
+      mKernel(gvsKernelNone),
+      mNumLanes((numLanes > 4) ? 8 : 4)
+{
+    setMetric(metric);
+}
+
+
+bool GvsPacketSolver::isValid() const {
+    return (mMetric != nullptr) && (mKernel != gvsKernelNone);
+}
+
+GvsMetricKernel GvsPacketSolver::getKernel() const {
+    return mKernel;
+}
+
+int GvsPacketSolver::getNumLanes() const {
+    return mNumLanes;
+}
+
+
+bool GvsPacketSolver::setMetric( m4d::Metric* metric ) {
+    mMetric = metric;
+    mKernel = gvsFindKernel(metric);
+    return isValid();
+}
+
+
+void GvsPacketSolver::setParams( const GvsRKParams &params ) {
+    mParams = params;
+    if (mParams.tableau == NULL) {
+        mParams.tableau = &gvsRKCashKarp;
+    }
+}
+
+
+void GvsPacketSolver::calculateGeodesics( int num, const m4d::vec4* yStart, const m4d::vec4* yDir, int maxNumPoints,
+                                          std::vector<m4d::vec4>* points, std::vector<m4d::vec4>* dirs,
+                                          m4d::enum_break_condition* breakConds ) {
+    switch (mKernel) {
+        case gvsKernelNone:
+            break;
+        case gvsKernelMinkowski:
+            integrate<GvsKernelMinkowski>(num, yStart, yDir, maxNumPoints, points, dirs, breakConds);
+            break;
+        case gvsKernelSchwarzschild:
+            integrate<GvsKernelSchwarzschild>(num, yStart, yDir, maxNumPoints, points, dirs, breakConds);
+            break;
+        case gvsKernelMorrisThorne:
+            integrate<GvsKernelMorrisThorne>(num, yStart, yDir, maxNumPoints, points, dirs, breakConds);
+            break;
+        case gvsKernelKerrBL:
+            integrate<GvsKernelKerrBL>(num, yStart, yDir, maxNumPoints, points, dirs, breakConds);
+            break;
+    }
+}
+
+
+template <class K>
+void GvsPacketSolver::integrate( int num, const m4d::vec4* yStart, const m4d::vec4* yDir, int maxNumPoints,
+                                 std::vector<m4d::vec4>* points, std::vector<m4d::vec4>* dirs,
+                                 m4d::enum_break_condition* breakConds ) {
+    // The parameters of the metric may change from frame to frame.
+    K kernel;
+    kernel.readParams(mMetric);
+
+    for (int first = 0; first < num; first += mNumLanes) {
+        int numLanes = std::min(mNumLanes, num - first);
+        if (mNumLanes == 8) {
+            integratePacket<K,8>(kernel, numLanes, yStart + first, yDir + first, maxNumPoints,
+                                 points + first, dirs + first, breakConds + first);
+        } else {
+            integratePacket<K,4>(kernel, numLanes, yStart + first, yDir + first, maxNumPoints,
+                                 points + first, dirs + first, breakConds + first);
+        }
+    }
+}
+
+
+template <class K, int N>
+void GvsPacketSolver::integratePacket( const K &kernel, int num, const m4d::vec4* yStart, const m4d::vec4* yDir,
+                                       int maxNumPoints, std::vector<m4d::vec4>* points,
+                                       std::vector<m4d::vec4>* dirs, m4d::enum_break_condition* breakConds ) {
+    const GvsRKTableau &tab = *mParams.tableau;
+
+    // State of the active lanes (structure of arrays). The active geodesics
+    // always occupy the first 'numActive' lanes; 'geod' maps them to their geodesic.
+    double y[8][N], yTmp[8][N], yErr[8][N];
+    double k[6][8][N];
+    double h[N];
+    int    geod[N];
+    bool   finished[N];
+
+    int numActive = 0;
+    for (int g = 0; g < num; g++) {
+        points[g].clear();
+        dirs[g].clear();
+        points[g].push_back(yStart[g]);
+        dirs[g].push_back(yDir[g]);
+        breakConds[g] = m4d::enum_break_none;
+        if (maxNumPoints < 2) {
+            breakConds[g] = m4d::enum_break_num_exceed;
+            continue;
+        }
+
+        int l = numActive++;
+        for (int i = 0; i < 4; i++) {
+            y[i][l]   = yStart[g].x(i);
+            y[i+4][l] = yDir[g].x(i);
+        }
+        h[l] = std::min(mParams.stepSize, mParams.maxStepSize);
+        geod[l] = g;
+    }
+
+    while (numActive > 0) {
+        // One Runge-Kutta step of every active lane with its own step size.
+        packetDerivs<K,N>(kernel, numActive, y, k[0]);
+        for (int s = 1; s < 6; s++) {
+            for (int i = 0; i < 8; i++) {
+                for (int l = 0; l < numActive; l++) {
+                    double sum = 0.0;
+                    for (int j = 0; j < s; j++) {
+                        sum += tab.b[s][j]*k[j][i][l];
+                    }
+                    yTmp[i][l] = y[i][l] + h[l]*sum;
+                }
+            }
+            packetDerivs<K,N>(kernel, numActive, yTmp, k[s]);
+        }
+        for (int i = 0; i < 8; i++) {
+            for (int l = 0; l < numActive; l++) {
+                double sum = 0.0;
+                double err = 0.0;
+                for (int s = 0; s < 6; s++) {
+                    sum += tab.c[s]*k[s][i][l];
+                    err += tab.e[s]*k[s][i][l];
+                }
+                yTmp[i][l] = y[i][l] + h[l]*sum;
+                yErr[i][l] = h[l]*err;
+            }
+        }
+
+        // Accept or reject the step of each lane.
+        for (int l = 0; l < numActive; l++) {
+            double yNew[8], yNewErr[8];
+            bool finite = true;
+            for (int i = 0; i < 8; i++) {
+                yNew[i] = yTmp[i][l];
+                yNewErr[i] = yErr[i][l];
+                finite = finite && std::isfinite(yNew[i]);
+            }
+
+            int g = geod[l];
+            m4d::enum_break_condition bc = m4d::enum_break_none;
+            if (!finite) {
+                bc = m4d::enum_break_other;
+            }
+            else if (mParams.stepCtrl && !gvsAdjustStep(mParams.errorRatio(yNew, yNewErr), tab.order, h[l], mParams.maxStepSize)) {
+                // rejected: the lane repeats the step with a smaller step size
+                GvsStatistics::countRejectedStep();
+                if (h[l] < GVS_RK_MIN_STEP) {
+                    bc = m4d::enum_break_step_size;
+                }
+            }
+            else {
+                for (int i = 0; i < 8; i++) {
+                    y[i][l] = yNew[i];
+                }
+                m4d::vec4 pos(yNew[0], yNew[1], yNew[2], yNew[3]);
+                points[g].push_back(pos);
+                dirs[g].push_back(m4d::vec4(yNew[4], yNew[5], yNew[6], yNew[7]));
+
+                if (mMetric->breakCondition(pos)) {
+                    bc = m4d::enum_break_cond;
+                }
+                else if (fabs(gvsNullConstraint(kernel, yNew, yNew + 4)) > GVS_RK_CONSTRAINT_EPS) {
+                    bc = m4d::enum_break_constraint;
+                }
+                else if (mParams.outsideBox(yNew)) {
+                    bc = m4d::enum_break_outside;
+                }
+                else if (static_cast<int>(points[g].size()) >= maxNumPoints) {
+                    bc = m4d::enum_break_num_exceed;
+                }
+            }
+
+            breakConds[g] = bc;
+            finished[l] = (bc != m4d::enum_break_none);
+        }
+
+        // Move the remaining lanes to the front; finished lanes are not evaluated any more.
+        int numLeft = 0;
+        for (int l = 0; l < numActive; l++) {
+            if (finished[l]) {
+                continue;
+            }
+            if (numLeft != l) {
+                for (int i = 0; i < 8; i++) {
+                    y[i][numLeft] = y[i][l];
+                }
+                h[numLeft] = h[l];
+                geod[numLeft] = geod[l];
+            }
+            numLeft++;
+        }
+        numActive = numLeft;
+    }
+}
+
+
+void GvsPacketSolver::Print( FILE* fptr ) const {
+    fprintf(fptr,"PacketSolver {\n");
+    fprintf(fptr,"\tlanes  : %d\n",mNumLanes);
+    fprintf(fptr,"\tkernel : %s\n",gvsKernelName(mKernel));
+    fprintf(fptr,"\tmethod : %s\n",mParams.tableau->name);
+    fprintf(fptr,"}\n");
+}
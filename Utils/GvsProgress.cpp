@@ -0,0 +1,185 @@
+/**
+ * @file    GvsProgress.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Utils/GvsProgress.h"
+
+static std::string jsonEscape( const std::string &str ) {
+    std::string escaped;
+    for (unsigned int i = 0; i < str.size(); i++) {
+        if (str[i] == '"' || str[i] == '\\') {
+            escaped += '\\';
+        }
+        escaped += str[i];
+    }
+    return escaped;
+}
+
+
+GvsProgress::GvsProgress()
+    : mNumPixels(0),
+      mNumPixelsDone(0),
+      mInterval(1.0),
+      mStartTime(std::chrono::steady_clock::now()),
+      mStop(false) {
+}
+
+GvsProgress::~GvsProgress() {
+    stop();
+}
+
+
+void GvsProgress::start( const std::string &label, long numPixels, double interval ) {
+    stop();
+    mLabel         = label;
+    mNumPixels     = numPixels;
+    mNumPixelsDone = 0;
+    mInterval      = interval;
+    mStartTime     = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTiles.clear();
+        mStop = false;
+    }
+    if (mInterval > 0.0) {
+        mThread = std::thread(&GvsProgress::run, this);
+    }
+}
+
+
+void GvsProgress::stop() {
+    if (!mThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+    print(true);
+}
+
+
+void GvsProgress::addTile( int x1, int y1, int x2, int y2, double seconds, int worker ) {
+    GvsTileTiming tile = { x1, y1, x2, y2, seconds, worker };
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTiles.push_back(tile);
+}
+
+
+long GvsProgress::numPixels() const {
+    return mNumPixels;
+}
+
+long GvsProgress::numPixelsDone() const {
+    return mNumPixelsDone.load(std::memory_order_relaxed);
+}
+
+double GvsProgress::wallTime() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+}
+
+double GvsProgress::raysPerSecond() const {
+    double seconds = wallTime();
+    return (seconds > 0.0) ? numPixelsDone() / seconds : 0.0;
+}
+
+double GvsProgress::eta() const {
+    long done = numPixelsDone();
+    if (done <= 0) {
+        return -1.0;
+    }
+    return wallTime() * (mNumPixels - done) / done;
+}
+
+
+std::vector<GvsTileTiming> GvsProgress::getTiles() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mTiles;
+}
+
+
+bool GvsProgress::writeReport( const std::string &filename, const std::string &frame, int width, int height ) const {
+    return writeReport(filename, frame, width, height, wallTime(), GVS_MAX(eta(), 0.0), getTiles());
+}
+
+
+bool GvsProgress::writeReport( const std::string &filename, const std::string &frame, int width, int height,
+                               double wallTime, double eta, const std::vector<GvsTileTiming> &tiles ) {
+    FILE* fptr = fopen(filename.c_str(), "w");
+    if (fptr == NULL) {
+        fprintf(stderr,"Cannot open file %s for output!\n",filename.c_str());
+        return false;
+    }
+
+    long   numPixels  = 0;
+    double sumSeconds = 0.0;
+    for (unsigned int i = 0; i < tiles.size(); i++) {
+        numPixels  += static_cast<long>(tiles[i].x2 - tiles[i].x1 + 1) * (tiles[i].y2 - tiles[i].y1 + 1);
+        sumSeconds += GVS_MAX(tiles[i].seconds, 0.0);
+    }
+    double raysPerSecond = (wallTime > 0.0) ? numPixels / wallTime : 0.0;
+
+    bool isCsv = (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0);
+    if (isCsv) {
+        fprintf(fptr,"# frame=%s width=%d height=%d wallTime=%g raysPerSecond=%g eta=%g\n",
+                frame.c_str(),width,height,wallTime,raysPerSecond,eta);
+        fprintf(fptr,"x1,y1,x2,y2,pixels,seconds,raysPerSecond,worker\n");
+        for (unsigned int i = 0; i < tiles.size(); i++) {
+            const GvsTileTiming &t = tiles[i];
+            long pixels = static_cast<long>(t.x2 - t.x1 + 1) * (t.y2 - t.y1 + 1);
+            fprintf(fptr,"%d,%d,%d,%d,%ld,%g,%g,%d\n",t.x1,t.y1,t.x2,t.y2,pixels,t.seconds,
+                    (t.seconds > 0.0 ? pixels / t.seconds : 0.0),t.worker);
+        }
+    }
+    else {
+        fprintf(fptr,"{\n");
+        fprintf(fptr,"  \"frame\": \"%s\",\n",jsonEscape(frame).c_str());
+        fprintf(fptr,"  \"width\": %d,\n",width);
+        fprintf(fptr,"  \"height\": %d,\n",height);
+        fprintf(fptr,"  \"pixels\": %ld,\n",numPixels);
+        fprintf(fptr,"  \"wallTime\": %g,\n",wallTime);
+        fprintf(fptr,"  \"renderTime\": %g,\n",sumSeconds);
+        fprintf(fptr,"  \"raysPerSecond\": %g,\n",raysPerSecond);
+        fprintf(fptr,"  \"eta\": %g,\n",eta);
+        fprintf(fptr,"  \"tiles\": [");
+        for (unsigned int i = 0; i < tiles.size(); i++) {
+            const GvsTileTiming &t = tiles[i];
+            fprintf(fptr,"%s\n    { \"x1\": %d, \"y1\": %d, \"x2\": %d, \"y2\": %d, \"seconds\": %g, \"worker\": %d }",
+                    (i > 0 ? "," : ""),t.x1,t.y1,t.x2,t.y2,t.seconds,t.worker);
+        }
+        fprintf(fptr,"\n  ]\n}\n");
+    }
+    fclose(fptr);
+    return true;
+}
+
+
+void GvsProgress::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStop) {
+        mCondition.wait_for(lock, std::chrono::duration<double>(mInterval));
+        if (!mStop) {
+            print(false);
+        }
+    }
+}
+
+
+void GvsProgress::print( bool final ) const {
+    long done = numPixelsDone();
+    double percent = (mNumPixels > 0) ? 100.0 * done / mNumPixels : 100.0;
+    double left = eta();
+    if (left < 0.0) {
+        fprintf(stderr,"\r%s %5.1f%%  %10.0f rays/s  ETA       ?",mLabel.c_str(),percent,raysPerSecond());
+    } else {
+        int sec = static_cast<int>(left + 0.5);
+        fprintf(stderr,"\r%s %5.1f%%  %10.0f rays/s  ETA %3d:%02d:%02d",mLabel.c_str(),percent,raysPerSecond(),
+                sec/3600,(sec/60)%60,sec%60);
+    }
+    if (final) {
+        fprintf(stderr,"  (%.1f s)\n",wallTime());
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file    GvsProgress.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_PROGRESS_H
+#define GVS_PROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+/**
+ * Rendering time of one tile.
+ */
+typedef struct GvsTileTiming_t {
+    int     x1;
+    int     y1;
+    int     x2;
+    int     y2;
+    double  seconds;
+    int     worker;    //!< thread or MPI node that rendered the tile
+} GvsTileTiming;
+
+/**
+ * Progress of a rendering.
+ *
+ *   The render threads only increment an atomic pixel counter and append
+ *   the timing of finished tiles. A reporter thread prints the progress,
+ *   the rays per second, and the estimated time of arrival at most once
+ *   per interval, so that console output does not slow down rendering.
+ *   A report with the timing of all tiles can be written as JSON or CSV.
+ */
+class API_EXPORT GvsProgress
+{
+public:
+    GvsProgress();
+    virtual ~GvsProgress();
+
+    /**
+     * Reset the counters and start the clock.
+     * @param label      printed in front of the progress
+     * @param numPixels  number of pixels to be rendered
+     * @param interval   seconds between two progress lines; no reporter thread if <= 0
+     */
+    void    start    ( const std::string &label, long numPixels, double interval = 1.0 );
+
+    //! Stop the reporter thread and print the final progress line.
+    void    stop     ( );
+
+    void    addPixels ( long num );
+    void    addTile   ( int x1, int y1, int x2, int y2, double seconds, int worker = 0 );
+
+    long    numPixels      ( ) const;
+    long    numPixelsDone  ( ) const;
+    double  wallTime       ( ) const;   //!< seconds since start
+    double  raysPerSecond  ( ) const;
+    double  eta            ( ) const;   //!< estimated seconds left, negative if unknown
+
+    std::vector<GvsTileTiming>  getTiles ( ) const;
+
+    /**
+     * Write report of the frame; the format is CSV if the filename ends
+     * with '.csv', JSON otherwise.
+     */
+    bool    writeReport ( const std::string &filename, const std::string &frame, int width, int height ) const;
+
+    //! Write report of a frame with given tile timings.
+    static bool  writeReport ( const std::string &filename, const std::string &frame, int width, int height,
+                               double wallTime, double eta, const std::vector<GvsTileTiming> &tiles );
+
+protected:
+    void    run   ( );
+    void    print ( bool final ) const;
+
+protected:
+    std::string        mLabel;
+    long               mNumPixels;
+    std::atomic<long>  mNumPixelsDone;
+    double             mInterval;
+    std::chrono::steady_clock::time_point  mStartTime;
+
+    mutable std::mutex          mMutex;
+    std::vector<GvsTileTiming>  mTiles;
+
+    std::thread              mThread;
+    std::condition_variable  mCondition;
+    bool                     mStop;
+};
+
+
+inline void GvsProgress::addPixels( long num ) {
+    mNumPixelsDone.fetch_add(num, std::memory_order_relaxed);
+}
+
+#endif // GVS_PROGRESS_H
@@ -0,0 +1,207 @@
+/**
+ * @file    GvsRenderJournal.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include <cstring>
+
+#include "Utils/GvsRenderJournal.h"
+
+GvsRenderJournal::GvsRenderJournal()
+    : mFile(NULL) {
+}
+
+GvsRenderJournal::~GvsRenderJournal() {
+    close();
+}
+
+
+bool GvsRenderJournal::open( const char* filename ) {
+    close();
+    mFilename = filename;
+    mFramesDone.clear();
+    mFramesRefined.clear();
+    mSignatures.clear();
+    mRegions.clear();
+
+    FILE* fptr = fopen(filename, "r");
+    if (fptr != NULL) {
+        readEntries(fptr);
+        fclose(fptr);
+    }
+
+    mFile = fopen(filename, "a");
+    if (mFile == NULL) {
+        fprintf(stderr,"Cannot open journal %s.\n",filename);
+        return false;
+    }
+    return true;
+}
+
+
+void GvsRenderJournal::close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile != NULL) {
+        fclose(mFile);
+        mFile = NULL;
+    }
+}
+
+
+bool GvsRenderJournal::isOpen() const {
+    return (mFile != NULL);
+}
+
+
+bool GvsRenderJournal::isFrameDone( const std::string &frame ) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (mFramesDone.find(frame) != mFramesDone.end());
+}
+
+
+void GvsRenderJournal::beginFrame( const std::string &frame, const std::string &signature ) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::map<std::string, std::string>::const_iterator itr = mSignatures.find(frame);
+    if (itr != mSignatures.end() && itr->second == signature) {
+        return;
+    }
+    mRegions.erase(frame);
+    mFramesRefined.erase(frame);
+    mSignatures[frame] = signature;
+    if (mFile == NULL) {
+        return;
+    }
+    fprintf(mFile,"scene %s %s\n",signature.c_str(),frame.c_str());
+    fflush(mFile);
+}
+
+
+/**
+ * The signature is '<devNum>:<resX>x<resY>:<hash>' with the FNV-1a hash of
+ * the content of the scene file, or 0 if it cannot be read.
+ */
+std::string GvsRenderJournal::makeSignature( const std::string &sceneFile, int devNum, int resX, int resY ) {
+    unsigned long long hash = 0;
+    FILE* fptr = fopen(sceneFile.c_str(), "rb");
+    if (fptr != NULL) {
+        hash = 14695981039346656037ULL;
+        int c;
+        while ((c = fgetc(fptr)) != EOF) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        fclose(fptr);
+    }
+    char buf[64];
+    sprintf(buf,"%d:%dx%d:%016llx",devNum,resX,resY,hash);
+    return std::string(buf);
+}
+
+
+std::vector<GvsJournalRegion> GvsRenderJournal::getRegions( const std::string &frame ) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::map<std::string, std::vector<GvsJournalRegion> >::const_iterator itr = mRegions.find(frame);
+    if (itr == mRegions.end() || mFramesDone.find(frame) != mFramesDone.end()) {
+        return std::vector<GvsJournalRegion>();
+    }
+    return itr->second;
+}
+
+
+void GvsRenderJournal::addRegion( const std::string &frame, int x1, int y1, int x2, int y2, double seconds ) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile == NULL) {
+        return;
+    }
+    fprintf(mFile,"region %d %d %d %d %g %s\n",x1,y1,x2,y2,seconds,frame.c_str());
+    fflush(mFile);
+}
+
+
+bool GvsRenderJournal::isFrameRefined( const std::string &frame ) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (mFramesRefined.find(frame) != mFramesRefined.end()) && (mFramesDone.find(frame) == mFramesDone.end());
+}
+
+
+void GvsRenderJournal::setFrameRefined( const std::string &frame ) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFramesRefined.insert(frame);
+    if (mFile == NULL) {
+        return;
+    }
+    fprintf(mFile,"refined %s\n",frame.c_str());
+    fflush(mFile);
+}
+
+
+void GvsRenderJournal::setFrameDone( const std::string &frame ) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFramesDone.insert(frame);
+    mFramesRefined.erase(frame);
+    mRegions.erase(frame);
+    if (mFile == NULL) {
+        return;
+    }
+    fprintf(mFile,"frame %s\n",frame.c_str());
+    fflush(mFile);
+}
+
+
+void GvsRenderJournal::Print( FILE* fptr ) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    size_t numRegions = 0;
+    std::map<std::string, std::vector<GvsJournalRegion> >::const_iterator itr;
+    for (itr = mRegions.begin(); itr != mRegions.end(); ++itr) {
+        numRegions += itr->second.size();
+    }
+    fprintf(fptr,"RenderJournal {\n");
+    fprintf(fptr,"\tfile:            %s\n",mFilename.c_str());
+    fprintf(fptr,"\tframes done:     %d\n",static_cast<int>(mFramesDone.size()));
+    fprintf(fptr,"\tregions resumed: %d\n",static_cast<int>(numRegions));
+    fprintf(fptr,"}\n");
+}
+
+
+/**
+ * Read entries line by line. An incomplete last line, e.g. after a crash
+ * while writing, is ignored.
+ */
+void GvsRenderJournal::readEntries( FILE* fptr ) {
+    char line[4096];
+    while (fgets(line, sizeof(line), fptr) != NULL) {
+        size_t len = strlen(line);
+        if (len == 0 || line[len-1] != '\n') {
+            continue;
+        }
+        line[len-1] = '\0';
+
+        GvsJournalRegion region;
+        char signature[64];
+        int pos = 0;
+        if (sscanf(line,"region %d %d %d %d %lf %n",&region.x1,&region.y1,&region.x2,&region.y2,&region.seconds,&pos) == 5 && pos > 0) {
+            mRegions[std::string(line + pos)].push_back(region);
+        }
+        else if (sscanf(line,"scene %63s %n",signature,&pos) == 1 && pos > 0) {
+            // a new signature starts the frame anew
+            std::string frame(line + pos);
+            if (mSignatures[frame] != signature) {
+                mRegions.erase(frame);
+                mFramesRefined.erase(frame);
+                mSignatures[frame] = signature;
+            }
+        }
+        else if (strncmp(line,"refined ",8) == 0) {
+            mFramesRefined.insert(std::string(line + 8));
+        }
+        else if (strncmp(line,"frame ",6) == 0) {
+            mFramesDone.insert(std::string(line + 6));
+        }
+    }
+
+    std::set<std::string>::const_iterator itr;
+    for (itr = mFramesDone.begin(); itr != mFramesDone.end(); ++itr) {
+        mRegions.erase(*itr);
+        mFramesRefined.erase(*itr);
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    GvsRenderJournal.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_RENDER_JOURNAL_H
+#define GVS_RENDER_JOURNAL_H
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "GvsGlobalDefs.h"
+
+/**
+ * Finished region of a frame; both corners belong to the region.
+ */
+typedef struct GvsJournalRegion_t {
+    int     x1;
+    int     y1;
+    int     x2;
+    int     y2;
+    double  seconds;   //!< rendering time, negative if unknown
+} GvsJournalRegion;
+
+/**
+ * Journal of a long render job for checkpoint and resume.
+ *
+ *   Every finished region, every finished refinement pass of adaptive
+ *   sampling, and every written frame is appended as one line and flushed
+ *   immediately:
+ *     scene <signature> <frame>
+ *     region <x1> <y1> <x2> <y2> <seconds> <frame>
+ *     refined <frame>
+ *     frame <frame>
+ *   A frame is identified by its output file name. The signature holds the
+ *   resolution and a hash of the scene file; regions of a frame that was
+ *   rendered with another signature are dropped. The pixels of a region have
+ *   to be written and flushed before the region is added. When the journal
+ *   is opened again, the entries of the previous runs are read, so a
+ *   restarted job can skip finished frames and regions.
+ */
+class API_EXPORT GvsRenderJournal
+{
+public:
+    GvsRenderJournal();
+    virtual ~GvsRenderJournal();
+
+    //! Read the entries of previous runs and open the journal for appending.
+    bool  open    ( const char* filename );
+    void  close   ( );
+    bool  isOpen  ( ) const;
+
+    bool  isFrameDone ( const std::string &frame ) const;
+
+    /**
+     * Start to render a frame with a signature, see makeSignature.
+     *   Regions and refinement passes of the frame that were journaled with
+     *   another signature, or without one, are dropped.
+     */
+    void  beginFrame  ( const std::string &frame, const std::string &signature );
+
+    //! Signature of the frame of device 'devNum' of the scene file with the resolution.
+    static std::string  makeSignature ( const std::string &sceneFile, int devNum, int resX, int resY );
+
+    //! Regions of an unfinished frame that were finished by previous runs.
+    std::vector<GvsJournalRegion>  getRegions ( const std::string &frame ) const;
+
+    void  addRegion   ( const std::string &frame, int x1, int y1, int x2, int y2, double seconds = -1.0 );
+    void  setFrameDone ( const std::string &frame );
+
+    //! The refinement pass of an unfinished frame was finished by previous runs.
+    bool  isFrameRefined  ( const std::string &frame ) const;
+    void  setFrameRefined ( const std::string &frame );
+
+    void  Print ( FILE* fptr = stderr ) const;
+
+protected:
+    void  readEntries ( FILE* fptr );
+
+protected:
+    std::string  mFilename;
+    FILE*        mFile;
+    mutable std::mutex  mMutex;
+
+    std::set<std::string>  mFramesDone;
+    std::set<std::string>  mFramesRefined;
+    std::map<std::string, std::string>  mSignatures;
+    std::map<std::string, std::vector<GvsJournalRegion> >  mRegions;
+};
+
+#endif // GVS_RENDER_JOURNAL_H
@@ -0,0 +1,137 @@
+/**
+ * @file    GvsRungeKutta.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_RUNGE_KUTTA_H
+#define GVS_RUNGE_KUTTA_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include <m4dGlobalDefs.h>
+
+#define GVS_RK_MIN_STEP  1.0e-12
+
+// Light rays stop with enum_break_constraint if |g(k,k)| exceeds this, as in libMotion4D.
+#ifdef DEF_CONSTRAINT_EPSILON
+#define GVS_RK_CONSTRAINT_EPS  DEF_CONSTRAINT_EPSILON
+#else
+#define GVS_RK_CONSTRAINT_EPS  1.0e-6
+#endif
+
+/**
+ * Coefficients of an embedded Runge-Kutta method with six stages.
+ *   The solution is y + h*sum(c[i]*k[i]), its error h*sum(e[i]*k[i]).
+ */
+struct GvsRKTableau
+{
+    const char*  name;     //!< name of the GSL solver of libMotion4D with this method
+    int     order;         //!< order of the method as reported by the GSL stepper
+    double  b[6][5];
+    double  c[6];
+    double  e[6];
+};
+
+//! Cash-Karp, see Press et al., Numerical Recipes, chapter 16.2
+static const GvsRKTableau gvsRKCashKarp = {
+    "GSL_RK_Cash-Karp", 4,
+    {{0.0, 0.0, 0.0, 0.0, 0.0},
+     {1.0/5.0, 0.0, 0.0, 0.0, 0.0},
+     {3.0/40.0, 9.0/40.0, 0.0, 0.0, 0.0},
+     {3.0/10.0, -9.0/10.0, 6.0/5.0, 0.0, 0.0},
+     {-11.0/54.0, 5.0/2.0, -70.0/27.0, 35.0/27.0, 0.0},
+     {1631.0/55296.0, 175.0/512.0, 575.0/13824.0, 44275.0/110592.0, 253.0/4096.0}},
+    {37.0/378.0, 0.0, 250.0/621.0, 125.0/594.0, 0.0, 512.0/1771.0},
+    {37.0/378.0 - 2825.0/27648.0, 0.0, 250.0/621.0 - 18575.0/48384.0,
+     125.0/594.0 - 13525.0/55296.0, -277.0/14336.0, 512.0/1771.0 - 0.25}
+};
+
+//! Runge-Kutta-Fehlberg 4(5)
+static const GvsRKTableau gvsRKFehlberg = {
+    "GSL_RK_Fehlberg", 5,
+    {{0.0, 0.0, 0.0, 0.0, 0.0},
+     {1.0/4.0, 0.0, 0.0, 0.0, 0.0},
+     {3.0/32.0, 9.0/32.0, 0.0, 0.0, 0.0},
+     {1932.0/2197.0, -7200.0/2197.0, 7296.0/2197.0, 0.0, 0.0},
+     {439.0/216.0, -8.0, 3680.0/513.0, -845.0/4104.0, 0.0},
+     {-8.0/27.0, 2.0, -3544.0/2565.0, 1859.0/4104.0, -11.0/40.0}},
+    {16.0/135.0, 0.0, 6656.0/12825.0, 28561.0/56430.0, -9.0/50.0, 2.0/55.0},
+    {16.0/135.0 - 25.0/216.0, 0.0, 6656.0/12825.0 - 1408.0/2565.0,
+     28561.0/56430.0 - 2197.0/4104.0, -9.0/50.0 + 1.0/5.0, 2.0/55.0}
+};
+
+//! Parameters of an integration with an embedded Runge-Kutta method.
+struct GvsRKParams
+{
+    const GvsRKTableau*  tableau;
+    double  stepSize;       //!< initial step size
+    double  maxStepSize;
+    bool    stepCtrl;       //!< adapt the step size to the error
+    double  epsAbs;
+    double  epsRel;
+    double  boxMin[4];      //!< bounding box of the coordinates
+    double  boxMax[4];
+
+    GvsRKParams()
+        : tableau(&gvsRKCashKarp), stepSize(0.01), maxStepSize(1.0), stepCtrl(true), epsAbs(1.0e-4), epsRel(0.0) {
+        for (int i = 0; i < 4; i++) {
+            boxMin[i] = -DBL_MAX;
+            boxMax[i] =  DBL_MAX;
+        }
+    }
+
+    bool outsideBox( const double* pos ) const {
+        return pos[0] < boxMin[0] || pos[0] > boxMax[0] || pos[1] < boxMin[1] || pos[1] > boxMax[1]
+            || pos[2] < boxMin[2] || pos[2] > boxMax[2] || pos[3] < boxMin[3] || pos[3] > boxMax[3];
+    }
+
+    //! Maximum ratio of the error yErr of a step to the tolerance at its end point yNew.
+    double errorRatio( const double* yNew, const double* yErr ) const {
+        double ratio = 0.0;
+        for (int i = 0; i < 8; i++) {
+            ratio = std::max(ratio, fabs(yErr[i])/(epsAbs + epsRel*fabs(yNew[i])));
+        }
+        return ratio;
+    }
+};
+
+/**
+ * Find the method of a solver of libMotion4D.
+ * @param solverName  name of the solver, e.g. "GSL_RK_Cash-Karp"
+ * @return NULL if the method is not available in GeoViS
+ */
+inline const GvsRKTableau* gvsFindRKTableau( const char* solverName ) {
+    if (strcmp(solverName, gvsRKCashKarp.name) == 0) {
+        return &gvsRKCashKarp;
+    }
+    if (strcmp(solverName, gvsRKFehlberg.name) == 0) {
+        return &gvsRKFehlberg;
+    }
+    return NULL;
+}
+
+/**
+ * Adapt the step size to the error of the last step like the controller of the GSL.
+ * @param errRatio  maximum ratio of the error to the tolerance
+ * @param order     order of the method, see GvsRKTableau
+ * @param h         step size; decreased if the step is rejected, otherwise increased up to maxStep
+ * @param maxStep   maximum step size
+ * @return  true if the step is accepted
+ */
+inline bool gvsAdjustStep( double errRatio, int order, double &h, double maxStep ) {
+    if (errRatio > 1.1) {
+        h *= std::max(0.9/pow(errRatio, 1.0/order), 0.2);
+        return false;
+    }
+    if (errRatio < 0.5) {
+        double scale = (errRatio > 0.0) ? 0.9/pow(errRatio, 1.0/(order + 1.0)) : 5.0;
+        h *= std::max(std::min(scale, 5.0), 1.0);
+    }
+    h = std::min(h, maxStep);
+    return true;
+}
+
+#endif // GVS_RUNGE_KUTTA_H
@@ -0,0 +1,241 @@
+/**
+ * @file    GvsStatistics.cpp
+ *
+ *  This file is part of GeoViS.
+ */
+#include "Utils/GvsStatistics.h"
+
+thread_local bool          GvsStatistics::mCountPixelCost = false;
+thread_local GvsPixelCost  GvsStatistics::mPixelCost = {0, 0};
+
+#ifdef GVS_STATISTICS
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+/**
+ * Counters of one thread.
+ *   The counters belong to the registry; the thread only holds a pointer.
+ *   If the thread exits, its counters are kept until the next reset.
+ */
+struct GvsStatCounters
+{
+    int            threadNr;
+    bool           threadExited;
+
+    unsigned long  numGeodesics;
+    unsigned long  numSteps;
+    unsigned long  numRejected;
+    int            maxPoints;
+    unsigned long  breakConds[GVS_STAT_NUM_BREAK_CONDS];
+
+    std::unordered_map<std::type_index, unsigned long>  segmentTests;
+    const std::type_info*  lastType;    //!< type of the last segment test
+    unsigned long*         lastCount;   //!< its counter in 'segmentTests'
+
+    unsigned long  numShaded;
+    double         shadingTime;
+
+    void clear() {
+        numGeodesics = 0;
+        numSteps = 0;
+        numRejected = 0;
+        maxPoints = 0;
+        for (int i = 0; i < GVS_STAT_NUM_BREAK_CONDS; i++) {
+            breakConds[i] = 0;
+        }
+        segmentTests.clear();
+        lastType = NULL;
+        lastCount = NULL;
+        numShaded = 0;
+        shadingTime = 0.0;
+    }
+
+    void add( const GvsStatCounters &counters ) {
+        numGeodesics += counters.numGeodesics;
+        numSteps += counters.numSteps;
+        numRejected += counters.numRejected;
+        if (counters.maxPoints > maxPoints) {
+            maxPoints = counters.maxPoints;
+        }
+        for (int i = 0; i < GVS_STAT_NUM_BREAK_CONDS; i++) {
+            breakConds[i] += counters.breakConds[i];
+        }
+        for (const auto &tests : counters.segmentTests) {
+            segmentTests[tests.first] += tests.second;
+        }
+        numShaded += counters.numShaded;
+        shadingTime += counters.shadingTime;
+    }
+};
+
+static std::mutex  gvsStatMutex;
+static std::vector<std::unique_ptr<GvsStatCounters>>  gvsStatRegistry;
+static int  gvsStatNumThreads = 0;
+
+/**
+ * Registers the counters of a thread on its first use and marks them
+ * when the thread exits.
+ */
+class GvsStatThread
+{
+public:
+    GvsStatThread() {
+        std::lock_guard<std::mutex> lock(gvsStatMutex);
+        std::unique_ptr<GvsStatCounters> counters(new GvsStatCounters);
+        counters->clear();
+        counters->threadNr = gvsStatNumThreads++;
+        counters->threadExited = false;
+        mCounters = counters.get();
+        gvsStatRegistry.push_back(std::move(counters));
+    }
+
+    ~GvsStatThread() {
+        std::lock_guard<std::mutex> lock(gvsStatMutex);
+        mCounters->threadExited = true;
+    }
+
+    GvsStatCounters* counters() {
+        return mCounters;
+    }
+
+private:
+    GvsStatCounters*  mCounters;
+};
+
+static GvsStatCounters* threadCounters() {
+    static thread_local GvsStatThread statThread;
+    return statThread.counters();
+}
+
+static std::string typeName( const std::type_index &type ) {
+    std::string name = type.name();
+#ifdef __GNUG__
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+    if (status == 0 && demangled != NULL) {
+        name = demangled;
+    }
+    std::free(demangled);
+#endif
+    return name;
+}
+
+static void printCounters( FILE* fptr, const char* label, const GvsStatCounters &counters ) {
+    double stepsPerGeod = (counters.numGeodesics > 0) ? counters.numSteps/static_cast<double>(counters.numGeodesics) : 0.0;
+    fprintf(fptr,"  %-10s geodesics: %lu  steps: %lu (%.1f per geodesic, max. %d points)  rejected: %lu\n",
+            label, counters.numGeodesics, counters.numSteps, stepsPerGeod, counters.maxPoints, counters.numRejected);
+
+    fprintf(fptr,"  %-10s break conditions:",label);
+    for (int i = 0; i < GVS_STAT_NUM_BREAK_CONDS; i++) {
+        if (counters.breakConds[i] > 0) {
+            fprintf(fptr,"  %s: %lu",m4d::stl_break_condition[i],counters.breakConds[i]);
+        }
+    }
+    fprintf(fptr,"\n");
+
+    // sorted by name to compare threads and frames
+    std::map<std::string,unsigned long> tests;
+    unsigned long numTests = 0;
+    for (const auto &objTests : counters.segmentTests) {
+        tests[typeName(objTests.first)] += objTests.second;
+        numTests += objTests.second;
+    }
+    fprintf(fptr,"  %-10s segment tests: %lu\n",label,numTests);
+    for (const auto &objTests : tests) {
+        fprintf(fptr,"  %-10s     %-24s %lu\n","",objTests.first.c_str(),objTests.second);
+    }
+
+    fprintf(fptr,"  %-10s shading: %lu calls, %.3f s\n",label,counters.numShaded,counters.shadingTime);
+}
+
+#endif // GVS_STATISTICS
+
+
+#ifdef GVS_STATISTICS
+void GvsStatistics::addGeodesic( int numPoints, m4d::enum_break_condition breakCond ) {
+    GvsStatCounters* counters = threadCounters();
+    counters->numGeodesics++;
+    if (numPoints > 1) {
+        counters->numSteps += numPoints - 1;
+    }
+    if (numPoints > counters->maxPoints) {
+        counters->maxPoints = numPoints;
+    }
+    int cond = static_cast<int>(breakCond);
+    if (cond >= 0 && cond < GVS_STAT_NUM_BREAK_CONDS) {
+        counters->breakConds[cond]++;
+    }
+}
+
+void GvsStatistics::addRejectedStep() {
+    threadCounters()->numRejected++;
+}
+
+void GvsStatistics::addShadingTime( double seconds ) {
+    GvsStatCounters* counters = threadCounters();
+    counters->numShaded++;
+    counters->shadingTime += seconds;
+}
+#endif
+
+void GvsStatistics::addSegmentTest( const std::type_info &type ) {
+#ifdef GVS_STATISTICS
+    GvsStatCounters* counters = threadCounters();
+    // Consecutive tests mostly belong to the same object.
+    if (counters->lastType != &type) {
+        counters->lastType = &type;
+        counters->lastCount = &counters->segmentTests[std::type_index(type)];
+    }
+    (*counters->lastCount)++;
+#else
+    (void)type;
+#endif
+}
+
+void GvsStatistics::reset() {
+#ifdef GVS_STATISTICS
+    std::lock_guard<std::mutex> lock(gvsStatMutex);
+    std::vector<std::unique_ptr<GvsStatCounters>> running;
+    for (auto &counters : gvsStatRegistry) {
+        if (!counters->threadExited) {
+            counters->clear();
+            running.push_back(std::move(counters));
+        }
+    }
+    gvsStatRegistry.swap(running);
+#endif
+}
+
+void GvsStatistics::Print( FILE* fptr ) {
+#ifdef GVS_STATISTICS
+    std::lock_guard<std::mutex> lock(gvsStatMutex);
+    GvsStatCounters total;
+    total.clear();
+
+    fprintf(fptr,"Statistics {\n");
+    char label[32];
+    for (const auto &counters : gvsStatRegistry) {
+        if (counters->numGeodesics == 0 && counters->numRejected == 0 && counters->segmentTests.empty() && counters->numShaded == 0) {
+            continue;
+        }
+        snprintf(label,sizeof(label),"thread %d",counters->threadNr);
+        printCounters(fptr,label,*counters);
+        total.add(*counters);
+    }
+    printCounters(fptr,"total",total);
+    fprintf(fptr,"}\n");
+#else
+    (void)fptr;
+#endif
+}
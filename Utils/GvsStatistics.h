@@ -0,0 +1,170 @@
+/**
+ * @file    GvsStatistics.h
+ *
+ *  This file is part of GeoViS.
+ */
+#ifndef GVS_STATISTICS_H
+#define GVS_STATISTICS_H
+
+#include <chrono>
+#include <cstdio>
+#include <typeinfo>
+
+#include <m4dGlobalDefs.h>
+
+#define GVS_STAT_NUM_BREAK_CONDS  (static_cast<int>(m4d::enum_break_other) + 1)
+
+//! Cost of the pixel which is rendered by the calling thread.
+struct GvsPixelCost
+{
+    unsigned long  numSteps;
+    unsigned long  numSegmentTests;
+};
+
+/**
+ * Counters of the hot paths of the ray tracer.
+ *   If GeoViS is configured with GVS_STATISTICS, the geodesic solver counts
+ *   its integrations, the accepted and rejected steps, and the break conditions, the scene
+ *   objects count the ray segments they test, and the projector measures the
+ *   time spent in the shaders. Without GVS_STATISTICS, all functions are
+ *   empty and the counters are always zero.
+ *
+ *   Independent of GVS_STATISTICS, the integrator steps and segment tests of
+ *   the current pixel are counted for the camera filter 'FilterRGBcost'; the
+ *   counting is switched on per thread with 'setPixelCostEnabled'. Otherwise,
+ *   the hot paths only read this flag.
+ *
+ *   Each thread counts into its own counters without locking. The counters of
+ *   all threads are printed by 'Print'; thus, it must only be called when no
+ *   thread renders. Rejected steps are counted by the native kernels of
+ *   GeoViS (GvsKernelSolver, GvsPacketSolver); those of the integrators of
+ *   libMotion4D are internal to them and are not counted.
+ */
+class GvsStatistics
+{
+public:
+    static bool  isEnabled ();
+
+    //! Count an integrated geodesic with its number of points and break condition.
+    static void  countGeodesic ( int numPoints, m4d::enum_break_condition breakCond );
+
+    //! Count a step that the step size control rejected.
+    static void  countRejectedStep ();
+
+    //! Count the test of one ray segment against a scene object.
+    template <class T>
+    static void  countSegmentTest ( const T* obj );
+
+    //! Add the time of one call of a shader.
+    static void  addShadingTime ( double seconds );
+
+    //! Reset the counters of all threads, e.g. at the start of a frame.
+    static void  reset ();
+
+    //! Print the counters of each thread and the total.
+    static void  Print ( FILE* fptr = stderr );
+
+    //! Count the cost of the pixels of the calling thread, see pixelCost.
+    static void  setPixelCostEnabled ( bool enabled );
+
+    //! Reset the cost of the current pixel of the calling thread.
+    static void  resetPixelCost ();
+
+    //! Integrator steps and segment tests of the calling thread since resetPixelCost.
+    static const GvsPixelCost&  pixelCost ();
+
+    /**
+     * Measure the lifetime of the timer as shading time.
+     *   Without GVS_STATISTICS, the timer does not read the clock.
+     */
+    class ShadingTimer
+    {
+    public:
+        ShadingTimer();
+        ~ShadingTimer();
+
+    private:
+#ifdef GVS_STATISTICS
+        std::chrono::steady_clock::time_point  mStart;
+#endif
+    };
+
+private:
+    static void  addGeodesic    ( int numPoints, m4d::enum_break_condition breakCond );
+    static void  addRejectedStep ();
+    static void  addSegmentTest ( const std::type_info &type );
+
+    static thread_local bool          mCountPixelCost;
+    static thread_local GvsPixelCost  mPixelCost;
+};
+
+
+inline bool GvsStatistics::isEnabled() {
+#ifdef GVS_STATISTICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline void GvsStatistics::countGeodesic( int numPoints, m4d::enum_break_condition breakCond ) {
+    if (mCountPixelCost && numPoints > 1) {
+        mPixelCost.numSteps += numPoints - 1;
+    }
+#ifdef GVS_STATISTICS
+    addGeodesic(numPoints, breakCond);
+#else
+    (void)breakCond;
+#endif
+}
+
+inline void GvsStatistics::countRejectedStep() {
+#ifdef GVS_STATISTICS
+    addRejectedStep();
+#endif
+}
+
+#ifndef GVS_STATISTICS
+inline void GvsStatistics::addShadingTime( double ) {
+}
+#endif
+
+template <class T>
+inline void GvsStatistics::countSegmentTest( const T* obj ) {
+    if (mCountPixelCost) {
+        mPixelCost.numSegmentTests++;
+    }
+#ifdef GVS_STATISTICS
+    addSegmentTest(typeid(*obj));
+#else
+    (void)obj;
+#endif
+}
+
+inline void GvsStatistics::setPixelCostEnabled( bool enabled ) {
+    mCountPixelCost = enabled;
+}
+
+inline void GvsStatistics::resetPixelCost() {
+    mPixelCost.numSteps = 0;
+    mPixelCost.numSegmentTests = 0;
+}
+
+inline const GvsPixelCost& GvsStatistics::pixelCost() {
+    return mPixelCost;
+}
+
+inline GvsStatistics::ShadingTimer::ShadingTimer() {
+#ifdef GVS_STATISTICS
+    mStart = std::chrono::steady_clock::now();
+#endif
+}
+
+inline GvsStatistics::ShadingTimer::~ShadingTimer() {
+#ifdef GVS_STATISTICS
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mStart;
+    addShadingTime(elapsed.count());
+#endif
+}
+
+#endif // GVS_STATISTICS_H
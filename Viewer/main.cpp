@@ -36,6 +36,7 @@ extern "C" {
 #include "Dev/GvsDevice.h"
 #include "Img/GvsPicIOEnvelope.h"
 #include "Img/GvsChannelImg2D.h"
+#include "Img/GvsTiledData.h"
 #include "Parser/GvsParser.h"
 #include "Utils/GvsLog.h"
 #include "Utils.h"
@@ -291,20 +292,33 @@ void TW_CALL SetFile( const void *value, void *clientData ) {
         // -------------------------------------
         else if (FileEndsWith(filePathNames[fileNum-1],".pdz")) {
                   // || FileEndsWith(filePathNames[fileNum-1],".jac")) {
-            FILE* fptr = fopen(filePathNames[fileNum-1].c_str(),"rb");
-            if (fptr==NULL) {
-                return;
-            }
-
             bool isOkay = true;
-            isOkay &= (fread((char*)&resX,sizeof(int),1,fptr)==1);
-            isOkay &= (fread((char*)&resY,sizeof(int),1,fptr)==1);
-            isOkay &= (fread((char*)&numChannels,sizeof(int),1,fptr)==1);
-            if (isOkay) {
-                data = new double[resX*resY*numChannels];
-                isOkay &= (fread((char*)&data[0],sizeof(double),resX*resY*numChannels,fptr)==(size_t)(resX*resY*numChannels));
+            if (GvsTiledDataReader::isTiledData(filePathNames[fileNum-1].c_str())) {
+                GvsTiledDataReader reader;
+                isOkay = reader.open(filePathNames[fileNum-1].c_str());
+                if (isOkay) {
+                    resX = reader.width();
+                    resY = reader.height();
+                    numChannels = reader.numChannels();
+                    data = new double[resX*resY*numChannels];
+                    isOkay = reader.readAll(data);
+                }
+            }
+            else {
+                // files written before the tiled container
+                FILE* fptr = fopen(filePathNames[fileNum-1].c_str(),"rb");
+                if (fptr==NULL) {
+                    return;
+                }
+                isOkay &= (fread((char*)&resX,sizeof(int),1,fptr)==1);
+                isOkay &= (fread((char*)&resY,sizeof(int),1,fptr)==1);
+                isOkay &= (fread((char*)&numChannels,sizeof(int),1,fptr)==1);
+                if (isOkay) {
+                    data = new double[resX*resY*numChannels];
+                    isOkay &= (fread((char*)&data[0],sizeof(double),resX*resY*numChannels,fptr)==(size_t)(resX*resY*numChannels));
+                }
+                fclose(fptr);
             }
-            fclose(fptr);
             
             if (!isOkay) {
                 fprintf(stderr,"Error reading file %s.\n",filePathNames[fileNum-1].c_str());
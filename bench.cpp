@@ -0,0 +1,362 @@
+/**
+ * @file    bench.cpp
+ *
+ *  This file is part of GeoViS.
+ *
+ *  Renders a fixed set of example scenes at a small resolution several times
+ *  and reports rays, integrator steps, and segment tests per second as JSON.
+ *  The result can be compared with a previous result (the baseline); the
+ *  benchmark fails if a rate dropped by more than the threshold.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Cam/GvsCamera.h"
+#include "Dev/GvsDevice.h"
+#include "Dev/GvsSampleMgr.h"
+#include "Parser/GvsParser.h"
+#include "Utils/GvsLog.h"
+#include "Utils/GvsStatistics.h"
+
+#ifndef _WIN32
+GvsLog& LOG = GvsLog::instance();
+#else
+m4d::MetricDatabase* m4d::MetricDatabase::m_instance = nullptr;
+#endif
+
+typedef std::chrono::steady_clock  bench_clock;
+
+//! Scenes rendered if none are given on the command line.
+static const char* benchDefaultScenes[] = {
+    "examples/minkowski.scm",
+    "examples/schwarzschild.scm",
+    "examples/kerrAccretionDisk.scm",
+    "examples/lattice.scm",
+    "examples/meshBench.scm"
+};
+
+//! Rates which are reported and compared with the baseline.
+static const int   benchNumRates = 3;
+static const char* benchRateNames[benchNumRates] = {
+    "raysPerSecond", "stepsPerSecond", "intersectionsPerSecond"
+};
+
+typedef struct BenchStat_T {
+    double median;
+    double min;
+    double max;
+} BenchStat;
+
+typedef struct BenchResult_T {
+    std::string    name;
+    std::string    file;
+    int            width;
+    int            height;
+    unsigned long  numSteps;         //!< integrator steps of one run
+    unsigned long  numSegmentTests;  //!< segment tests of one run
+    BenchStat      seconds;
+    BenchStat      rates[benchNumRates];
+} BenchResult;
+
+
+static BenchStat calcStat( std::vector<double> values ) {
+    BenchStat stat = {0.0, 0.0, 0.0};
+    if (values.empty()) {
+        return stat;
+    }
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    stat.median = (n % 2 == 1) ? values[n/2] : 0.5*(values[n/2-1] + values[n/2]);
+    stat.min = values.front();
+    stat.max = values.back();
+    return stat;
+}
+
+//! Relative spread (max-min)/median.
+static double calcSpread( const BenchStat &stat ) {
+    return (stat.median > 0.0) ? (stat.max - stat.min)/stat.median : 0.0;
+}
+
+static std::string sceneName( const std::string &file ) {
+    size_t start = file.find_last_of("/\\");
+    start = (start == std::string::npos) ? 0 : start+1;
+    size_t end = file.find_last_of(".");
+    if (end == std::string::npos || end < start) {
+        end = file.length();
+    }
+    return file.substr(start, end-start);
+}
+
+
+/**
+ * Render a scene 'warmup' + 'runs' times on the calling thread.
+ *   The camera resolution is scaled such that its longer edge has 'size' pixels.
+ *   Only the main thread renders; thus, the steps and segment tests are the
+ *   per-pixel counters of GvsStatistics of this thread.
+ */
+static bool benchScene( const std::string &file, int size, int warmup, int runs, BenchResult &result ) {
+    std::ifstream in(file.c_str());
+    if (!in) {
+        fprintf(stderr,"Cannot open scene %s\n",file.c_str());
+        return false;
+    }
+    in.close();
+
+    GvsParser* parser = new GvsParser();
+    parser->read_scene(file.c_str());
+
+    GvsDevice device;
+    parser->getDevice(&device,0);
+    device.makeChange();
+
+    m4d::ivec2 res = device.camera->GetResolution();
+    int width  = size;
+    int height = size;
+    if (res.x(0) >= res.x(1)) {
+        height = std::max(1, static_cast<int>(floor(size*res.x(1)/static_cast<double>(res.x(0)) + 0.5)));
+    } else {
+        width  = std::max(1, static_cast<int>(floor(size*res.x(0)/static_cast<double>(res.x(1)) + 0.5)));
+    }
+    device.camera->SetResolution(m4d::ivec2(width,height));
+
+    GvsSampleMgr* sampleMgr = new GvsSampleMgr(&device);
+    sampleMgr->setRegionToImage();
+
+    std::vector<double> seconds;
+    std::vector<double> rates[benchNumRates];
+    // the cost of all pixels of a run is counted
+    GvsStatistics::setPixelCostEnabled(true);
+    for (int run = 0; run < warmup + runs; run++) {
+        GvsStatistics::resetPixelCost();
+        bench_clock::time_point start = bench_clock::now();
+        sampleMgr->putFirstPixel();
+        while (sampleMgr->putNextPixel());
+        double time = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+        result.numSteps = GvsStatistics::pixelCost().numSteps;
+        result.numSegmentTests = GvsStatistics::pixelCost().numSegmentTests;
+        fprintf(stderr,"%s %s %d: %.3f s\n",sceneName(file).c_str(),(run < warmup ? "warmup" : "run"),
+                (run < warmup ? run : run-warmup),time);
+        if (run < warmup || time <= 0.0) {
+            continue;
+        }
+        seconds.push_back(time);
+        rates[0].push_back(width*height/time);
+        rates[1].push_back(result.numSteps/time);
+        rates[2].push_back(result.numSegmentTests/time);
+    }
+
+    result.name   = sceneName(file);
+    result.file   = file;
+    GvsStatistics::setPixelCostEnabled(false);
+    result.width  = width;
+    result.height = height;
+    result.seconds = calcStat(seconds);
+    for (int i = 0; i < benchNumRates; i++) {
+        result.rates[i] = calcStat(rates[i]);
+    }
+
+    delete sampleMgr;
+    delete parser;
+    return !seconds.empty();
+}
+
+
+static void writeStat( FILE* fptr, const char* name, const BenchStat &stat ) {
+    fprintf(fptr,"\"%s\": {\"median\": %.6g, \"min\": %.6g, \"max\": %.6g, \"spread\": %.4f}",
+            name,stat.median,stat.min,stat.max,calcSpread(stat));
+}
+
+/**
+ * Each scene is written in one line; thus, readBaseline can find the
+ * values of a scene without a JSON parser.
+ */
+static void writeResults( FILE* fptr, const std::vector<BenchResult> &results, int size, int warmup, int runs ) {
+    fprintf(fptr,"{\n");
+    fprintf(fptr,"  \"size\": %d,\n",size);
+    fprintf(fptr,"  \"warmup\": %d,\n",warmup);
+    fprintf(fptr,"  \"runs\": %d,\n",runs);
+    fprintf(fptr,"  \"scenes\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &result = results[i];
+        fprintf(fptr,"    {\"name\": \"%s\", \"file\": \"%s\", \"width\": %d, \"height\": %d, \"steps\": %lu, \"segmentTests\": %lu, ",
+                result.name.c_str(),result.file.c_str(),result.width,result.height,result.numSteps,result.numSegmentTests);
+        writeStat(fptr,"seconds",result.seconds);
+        for (int r = 0; r < benchNumRates; r++) {
+            fprintf(fptr,", ");
+            writeStat(fptr,benchRateNames[r],result.rates[r]);
+        }
+        fprintf(fptr,"}%s\n",(i+1 < results.size() ? "," : ""));
+    }
+    fprintf(fptr,"  ]\n");
+    fprintf(fptr,"}\n");
+}
+
+/**
+ * Read the median rates of all scenes of a previous result.
+ * @param filename  result of an earlier run of gvsBench
+ * @param medians   median rates per scene name
+ */
+static bool readBaseline( const char* filename, std::map<std::string, std::vector<double> > &medians ) {
+    std::ifstream in(filename);
+    if (!in) {
+        fprintf(stderr,"Cannot open baseline %s\n",filename);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::string nameKey = "\"name\": \"";
+        size_t pos = line.find(nameKey);
+        if (pos == std::string::npos) {
+            continue;
+        }
+        pos += nameKey.length();
+        std::string name = line.substr(pos, line.find('"', pos) - pos);
+
+        std::vector<double> values(benchNumRates, 0.0);
+        for (int r = 0; r < benchNumRates; r++) {
+            std::string rateKey = std::string("\"") + benchRateNames[r] + "\": {\"median\": ";
+            size_t ratePos = line.find(rateKey);
+            if (ratePos != std::string::npos) {
+                values[r] = atof(line.c_str() + ratePos + rateKey.length());
+            }
+        }
+        medians[name] = values;
+    }
+    return true;
+}
+
+/**
+ * Compare the median rates with the baseline.
+ * @return number of rates which dropped by more than 'threshold'
+ */
+static int compareBaseline( const std::vector<BenchResult> &results,
+                            std::map<std::string, std::vector<double> > &medians, double threshold ) {
+    int numRegressions = 0;
+    fprintf(stderr,"\n%-20s %-24s %12s %12s %8s\n","scene","rate","baseline","current","change");
+    for (size_t i = 0; i < results.size(); i++) {
+        std::map<std::string, std::vector<double> >::iterator itr = medians.find(results[i].name);
+        if (itr == medians.end()) {
+            fprintf(stderr,"%-20s not in baseline\n",results[i].name.c_str());
+            continue;
+        }
+        for (int r = 0; r < benchNumRates; r++) {
+            double base = itr->second[r];
+            double curr = results[i].rates[r].median;
+            if (base <= 0.0) {
+                continue;
+            }
+            double change = curr/base - 1.0;
+            bool regression = (change < -threshold);
+            if (regression) {
+                numRegressions++;
+            }
+            fprintf(stderr,"%-20s %-24s %12.4g %12.4g %+7.1f%%%s\n",results[i].name.c_str(),benchRateNames[r],
+                    base,curr,100.0*change,(regression ? "  REGRESSION" : ""));
+        }
+    }
+    return numRegressions;
+}
+
+
+/**
+ * @brief Main program for the rendering benchmark.
+ * @param argc
+ * @param argv
+ * @return 0 if there is no regression, 1 otherwise
+ *
+ *   ./gvsBench  [-runs N]  [-warmup N]  [-size N]  [-o result.json]
+ *               [-baseline file]  [-threshold t]  [scene.scm ...]
+ *
+ *   Run it in the GeoViS folder like gvsRender.
+ */
+int main(int argc, char* argv[]) {
+    int    runs      = 5;
+    int    warmup    = 1;
+    int    size      = 96;
+    double threshold = 0.1;
+    char*  outFileName  = NULL;
+    char*  baselineName = NULL;
+
+    bool usage = false;
+    std::vector<std::string> scenes;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i],"-runs") == 0 && i+1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i],"-warmup") == 0 && i+1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i],"-size") == 0 && i+1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (strcmp(argv[i],"-o") == 0 && i+1 < argc) {
+            outFileName = argv[++i];
+        } else if (strcmp(argv[i],"-baseline") == 0 && i+1 < argc) {
+            baselineName = argv[++i];
+        } else if (strcmp(argv[i],"-threshold") == 0 && i+1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage = true;
+        } else {
+            scenes.push_back(argv[i]);
+        }
+    }
+
+    if (usage || runs < 1 || warmup < 0 || size < 1 || threshold < 0.0) {
+        fprintf(stderr,"Usage: ./gvsBench [-runs N] [-warmup N] [-size N] [-o result.json] [-baseline file] [-threshold t] [scene.scm ...]\n");
+        fprintf(stderr,"       -size N       longer image edge in pixels (default 96)\n");
+        fprintf(stderr,"       -baseline     earlier result; rates which dropped by more than\n");
+        fprintf(stderr,"                     the threshold (default 0.1) are regressions\n");
+        return -1;
+    }
+
+    if (scenes.empty()) {
+        int numScenes = static_cast<int>(sizeof(benchDefaultScenes)/sizeof(benchDefaultScenes[0]));
+        for (int i = 0; i < numScenes; i++) {
+            scenes.push_back(benchDefaultScenes[i]);
+        }
+    }
+
+    std::map<std::string, std::vector<double> > medians;
+    if (baselineName != NULL && !readBaseline(baselineName, medians)) {
+        return -1;
+    }
+
+    std::vector<BenchResult> results;
+    for (size_t i = 0; i < scenes.size(); i++) {
+        BenchResult result;
+        if (benchScene(scenes[i], size, warmup, runs, result)) {
+            results.push_back(result);
+        }
+    }
+
+    FILE* fptr = stdout;
+    if (outFileName != NULL) {
+        fptr = fopen(outFileName,"w");
+        if (fptr == NULL) {
+            fprintf(stderr,"Cannot open file %s for output!\n",outFileName);
+            return -1;
+        }
+    }
+    writeResults(fptr, results, size, warmup, runs);
+    if (fptr != stdout) {
+        fclose(fptr);
+    }
+
+    if (results.size() != scenes.size()) {
+        fprintf(stderr,"\n%d of %d scenes could not be rendered.\n",
+                static_cast<int>(scenes.size() - results.size()),static_cast<int>(scenes.size()));
+        return 1;
+    }
+    if (baselineName != NULL && compareBaseline(results, medians, threshold) > 0) {
+        fprintf(stderr,"\nRegression of more than %.0f%% compared with %s.\n",100.0*threshold,baselineName);
+        return 1;
+    }
+    return 0;
+}
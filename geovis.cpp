@@ -17,13 +17,19 @@
 //  along with GeoViS.  If not, see <http://www.gnu.org/licenses/>.
 // ---------------------------------------------------------------------
 
+#include <cstring>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "Dev/GvsDevice.h"
+#include "Dev/GvsRayCache.h"
 #include "Dev/GvsSampleMgr.h"
 #include "Img/GvsPicIOEnvelope.h"
 #include "Parser/GvsParser.h"
 #include "Utils/GvsLog.h"
+#include "Utils/GvsRenderJournal.h"
+#include "Utils/GvsStatistics.h"
 
 #ifndef _WIN32
 GvsLog& LOG = GvsLog::instance();
@@ -31,16 +37,54 @@ GvsLog& LOG = GvsLog::instance();
 m4d::MetricDatabase* m4d::MetricDatabase::m_instance = nullptr;
 #endif
 
-void renderDevice( GvsDevice* dev, char* outFileName ) {   
+/**
+ * @brief Name of the image file that is written for the device.
+ *   Stereo images get '.left.' or '.right.' before the extension.
+ */
+std::string frameName( GvsDevice* dev, char* outFileName ) {
+    std::string name = std::string(outFileName);
+    size_t pos = name.find_last_of(".");
+    if (dev->camEye == gvsCamEyeStandard || pos == std::string::npos || pos == 0) {
+        return name;
+    }
+    return name.substr(0,pos) + GvsCamEyeFileExt[dev->camEye] + name.substr(pos+1);
+}
+
+void renderDevice( GvsDevice* dev, const char* sceneFileName, int devNum, char* outFileName, int numThreads,
+                   GvsRenderJournal* journal, const char* reportFormat,
+                   int adaptiveGrid, double adaptiveThreshold, double adaptiveBudget ) {
+    std::string frame = frameName(dev,outFileName);
+    if (journal != NULL && journal->isFrameDone(frame)) {
+        fprintf(stderr,"\n%s is already done.\n",frame.c_str());
+        return;
+    }
+
     GvsSampleMgr* sampleMgr = new GvsSampleMgr(dev,true);
     sampleMgr->setRegionToImage();
+    if (journal != NULL) {
+        m4d::ivec2 res = dev->camera->GetResolution();
+        sampleMgr->setJournal(journal,frame,GvsRenderJournal::makeSignature(sceneFileName,devNum,res.x(0),res.x(1)));
+    }
+    sampleMgr->setAdaptiveSampling(adaptiveGrid,adaptiveThreshold,adaptiveBudget);
+    GvsStatistics::reset();
 
     fprintf(stderr,"\nStart rendering...\n");
-    sampleMgr->putFirstPixel();
-    while (sampleMgr->putNextPixel());
+    if (numThreads > 1 || journal != NULL) {
+        // only tiles can be journaled
+        sampleMgr->renderParallel(numThreads);
+    } else {
+        sampleMgr->putFirstPixel();
+        while (sampleMgr->putNextPixel());
+    }
 
     fprintf(stderr,"\nRendering done... write image...\n");
+    sampleMgr->printAllocations();
+    GvsStatistics::Print();
     sampleMgr->writePicture(outFileName);
+    sampleMgr->finishJournal();
+    if (reportFormat != NULL) {
+        sampleMgr->writeReport(frame + "." + reportFormat, frame);
+    }
 
     delete sampleMgr;
 }
@@ -54,13 +98,62 @@ void renderDevice( GvsDevice* dev, char* outFileName ) {
  * @file   geovis.cpp
  */
 int main(int argc, char* argv[]) {
-    if (argc<3) {
-        fprintf(stderr,"Usage: ./gvsRender <SDL-file> <img-filename> [deviceNo]\n");
+    // Options are separated from the positional arguments.
+    int numThreads = 1;
+    char* journalFileName = NULL;
+    char* reportFormat = NULL;
+    int adaptiveGrid = 0;
+    double adaptiveThreshold = 0.05;
+    double adaptiveBudget = 1.0;
+    char* rayCacheFileName = NULL;
+    double rayCacheMBytes = 1024.0;
+    std::vector<char*> args;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i],"--threads") == 0 && i+1 < argc) {
+            numThreads = atoi(argv[++i]);
+            if (numThreads <= 0) {
+                numThreads = static_cast<int>(std::thread::hardware_concurrency());
+            }
+        } else if (strcmp(argv[i],"--journal") == 0 && i+1 < argc) {
+            journalFileName = argv[++i];
+        } else if (strcmp(argv[i],"--report") == 0 && i+1 < argc) {
+            reportFormat = argv[++i];
+            if (strcmp(reportFormat,"json") != 0 && strcmp(reportFormat,"csv") != 0) {
+                fprintf(stderr,"Report format has to be 'json' or 'csv'.\n");
+                return -1;
+            }
+        } else if (strcmp(argv[i],"--adaptive") == 0 && i+1 < argc) {
+            adaptiveGrid = atoi(argv[++i]);
+        } else if (strcmp(argv[i],"--adaptive-threshold") == 0 && i+1 < argc) {
+            adaptiveThreshold = atof(argv[++i]);
+        } else if (strcmp(argv[i],"--adaptive-budget") == 0 && i+1 < argc) {
+            adaptiveBudget = atof(argv[++i]);
+        } else if (strcmp(argv[i],"--raycache") == 0 && i+1 < argc) {
+            rayCacheFileName = argv[++i];
+        } else if (strcmp(argv[i],"--raycache-mb") == 0 && i+1 < argc) {
+            rayCacheMBytes = atof(argv[++i]);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size()<2) {
+        fprintf(stderr,"Usage: ./gvsRender [--threads N] [--journal file] [--report json|csv] [--adaptive N] [--raycache file] <SDL-file> <img-filename> [deviceNo]\n");
+        fprintf(stderr,"       --threads N      render with N threads (N=0: number of cores)\n");
+        fprintf(stderr,"       --journal file   journal of finished tiles and images; an interrupted\n");
+        fprintf(stderr,"                        render resumes when it is started again\n");
+        fprintf(stderr,"       --report json|csv  write the timing of all tiles to <img-filename>.json|csv\n");
+        fprintf(stderr,"       --adaptive N     render edges with NxN rays per pixel (FilterRGB only)\n");
+        fprintf(stderr,"       --adaptive-threshold t  color difference of an edge (default 0.05)\n");
+        fprintf(stderr,"       --adaptive-budget b     additional rays per pixel on average (default 1)\n");
+        fprintf(stderr,"       --raycache file  keep the light rays in 'file' for the next images; they are\n");
+        fprintf(stderr,"                        reused while observer, camera, and metric do not change\n");
+        fprintf(stderr,"       --raycache-mb m  maximum size of the ray cache in megabytes (default 1024)\n");
         return -1;
     }
 
-    char* inFileName  = argv[1];
-    char* outFileName = argv[2];
+    char* inFileName  = args[0];
+    char* outFileName = args[1];
 
     //LOG.setLogFile("log.txt",0);
 
@@ -72,7 +165,13 @@ int main(int argc, char* argv[]) {
     }
 
     int   devNum = 0;
-    if (argc>3) devNum = atoi(argv[3]);
+    if (args.size()>2) devNum = atoi(args[2]);
+
+    GvsRenderJournal journal;
+    if (journalFileName != NULL && !journal.open(journalFileName)) {
+        return -1;
+    }
+    GvsRenderJournal* journalPtr = journal.isOpen() ? &journal : NULL;
 
     // ---- parse SDL file
     GvsParser* parser = new GvsParser();
@@ -82,25 +181,38 @@ int main(int argc, char* argv[]) {
     // ---- get device
     GvsDevice device;
     parser->getDevice(&device,0);
+
+    GvsRayCache rayCache(rayCacheMBytes);
+    if (rayCacheFileName != NULL) {
+        rayCache.read(rayCacheFileName);
+        device.rayCache = &rayCache;
+    }
     
     if (device.camera->isStereoCam() && parser->getNumDevices() > 1) {
         parser->getDevice(&device, static_cast<unsigned int>(2*devNum+0));
         device.makeChange();
         //device.Print();
-        renderDevice(&device,outFileName);
+        renderDevice(&device,inFileName,2*devNum+0,outFileName,numThreads,journalPtr,reportFormat,
+                     adaptiveGrid,adaptiveThreshold,adaptiveBudget);
         
         parser->getDevice(&device, static_cast<unsigned int>(2*devNum+1));
         device.makeChange();
         //device.Print();
-        renderDevice(&device,outFileName);
+        renderDevice(&device,inFileName,2*devNum+1,outFileName,numThreads,journalPtr,reportFormat,
+                     adaptiveGrid,adaptiveThreshold,adaptiveBudget);
     }
     else {
         parser->getDevice(&device, static_cast<unsigned int>(devNum));
         device.makeChange();
-        renderDevice(&device,outFileName);
+        renderDevice(&device,inFileName,devNum,outFileName,numThreads,journalPtr,reportFormat,
+                     adaptiveGrid,adaptiveThreshold,adaptiveBudget);
     }
     //device.Print();
 
+    if (rayCacheFileName != NULL) {
+        rayCache.write(rayCacheFileName);
+    }
+
 
     // ---- initialize sample manager
     /*
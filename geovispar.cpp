@@ -1,25 +1,42 @@
 #include <mpi.h>
 
+#include <chrono>
 #include <iostream>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include "Dev/GvsDevice.h"
 #include "Dev/GvsSampleMgr.h"
 #include "Img/GvsPicIOEnvelope.h"
 #include "Parser/GvsParser.h"
 #include "Utils/GvsLog.h"
+#include "Utils/GvsProgress.h"
+#include "Utils/GvsStatistics.h"
 
 #include "MpiUtils/GvsMpiDefs.h"
 #include "MpiUtils/MpiTaskManager.h"
+#include "MpiUtils/MpiResultWriter.h"
+
+// Number of tasks a slave holds at the same time: one to render and the next ones to start with.
+#define GVS_MPI_TASKS_PER_NODE  2
 
 
 char* inFileName   = nullptr;
 char* outFileName  = nullptr;
 char* maskFileName = nullptr;
 char* logFileName  = nullptr;
+char* journalFileName = nullptr;
+char* reportFormat = nullptr;
+bool  verbose       = false;
 int   numNodesImage = 1;
+int   tileSize      = 64;
+int   minTileSize   = 8;
+int   numThreads    = 1;
+bool  masterRenders = true;
 int   renderDevice  = -1;
 int   startDevice   = 0;
+int   statImageNr   = -1;   // image of the counters of GvsStatistics
 
 GvsDevice     device;
 GvsSampleMgr  sampleMgr ( &device );
@@ -28,9 +45,9 @@ GvsLog& LOG = GvsLog::instance();
 
 
 void MpiCreateMsgPtType( MPIMsgPt *c, MPI_Datatype *newType ) {
-    MPI_Datatype  type[5]     = {MPI_INT, MPI_INT, MPI_INT, MPI_LONG, MPI_LONG};
-    int           blocklen[5] = { 1, 1, 1, 1, 1 };
-    MPI_Aint      disp[5];
+    MPI_Datatype  type[6]     = {MPI_INT, MPI_INT, MPI_INT, MPI_LONG, MPI_LONG, MPI_DOUBLE};
+    int           blocklen[6] = { 1, 1, 1, 1, 1, 1 };
+    MPI_Aint      disp[6];
     long          base,i;
 
     MPI_Get_address ( c, disp );
@@ -38,15 +55,69 @@ void MpiCreateMsgPtType( MPIMsgPt *c, MPI_Datatype *newType ) {
     MPI_Get_address ( &(c->task),      disp + 2 );
     MPI_Get_address ( &(c->bytes),     disp + 3 );
     MPI_Get_address ( &(c->numPixels), disp + 4 );
+    MPI_Get_address ( &(c->seconds),   disp + 5 );
     base = disp[0];
 
-    for (i = 0; i < 5; i++) {
+    for (i = 0; i < 6; i++) {
         disp[i] -= base;
     }
-    MPI_Type_create_struct ( 5, blocklen, disp, type, newType );
+    MPI_Type_create_struct ( 6, blocklen, disp, type, newType );
+    MPI_Type_commit ( newType );
+}
+
+void MpiCreateTaskMsgType( MPI_Datatype *newType ) {
+    MPI_Type_contiguous ( sizeof(MPITaskMsg)/sizeof(int), MPI_INT, newType );
     MPI_Type_commit ( newType );
 }
 
+/**
+ * @brief sendTask
+ *    Send next task to node. If no task is left, the node is told to stop.
+ * @return true if a task was sent
+ */
+bool sendTask( GvsMpiTaskManager* taskManager, int node, MPI_Datatype taskMsgType ) {
+    MPITaskMsg taskMsg;
+    taskMsg.task = taskManager->getNextTask();
+    if (taskMsg.task >= 0) {
+        taskMsg.imageNr = taskManager->getImageNr(taskMsg.task);
+        taskManager->getViewPort(taskMsg.task,taskMsg.x1,taskMsg.y1,taskMsg.x2,taskMsg.y2);
+        printf("Master: Sending task %d to MPI-Prozess %d \n",taskMsg.task,node);
+    } else {
+        taskMsg.imageNr = taskMsg.x1 = taskMsg.y1 = taskMsg.x2 = taskMsg.y2 = -1;
+    }
+    MPI_Send ( &taskMsg, 1, taskMsgType, node, TAG_START_TASK, MPI_COMM_WORLD );
+    return (taskMsg.task >= 0);
+}
+
+/**
+ * Result of a slave which is sent asynchronously while the next region is rendered.
+ */
+typedef struct _MPIResultBuffer {
+    MPIMsgPt     msgPt;
+    uchar*       region;
+    gvsData*     data;
+    MPI_Request  request[3];
+    int          numRequests;
+} MPIResultBuffer;
+
+/**
+ * @brief waitForResult
+ *    Wait until the result is sent and free its buffers.
+ */
+void waitForResult( MPIResultBuffer &result ) {
+    if (result.numRequests > 0) {
+        MPI_Waitall ( result.numRequests, result.request, MPI_STATUSES_IGNORE );
+    }
+    result.numRequests = 0;
+
+    delete [] result.region;
+    result.region = NULL;
+    if (result.data != NULL) {
+        delete [] result.data;
+        result.data = NULL;
+    }
+}
+
 /**
  * @brief readCmdLineParams
  * @param argc
@@ -56,11 +127,19 @@ void MpiCreateMsgPtType( MPIMsgPt *c, MPI_Datatype *newType ) {
 int readCmdLineParams( int argc, char** argv ) {
     if ( argc < 3 ) {
         fprintf(stderr,"Usage: ./gvsRenderPar [options] <infilename> <outfilename>\n");
-        fprintf(stderr,"\t[-tasks <n>]       tasks per image\n");
+        fprintf(stderr,"\t[-tasks <n>]       minimum number of tiles per image\n");
+        fprintf(stderr,"\t[-tile <n>]        initial tile size (default: 64)\n");
+        fprintf(stderr,"\t[-mintile <n>]     minimum tile size when splitting expensive tiles (default: 8)\n");
+        fprintf(stderr,"\t[-threads <n>]     render threads per process, 0: all cores (default: 1)\n");
+        fprintf(stderr,"\t[-nomaster]        master process does not render\n");
         fprintf(stderr,"\t[-renderdev <n>]   render only device <n>\n");
         fprintf(stderr,"\t[-startdev <n>]    start device <n>\n");
         fprintf(stderr,"\t[-mask <filename>] mask image\n");
         fprintf(stderr,"\t[-log <filename>]  log filename\n");
+        fprintf(stderr,"\t[-journal <filename>] journal of finished regions and images;\n");
+        fprintf(stderr,"\t                   a restarted job skips everything that is finished\n");
+        fprintf(stderr,"\t[-report json|csv] write the timing of all regions to <image>.json|csv\n");
+        fprintf(stderr,"\t[-verbose]         print every rendered region\n");
         fprintf(stderr,"\tinfilename         scene description file\n");
         fprintf(stderr,"\toutfilename        output image base file name\n");
         fprintf(stderr,"\n");
@@ -78,6 +157,30 @@ int readCmdLineParams( int argc, char** argv ) {
                 return 0;
             }
         }
+        else if (!strcmp( argv[i], "-tile")) {
+            if (sscanf( argv[++i], "%d", &tileSize) != 1) {
+                std::cerr << "Error: Integer expected for <n> in '-tile <n>'\n";
+                return 0;
+            }
+        }
+        else if (!strcmp( argv[i], "-mintile")) {
+            if (sscanf( argv[++i], "%d", &minTileSize) != 1) {
+                std::cerr << "Error: Integer expected for <n> in '-mintile <n>'\n";
+                return 0;
+            }
+        }
+        else if (!strcmp( argv[i], "-threads")) {
+            if (sscanf( argv[++i], "%d", &numThreads) != 1) {
+                std::cerr << "Error: Integer expected for <n> in '-threads <n>'\n";
+                return 0;
+            }
+            if (numThreads <= 0) {
+                numThreads = GVS_MAX(static_cast<int>(std::thread::hardware_concurrency()),1);
+            }
+        }
+        else if (!strcmp( argv[i], "-nomaster")) {
+            masterRenders = false;
+        }
         else if (!strcmp( argv[i], "-renderdev")) {
             if (sscanf( argv[++i], "%d", &renderDevice) != 1) {
                 std::cerr << "Error: Integer expected for <n> in '-renderdev <n>'\n";
@@ -96,13 +199,50 @@ int readCmdLineParams( int argc, char** argv ) {
         else if (!strcmp( argv[i], "-log")) {
             logFileName = argv[++i];
         }
+        else if (!strcmp( argv[i], "-journal")) {
+            journalFileName = argv[++i];
+        }
+        else if (!strcmp( argv[i], "-report")) {
+            reportFormat = argv[++i];
+            if (strcmp(reportFormat,"json") && strcmp(reportFormat,"csv")) {
+                std::cerr << "Error: 'json' or 'csv' expected in '-report <format>'\n";
+                return 0;
+            }
+        }
+        else if (!strcmp( argv[i], "-verbose")) {
+            verbose = true;
+        }
     }
     return 1;
 }
 
 
+/**
+ * @brief renderRegion
+ *    Render the region of the sample manager with all render threads.
+ */
+void renderRegion ( ) {
+    if (numThreads > 1) {
+        // Small tiles, so that all threads are busy even for small regions.
+        sampleMgr.renderParallel(numThreads,8);
+    } else {
+        sampleMgr.putFirstPixel();
+        while (sampleMgr.putNextPixel());
+    }
+}
+
+/**
+ * @brief wallTime
+ * @return wall clock time in seconds
+ */
+double wallTime ( ) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void RayTraceRegion ( int x1, int y1, int x2, int y2, int image, uchar region[] ) {
-    if (device.camEye == gvsCamEyeLeft) {
+    if (!verbose) {
+        // progress is reported by the master
+    } else if (device.camEye == gvsCamEyeLeft) {
         fprintf(stderr,"Raytracing-Region: (%4i,%4i) - (%4i,%4i) of image %4i  (left)\n",x1+1,y1+1,x2+1,y2+1,image);
     } else if (device.camEye == gvsCamEyeRight) {
         fprintf(stderr,"Raytracing-Region: (%4i,%4i) - (%4i,%4i) of image %4i  (right)\n",x1+1,y1+1,x2+1,y2+1,image);
@@ -111,8 +251,7 @@ void RayTraceRegion ( int x1, int y1, int x2, int y2, int image, uchar region[]
     }
 
     sampleMgr.setRegion(m4d::ivec2(x1,y1),m4d::ivec2(x2,y2));
-    sampleMgr.putFirstPixel();
-    while (sampleMgr.putNextPixel());
+    renderRegion();
 
     sampleMgr.extractRegion(x1,y1,x2,y2,region);
 }
@@ -128,11 +267,12 @@ void RayTraceRegion ( int x1, int y1, int x2, int y2, int image, uchar region[]
  * @param regData
  */
 void RayTraceRegionData ( int x1, int y1, int x2, int y2, int image, uchar region[], gvsData* regData ) {
-    fprintf(stderr,"Raytracing-RegionData: (%4i,%4i) - (%4i,%4i) of image %4i\n",x1+1,y1+1,x2+1,y2+1,image);
+    if (verbose) {
+        fprintf(stderr,"Raytracing-RegionData: (%4i,%4i) - (%4i,%4i) of image %4i\n",x1+1,y1+1,x2+1,y2+1,image);
+    }
 
     sampleMgr.setRegion(m4d::ivec2(x1,y1),m4d::ivec2(x2,y2));        
-    sampleMgr.putFirstPixel();    
-    while (sampleMgr.putNextPixel());
+    renderRegion();
 
     sampleMgr.extractRegionData(x1,y1,x2,y2,region,regData);
 }
@@ -146,6 +286,110 @@ void printMPIStatus( MPI_Status &status ) {
 }
 
 
+/**
+ * @brief printStatistics
+ *    Print the hot-path counters of this process for the image rendered last
+ *    and reset them. Regions of different images may alternate; then, the
+ *    counters cover less than an image.
+ * @param node  rank of this process
+ */
+void printStatistics( int node ) {
+    if (GvsStatistics::isEnabled() && statImageNr >= 0) {
+        fprintf(stderr,"Node %3i, image %d: ",node,statImageNr);
+        GvsStatistics::Print();
+    }
+    GvsStatistics::reset();
+}
+
+
+/**
+ * @brief renderTask
+ *    Render region of a task with all render threads of this process.
+ * @param taskManager  task manager
+ * @param taskMsg      task to be rendered
+ * @param msgPt        result message (size of the buffers and rendering time)
+ * @param region       new region buffer
+ * @param data         new data buffer or NULL
+ */
+void renderTask( GvsMpiTaskManager* taskManager, const MPITaskMsg &taskMsg, MPIMsgPt &msgPt, uchar* &region, gvsData* &data ) {
+    if (taskMsg.imageNr != statImageNr) {
+        printStatistics(msgPt.node);
+        statImageNr = taskMsg.imageNr;
+    }
+    taskManager->createScene(taskMsg.imageNr, &device);
+    double startTime = wallTime();
+
+    int x1 = taskMsg.x1;
+    int y1 = taskMsg.y1;
+    int x2 = taskMsg.x2;
+    int y2 = taskMsg.y2;
+    long numBytes  = sampleMgr.calcRegionBytes ( x1, y1, x2, y2 );
+    long numPixels = sampleMgr.calcRegionPixels( x1, y1, x2, y2 );
+    long numData   = sampleMgr.calcRegionData(x1, y1, x2, y2);
+
+    region = new uchar[numBytes];
+    assert(region!=NULL);
+
+    data = NULL;
+    if (numData > 0) {
+        data = new gvsData[numData];
+        assert(data != NULL);
+    }
+
+    if (verbose) {
+        char hostname[1024];
+        gethostname(hostname,1024);
+        fprintf(stderr,"  Node %3i (%s): ",msgPt.node,hostname);
+    }
+    GvsCamFilter filter = device.camera->getCamFilter();
+
+    int imgNr = taskMsg.imageNr + taskManager->getStartDevNr();
+    if (device.camEye == gvsCamEyeLeft || device.camEye == gvsCamEyeRight) {
+        imgNr = taskMsg.imageNr/2 + taskManager->getStartDevNr();
+    }
+
+    if ((filter == gvsCamFilterRGBpdz) ||
+            (filter == gvsCamFilterRGBjac) ||
+            (filter == gvsCamFilterRGBpt) ||
+            (filter == gvsCamFilterRGBIntersec) ||
+            (filter == gvsCamFilterRGBcost)) {
+
+        msgPt.numPixels = numPixels;
+        RayTraceRegionData(x1,y1,x2,y2, imgNr, region, data);
+    } else {
+        msgPt.numPixels = -1;
+        RayTraceRegion(x1,y1,x2,y2, imgNr, region);
+    }
+
+    msgPt.continueCalc = 1;
+    msgPt.bytes   = numBytes;
+    msgPt.task    = taskMsg.task;
+    msgPt.seconds = wallTime() - startTime;
+}
+
+/**
+ * @brief renderOnMaster
+ *    The master renders tasks in a separate thread while it distributes
+ *    the other tasks. This thread must not call any MPI function.
+ * @param taskManager  task manager
+ * @param writer       result writer
+ */
+void renderOnMaster( GvsMpiTaskManager* taskManager, GvsMpiResultWriter* writer ) {
+    MPITaskMsg taskMsg;
+    while ((taskMsg.task = taskManager->getNextTask()) >= 0) {
+        taskMsg.imageNr = taskManager->getImageNr(taskMsg.task);
+        taskManager->getViewPort(taskMsg.task,taskMsg.x1,taskMsg.y1,taskMsg.x2,taskMsg.y2);
+
+        MPIMsgPt  msgPt;
+        uchar*    region;
+        gvsData*  data;
+        msgPt.node = 0;
+        renderTask(taskManager, taskMsg, msgPt, region, data);
+        writer->push(taskMsg.task, region, data, msgPt.seconds, 0);
+    }
+    printStatistics(0);
+}
+
 /**
  * @brief main
  * @param argc
@@ -166,26 +410,40 @@ int main(int argc, char* argv[]) {
 
     int  myrank;
     int  ranksize;
+    int  threadSupport;
     MPI_Status  status;
 
-    // Initialize MPI
-    MPI_Init(&argc,&argv);
+    // Initialize MPI; only the main thread calls MPI functions.
+    MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&threadSupport);
     MPI_Comm_rank( MPI_COMM_WORLD, &myrank );     // my place in MPI system
     MPI_Comm_size( MPI_COMM_WORLD, &ranksize );   // size of MPI system
 
-    if (ranksize<2) {
-        fprintf(stderr,"Needs at least two nodes!\n");
+    if (ranksize<2 && !masterRenders) {
+        fprintf(stderr,"Needs at least two nodes if the master does not render!\n");
         MPI_Finalize();
         return -2;
     }
 
-    int   nrNodes       = ranksize-1;   // master node does not render
-    int   nrActiveNodes = 0;            // until now, no node is active
+    // number of rendering processes
+    int   nrNodes       = masterRenders ? ranksize : ranksize-1;
 
     GvsMpiTaskManager* taskManager;
     taskManager = new GvsMpiTaskManager(inFileName,outFileName);
     taskManager->setStartDevice(startDevice);
     taskManager->setRenderDevice(renderDevice);
+    taskManager->setTileSize(tileSize,minTileSize);
+
+    // Only the master schedules tasks and writes images.
+    GvsRenderJournal journal;
+    if (myrank == 0 && journalFileName != NULL) {
+        if (!journal.open(journalFileName)) {
+            MPI_Finalize();
+            return -1;
+        }
+        journal.Print();
+        taskManager->setJournal(&journal);
+    }
+
     if (!taskManager->initialize(nrNodes,numNodesImage)) {
         MPI_Finalize();
         return -1;
@@ -197,7 +455,6 @@ int main(int argc, char* argv[]) {
         sampleMgr.setMask(maskFileName);
     }
 
-    int actTask = 0;
     MPI_Barrier ( MPI_COMM_WORLD );
 
     int  namelen;
@@ -215,166 +472,144 @@ int main(int argc, char* argv[]) {
     MPIMsgPt       msgPt;
     MpiCreateMsgPtType( &msgPt, &MPI_MsgPt );
 
+    MPI_Datatype   MPI_TaskMsg;
+    MpiCreateTaskMsgType( &MPI_TaskMsg );
+
     // --------------------------------------------------------------
     //                        M A S T E R
     // --------------------------------------------------------------
     if (myrank == 0) {
         taskManager->Print();
 
-        for ( int i = 1; i < ranksize; i++ ) {
-            actTask = taskManager->getNextAvailableTask(actTask);
-            printf("Master: Sending task %d to MPI-Prozess %d \n",actTask,i);
+        // Inserted regions are counted; a reporter thread prints the progress.
+        GvsProgress progress;
+        progress.start("Master:", taskManager->getNumPixelsLeft(), 2.0);
+        taskManager->setProgress(&progress, reportFormat != NULL ? reportFormat : "");
 
-            if (actTask < taskManager->getNumTasks() ) {
-                taskManager->activateTask(actTask);
+        // Regions are inserted and images are written by the writer thread.
+        GvsMpiResultWriter writer(taskManager);
+        writer.start();
 
-                MPI_Send( &actTask, 1, MPI_INT, i, TAG_START_TASK, MPI_COMM_WORLD);
-                nrActiveNodes++;
-            }
-            else {
-                int dummyTask = -1;
-                MPI_Send ( &dummyTask, 1, MPI_INT, i, TAG_START_TASK, MPI_COMM_WORLD );
-                MPI_Recv ( &msgPt, 1, MPI_MsgPt, i, TAG_RESULT, MPI_COMM_WORLD, &status );
-            }
+        // The master renders whenever it is not busy with communication.
+        std::thread masterRenderer;
+        if (masterRenders) {
+            masterRenderer = std::thread(renderOnMaster, taskManager, &writer);
         }
-    }
-
-    // --------------------------------------------------------------
-    //                        S L A V E
-    // --------------------------------------------------------------
-    else {
-        do {
-            MPI_Recv( &actTask, 1, MPI_INT, 0, TAG_START_TASK, MPI_COMM_WORLD, &status);
-            if (actTask >= 0) {
-                taskManager->createScene(actTask, &device);
-
-                int x1,y1,x2,y2;
-                taskManager->getViewPort(actTask,x1,y1,x2,y2);
-                long numBytes  = sampleMgr.calcRegionBytes ( x1, y1, x2, y2 );
-                long numPixels = sampleMgr.calcRegionPixels( x1, y1, x2, y2 );
-                long numData   = sampleMgr.calcRegionData(x1, y1, x2, y2);
-
-                uchar* regionBuffer = new uchar[numBytes];
-                assert(regionBuffer!=NULL);
-
-                gvsData* regionData = NULL;
-                if (numData > 0) {
-                    regionData = new gvsData[numData];
-                    assert(regionData != NULL);
-                }
-
-
-                char hostname[1024];
-                gethostname(hostname,1024);
 
-                fprintf(stderr,"  Node %3i (%s): ",myrank,hostname);
-                GvsCamFilter filter = device.camera->getCamFilter();
+        std::vector<MPIMsgPt>     results(ranksize);
+        std::vector<MPI_Request>  resultRequests(ranksize,MPI_REQUEST_NULL);
+        std::vector<int>          numPending(ranksize,0);
+        std::vector<bool>         stopped(ranksize,false);
 
-                int imgNr = taskManager->getImageNr(actTask) + taskManager->getStartDevNr();
-                if (device.camEye == gvsCamEyeLeft || device.camEye == gvsCamEyeRight) {
-                    imgNr = taskManager->getImageNr(actTask)/2 + taskManager->getStartDevNr();
+        // Every node gets several tasks, so it can start with the next one right away.
+        for ( int i = 1; i < ranksize; i++ ) {
+            for ( int k = 0; k < GVS_MPI_TASKS_PER_NODE && !stopped[i]; k++ ) {
+                if (sendTask(taskManager,i,MPI_TaskMsg)) {
+                    numPending[i]++;
+                } else {
+                    stopped[i] = true;
                 }
+            }
+            if (numPending[i] > 0) {
+                MPI_Irecv ( &results[i], 1, MPI_MsgPt, i, TAG_RESULT, MPI_COMM_WORLD, &resultRequests[i] );
+            }
+        }
 
-                if ((filter == gvsCamFilterRGBpdz) ||
-                        (filter == gvsCamFilterRGBjac) ||
-                        (filter == gvsCamFilterRGBpt) ||
-                        (filter == gvsCamFilterRGBIntersec)) {
+        while (true) {
+            int fromNode;
+            MPI_Waitany ( ranksize, &resultRequests[0], &fromNode, &status );
+            if (fromNode == MPI_UNDEFINED) {
+                break;
+            }
+            numPending[fromNode]--;
 
-                    msgPt.numPixels = numPixels;
-                    RayTraceRegionData(x1,y1,x2,y2, imgNr, regionBuffer, regionData);
+            // Refill the task queue of the node before receiving the region.
+            if (!stopped[fromNode]) {
+                if (sendTask(taskManager,fromNode,MPI_TaskMsg)) {
+                    numPending[fromNode]++;
                 } else {
-                    msgPt.numPixels = -1;
-                    RayTraceRegion(x1,y1,x2,y2, imgNr, regionBuffer);
+                    stopped[fromNode] = true;
                 }
+            }
 
-                // send raytraced region back to MASTER
-                msgPt.continueCalc = 1;
-                msgPt.node  = myrank;
-                msgPt.bytes = numBytes;
-                msgPt.task  = actTask;
+            int  currTask  = results[fromNode].task;
+            long numBytes  = results[fromNode].bytes;
+            long numPixels = results[fromNode].numPixels;
+            double seconds = results[fromNode].seconds;
 
-                MPI_Send ( &msgPt, 1, MPI_MsgPt, 0, TAG_RESULT, MPI_COMM_WORLD);
-                MPI_Send ( regionBuffer, numBytes, MPI_UNSIGNED_CHAR, 0, TAG_REGION_BUFFER, MPI_COMM_WORLD );
-                delete [] regionBuffer;
+            assert ( numBytes >= 0);
+            uchar* regionBuffer = new uchar[numBytes];
+            gvsData* regionData = NULL;
 
-                if (msgPt.numPixels > 0) {
-                    MPI_Send ( regionData, numPixels*sizeof(gvsData), MPI_BYTE, 0, TAG_DATA_BUFFER, MPI_COMM_WORLD );
-                }
-                if (regionData!=NULL) {
-                    delete [] regionData;
-                }
+            MPI_Recv ( regionBuffer, numBytes, MPI_UNSIGNED_CHAR, fromNode, TAG_REGION_BUFFER, MPI_COMM_WORLD, &status );
+            if (numPixels > 0) {
+                regionData = new gvsData[numPixels];
+                MPI_Recv ( regionData, numPixels*sizeof(gvsData), MPI_BYTE, fromNode, TAG_DATA_BUFFER, MPI_COMM_WORLD, &status);                    
             }
-            else {
-                fprintf(stderr,"Node %3i: FINISHED\n",myrank);
-
-                msgPt.continueCalc = 0;
-                msgPt.node  = myrank;
-                msgPt.bytes = -1;
-                msgPt.task  = actTask;
-                msgPt.numPixels = -1;
 
-                MPI_Send ( &msgPt, 1, MPI_MsgPt, 0, TAG_RESULT, MPI_COMM_WORLD );
+            if (numPending[fromNode] > 0) {
+                MPI_Irecv ( &results[fromNode], 1, MPI_MsgPt, fromNode, TAG_RESULT, MPI_COMM_WORLD, &resultRequests[fromNode] );
             }
+
+            writer.push( currTask, regionBuffer, regionData, seconds, fromNode );
         }
-        while (actTask >= 0);
+
+        if (masterRenderer.joinable()) {
+            masterRenderer.join();
+        }
+        writer.finish();
+        progress.stop();
+        fprintf(stderr,"Master: %d images written.\n",writer.getNumImagesWritten());
     }
 
     // --------------------------------------------------------------
-    //                        M A S T E R
+    //                        S L A V E
     // --------------------------------------------------------------
-    if (myrank == 0) {
-        while (nrActiveNodes > 0) {
-            //bool written = false;
-            MPI_Recv ( &msgPt, 1, MPI_MsgPt, MPI_ANY_SOURCE, TAG_RESULT, MPI_COMM_WORLD, &status );
-            nrActiveNodes--;
-
-            if (msgPt.continueCalc) {
-                int  currTask  = msgPt.task;
-                int  fromNode  = msgPt.node;
-                long numBytes  = msgPt.bytes;
-                long numPixels = msgPt.numPixels;
-
-                assert ( numBytes >= 0);
-                uchar* regionBuffer = new uchar[numBytes];
-                gvsData* regionData = NULL;
-
-                MPI_Recv ( regionBuffer, numBytes, MPI_UNSIGNED_CHAR, fromNode, TAG_REGION_BUFFER, MPI_COMM_WORLD, &status );
-                if (numPixels > 0) {
-                    regionData = new gvsData[numPixels];
-                    MPI_Recv ( regionData, numPixels*sizeof(gvsData), MPI_BYTE, fromNode, TAG_DATA_BUFFER, MPI_COMM_WORLD, &status);                    
-                }
-
-                taskManager->insertRegion( currTask, regionBuffer, regionData);
-
-                delete [] regionBuffer;
-                if (regionData!=NULL) {
-                    delete [] regionData;
-                }
-
-                //written = taskManager->writeImageFileIfPossible( currTask );
-                taskManager->writeImageFileIfPossible( currTask );
-
-                actTask = taskManager->getNextAvailableTask(actTask);
-                if (actTask < taskManager->getNumTasks())
-                {
-                    taskManager->activateTask(actTask);
-                    MPI_Send ( &actTask, 1, MPI_INT, fromNode, TAG_START_TASK, MPI_COMM_WORLD );
+    else {
+        MPITaskMsg       taskMsg[2];
+        MPI_Request      taskRequest;
+        MPIResultBuffer  results[2];
+        for ( int i = 0; i < 2; i++ ) {
+            results[i].region = NULL;
+            results[i].data   = NULL;
+            results[i].numRequests = 0;
+        }
 
-                    nrActiveNodes++;
-                }
-                else
-                {
-                    int dummyTask = -1;
-                    MPI_Send ( &dummyTask, 1, MPI_INT, fromNode, TAG_START_TASK, MPI_COMM_WORLD );
-                    MPI_Recv ( &msgPt, 1, MPI_MsgPt, fromNode, TAG_RESULT, MPI_COMM_WORLD, &status );
-                }
+        int curr = 0;
+        MPI_Recv( &taskMsg[curr], 1, MPI_TaskMsg, 0, TAG_START_TASK, MPI_COMM_WORLD, &status);
+        while (taskMsg[curr].task >= 0) {
+            // Receive next task while rendering the current one.
+            MPI_Irecv( &taskMsg[1-curr], 1, MPI_TaskMsg, 0, TAG_START_TASK, MPI_COMM_WORLD, &taskRequest );
+
+            // The result buffer is reused when its previous result has been sent.
+            MPIResultBuffer &result = results[curr];
+            waitForResult(result);
+
+            result.msgPt.node = myrank;
+            renderTask(taskManager, taskMsg[curr], result.msgPt, result.region, result.data);
+            long numBytes  = result.msgPt.bytes;
+            long numPixels = result.msgPt.numPixels;
+
+            // send raytraced region back to MASTER without waiting
+            MPI_Isend ( &result.msgPt, 1, MPI_MsgPt, 0, TAG_RESULT, MPI_COMM_WORLD, &result.request[result.numRequests++] );
+            MPI_Isend ( result.region, numBytes, MPI_UNSIGNED_CHAR, 0, TAG_REGION_BUFFER, MPI_COMM_WORLD, &result.request[result.numRequests++] );
+            if (result.msgPt.numPixels > 0) {
+                MPI_Isend ( result.data, numPixels*sizeof(gvsData), MPI_BYTE, 0, TAG_DATA_BUFFER, MPI_COMM_WORLD, &result.request[result.numRequests++] );
             }
+
+            MPI_Wait ( &taskRequest, &status );
+            curr = 1-curr;
         }
+
+        waitForResult(results[0]);
+        waitForResult(results[1]);
+        printStatistics(myrank);
+        fprintf(stderr,"Node %3i: FINISHED\n",myrank);
     }
 
     // Clean up MPI
     MPI_Type_free(&MPI_MsgPt);
+    MPI_Type_free(&MPI_TaskMsg);
     MPI_Finalize();
     return 0;
 }
-
@@ -0,0 +1,122 @@
+/**
+ * @file    meshbench.cpp
+ *
+ *  This file is part of GeoViS.
+ *
+ *  Compares the bounding volume hierarchy of GvsOBJMesh with the brute-force
+ *  test of all faces. Random line segments in object space are intersected
+ *  with the mesh by both methods; timings and mismatches are reported.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Obj/MeshObj/GvsOBJMesh.h"
+#include "Utils/GvsLog.h"
+
+#ifndef _WIN32
+GvsLog& LOG = GvsLog::instance();
+#else
+m4d::MetricDatabase* m4d::MetricDatabase::m_instance = nullptr;
+#endif
+
+typedef std::chrono::steady_clock  bench_clock;
+
+static double secondsSince( const bench_clock::time_point &start ) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+
+/**
+ * @brief Main program for the mesh intersection benchmark.
+ * @param argc
+ * @param argv
+ * @return
+ *
+ *   ./gvsMeshBench  objPath  objFile  [numSegments]  [segLength]
+ *
+ *   The segment length is given relative to the diagonal of the mesh.
+ */
+int main(int argc, char* argv[]) {
+    if (argc<3) {
+        fprintf(stderr,"Usage: ./gvsMeshBench <obj-path> <obj-file> [numSegments] [segLength]\n");
+        return -1;
+    }
+
+    int    numSegments = (argc>3) ? atoi(argv[3]) : 10000;
+    double segLength   = (argc>4) ? atof(argv[4]) : 0.05;
+
+    bench_clock::time_point start = bench_clock::now();
+    GvsOBJMesh* mesh = new GvsOBJMesh(argv[1],argv[2],NULL,NULL);
+    double loadTime = secondsSince(start);
+
+    if (mesh->getNumFaces()==0) {
+        fprintf(stderr,"Mesh %s/%s has no faces.\n",argv[1],argv[2]);
+        delete mesh;
+        return -1;
+    }
+
+    m4d::vec3 lower, upper;
+    mesh->getVertexBounds(lower,upper);
+    m4d::vec3 center = 0.5*(lower + upper);
+    m4d::vec3 diag   = upper - lower;
+    double length = segLength * diag.getNorm();
+
+    // Segments start in a slightly enlarged bounding box and point in random directions.
+    std::mt19937 rng(4711);
+    std::uniform_real_distribution<double> uni(-0.6,0.6);
+    std::normal_distribution<double> gauss(0.0,1.0);
+
+    std::vector<m4d::vec3> p0(numSegments), p1(numSegments);
+    for (int i=0; i<numSegments; i++) {
+        m4d::vec3 dir(gauss(rng),gauss(rng),gauss(rng));
+        if (dir.isZero()) {
+            dir = m4d::vec3(1.0,0.0,0.0);
+        }
+        p0[i] = center + m4d::vec3(uni(rng)*diag.x(0),uni(rng)*diag.x(1),uni(rng)*diag.x(2));
+        p1[i] = p0[i] + length*dir.getNormalized();
+    }
+
+    std::vector<int>    faceBF(numSegments), faceBVH(numSegments);
+    std::vector<double> alphaBF(numSegments), alphaBVH(numSegments);
+
+    start = bench_clock::now();
+    for (int i=0; i<numSegments; i++) {
+        mesh->intersectSegment(p0[i],p1[i],alphaBF[i],faceBF[i],false);
+    }
+    double timeBF = secondsSince(start);
+
+    start = bench_clock::now();
+    for (int i=0; i<numSegments; i++) {
+        mesh->intersectSegment(p0[i],p1[i],alphaBVH[i],faceBVH[i],true);
+    }
+    double timeBVH = secondsSince(start);
+
+    int numHits = 0;
+    int numMismatches = 0;
+    for (int i=0; i<numSegments; i++) {
+        if (faceBF[i]>=0) {
+            numHits++;
+        }
+        if (faceBF[i]!=faceBVH[i] || (faceBF[i]>=0 && fabs(alphaBF[i]-alphaBVH[i])>1e-12)) {
+            numMismatches++;
+        }
+    }
+
+    fprintf(stderr,"Mesh:          %s/%s\n",argv[1],argv[2]);
+    fprintf(stderr,"# faces:       %d\n",mesh->getNumFaces());
+    fprintf(stderr,"load + build:  %.3f s\n",loadTime);
+    fprintf(stderr,"# segments:    %d  (length %g)\n",numSegments,length);
+    fprintf(stderr,"# hits:        %d\n",numHits);
+    fprintf(stderr,"brute force:   %.3f s  (%.3f us/segment)\n",timeBF,1e6*timeBF/numSegments);
+    fprintf(stderr,"bvh:           %.3f s  (%.3f us/segment)\n",timeBVH,1e6*timeBVH/numSegments);
+    if (timeBVH>0.0) {
+        fprintf(stderr,"speedup:       %.1f\n",timeBF/timeBVH);
+    }
+    fprintf(stderr,"# mismatches:  %d\n",numMismatches);
+
+    delete mesh;
+    return (numMismatches==0) ? 0 : 1;
+}
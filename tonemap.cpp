@@ -0,0 +1,75 @@
+/**
+ * @file    tonemap.cpp
+ *
+ *  This file is part of GeoViS.
+ *
+ *  Tone maps a high dynamic range image (pfm, exr) written by gvsRender into
+ *  a low dynamic range image. Exposure and gamma can be changed without
+ *  rendering the scene again.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Img/GvsChannelImg2D.h"
+#include "Img/GvsHdrImg2D.h"
+#include "Img/GvsPicIOEnvelope.h"
+#include "Utils/GvsLog.h"
+
+#ifndef _WIN32
+GvsLog& LOG = GvsLog::instance();
+#else
+m4d::MetricDatabase* m4d::MetricDatabase::m_instance = nullptr;
+#endif
+
+
+/**
+ * @brief Main program for tone mapping.
+ * @param argc
+ * @param argv
+ * @return
+ *
+ *   ./gvsToneMap  [-exposure <stops>]  [-gamma <g>]  [-reinhard]  <hdr-file>  <img-file>
+ */
+int main(int argc, char* argv[]) {
+    double exposure = 0.0;
+    double gamma    = 1.0;
+    GvsToneMapOp op = gvsToneMapClamp;
+
+    std::vector<char*> args;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i],"-exposure") == 0 && i+1 < argc) {
+            exposure = atof(argv[++i]);
+        } else if (strcmp(argv[i],"-gamma") == 0 && i+1 < argc) {
+            gamma = atof(argv[++i]);
+        } else if (strcmp(argv[i],"-reinhard") == 0) {
+            op = gvsToneMapReinhard;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() != 2 || gamma <= 0.0) {
+        fprintf(stderr,"Usage: ./gvsToneMap [-exposure <stops>] [-gamma <g>] [-reinhard] <hdr-file> <img-file>\n");
+        return -1;
+    }
+
+    GvsPicIOEnvelope picIO;
+    if (!GvsPicIOEnvelope::isHdrExtension(args[0])) {
+        fprintf(stderr,"%s is not a high dynamic range image (pfm, exr).\n",args[0]);
+        return -1;
+    }
+    if (!picIO.testImageExtension(args[1])) {
+        fprintf(stderr,"file ending unknown!\n");
+        return -1;
+    }
+
+    GvsHdrImg2D hdrImg;
+    if (!picIO.readHdrImg(hdrImg,args[0])) {
+        return -1;
+    }
+
+    GvsChannelImg2D ldrImg;
+    hdrImg.toneMap(ldrImg,exposure,gamma,op);
+    return picIO.writeChannelImg(ldrImg,args[1]) ? 0 : -1;
+}